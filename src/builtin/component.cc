@@ -57,6 +57,12 @@ Component::send_openflow_command(const datapathid& datapath_id,
 				      (ofp_header *) of_raw.get(), block);
 }
 
+int
+Component::send_openflow_command(const datapathid& datapath_id,
+                                 std::auto_ptr<Buffer>& b, bool block) const {
+    return nox::send_openflow_command(datapath_id, b, block);
+}
+
 int
 Component::send_openflow_msg(const datapathid& dpid, struct ::ofl_msg_header *msg, uint32_t xid, bool block) const {
     return nox::send_openflow_msg(dpid, msg, xid, block);
@@ -112,6 +118,16 @@ Component::register_handler(const Event_name& event_name,
     }
 }
 
+void
+Component::register_shard_handler(const Event_name& event_name,
+                                  const Event_handler& h) const {
+    EventDispatcherComponent* dispatcher;
+    resolve<EventDispatcherComponent>(dispatcher);
+    if (!dispatcher->register_handler(ctxt->get_name(), event_name, h, true)) {
+        throw runtime_error("Event '" + event_name +"' doesn't exist.");
+    }
+}
+
 Component::Rule_id
 Component::register_handler_on_match(uint32_t priority, 
                                      const Packet_expr &expr, 
@@ -142,22 +142,26 @@ EventDispatcherComponent::register_event(const Event_name& name) const {
 bool
 EventDispatcherComponent::register_handler(const Component_name& filter,
                                            const Event_name& name,
-                                           const Event_handler& h) const {
+                                           const Event_handler& h,
+                                           bool shard_safe) const {
     if (events.find(name) == events.end()) {
         return false;
     }
 
-    if (filter_chains.find(name) == filter_chains.end()) {
-        nox::register_handler(name, h, 0);
-    } else {
+    int order = 0;
+    if (filter_chains.find(name) != filter_chains.end()) {
         EventFilterChain& chain = filter_chains[name];
-        if (chain.find(filter) == chain.end()) {
-            nox::register_handler(name, h, 0);
-        } else {
-            nox::register_handler(name, h, chain[filter]);
+        if (chain.find(filter) != chain.end()) {
+            order = chain[filter];
         }
     }
 
+    if (shard_safe) {
+        nox::register_shard_handler(name, h, order);
+    } else {
+        nox::register_handler(name, h, order);
+    }
+
     return true;
 }
 
@@ -63,10 +63,12 @@ public:
     /* Register an event */
     bool register_event(const Event_name&) const;
        
-    /* Register an event handler */
+    /* Register an event handler.  If 'shard_safe' is true, the handler may
+     * run in a datapath's shard, see nox::register_shard_handler(). */
     bool register_handler(const container::Component_name&,
                           const Event_name&,
-                          const Event_handler&) const;
+                          const Event_handler&,
+                          bool shard_safe = false) const;
     
 private:
     EventDispatcherComponent(const container::Context*,const json_object*);
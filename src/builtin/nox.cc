@@ -22,6 +22,7 @@
 #include <boost/shared_array.hpp>
 #include <errno.h>
 #include <map>
+#include <vector>
 #include <signal.h>
 #include <inttypes.h>
 #include "kernel.hh" 
@@ -30,6 +31,7 @@
 #include "datapath-join.hh"
 #include "datapath-leave.hh"
 #include "event-dispatcher.hh"
+#include "mailbox.hh"
 #include "ofp-msg-event.hh"
 #include "openflow.hh"
 #include "openflow/nicira-ext.h"
@@ -45,6 +47,7 @@
 #include "../oflib/ofl-actions.h"
 #include "../oflib/ofl-structs.h"
 #include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-print.h"
 
 namespace vigil {
 namespace nox {
@@ -59,6 +62,81 @@ static Event_dispatcher event_dispatcher;
 static Timer_dispatcher timer_dispatcher;
 static Switch_Auth *switch_authenticator = NULL; 
 
+/* Dispatch budget for a single Conn::poll() call.  A connection that still
+ * has messages queued once either limit is reached yields back to the poll
+ * loop, which then services every other pollable before coming back to it. */
+static unsigned int dispatch_max_msgs = 64;
+static unsigned int dispatch_max_usecs = 1000;
+static Dispatch_stats dispatch_stats;
+
+/* Per-poll budgets for the main Event_dispatcher's lanes, 0 for no limit.
+ * Echo, error and port status messages go in the high lane so that a burst
+ * of packet-ins, which go in the low lane, cannot delay them, except behind
+ * the same datapath's earlier events.  See set_default_lanes(). */
+static unsigned int lane_budgets[Event_dispatcher::N_LANES] = { 0, 256, 64 };
+
+/* Sharded mode.
+ *
+ * With set_shards(K) for K > 0, each datapath is assigned to one of K shards
+ * by hashing its datapath id.  A shard is a thread group of its own, so the
+ * shards run in parallel with each other and with the main thread group.
+ * Connections are still serviced by the main Poll_loop, since their FSMs
+ * belong to co_group_coop, but every message received is handed to the
+ * datapath's shard, which decodes it and dispatches it to the handlers
+ * registered with register_shard_handler().  Unless one of them returns
+ * STOP, the event is then handed back to the main thread group and posted
+ * to the handlers registered with register_handler().
+ *
+ * Datapath_join and Datapath_leave events take the same path as the
+ * datapath's messages, and each hop is a FIFO, so the events for any one
+ * datapath reach both kinds of handlers in the order they occurred.  The
+ * last hop, the main Event_dispatcher, would let a high lane event such as
+ * a leave or a port status pass the datapath's queued packet-ins, so a
+ * datapath's events are posted to it with post_in_order(), keyed on the
+ * datapath id. */
+static const int N_SHARD_THREADS = 2;
+
+class Shard {
+public:
+    Shard();
+
+    void start();
+    bool is_current() const { return co_group_self() == group; }
+
+    void post(const Mailbox::Callback& cb) { inbox.post(cb); }
+
+    /* The shard's dispatcher is only touched from within the shard, so
+     * handlers are added through its inbox like everything else. */
+    void add_handler(const Event_name& name,
+                     const Event_dispatcher::Handler& handler, int order) {
+        Event_dispatcher::Handler_id (Event_dispatcher::*add)(
+            Event_type, const Event_dispatcher::Handler&, int)
+            = &Event_dispatcher::add_handler;
+        post(boost::bind(add, &dispatcher, event_type(name), handler, order));
+    }
+
+    void handle_msg(datapathid, Buffer*, boost::shared_ptr<Ofp_msg_arenas>);
+    void handle_event(datapathid, Event*);
+private:
+    co_group* group;
+    Mailbox inbox;
+    Event_dispatcher dispatcher;
+    Poll_loop* loop;
+
+    void run();
+};
+
+static unsigned int n_shards;
+static std::vector<Shard*> shards;
+
+/* Work posted by the shards to the main thread group. */
+static Mailbox* main_inbox;
+
+static Shard* current_shard();
+static Shard* shard_for(const datapathid&);
+static void post_datapath_event(const datapathid&, Event*);
+static void report_decode_error(datapathid, const Ofp_msg&, ofl_err);
+
 class Conn
     : public Pollable {
 public:
@@ -77,7 +155,17 @@ private:
     bool closing;
     int poll_cnt;
 
+    /* Arenas that received messages are decoded into.  Shared with the
+     * messages, which may outlive the connection. */
+    boost::shared_ptr<Ofp_msg_arenas> arenas;
+
+    /* Statistics. */
+    uint64_t n_polls;
+    uint64_t n_msgs;
+    uint64_t n_exhausted;
+
     bool do_poll();
+    void dispatch(std::auto_ptr<Buffer>&);
 };
 
 // DPID to connection mappings 
@@ -89,8 +177,14 @@ Conn::Conn(boost::shared_ptr<Openflow_connection> oconn_,
     : oconn(oconn_),
       disconnected(disconnected_),
       closing(false),
-      poll_cnt(0)
+      poll_cnt(0),
+      arenas(new Ofp_msg_arenas),
+      n_polls(0),
+      n_msgs(0),
+      n_exhausted(0)
 {
+    arenas->set_error_handler(boost::bind(report_decode_error,
+                                          oconn->get_datapath_id(), _1, _2));
     main_loop->add_pollable(this);
 }
 
@@ -102,6 +196,7 @@ Conn::~Conn()
 static boost::shared_ptr<Openflow_connection>
 dpid_to_oconn(datapathid dpid)
 {
+    assert(!current_shard());
     chashmap::iterator iter = connection_map.find(dpid);
     if (iter == connection_map.end()) {
         lg.err("no datapath with id %s registered at nox",
@@ -130,8 +225,11 @@ Conn::close()
     if (!closing) {
         closing = true;
         datapathid dp_id = oconn->get_datapath_id();
+        lg.dbg("%s: dispatched %"PRIu64" messages in %"PRIu64" polls, "
+               "budget exhausted %"PRIu64" times",
+               oconn->to_string().c_str(), n_msgs, n_polls, n_exhausted);
         Datapath_leave_event* dple = new Datapath_leave_event(dp_id);
-        post_event(dple);
+        post_datapath_event(dp_id, dple);
 
         connection_map.erase(dp_id);
         main_loop->remove_pollable(this);
@@ -141,44 +239,139 @@ Conn::close()
     }
 }
 
+/* Receives and dispatches the OpenFlow messages queued on this connection,
+ * up to the limits set with set_dispatch_budget().  Returns true if any
+ * progress was made, false if no message was ready. */
 bool
 Conn::do_poll()
 {
-    int error;
-    std::auto_ptr<Buffer> b(oconn->recv_openflow(error, false));
-    switch (error) {
-    case 0: {
-
-        struct ofl_msg_header *ofl_msg;
-        uint32_t xid;
-        if (ofl_msg_unpack(b.get()->data(), b.get()->size(), &ofl_msg, &xid, NULL/*ofl_exp*/)) {
-            lg.warn("Error unpacking OpenFlow message.");
-            return false;
+    timeval deadline;
+    if (dispatch_max_usecs) {
+        deadline = do_gettimeofday(true) + make_timeval(0, dispatch_max_usecs);
+    }
+
+    ++n_polls;
+    ++dispatch_stats.n_polls;
+    unsigned int n = 0;
+    while (!closing) {
+        int error;
+        std::auto_ptr<Buffer> b(oconn->recv_openflow(error, false));
+        switch (error) {
+        case 0:
+            ++n;
+            ++n_msgs;
+            ++dispatch_stats.n_msgs;
+            dispatch(b);
+            break;
+
+        case EAGAIN:
+            return n > 0;
+
+        case EOF:
+            lg.warn("%s: connection closed by peer", oconn->to_string().c_str());
+            close();
+            return true;
+
+        default:
+            lg.warn("%s: disconnected (%s)",
+                    oconn->to_string().c_str(), strerror(error));
+            close();
+            return true;
         }
-        Ofp_msg *ofp_msg = new Ofp_msg(ofl_msg);
-        std::auto_ptr<Event> event(Ofp_msg_event::create_event(oconn->get_datapath_id(), xid, boost::shared_ptr<Ofp_msg>(ofp_msg)));
 
-        if (event.get() != NULL) {
-            event_dispatcher.dispatch(*event);
+        if (n >= dispatch_max_msgs
+            || (dispatch_max_usecs && do_gettimeofday(true) >= deadline)) {
+            ++n_exhausted;
+            ++dispatch_stats.n_exhausted;
+            return true;
         }
+    }
+    return true;
+}
 
-        return true;
+/* Wraps the OpenFlow message in 'b', received from datapath 'dpid', in a new
+ * event.  Only the message header is checked here: the body is decoded, into
+ * an arena from 'arenas', when a handler first reads it.  Returns null if the
+ * header is bad.  On success the message takes over 'b', since it is decoded
+ * from it and packet-in data is not copied out of it. */
+static Event*
+decode_openflow(const datapathid& dpid, std::auto_ptr<Buffer>& b,
+                const boost::shared_ptr<Ofp_msg_arenas>& arenas)
+{
+    uint32_t xid;
+    boost::shared_ptr<Ofp_msg> msg(Ofp_msg::unpack(b, &xid, arenas));
+    if (!msg) {
+        lg.warn("Error unpacking OpenFlow message.");
+        return NULL;
     }
+    return Ofp_msg_event::create_event(dpid, xid, msg);
+}
 
-    case EAGAIN:
-        return false;
+/* Sends 'error' to datapath 'dpid' in reply to message 'xid', with 'data',
+ * the start of the message. */
+static void
+send_decode_error(datapathid dpid, uint32_t xid,
+                  boost::shared_ptr<Buffer> data, ofl_err error)
+{
+    struct ofl_msg_error err;
+    err.header.type = OFPT_ERROR;
+    err.type = (enum ofp_error_type) ofl_error_type(error);
+    err.code = ofl_error_code(error);
+    err.data_length = data->size();
+    err.data = data->data();
+    send_openflow_msg(dpid, &err.header, xid, false);
+}
 
-    case EOF:
-        lg.warn("%s: connection closed by peer", oconn->to_string().c_str());
-        close();
-        return true;
- 
-    default:
-        lg.warn("%s: disconnected (%s)",
-                oconn->to_string().c_str(), strerror(error));
-        close();
-        return true;
-   }
+/* Error handler for the arenas of a connection to datapath 'dpid', called
+ * when a handler reads a message whose body turns out to be malformed.  Logs
+ * 'error' and, as OpenFlow asks for, reports it back to the datapath with
+ * the start of the message.  The handler's read then throws Bad_ofp_msg,
+ * which ends the dispatch of the message. */
+static void
+report_decode_error(datapathid dpid, const Ofp_msg& msg, ofl_err error)
+{
+    const char* name = ofl_message_type_name(msg.get_type());
+    if (error == OFL_ERROR) {
+        lg.warn("%012"PRIx64": dropping malformed %s", dpid.as_host(), name);
+        return;
+    }
+    uint16_t type = ofl_error_type(error);
+    uint16_t code = ofl_error_code(error);
+    lg.warn("%012"PRIx64": dropping malformed %s (%s, %s)",
+            dpid.as_host(), name,
+            ofl_error_type_name(type), ofl_error_code_name(type, code));
+
+    /* The message may be gone by the time a shard's report is sent. */
+    const Buffer* b = msg.get_buffer();
+    uint32_t xid = ntohl(b->at<ofp_header>(0).xid);
+    boost::shared_ptr<Buffer> data(
+        new Array_buffer(std::min(b->size(), size_t(64))));
+    memcpy(data->data(), b->data(), data->size());
+    if (current_shard()) {
+        main_inbox->post(boost::bind(send_decode_error, dpid, xid, data,
+                                     error));
+    } else {
+        send_decode_error(dpid, xid, data, error);
+    }
+}
+
+/* Dispatches the message in 'b', taking ownership of it in sharded mode or
+ * if it is decoded successfully. */
+void
+Conn::dispatch(std::auto_ptr<Buffer>& b)
+{
+    datapathid dpid = oconn->get_datapath_id();
+    if (n_shards) {
+        Shard* shard = shard_for(dpid);
+        shard->post(boost::bind(&Shard::handle_msg, shard, dpid, b.release(),
+                                arenas));
+        return;
+    }
+
+    std::auto_ptr<Event> event(decode_openflow(dpid, b, arenas));
+    if (event.get() != NULL) {
+        event_dispatcher.dispatch(*event);
+    }
 }
 
 void
@@ -187,6 +380,96 @@ Conn::wait()
     oconn->recv_openflow_wait();
 }
 
+Shard::Shard()
+    : loop(NULL)
+{
+    co_group_create(&group);
+}
+
+void
+Shard::start()
+{
+    co_thread_create(group, boost::bind(&Shard::run, this));
+}
+
+void
+Shard::run()
+{
+    /* The Poll_loop's threads must be created from within 'group'. */
+    loop = new Poll_loop(N_SHARD_THREADS, group);
+    loop->add_pollable(&inbox);
+    loop->run();
+}
+
+void
+Shard::handle_msg(datapathid dpid, Buffer* b_,
+                  boost::shared_ptr<Ofp_msg_arenas> arenas)
+{
+    std::auto_ptr<Buffer> b(b_);
+    Event* event = decode_openflow(dpid, b, arenas);
+    if (event) {
+        handle_event(dpid, event);
+    }
+}
+
+static void
+post_on_main(Event* event)
+{
+    event_dispatcher.post(event);
+}
+
+static void
+post_datapath_event_on_main(datapathid dpid, Event* event)
+{
+    event_dispatcher.post_in_order(event, dpid.as_host());
+}
+
+/* Dispatches 'event', which pertains to datapath 'dpid', to this shard's
+ * handlers, then passes it on to the main thread group's handlers unless one
+ * of them stopped it. */
+void
+Shard::handle_event(datapathid dpid, Event* event_)
+{
+    std::auto_ptr<Event> event(event_);
+    if (dispatcher.dispatch(*event) != STOP) {
+        main_inbox->post(boost::bind(post_datapath_event_on_main, dpid,
+                                     event.release()));
+    }
+}
+
+/* Returns the shard that the running thread belongs to, or null if it is not
+ * running in a shard. */
+static Shard*
+current_shard()
+{
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (shards[i]->is_current()) {
+            return shards[i];
+        }
+    }
+    return NULL;
+}
+
+static Shard*
+shard_for(const datapathid& dpid)
+{
+    uint64_t id = dpid.as_host();
+    return shards[(id ^ (id >> 32)) % shards.size()];
+}
+
+/* Posts 'event', which pertains to datapath 'dpid', in order with respect to
+ * the messages received from 'dpid'. */
+static void
+post_datapath_event(const datapathid& dpid, Event* event)
+{
+    if (n_shards) {
+        Shard* shard = shard_for(dpid);
+        shard->post(boost::bind(&Shard::handle_event, shard, dpid, event));
+    } else {
+        event_dispatcher.post_in_order(event, dpid.as_host());
+    }
+}
+
 class Signal_handler {
 public:
     Signal_handler();
@@ -241,15 +524,52 @@ handle_echo_request(const Event& e)
     return CONTINUE;
 }
 
+void
+set_default_lanes(Event_dispatcher& dispatcher)
+{
+    static const ofp_type high_types[] = {
+        OFPT_ECHO_REQUEST, OFPT_ECHO_REPLY, OFPT_ERROR, OFPT_PORT_STATUS,
+        OFPT_ROLE_REPLY
+    };
+    for (size_t i = 0; i < sizeof high_types / sizeof *high_types; i++) {
+        dispatcher.set_lane(Ofp_msg_event::get_event_type(high_types[i]),
+                            Event_dispatcher::HIGH_LANE);
+    }
+    dispatcher.set_lane(Ofp_msg_event::get_event_type(OFPT_PACKET_IN),
+                        Event_dispatcher::LOW_LANE);
+
+    /* Datapath events are posted in order per datapath, so these lanes only
+     * let a datapath's join and leave pass other datapaths' events. */
+    dispatcher.set_lane(static_event_type<Datapath_join_event>(),
+                        Event_dispatcher::HIGH_LANE);
+    dispatcher.set_lane(static_event_type<Datapath_leave_event>(),
+                        Event_dispatcher::HIGH_LANE);
+}
+
 void
 init()
 {
     classifier.register_packet_in();
     register_handler("Echo_request_event",
                      handle_echo_request, 100);
+
+    set_default_lanes(event_dispatcher);
+
+    for (int i = 0; i < Event_dispatcher::N_LANES; i++) {
+        event_dispatcher.set_lane_budget(Event_dispatcher::Lane(i),
+                                         lane_budgets[i]);
+    }
+
     main_loop = new Poll_loop(N_THREADS);
     main_loop->add_pollable(&event_dispatcher);
     main_loop->add_pollable(&timer_dispatcher);
+    if (n_shards) {
+        main_inbox = new Mailbox;
+        main_loop->add_pollable(main_inbox);
+        for (unsigned int i = 0; i < n_shards; i++) {
+            shards.push_back(new Shard);
+        }
+    }
     new Signal_handler;
 }
 
@@ -258,11 +578,125 @@ get_poll_loop() {
     return main_loop;
 }
 
-void
+Event_dispatcher::Handler_id
 register_handler(const Event_name& name,
                  boost::function<Disposition(const Event&)> handler, int order)
 {
-    event_dispatcher.add_handler(name, handler, order);
+    return event_dispatcher.add_handler(name, handler, order);
+}
+
+Event_dispatcher::Handler_id
+register_handler(Event_type type,
+                 boost::function<Disposition(const Event&)> handler, int order)
+{
+    return event_dispatcher.add_handler(type, handler, order);
+}
+
+/* Unregisters a handler registered with register_handler(), given the ID
+ * that it returned.  Returns false if there is no such handler. */
+bool
+remove_handler(Event_dispatcher::Handler_id id)
+{
+    return event_dispatcher.remove_handler(id);
+}
+
+/* Registers 'handler' for events named 'name' like register_handler(), but
+ * in sharded mode runs it in the shard of the datapath that the event
+ * pertains to, before any handler registered with register_handler() for the
+ * same event, which does not see the event at all if 'handler' returns STOP.
+ * Without shards this is the same as register_handler().
+ *
+ * A shard handler must only be registered for events that pertain to a
+ * datapath (OpenFlow message events, Datapath_join_event and
+ * Datapath_leave_event), and only after init().  It may run in
+ * parallel with other shards and with the main thread group, so it must not
+ * touch state shared with them without locking.  It may call post_event(),
+ * the send_openflow_*() functions and close_openflow_connection(), which
+ * then take effect asynchronously on the main thread group, but not
+ * post_timer() or the functions that look up a datapath's connection. */
+void
+register_shard_handler(const Event_name& name,
+                       boost::function<Disposition(const Event&)> handler,
+                       int order)
+{
+    assert(main_loop);
+    if (!n_shards) {
+        event_dispatcher.add_handler(name, handler, order);
+    } else {
+        for (size_t i = 0; i < shards.size(); i++) {
+            shards[i]->add_handler(name, handler, order);
+        }
+    }
+}
+
+/* Sets the number of shards to 'n', or disables sharded mode if 'n' is 0.
+ * Must be called before init(). */
+void
+set_shards(unsigned int n)
+{
+    assert(!main_loop);
+    n_shards = n;
+}
+
+unsigned int
+get_shards()
+{
+    return n_shards;
+}
+
+/* Limits each connection to dispatching at most 'max_msgs' OpenFlow messages
+ * and spending at most 'max_usecs' microseconds per pass of the poll loop,
+ * whichever comes first.  'max_msgs' must be nonzero; a 'max_usecs' of 0
+ * disables the time limit. */
+void
+set_dispatch_budget(unsigned int max_msgs, unsigned int max_usecs)
+{
+    assert(max_msgs > 0);
+    dispatch_max_msgs = max_msgs;
+    dispatch_max_usecs = max_usecs;
+}
+
+unsigned int
+get_dispatch_budget_msgs()
+{
+    return dispatch_max_msgs;
+}
+
+unsigned int
+get_dispatch_budget_usecs()
+{
+    return dispatch_max_usecs;
+}
+
+/* Returns dispatch statistics accumulated across all connections. */
+Dispatch_stats
+get_dispatch_stats()
+{
+    return dispatch_stats;
+}
+
+/* Limits each poll of the main event queue to dispatching at most 'budget'
+ * events from 'lane', 0 for no limit beyond the events queued when the poll
+ * began.  May be called before or after init(). */
+void
+set_lane_budget(Event_dispatcher::Lane lane, unsigned int budget)
+{
+    lane_budgets[lane] = budget;
+    event_dispatcher.set_lane_budget(lane, budget);
+}
+
+unsigned int
+get_lane_budget(Event_dispatcher::Lane lane)
+{
+    return lane_budgets[lane];
+}
+
+/* Returns statistics for 'lane' of the main event queue.  Must be called
+ * from the main thread group. */
+Event_dispatcher::Lane_stats
+get_lane_stats(Event_dispatcher::Lane lane)
+{
+    return event_dispatcher.get_lane_stats(lane);
 }
 
 /* Returns a nonzero OpenFlow transaction ID that has not been used for some
@@ -272,11 +706,24 @@ register_handler(const Event_name& name,
 uint32_t
 allocate_openflow_xid()
 {
+    /* Shards allocate transaction IDs too, so this must be atomic. */
     static uint32_t xid;
-    if (!xid) {
-        xid = 1;
+    uint32_t x;
+    do {
+        x = __sync_fetch_and_add(&xid, 1);
+    } while (!x);
+    return x;
+}
+
+static void
+send_on_main(datapathid dpid, Buffer* b_, bool block)
+{
+    std::auto_ptr<Buffer> b(b_);
+    int error = send_openflow_command(dpid, b, block);
+    if (error) {
+        lg.warn("%s: failed to send message from shard (%s)",
+                dpid.string().c_str(), strerror(error));
     }
-    return xid++;
 }
 
 /* Attempts to send OpenFlow command 'oh' to switch 'datapath_id'.
@@ -287,6 +734,12 @@ allocate_openflow_xid()
 int send_openflow_command(const datapathid& datapath_id, const ofp_header* oh,
                           bool block)
 {
+    if (current_shard()) {
+        std::auto_ptr<Buffer> b(new Array_buffer(ntohs(oh->length)));
+        memcpy(b->data(), oh, b->size());
+        return send_openflow_command(datapath_id, b, block);
+    }
+
     co_might_yield_if(block);
     boost::shared_ptr<Openflow_connection> oconn = dpid_to_oconn(datapath_id);
     if (!oconn) {
@@ -299,8 +752,57 @@ int send_openflow_command(const datapathid& datapath_id, const ofp_header* oh,
     return error;
 }
 
+/* Like send_openflow_command() above, but on success takes ownership of the
+ * OpenFlow command in 'b', leaving it null, so that it can be queued for
+ * transmission without being copied.
+ *
+ * Called from a shard, hands 'b' to the main thread group to be sent and
+ * returns 0 without waiting; errors are only logged. */
+int send_openflow_command(const datapathid& datapath_id,
+                          std::auto_ptr<Buffer>& b, bool block)
+{
+    if (current_shard()) {
+        main_inbox->post(boost::bind(send_on_main, datapath_id, b.release(),
+                                     block));
+        return 0;
+    }
+
+    co_might_yield_if(block);
+    boost::shared_ptr<Openflow_connection> oconn = dpid_to_oconn(datapath_id);
+    if (!oconn) {
+        return ESRCH;
+    }
+
+    return oconn->send_openflow(b, block);
+}
+
 int
 send_openflow_msg(const datapathid& dpid, struct ::ofl_msg_header *msg, uint32_t xid, bool block) {
+    if (lg.is_dbg_enabled()) {
+        /* Traced into a stack buffer, with long lists cut short, so that
+         * debug logging does not slow down a busy controller. */
+        char text[1024];
+        struct ofl_fmt fmt;
+        ofl_fmt_init(&fmt, text, sizeof text, 8);
+        ofl_msg_format(&fmt, msg);
+        lg.dbg("%012"PRIx64": sending %s", dpid.as_host(), ofl_fmt_finish(&fmt));
+    }
+
+    /* Flow-mods that just output to a port are by far the most common, and
+     * are packed straight into the buffer that is sent. */
+    const struct ofl_action_output *output;
+    if (msg->type == OFPT_FLOW_MOD
+        && ofl_msg_flow_mod_is_output((struct ofl_msg_flow_mod *)msg, &output)) {
+        struct ofl_msg_flow_mod *mod = (struct ofl_msg_flow_mod *)msg;
+        std::auto_ptr<Buffer> b(
+            new Array_buffer(OFL_FLOW_MOD_OUTPUT_LEN(mod->match->length)));
+        if (ofl_msg_pack_flow_mod_output(mod, xid, output->port,
+                                         output->max_len,
+                                         b->data(), b->size())) {
+            return send_openflow_command(dpid, b, block);
+        }
+    }
+
     uint8_t *buf;
     size_t buf_len;
 
@@ -308,54 +810,44 @@ send_openflow_msg(const datapathid& dpid, struct ::ofl_msg_header *msg, uint32_t
     if (error) {
         return error;
     }
-    int ret = send_openflow_command(dpid, (const ofp_header*)buf, block);
-    free(buf);
-    return ret;
+    std::auto_ptr<Buffer> b(new Malloc_buffer(buf, buf_len));
+    return send_openflow_command(dpid, b, block);
 }
 
 int
 send_openflow_pkt(const datapathid& dpid, uint32_t buffer_id, uint32_t in_port, uint32_t out_port, bool block) {
-    struct ofl_action_output output =
-            {{/*.type = */OFPAT_OUTPUT}, /*.port = */out_port, /*.max_len = */0};
-
-    struct ofl_action_header *actions[] =
-            { (struct ofl_action_header *)&output };
-
-    struct ofl_msg_packet_out out =
-            {{/*.type       = */OFPT_PACKET_OUT},
-             /*.buffer_id   = */buffer_id,
-             /*.in_port     = */in_port,
-             /*.actions_num = */1,
-             /*.actions     = */actions,
-             /*.data_length = */0,
-             /*.data        = */NULL};
-
-    return send_openflow_msg(dpid, (struct ofl_msg_header *)&out, 0/*xid*/, block);
+    std::auto_ptr<Buffer> b(new Array_buffer(OFL_PACKET_OUT_OUTPUT_LEN(0)));
+    ofl_msg_pack_packet_out_output(0/*xid*/, buffer_id, in_port, out_port,
+                                   NULL, 0, b->data(), b->size());
+    return send_openflow_command(dpid, b, block);
 }
 
 int
 send_openflow_pkt(const datapathid& dpid, const Buffer& buffer, uint32_t in_port, uint32_t out_port, bool block) {
-    struct ofl_action_output output =
-            {{/*.type = */OFPAT_OUTPUT}, /*.port = */out_port, /*.max_len = */0};
-
-    struct ofl_action_header *actions[] =
-            { (struct ofl_action_header *)&output };
+    std::auto_ptr<Buffer> b(
+        new Array_buffer(OFL_PACKET_OUT_OUTPUT_LEN(buffer.size())));
+    if (!ofl_msg_pack_packet_out_output(0/*xid*/, 0xffffffff, in_port,
+                                        out_port, buffer.data(), buffer.size(),
+                                        b->data(), b->size())) {
+        return EMSGSIZE;
+    }
+    return send_openflow_command(dpid, b, block);
+}
 
-    struct ofl_msg_packet_out out =
-            {{/*.type       = */OFPT_PACKET_OUT},
-             /*.buffer_id   = */0xffffffff, // no buffer
-             /*.in_port     = */in_port,
-             /*.actions_num = */1,
-             /*.actions     = */actions,
-             /*.data_length = */buffer.size(),
-             /*.data        = */(uint8_t *)buffer.data()};
 
-    return send_openflow_msg(dpid, (struct ofl_msg_header *)&out, 0/*xid*/, block);
+static void
+close_on_main(datapathid dpid)
+{
+    close_openflow_connection(dpid);
 }
 
-
 int close_openflow_connection(const datapathid& dpid)
 {
+    if (current_shard()) {
+        main_inbox->post(boost::bind(close_on_main, dpid));
+        return 0;
+    }
+
     chashmap::iterator iter = connection_map.find(dpid);
     if (iter == connection_map.end()) {
         lg.err("request to close connection to unknown dpid '%s'\n",
@@ -475,18 +967,24 @@ Log_fetcher::die(int error, const std::string& msg)
 void
 post_event(Event* event)
 {
-    event_dispatcher.post(event);
+    if (current_shard()) {
+        main_inbox->post(boost::bind(post_on_main, event));
+    } else {
+        event_dispatcher.post(event);
+    }
 }
 
 Timer
 post_timer(const Callback& callback, const timeval& duration)
 {
+    assert(!current_shard());
     return timer_dispatcher.post(callback, duration);
 }
 
 Timer
 post_timer(const Callback& callback)
 {
+    assert(!current_shard());
     return timer_dispatcher.post(callback);
 }
 
@@ -497,17 +995,74 @@ timer_debug() {
 
 //-----------------------------------------------------------------------------
 
+/* Leaves split per run of the classifier maintenance timer.  Each split costs
+ * on the order of the size of one leaf, so a run stays short however much
+ * restructuring a burst of registrations has queued. */
+static const uint32_t CLASSIFIER_SPLITS_PER_RUN = 16;
+static bool classifier_maintenance_posted = false;
+
+static void maintain_classifier();
+
+static void
+post_classifier_maintenance()
+{
+    if (!classifier_maintenance_posted) {
+        classifier_maintenance_posted = true;
+        post_timer(maintain_classifier);
+    }
+}
+
+static void
+maintain_classifier()
+{
+    classifier_maintenance_posted = false;
+    if (classifier.maintain(CLASSIFIER_SPLITS_PER_RUN)) {
+        post_classifier_maintenance();
+    }
+}
+
 uint32_t 
 register_handler_on_match(uint32_t priority, const Packet_expr &expr,
                           Pexpr_action callback)
 {
-    return classifier.add_rule(priority, expr, callback);
+    /* The tree is split by later runs of the maintenance timer rather than
+     * here, so that handler churn never stalls packet-in dispatch on a
+     * rebuild.  Until then packet-ins are still classified correctly, just
+     * against longer rule lists. */
+    uint32_t id = classifier.add_rule(priority, expr, callback);
+    post_classifier_maintenance();
+    return id;
+}
+
+/* Caches how the last 'capacity' distinct flows to arrive as packet-ins were
+ * classified, so that packet-ins repeating a flow, e.g. until the switch
+ * installs its flow-mod, skip classification.  0 disables the cache. */
+void
+set_flow_cache(size_t capacity)
+{
+    classifier.set_flow_cache(capacity);
+}
+
+size_t
+get_flow_cache()
+{
+    return classifier.get_flow_cache_capacity();
+}
+
+Flow_cache_stats
+get_flow_cache_stats()
+{
+    return classifier.get_flow_cache_stats();
 }
 
 bool 
 unregister_handler(uint32_t rule_id)
 {
-    return classifier.delete_rule(rule_id);
+    if (!classifier.delete_rule(rule_id)) {
+        return false;
+    }
+    post_classifier_maintenance();
+    return true;
 }
 
 void register_switch_auth(Switch_Auth* auth) { 
@@ -645,7 +1200,7 @@ void Handshake_fsm::recv_message() {
     } else {
       lg.dbg("Success receiving in '%s'", state_desc[state].c_str());
 
-      boost::shared_ptr<Ofp_msg> msg(new Ofp_msg(ofl_msg));
+      boost::shared_ptr<Ofp_msg> msg(Ofp_msg::create(ofl_msg));
 
       switch ((*msg)->type) {
         case OFPT_FEATURES_REPLY:
@@ -760,7 +1315,7 @@ void Handshake_fsm::register_switch() {
      * prevent any handlers for it from blocking, since we're running inside
      * an FSM. */
     // NOTE: event steals auto_ptr to features
-    event_dispatcher.post(new Datapath_join_event(dpid, 0/*xid*/, features_reply));
+    post_datapath_event(dpid, new Datapath_join_event(dpid, 0/*xid*/, features_reply));
     disconnected = NULL;
 
     do_exit(0);
@@ -896,6 +1451,9 @@ register_conn(Openflow_connection* oconn, Co_sema* disconnected)
 
 void run()
 {
+    for (size_t i = 0; i < shards.size(); i++) {
+        shards[i]->start();
+    }
     main_loop->run();
 }
 
@@ -37,14 +37,55 @@ Packet_classifier::register_packet_in()
 Disposition
 Packet_classifier::handle_packet_in(const Event& e)
 {
+    if (empty()) {
+        return CONTINUE;
+    }
+
     const Ofp_msg_event& pi = assert_cast<const Ofp_msg_event&>(e);
     struct ofl_msg_packet_in *opi = (struct ofl_msg_packet_in *)**pi.msg;
+    const struct ofl_match *pm = (const struct ofl_match *)opi->match;
 
-    const Rule<Packet_expr, Pexpr_action> *match;
-    //Flow flow(opi->in_port, Nonowning_buffer(opi->data, opi->data_length));
+    /* The frame gives the packet's header fields and the packet-in's match
+     * the pipeline fields: in_port, in_phy_port, metadata and tunnel_id.
+     * Header fields in the match are not copied, so that rules see the
+     * frame the switch sent even when its match disagrees. */
+    static const uint32_t pipeline_fields[] = {
+        OXM_OF_IN_PHY_PORT, OXM_OF_METADATA, OXM_OF_TUNNEL_ID
+    };
+    uint32_t in_port = OFPP_ANY;
+    const uint8_t *value = ofl_structs_match_get(pm, OXM_OF_IN_PORT);
+    if (value != NULL) {
+        memcpy(&in_port, value, sizeof in_port);
+    }
+    Flow flow;
+    flow.extract(in_port, opi->data, opi->data_length);
+    for (size_t i = 0; i < sizeof pipeline_fields / sizeof *pipeline_fields;
+         ++i)
+    {
+        value = ofl_structs_match_get(pm, pipeline_fields[i]);
+        if (value != NULL) {
+            ofl_structs_match_put_bytes(&flow.match, pipeline_fields[i],
+                                        value, NULL);
+        }
+    }
+
+    if (cache) {
+        /* An action may classify another packet, which can refill the
+         * cache entry, or change the rules, which can delete the rest. */
+        const Cache::Rule_vector rules
+            = cache->get_top_rules(*this, flow, result);
+        uint64_t gen = generation();
+        for (Cache::Rule_vector::const_iterator rule = rules.begin();
+             rule != rules.end() && generation() == gen; ++rule)
+        {
+            (*rule)->action(pi);
+        }
+        return CONTINUE;
+    }
 
-    //result.set_data(&flow);
-    get_rules(result);
+    const Rule<Packet_expr, Pexpr_action> *match;
+    result.set_data(&flow);
+    get_top_rules(result);
     match = result.next();
     if (match == NULL) {
         result.clear();
@@ -61,4 +102,21 @@ Packet_classifier::handle_packet_in(const Event& e)
     return CONTINUE;
 }
 
+void
+Packet_classifier::set_flow_cache(size_t capacity)
+{
+    cache.reset(capacity ? new Cache(capacity) : NULL);
+}
+
+Flow_cache_stats
+Packet_classifier::get_flow_cache_stats() const
+{
+    if (cache) {
+        return cache->get_stats();
+    }
+    Flow_cache_stats stats;
+    memset(&stats, 0, sizeof stats);
+    return stats;
+}
+
 }
@@ -19,6 +19,7 @@
 #define ASYNC_IO_HH 1
 
 #include <memory>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace vigil {
@@ -41,6 +42,7 @@ public:
     virtual ~Async_stream() { }
     ssize_t read(Buffer&, bool block);
     ssize_t write(const Buffer&, bool block);
+    ssize_t writev(const struct iovec*, int iovcnt, bool block);
     int read_fully(Buffer&, ssize_t *bytes_read, bool block);
     int write_fully(const Buffer&, ssize_t *bytes_written, bool block);
     virtual void read_wait() = 0;
@@ -50,6 +52,7 @@ public:
 protected:
     virtual ssize_t do_read(Buffer&) = 0;
     virtual ssize_t do_write(const Buffer&) = 0;
+    virtual ssize_t do_writev(const struct iovec*, int iovcnt);
 };
 
 class Async_datagram
@@ -0,0 +1,144 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BLOCK_POOL_HH
+#define BLOCK_POOL_HH 1
+
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+#include "threads/native.hh"
+
+namespace vigil {
+
+/* A free list of fixed-size memory blocks, for objects that are allocated and
+ * freed at a high rate, such as the events created for each OpenFlow message.
+ * Freed blocks are kept for reuse, up to a limit, instead of being returned to
+ * the global allocator.
+ *
+ * Any thread may allocate and free blocks, since a block allocated in one
+ * thread group is often freed in another. */
+class Block_pool {
+public:
+    struct Stats {
+        uint64_t n_allocs;      /* Blocks handed out. */
+        uint64_t n_new;         /* Blocks taken from the global allocator. */
+        size_t n_free;          /* Blocks on the free list now. */
+    };
+
+    /* Creates a pool of 'block_size'-byte blocks that keeps up to 'max_free'
+     * freed blocks for reuse. */
+    explicit Block_pool(size_t block_size, size_t max_free = 4096);
+    ~Block_pool();
+
+    void* allocate();
+    void deallocate(void*);
+
+    size_t get_block_size() const { return block_size; }
+    Stats get_stats();
+
+private:
+    struct Free_block {
+        Free_block* next;
+    };
+
+    Native_mutex mutex;
+    Free_block* free_list;
+    const size_t block_size;
+    const size_t max_free;
+    Stats stats;
+
+    Block_pool(const Block_pool&);
+    Block_pool& operator=(const Block_pool&);
+};
+
+/* Returns the pool for objects of type T.  The pool is never destroyed, so
+ * that objects may be freed during static destruction. */
+template <class T>
+Block_pool&
+block_pool_for()
+{
+    static Block_pool* pool = new Block_pool(sizeof(T));
+    return *pool;
+}
+
+/* A standard allocator that allocates single objects from block_pool_for<T>()
+ * and arrays from the global allocator.  For example, to allocate an object
+ * together with its reference count from a pool:
+ *
+ *     boost::allocate_shared<T>(Pool_allocator<T>(), args...)
+ */
+template <class T>
+class Pool_allocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef Pool_allocator<U> other;
+    };
+
+    Pool_allocator() { }
+    template <class U>
+    Pool_allocator(const Pool_allocator<U>&) { }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void* = 0) {
+        return static_cast<pointer>(
+            n == 1 ? block_pool_for<T>().allocate()
+                   : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type n) {
+        if (n == 1) {
+            block_pool_for<T>().deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+    void construct(pointer p, const T& x) { new (p) T(x); }
+    void destroy(pointer p) { p->~T(); }
+};
+
+template <class T, class U>
+inline bool
+operator==(const Pool_allocator<T>&, const Pool_allocator<U>&)
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool
+operator!=(const Pool_allocator<T>&, const Pool_allocator<U>&)
+{
+    return false;
+}
+
+} // namespace vigil
+
+#endif /* block-pool.hh */
@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <stdint.h>
 #include <stdexcept>
+#include <boost/shared_array.hpp>
 
 namespace vigil {
 
@@ -222,6 +223,28 @@ inline Array_buffer::Array_buffer(uint8_t* data_, size_t size_)
     : Buffer(data_, size_), base(data_), capacity(size_)
 { }
 
+/* Buffer that takes possession of a region allocated with malloc(), such as
+ * the output of ofl_msg_pack(), and destroys it with free().  The buffer may
+ * not be extended. */
+class Malloc_buffer
+    : public Buffer
+{
+public:
+    Malloc_buffer(uint8_t* data_, size_t size_)
+        : Buffer(data_, size_), base(data_) { }
+    ~Malloc_buffer() { std::free(base); }
+
+    /* A Malloc_buffer cannot be extended. */
+    uint8_t* push(size_t n) { ::abort(); }
+    uint8_t* put(size_t n) { ::abort(); }
+
+private:
+    uint8_t* base;
+
+    Malloc_buffer(const Malloc_buffer&);
+    Malloc_buffer& operator=(const Malloc_buffer&);
+};
+
 /* A buffer that does not own its content.  The destructor does not do
  * anything, and the buffer may not be extended.
  *
@@ -299,6 +322,29 @@ inline void Nonowning_buffer::reinit(uint8_t* data_, size_t size_)
     m_size = size_;
 }
 
+/* A buffer whose content is a region of a reference-counted array.  The
+ * array is kept alive for as long as the buffer exists, so that several
+ * buffers can share one underlying allocation (e.g. many messages received
+ * into a single receive ring) without copying.
+ *
+ * Like a Nonowning_buffer, a Shared_array_buffer cannot be extended. */
+class Shared_array_buffer
+    : public Buffer
+{
+public:
+    Shared_array_buffer(const boost::shared_array<uint8_t>& storage_,
+                        size_t offset, size_t length)
+        : Buffer(storage_.get() + offset, length), storage(storage_) { }
+    ~Shared_array_buffer() { }
+
+    /* A Shared_array_buffer cannot be extended. */
+    uint8_t* push(size_t n) { ::abort(); }
+    uint8_t* put(size_t n) { ::abort(); }
+
+private:
+    boost::shared_array<uint8_t> storage;
+};
+
 } // namespace vigil
 
 #endif /* buffer.hh */
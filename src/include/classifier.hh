@@ -18,6 +18,7 @@
 #ifndef  CLASSIFIER_HH
 #define  CLASSIFIER_HH
 
+#include <deque>
 #include <errno.h>
 #include <stdint.h>
 #include <boost/scoped_ptr.hpp>
@@ -25,6 +26,7 @@
 
 #include "cnode.hh"
 #include "errno_exception.hh"
+#include "frozen-tree.hh"
 #include "hash_map.hh"
 #include "rule.hh"
 
@@ -39,7 +41,27 @@
  * with it a map of rule pointers allowing for easy removal of rules by ID
  * (instead of requiring a search of the entire tree).
  *
+ * Adding and deleting a rule touch only the node the rule lives in.  A leaf
+ * that grows too large is queued rather than split on the spot, and maintain()
+ * splits queued leaves a bounded number at a time, so callers taking steady
+ * rule churn can spread the restructuring out (e.g. on a timer) instead of
+ * stalling on a build() of the whole tree.  Nodes left empty by deletions are
+ * pruned by maintain() once enough rules have been deleted to be worth a
+ * clean() pass.
+ *
+ * generation() changes whenever adding, deleting or reprioritizing rules may
+ * have changed the result of a lookup, so that results cached outside the
+ * classifier (see "flow-cache.hh") can tell when they are stale.  Restructuring
+ * the tree does not change it.
+ *
+ * Lookups use a frozen, contiguous copy of the tree (see "frozen-tree.hh")
+ * while no rule has changed since it was made, and the tree itself otherwise.
+ * build(), freeze(), and maintain() once it has no splits left to do, make the
+ * copy again.
+ *
  * Expr should follow the model described by the example in "expr.hh".
+ * Tuple_space ("tuple-space.hh") offers the same interface with a different
+ * engine.
  */
 
 namespace vigil {
@@ -66,10 +88,22 @@ public:
     uint32_t delete_rules(const Data*);
     void build();
     void unbuild();
-    void clean() { root->clean(); } /* deletes empty subtrees */
+    void clean()    /* deletes empty subtrees */
+        { root->clean(); n_deleted = 0; frozen_outdated = true; }
+    bool maintain(uint32_t);
+    void freeze();
+    void thaw() { frozen.clear(); }     /* looks up in the tree until frozen */
+    bool is_frozen() const
+        { return !frozen.empty() && frozen_generation == n_generation; }
+    bool empty() const { return rules.empty(); }
+    uint64_t generation() const { return n_generation; }
 
     template<typename Data>
     void get_rules(Cnode_result<Expr, Action, Data>&);
+    /* Tuple_space prunes its lookup here; a tree has nothing to prune. */
+    template<typename Data>
+    void get_top_rules(Cnode_result<Expr, Action, Data>& result)
+        { get_rules(result); }
     void print() const;
 
 private:
@@ -77,6 +111,12 @@ private:
     std::vector<Cnode<Expr, Action>*> to_traverse;
     Id_map rules;
     uint32_t id_counter;
+    std::deque<uint32_t> to_split;  /* rules whose leaves need splitting */
+    uint32_t n_deleted;             /* rules deleted since last clean() */
+    uint64_t n_generation;          /* bumped whenever lookups may change */
+    Frozen_tree<Expr, Action> frozen;
+    uint64_t frozen_generation;     /* n_generation when 'frozen' was made */
+    bool frozen_outdated;           /* tree restructured since then */
 
     uint32_t get_id();
 
@@ -92,7 +132,8 @@ private:
 
 template<class Expr, typename Action>
 Classifier<Expr, Action>::Classifier(uint32_t split_field, int n_buckets)
-    : id_counter(1)
+    : id_counter(1), n_deleted(0), n_generation(0), frozen_generation(0),
+      frozen_outdated(false)
 {
     root.reset(new Cnode<Expr, Action>(split_field, n_buckets));
 }
@@ -104,7 +145,8 @@ Classifier<Expr, Action>::Classifier(uint32_t split_field, int n_buckets)
 
 template<class Expr, typename Action>
 Classifier<Expr, Action>::Classifier()
-    : id_counter(1)
+    : id_counter(1), n_deleted(0), n_generation(0), frozen_generation(0),
+      frozen_outdated(false)
 {
     root.reset(new Cnode<Expr, Action>());
 }
@@ -139,7 +181,10 @@ Classifier<Expr, Action>::reset(uint32_t split_field, int n_buckets)
         delete id->second;
     }
     rules.clear();
+    to_split.clear();
+    n_deleted = 0;
     id_counter = 1;
+    n_generation++;
 }
 
 
@@ -158,7 +203,10 @@ Classifier<Expr, Action>::reset()
         delete id->second;
     }
     rules.clear();
+    to_split.clear();
+    n_deleted = 0;
     id_counter = 1;
+    n_generation++;
 }
 
 
@@ -194,7 +242,8 @@ Classifier<Expr, Action>::get_id()
 
 /*
  * Creates a rule from the passed in priority, expr, and action and adds it to
- * the classifier.  Returns the new rule's ID.
+ * the classifier.  If the leaf the rule lands in has grown too large, queues
+ * it for maintain() to split.  Returns the new rule's ID.
  */
 
 template<class Expr, typename Action>
@@ -213,7 +262,14 @@ Classifier<Expr, Action>::add_rule(uint32_t priority, const Expr& expr,
     if (inserted.second == true) {
         try {
             root->add_rule(entry.second, 0);
+            if (entry.second->get_node()->check_split()) {
+                to_split.push_back(new_id);
+            }
         } catch (...) {
+            Cnode<Expr, Action> *node = entry.second->get_node();
+            if (node != NULL) {
+                node->remove_rule(new_id);
+            }
             rules.erase(inserted.first);
             delete entry.second;
             throw;
@@ -223,6 +279,7 @@ Classifier<Expr, Action>::add_rule(uint32_t priority, const Expr& expr,
         throw errno_exception(ENOMEM, "classifier::add_rule");
     }
 
+    n_generation++;
     return new_id;
 }
 
@@ -242,7 +299,11 @@ Classifier<Expr, Action>::change_rule_priority(uint32_t id, uint32_t priority)
         return false;
     }
 
-    return node->change_rule_priority(id, priority);
+    if (!node->change_rule_priority(id, priority)) {
+        return false;
+    }
+    n_generation++;
+    return true;
 }
 
 template<class Expr, typename Action>
@@ -283,6 +344,8 @@ Classifier<Expr, Action>::delete_rule(uint32_t id)
 
     delete entry->second;
     rules.erase(entry);
+    n_deleted++;
+    n_generation++;
     return true;
 }
 
@@ -317,7 +380,8 @@ Classifier<Expr, Action>::delete_rules(const Data *data)
 }
 
 /*
- * Builds the tree.
+ * Builds the tree, then freezes it.  Leaves queued for maintain() are split
+ * along the way.
  */
 
 template<class Expr, typename Action>
@@ -328,6 +392,22 @@ Classifier<Expr, Action>::build()
     if (tmp != root.get()) {
         root.reset(tmp);
     }
+    to_split.clear();
+    freeze();
+}
+
+
+/*
+ * Makes the frozen copy of the tree that lookups use until a rule changes.
+ */
+
+template<class Expr, typename Action>
+void
+Classifier<Expr, Action>::freeze()
+{
+    frozen.freeze(*root);
+    frozen_generation = n_generation;
+    frozen_outdated = false;
 }
 
 
@@ -339,6 +419,53 @@ Classifier<Expr, Action>::unbuild()
     if (tmp != root.get()) {
         root.reset(tmp);
     }
+    to_split.clear();
+    frozen_outdated = true;
+}
+
+/*
+ * Runs one bounded maintenance pass: splits at most 'max_splits' of the leaves
+ * queued by add_rule(), one level each, queueing any resulting children that
+ * are still too large.  The leaf is found again from the queued rule's
+ * expression, so queued leaves may safely have been split, pruned or rebuilt
+ * since.  Once the queue is empty and more rules have been deleted since the
+ * last clean() than remain, prunes empty subtrees, which keeps that pass
+ * amortized constant per deletion.  With no splits left, freezes the tree
+ * again if rules or the tree have changed since it was last frozen.  Lookups
+ * see a consistent tree between passes.  Returns 'true' if queued splits
+ * remain.
+ */
+
+template<class Expr, typename Action>
+bool
+Classifier<Expr, Action>::maintain(uint32_t max_splits)
+{
+    for (uint32_t i = 0; i < max_splits && !to_split.empty(); i++) {
+        typename Id_map::iterator entry = rules.find(to_split.front());
+        to_split.pop_front();
+        if (entry == rules.end()) {
+            continue;
+        }
+
+        uint32_t path = 0;
+        Cnode<Expr, Action> *node = root->find_node(entry->second->expr, path);
+        if (node != NULL && node == entry->second->get_node()
+            && node->split_leaf(path, to_split)) {
+            frozen_outdated = true;
+        }
+    }
+
+    if (!to_split.empty()) {
+        return true;
+    }
+
+    if (n_deleted > rules.size()) {
+        clean();
+    }
+    if (frozen_outdated || !is_frozen()) {
+        freeze();
+    }
+    return false;
 }
 
 /*
@@ -355,6 +482,11 @@ template<typename Data>
 void
 Classifier<Expr, Action>::get_rules(Cnode_result<Expr, Action, Data>& result)
 {
+    if (is_frozen()) {
+        frozen.traverse(result);
+        return;
+    }
+
     root->traverse(result, to_traverse);
     while (!to_traverse.empty()) {
         Cnode<Expr, Action> *node = to_traverse.back();
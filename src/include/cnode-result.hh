@@ -39,11 +39,19 @@
 
 namespace vigil {
 
+template<class Expr, typename Action>
+class Tuple_space;
+
+template<class Expr, typename Action>
+class Frozen_tree;
+
 template<class Expr, typename Action, typename Data>
 class Cnode_result {
 
 public:
     friend class Cnode<Expr, Action>;
+    friend class Tuple_space<Expr, Action>;
+    friend class Frozen_tree<Expr, Action>;
 
     typedef Rule<Expr, Action>* Rule_ptr;
     typedef std::list<Rule_ptr> Rule_list;
@@ -52,40 +60,70 @@ public:
         : data(data_), num_lists(0) {}
 
     void push(const Rule_list&);
+    void push(const Rule_ptr *, const Rule_ptr *);
     const Rule<Expr, Action>* next();
     void set_data(const Data *data_) { data = data_; }
     void clear() { num_lists = 0; }
 
 private:
+    /* Position in a pushed list of rules, which is either a Cnode's list or,
+     * if 'array', a range of a Frozen_tree's rule array. */
     struct current_rule {
         current_rule()
-            : ismatch(false), set(false) {}
+            : ismatch(false), set(false), array(false) {}
 
         current_rule(const Rule_list& rules)
-            : rule(rules.begin()), end(rules.end()), ismatch(false), set(true) { }
+            : rule(rules.begin()), end(rules.end()), ismatch(false), set(true),
+              array(false) { }
+
+        current_rule(const Rule_ptr *first_, const Rule_ptr *last_)
+            : first(first_), last(last_), ismatch(false), set(true),
+              array(true) { }
 
         current_rule(const current_rule& other)
-            : ismatch(false), set(other.set) {
-            if (set) {
-                rule = other.rule;
-                end = other.end;
-                ismatch = other.ismatch;
-            }
+            : ismatch(false), set(other.set), array(other.array) {
+            copy(other);
         }
 
         current_rule& operator=(const current_rule& other) {
             set = other.set;
-            if (set) {
-                rule = other.rule;
-                end = other.end;
-                ismatch = other.ismatch;
-            }
+            array = other.array;
+            copy(other);
             return *this;
         }
+
+        const Rule<Expr, Action>* get() const {
+            return array ? *first : *rule;
+        }
+
+        /* Moves on to the next rule, returning false if there is none. */
+        bool advance() {
+            return array ? ++first != last : ++rule != end;
+        }
+
         typename std::list<Rule_ptr>::const_iterator rule;
         typename std::list<Rule_ptr>::const_iterator end;
+        const Rule_ptr *first;
+        const Rule_ptr *last;
         bool ismatch;
         bool set;
+        bool array;
+
+    private:
+        /* List iterators are only copied once set, since copying singular
+         * ones is an error to the debugging library. */
+        void copy(const current_rule& other) {
+            if (set) {
+                if (array) {
+                    first = other.first;
+                    last = other.last;
+                } else {
+                    rule = other.rule;
+                    end = other.end;
+                }
+                ismatch = other.ismatch;
+            }
+        }
     };
 
     const Data *data;
@@ -114,6 +152,28 @@ Cnode_result<Expr, Action, Data>::push(const Rule_list& rules)
 }
 
 
+/*
+ * Pushes the rules from 'first' up to 'last', which must be sorted by
+ * priority.
+ */
+
+template<class Expr, typename Action, typename Data>
+void
+Cnode_result<Expr, Action, Data>::push(const Rule_ptr *first,
+                                       const Rule_ptr *last)
+{
+    if (first != last) {
+        current_rule r(first, last);
+        if (num_lists == traversed.size()) {
+            traversed.push_back(r);
+        } else {
+            traversed[num_lists] = r;
+        }
+        ++num_lists;
+    }
+}
+
+
 /*
  * Returns the next rule in the priority queue, popping it off the list.
  * shared_ptr points to NULL if no matching rules remain.
@@ -132,7 +192,7 @@ Cnode_result<Expr, Action, Data>::next()
 
     for (uint32_t i = 0; i < num_lists;) {
         current_rule& current = traversed[i];
-        const Rule<Expr, Action>* rule = *(current.rule);
+        const Rule<Expr, Action>* rule = current.get();
         if (match == NULL || rule->priority < min_pri) {
             if (current.ismatch || matches(rule->id, rule->expr, *data)) {
                 match = rule;
@@ -140,11 +200,8 @@ Cnode_result<Expr, Action, Data>::next()
                 min_idx = i;
                 current.ismatch = true;
                 ++i;
-            } else {
-                ++(current.rule);
-                if (current.rule == current.end) {
-                    current = traversed[--num_lists];
-                }
+            } else if (!current.advance()) {
+                current = traversed[--num_lists];
             }
         } else {
             ++i;
@@ -153,8 +210,7 @@ Cnode_result<Expr, Action, Data>::next()
 
     if (match != NULL) {
         current_rule& current = traversed[min_idx];
-        ++(current.rule);
-        if (current.rule == current.end) {
+        if (!current.advance()) {
             current = traversed[--num_lists];
         } else {
             current.ismatch = false;
@@ -18,6 +18,8 @@
 #ifndef  CNODE_HH
 #define  CNODE_HH
 
+#include <algorithm>
+#include <deque>
 #include <list>
 #include <string>
 #include <vector>
@@ -36,10 +38,15 @@
 
 namespace vigil {
 
+template<class Expr, typename Action>
+class Frozen_tree;
+
 template<class Expr, typename Action>
 class Cnode {
 
 public:
+    friend class Frozen_tree<Expr, Action>;
+
     typedef Rule<Expr, Action>* Rule_ptr;
     typedef std::list<Rule_ptr> Rule_list;
 
@@ -54,6 +61,9 @@ public:
     Cnode<Expr, Action> *build(uint32_t, bool);
     Cnode<Expr, Action> *unbuild();
     bool clean();
+    bool check_split();
+    Cnode<Expr, Action> *find_node(const Expr&, uint32_t&);
+    bool split_leaf(uint32_t, std::deque<uint32_t>&);
     template<typename Data>
     void traverse(Cnode_result<Expr, Action, Data>&, std::vector<Cnode<Expr, Action>*>&) const;
 
@@ -73,6 +83,8 @@ private:
 
     Cnode<Expr, Action> *next;      // for chaining
 
+    uint32_t split_check;           // leaf size to queue a split at
+
     void add_rule_to_list(const Rule_ptr&);
     void build_children(uint32_t, bool);
     Cnode<Expr, Action>* split(uint32_t, bool);
@@ -113,7 +125,7 @@ const uint32_t Cnode<Expr, Action>::MASKS[] = {
 template<class Expr, typename Action>
 Cnode<Expr, Action>::Cnode(uint32_t field, int n_buckets, uint32_t value_)
     : value(value_), bucket_mask(n_buckets - 1), split_field(field),
-      any_node(NULL), next(NULL)
+      any_node(NULL), next(NULL), split_check(Expr::LEAF_THRESHOLD + 1)
 {
     assert(split_field < 32);
     assert(n_buckets > 0 && ((n_buckets & (n_buckets - 1)) == 0));
@@ -131,7 +143,8 @@ Cnode<Expr, Action>::Cnode(uint32_t field, int n_buckets, uint32_t value_)
 
 template<class Expr, typename Action>
 Cnode<Expr, Action>::Cnode(uint32_t value_)
-    : value(value_), bucket_mask(-1), buckets(NULL), any_node(NULL), next(NULL)
+    : value(value_), bucket_mask(-1), buckets(NULL), any_node(NULL), next(NULL),
+      split_check(Expr::LEAF_THRESHOLD + 1)
 { }
 
 
@@ -141,7 +154,8 @@ Cnode<Expr, Action>::Cnode(uint32_t value_)
 
 template<class Expr, typename Action>
 Cnode<Expr, Action>::Cnode()
-    : value(0), bucket_mask(-1), buckets(NULL), any_node(NULL), next(NULL)
+    : value(0), bucket_mask(-1), buckets(NULL), any_node(NULL), next(NULL),
+      split_check(Expr::LEAF_THRESHOLD + 1)
 { }
 
 
@@ -282,8 +296,11 @@ Cnode<Expr, Action>::change_rule_priority(uint32_t id, uint32_t priority)
 
 /*
  * Removes rule with 'id' from the node's 'rules' lists and sets its Cnode
- * pointer to NULL if it is pointing to the current node.  Returns 'true' if
- * the rule was found and thus removed from the list, else returns 'false'.
+ * pointer to NULL if it is pointing to the current node.  Once a leaf has
+ * shrunk to half the size it was last queued for splitting at, lowers its
+ * check_split() size again, since the rule it was queued by may be gone.
+ * Returns 'true' if the rule was found and thus removed from the list, else
+ * returns 'false'.
  */
 
 template<class Expr, typename Action>
@@ -298,6 +315,10 @@ Cnode<Expr, Action>::remove_rule(uint32_t id)
                 (*iter)->node = NULL;
             }
             rules.erase(iter);
+            if (rules.size() * 4 <= split_check) {
+                split_check = std::max(rules.size() + 1,
+                                       (size_t) Expr::LEAF_THRESHOLD + 1);
+            }
             return true;
         }
     }
@@ -456,6 +477,118 @@ Cnode<Expr, Action>::unbuild()
 }
 
 
+/*
+ * Returns 'true' if the node is a leaf that has grown past the size at which
+ * it should next be offered to split_leaf(), and doubles that size so that a
+ * leaf that cannot be split is not offered again on every added rule.  Keeps
+ * the cost of queueing splits amortized constant per added rule.
+ */
+
+template<class Expr, typename Action>
+bool
+Cnode<Expr, Action>::check_split()
+{
+    if (bucket_mask >= 0 || rules.size() < split_check) {
+        return false;
+    }
+
+    split_check = rules.size() * 2;
+    return true;
+}
+
+
+/*
+ * Returns the node in the sub-tree rooted at the current node that add_rule()
+ * would add a rule with expression 'expr' to, or NULL if that node does not
+ * exist.  'path' should hold the fields split on to reach the current node and
+ * is set to the fields split on to reach the returned node.
+ */
+
+template<class Expr, typename Action>
+Cnode<Expr, Action> *
+Cnode<Expr, Action>::find_node(const Expr& expr, uint32_t& path)
+{
+    Cnode<Expr, Action> *node = this;
+    uint32_t rule_value;
+
+    while (node->bucket_mask >= 0 && expr.splittable(path)) {
+        Cnode<Expr, Action> *child;
+        if (expr.get_field(node->split_field, rule_value)) {
+            int bucket = get_bucket(rule_value, node->bucket_mask);
+            for (child = node->buckets[bucket]; child != NULL;
+                 child = child->next)
+            {
+                if (child->value == rule_value) {
+                    break;
+                }
+            }
+        } else {
+            child = node->any_node;
+        }
+
+        if (child == NULL) {
+            return NULL;
+        }
+        path = path | MASKS[node->split_field];
+        node = child;
+    }
+
+    return node;
+}
+
+
+/*
+ * Splits the leaf in place, one level only, so that its parent need not be
+ * known.  'path' denotes the fields split on to reach the node.  The split is
+ * made on a copy by split() and the result swapped into the node, so if an
+ * exception is thrown the node is left as it was.  Children that are
+ * themselves too large to remain leaves are queued on 'to_split' by the ID of
+ * one of their rules, to be split by a later call.  Cost is bounded by the
+ * size of the leaf rather than of the sub-tree.  Returns 'true' if the node
+ * was split.
+ */
+
+template<class Expr, typename Action>
+bool
+Cnode<Expr, Action>::split_leaf(uint32_t path, std::deque<uint32_t>& to_split)
+{
+    if (bucket_mask >= 0 || rules.size() <= Expr::LEAF_THRESHOLD) {
+        return false;
+    }
+
+    Cnode<Expr, Action> *new_node = split(path, false);
+    if (new_node == this) {
+        return false;
+    }
+
+    rules.swap(new_node->rules);
+    std::swap(bucket_mask, new_node->bucket_mask);
+    std::swap(buckets, new_node->buckets);
+    std::swap(any_node, new_node->any_node);
+    split_field = new_node->split_field;
+    new_node->next = NULL;
+    delete new_node;
+
+    set_node_pointers();
+
+    for (int i = 0; i <= bucket_mask; i++) {
+        for (Cnode<Expr, Action> *child = buckets[i]; child != NULL;
+             child = child->next)
+        {
+            if (child->check_split()) {
+                to_split.push_back(child->rules.front()->id);
+            }
+        }
+    }
+
+    if (any_node != NULL && any_node->check_split()) {
+        to_split.push_back(any_node->rules.front()->id);
+    }
+
+    return true;
+}
+
+
 /*
  * Optimally splits a node on a field.  'path' denotes the fields that were
  * split on to reach the node, and thus the fields do not need to be checked
@@ -39,7 +39,8 @@ struct Datapath_join_event
     : public Ofp_msg_event
 {
     Datapath_join_event(datapathid dpid, uint32_t xid, boost::shared_ptr<Ofp_msg> msg) :
-        Ofp_msg_event(static_get_name(), dpid, xid, msg) {
+        Ofp_msg_event(static_event_type<Datapath_join_event>(), dpid, xid,
+                      msg) {
             assert((*msg)->type == OFPT_FEATURES_REPLY);
         };
 
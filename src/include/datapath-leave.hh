@@ -34,7 +34,8 @@ struct Datapath_leave_event
     : public Event
 {
     Datapath_leave_event(datapathid datapath_id_)
-        : Event(static_get_name()), datapath_id(datapath_id_) { }
+        : Event(static_event_type<Datapath_leave_event>()),
+          datapath_id(datapath_id_) { }
 
     // -- only for use within python
     Datapath_leave_event() : Event(static_get_name()) { }
@@ -19,6 +19,7 @@
 #define EVENT_DISPATCHER_HH 1
 
 #include <boost/function.hpp>
+#include <stdint.h>
 #include "event.hh"
 #include "poll-loop.hh"
 
@@ -34,7 +35,7 @@ struct Event_dispatcher_impl;
  *   - Associates events with handlers and allows events to be dispatched to
  *     the appropriate handlers.
  *
- *   - Maintains a queue of pending events.
+ *   - Maintains queues of pending events, one per priority lane.
  *
  *   - Implements Pollable, which allows it to be added to a Poll_loop for
  *     periodic processing of the event queue.
@@ -52,16 +53,66 @@ public:
 
     /* Registers 'handler' to be called to process each event of the given
      * 'type'.  Multiple handlers may be registered for any 'type', in which
-     * case the handlers are called in increasing order of 'order'. */
+     * case the handlers are called in increasing order of 'order', and in
+     * order of registration among handlers with equal 'order'.  Returns an
+     * ID that may be passed to remove_handler(). */
     typedef Disposition Handler_signature(const Event&);
     typedef boost::function<Handler_signature> Handler;
-    void add_handler(const Event_name&, const Handler&, int order);
+    typedef unsigned int Handler_id;
+    Handler_id add_handler(const Event_name&, const Handler&, int order);
+    Handler_id add_handler(Event_type, const Handler&, int order);
 
-    /* Appends 'event' to the list of events to be handled in the main loop. */
+    /* Unregisters the handler with the given 'id'.  Returns false if there
+     * is no such handler.  A dispatch() that is already running (because a
+     * handler blocked) still calls the removed handler. */
+    bool remove_handler(Handler_id id);
+
+    /* Priority lanes for posted events.  Each poll() takes events from the
+     * lanes in this order, up to each lane's budget, so that a flood of
+     * events in one lane cannot hold up the lanes above it.  Events are
+     * dispatched in the order they were posted within a lane, but not
+     * across lanes. */
+    enum Lane { HIGH_LANE, NORMAL_LANE, LOW_LANE, N_LANES };
+
+    /* Statistics for one lane. */
+    struct Lane_stats {
+        size_t depth;               /* Events queued now. */
+        size_t max_depth;           /* Most events ever queued at once. */
+        uint64_t n_dispatched;      /* Events dispatched. */
+        uint64_t total_wait_usecs;  /* Sum of time from post to dispatch. */
+        uint64_t max_wait_usecs;    /* Longest time from post to dispatch. */
+    };
+
+    /* Posts events of the given 'type' to 'lane' from now on.  Events are
+     * posted to NORMAL_LANE unless set otherwise. */
+    void set_lane(Event_type type, Lane lane);
+    Lane get_lane(Event_type type) const;
+
+    /* Limits each poll() to dispatching at most 'budget' events from 'lane',
+     * or only to the events already queued when poll() started if 'budget'
+     * is 0. */
+    void set_lane_budget(Lane lane, unsigned int budget);
+    unsigned int get_lane_budget(Lane lane) const;
+
+    Lane_stats get_lane_stats(Lane lane) const;
+
+    /* Appends 'event' to the queue of its type's lane, or to 'lane', to be
+     * handled in the main loop. */
     void post(Event* event);
+    void post(Event* event, Lane lane);
+
+    /* Like post(event), but dispatches 'event' only after every event
+     * posted earlier with the same 'key', whatever their lanes.  'event' is
+     * queued in the lowest of its type's lane and the lanes that hold such
+     * events, and waits at the head of that lane while earlier ones remain
+     * in higher lanes.  Events with different keys, or posted without a key,
+     * still pass each other by lane. */
+    void post_in_order(Event* event, uint64_t key);
 
-    /* Dispatches 'event' immediately, bypassing the event queue. */
-    void dispatch(const Event& event);
+    /* Dispatches 'event' immediately, bypassing the event queue.  Returns
+     * STOP if a handler returned STOP or leaked an exception, otherwise
+     * CONTINUE. */
+    Disposition dispatch(const Event& event);
 
     /* Pollable implementation.  Processes pending events when polled.  */
     bool poll();
@@ -28,6 +28,26 @@ enum Disposition { CONTINUE, STOP };
 
 typedef std::string Event_name;
 
+/* Small integer that identifies an event name.  Each distinct name is
+ * assigned the next unused type the first time it is seen, so types are
+ * dense and can be used to index arrays, but they are only meaningful
+ * within a single process. */
+typedef unsigned int Event_type;
+
+Event_type event_type(const Event_name&);
+const Event_name& event_type_name(Event_type);
+Event_type n_event_types();
+
+/* Returns the type for the events named T::static_get_name(), looking it up
+ * only on the first call. */
+template <class T>
+inline Event_type
+static_event_type()
+{
+    static const Event_type type = event_type(T::static_get_name());
+    return type;
+}
+
 /** @defgroup noxevents NOX Events
  *
  * An Event represents a low-level or high-level event in the network.  The
@@ -55,18 +75,22 @@ public:
     virtual ~Event();
     
     /* Get event name */
-    Event_name get_name() const;
+    const Event_name& get_name() const;
+
+    /* Get event type, which is cheaper to compare than the name. */
+    Event_type get_type() const { return type; }
 
     /* For debugging purposes only. */
     std::string get_class_name() const; 
 
 protected:
     Event(const Event_name&);
+    Event(Event_type);
 
     void set_name(const Event_name&);
 
 private:
-    Event_name name;
+    Event_type type;
 };
 
 } // namespace vigil
@@ -24,6 +24,8 @@
 
 #include "cnode.hh"
 #include "cnode-result.hh"
+#include "flow.hh"
+#include "../oflib/ofl-structs.h"
 
 /*
  * Example implementation of the Expr model used by Classifier, Cnode,
@@ -54,7 +56,14 @@
 
 namespace vigil {
 
-class Flow;
+/*
+ * The Expr that nox::register_handler_on_match() takes: an OpenFlow 1.3 match
+ * that a packet-in's Flow must satisfy for the handler to run.  It may hold
+ * any OXM field of the OpenFlow basic class, masked or not, in the byte order
+ * ofl_match keeps decoded matches in.  The Cnode tree splits on the exact
+ * (unmasked) values of the fields in Expr_field; the others, and masked
+ * fields, are checked by matches() only.
+ */
 
 class Packet_expr {
 
@@ -64,7 +73,7 @@ public:
 
     /* Constants */
 
-    static const uint32_t NUM_FIELDS = 13;     // num fields that can be split
+    static const uint32_t NUM_FIELDS = 18;     // num fields that can be split
                                                // on by Cnode
     static const uint32_t LEAF_THRESHOLD = 1;  // min num rules that should be
                                                // saved by a split for it to be
@@ -89,39 +98,60 @@ public:
     bool splittable(uint32_t path) const;
 
     /*
-     * Sets the memory pointed to by 'value' equal to the expression's value
-     * for 'field'.  Returns 'false' if 'value' has not been set (i.e. when
-     * expr is wildcarded on 'field'), else returns 'true'.  Should set any of
-     * the MAX_FIELD_LEN * 4 bytes in 'value' not used by 'field' to 0.
+     * Sets 'value' equal to the expression's value for 'field'.  Returns
+     * 'false' if 'value' has not been set (i.e. when expr is wildcarded on
+     * 'field'), else returns 'true'.  Fields wider than 32 bits (Ethernet and
+     * IPv6 addresses, metadata, tunnel_id) are folded into 32 bits, so two
+     * values may share a branch; matches() tells them apart.
      */
 
     bool get_field(uint32_t field, uint32_t& value) const;
 
 /**************************** END REQUIRED INTERFACE **************************/
 
-    Packet_expr() : wildcards(~0) { }
+    Packet_expr();
     ~Packet_expr() { }
 
+    /* The fields Cnode splits on, in order of preference when it has to pick
+     * between equally good splits. */
     enum Expr_field {
-        AP_SRC,
-        AP_DST,
-        DL_VLAN,
-        DL_VLAN_PCP,
-        DL_TYPE,
-        DL_SRC,
-        DL_DST,
-        NW_SRC,
-        NW_DST,
-        NW_PROTO,
-        TP_SRC,
-        TP_DST,
-        GROUP_SRC,
-        GROUP_DST,
+        IN_PORT,
+        ETH_TYPE,
+        IP_PROTO,
+        TCP_DST,
+        UDP_DST,
+        TCP_SRC,
+        UDP_SRC,
+        IPV4_DST,
+        IPV4_SRC,
+        IPV6_DST,
+        IPV6_SRC,
+        ETH_DST,
+        ETH_SRC,
+        VLAN_VID,
+        VLAN_PCP,
+        MPLS_LABEL,
+        TUNNEL_ID,
+        METADATA,
     };
 
-    static const int MAX_FIELD_LEN = 2;
+    /* Returns the OXM field number of split field 'field'. */
+    static unsigned int oxm_field(uint32_t field);
+
+    /* Requires OXM field 'header' to be 'value', or to be 'value' under
+     * 'mask' if 'mask' is nonnull, as ofl_structs_match_put_bytes() does. */
+    void set_field(uint32_t header, const void *value, const void *mask = NULL);
+
+    template<uint32_t HEADER>
+    void set(const typename Oxm_field<HEADER>::type& value) {
+        set_field(HEADER, &value);
+    }
 
-    void set_field(Expr_field, const uint32_t [MAX_FIELD_LEN]);
+    template<uint32_t HEADER>
+    void set(const typename Oxm_field<HEADER>::type& value,
+             const typename Oxm_field<HEADER>::type& mask) {
+        set_field(Oxm_field<HEADER>::masked_header, &value, &mask);
+    }
 
     void print() const;
     void print(uint32_t) const;
@@ -129,33 +159,18 @@ public:
     const std::string to_string() const;
     const std::string to_string(uint32_t field) const;
 
-    uint16_t ap_src;
-    uint16_t ap_dst;    //how have data during classification
-    uint16_t dl_vlan;
-    uint16_t dl_vlan_pcp;
-    uint16_t dl_proto;
-    uint8_t dl_src[6];
-    uint8_t dl_dst[6];
-    uint32_t nw_src;
-    uint32_t nw_dst;
-    uint16_t tp_src;
-    uint16_t tp_dst;
-    uint32_t group_src;
-    uint32_t group_dst;
-    uint32_t wildcards;
-    uint8_t nw_proto;
+    struct ofl_match match;
+    uint32_t wildcards;   // MASKS[field] for each split field not exact
 };
 
 
 /*
  * This function should be defined for every Data type that
- * Classifier::traverse might get called on.  This example Expr assumes it
- * will get called on either a Flow or another Packet_expr.  Sets the
- * memory pointed to by 'value' equal to the data's value for 'field' where
- * 'field' is one of the above-described single-bit masks.  Returns 'true'
- * if 'value' was set, else 'false' (e.g. when the data does not have a
- * value for 'field'.  Should set any of the MAX_FIELD_LEN * 4 bytes in
- * 'value' not used by 'field' equal to '0'.
+ * Classifier::traverse might get called on.  This Expr gets called on either
+ * a Flow or another Packet_expr.  Sets 'value' equal to the data's value for
+ * 'field', folded as Packet_expr::get_field() folds it.  Returns 'true' if
+ * 'value' was set, else 'false', in which case every branch is taken.  A
+ * Flow without the field takes only the wildcard branch.
  */
 
 template <>
@@ -170,11 +185,10 @@ get_field<Packet_expr, Packet_expr>(uint32_t field, const Packet_expr& expr,
 /*
  * This function should be defined for every Data type that
  * Classifier::traverse might get called on.  It is used by Cnode_result to
- * iterate through only the valid rules.  This example Expr assumes it will
- * get called on either a Flow or another Packet_expr.  Returns
- * 'true' if the expr matches the packet argument.  This is where the expr
- * can check for fields that the Cnode tree either has not or cannot
- * split on.  Returns 'false' if the expr does not match the argument.
+ * iterate through only the valid rules.  Returns 'true' if the expr matches
+ * the argument: a Flow that has every field of the expr, equal to it under
+ * the field's mask, or a Packet_expr all of whose fields the expr has with
+ * the same value and mask.  Returns 'false' otherwise.
  */
 
 template <>
@@ -0,0 +1,335 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef  FLOW_CACHE_HH
+#define  FLOW_CACHE_HH
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "cnode-result.hh"
+#include "flow.hh"
+#include "rule.hh"
+
+/*
+ * Exact-match microflow cache for a classifier.
+ *
+ * Remembers, for each recently looked up Flow, the rules of the best matching
+ * priority that get_top_rules() resolved for it, so that a flow that keeps
+ * coming back (e.g. as packet-ins until its flow-mod lands) is classified
+ * once.  Flows are keyed on every field they carry, values and masks, so two
+ * flows share an entry only if they would classify alike.
+ *
+ * Entries are tagged with the classifier's generation() when filled, and an
+ * entry whose tag no longer matches is looked up again rather than used, so
+ * adding or deleting a rule invalidates the whole cache in constant time and
+ * cached rule pointers are never used after their rule is deleted.
+ *
+ * The cache holds at most a fixed number of entries.  When full, an entry is
+ * evicted with the CLOCK algorithm: a hand sweeps the entries, clearing the
+ * reference bit that a hit sets, and evicts the first entry found without
+ * one.  New entries start unreferenced, so flows seen only once are evicted
+ * before flows that have hit.
+ *
+ * Works with either Classifier or Tuple_space as 'Engine'.
+ */
+
+namespace vigil {
+
+struct Flow_cache_stats {
+    uint64_t n_hits;            /* Lookups answered from the cache. */
+    uint64_t n_misses;          /* Lookups passed to the classifier. */
+    uint64_t n_stale;           /* Misses on an entry a rule change expired. */
+    uint64_t n_evictions;       /* Entries evicted to make room. */
+
+    /* Fraction of lookups answered from the cache, 0 if there were none. */
+    double hit_rate() const {
+        uint64_t n = n_hits + n_misses;
+        return n ? (double) n_hits / n : 0;
+    }
+};
+
+template<class Expr, typename Action>
+class Flow_cache {
+
+public:
+    typedef const Rule<Expr, Action>* Rule_ptr;
+    typedef std::vector<Rule_ptr> Rule_vector;
+
+    Flow_cache(size_t);
+
+    template<class Engine>
+    const Rule_vector& get_top_rules(Engine&, const Flow&,
+                                     Cnode_result<Expr, Action, Flow>&);
+    void clear();
+
+    size_t capacity() const { return entries.size(); }
+    size_t size() const { return n_used; }
+    const Flow_cache_stats& get_stats() const { return stats; }
+
+private:
+    struct Entry {
+        Flow flow;
+        uint64_t generation;    // classifier generation 'rules' are for
+        uint32_t hash;
+        int32_t next;           // next entry in the same hash bucket, or -1
+        bool referenced;        // hit since the CLOCK hand last passed
+        Rule_vector rules;
+    };
+
+    static const uint64_t INVALID = ~(uint64_t) 0;
+
+    std::vector<Entry> entries;
+    std::vector<int32_t> buckets;       // first entry per hash bucket, or -1
+    size_t n_used;
+    size_t hand;
+    Flow_cache_stats stats;
+
+    static uint32_t hash_value(uint32_t, uint32_t);
+    static uint32_t hash_flow(const Flow&);
+    static bool same_flow(const Flow&, const Flow&);
+    int32_t find(const Flow&, uint32_t) const;
+    int32_t evict();
+
+    Flow_cache(const Flow_cache&);
+    Flow_cache& operator=(const Flow_cache&);
+};
+
+
+/*
+ * Constructs an empty cache of at most 'capacity' entries, which must be
+ * nonzero.
+ */
+
+template<class Expr, typename Action>
+Flow_cache<Expr, Action>::Flow_cache(size_t capacity)
+    : entries(capacity), n_used(0), hand(0)
+{
+    assert(capacity > 0 && capacity < (1U << 30));
+
+    size_t n_buckets = 1;
+    while (n_buckets < capacity * 2) {
+        n_buckets = n_buckets << 1;
+    }
+    buckets.assign(n_buckets, -1);
+    memset(&stats, 0, sizeof stats);
+}
+
+
+/*
+ * Drops every entry.  Statistics are kept.
+ */
+
+template<class Expr, typename Action>
+void
+Flow_cache<Expr, Action>::clear()
+{
+    buckets.assign(buckets.size(), -1);
+    n_used = 0;
+    hand = 0;
+}
+
+
+/*
+ * Returns the rules of the best matching priority for 'flow' in 'classifier',
+ * in the order get_top_rules() returns them, from the cache if it holds a
+ * current entry for 'flow', else by looking 'flow' up with 'result' and
+ * caching what is found.  The returned vector belongs to the cache entry: a
+ * later call may refill or evict it, and its rules may be deleted once the
+ * classifier's generation() changes.  A caller that runs code while walking
+ * it, such as rule actions, should copy it first and stop if generation()
+ * changes.
+ */
+
+template<class Expr, typename Action>
+template<class Engine>
+const typename Flow_cache<Expr, Action>::Rule_vector&
+Flow_cache<Expr, Action>::get_top_rules(Engine& classifier, const Flow& flow,
+                                        Cnode_result<Expr, Action, Flow>& result)
+{
+    uint32_t hash = hash_flow(flow);
+    int32_t i = find(flow, hash);
+
+    if (i >= 0) {
+        Entry& entry = entries[i];
+        if (entry.generation == classifier.generation()) {
+            entry.referenced = true;
+            stats.n_hits++;
+            return entry.rules;
+        }
+        stats.n_stale++;
+    } else {
+        i = n_used < entries.size() ? n_used++ : evict();
+        Entry& entry = entries[i];
+        entry.flow = flow;
+        entry.hash = hash;
+        entry.referenced = false;
+        entry.next = buckets[hash & (buckets.size() - 1)];
+        buckets[hash & (buckets.size() - 1)] = i;
+    }
+    stats.n_misses++;
+
+    /* Stays invalid if filling it throws. */
+    Entry& entry = entries[i];
+    entry.generation = INVALID;
+    entry.rules.clear();
+
+    result.set_data(&flow);
+    classifier.get_top_rules(result);
+    const Rule<Expr, Action> *match = result.next();
+    if (match != NULL) {
+        uint32_t top_priority = match->priority;
+        do {
+            entry.rules.push_back(match);
+            match = result.next();
+        } while (match != NULL && match->priority == top_priority);
+    }
+    result.clear();
+
+    entry.generation = classifier.generation();
+    return entry.rules;
+}
+
+
+/*
+ * Returns the index of the entry for 'flow', whose hash is 'hash', or -1 if
+ * there is none.
+ */
+
+template<class Expr, typename Action>
+int32_t
+Flow_cache<Expr, Action>::find(const Flow& flow, uint32_t hash) const
+{
+    for (int32_t i = buckets[hash & (buckets.size() - 1)]; i >= 0;
+         i = entries[i].next)
+    {
+        if (entries[i].hash == hash && same_flow(entries[i].flow, flow)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/*
+ * Advances the CLOCK hand to the first unreferenced entry, clearing the
+ * reference bits it passes, unlinks that entry from its hash bucket and
+ * returns its index.
+ */
+
+template<class Expr, typename Action>
+int32_t
+Flow_cache<Expr, Action>::evict()
+{
+    int32_t victim;
+
+    for (;;) {
+        victim = hand;
+        hand = hand + 1 < entries.size() ? hand + 1 : 0;
+        if (!entries[victim].referenced) {
+            break;
+        }
+        entries[victim].referenced = false;
+    }
+
+    int32_t *prev = &buckets[entries[victim].hash & (buckets.size() - 1)];
+    while (*prev != victim) {
+        prev = &entries[*prev].next;
+    }
+    *prev = entries[victim].next;
+
+    stats.n_evictions++;
+    return victim;
+}
+
+
+/*
+ * Mixes 'value' into 'hash'.
+ */
+
+template<class Expr, typename Action>
+uint32_t
+Flow_cache<Expr, Action>::hash_value(uint32_t hash, uint32_t value)
+{
+    hash ^= value;
+    hash *= 0x9e3779b1;
+    return hash ^ (hash >> 16);
+}
+
+
+/*
+ * Hashes which fields 'flow' carries and their values and masks.
+ */
+
+template<class Expr, typename Action>
+uint32_t
+Flow_cache<Expr, Action>::hash_flow(const Flow& flow)
+{
+    const struct ofl_match *m = &flow.match;
+    uint32_t hash = hash_value(hash_value(0, m->present), m->masked);
+    unsigned int field;
+
+    OFL_MATCH_FOR_EACH_FIELD (field, m) {
+        const uint8_t *value = ofl_structs_match_field_value(m, field);
+        size_t len = ofl_structs_match_field_len(field);
+        if (m->masked & ((uint64_t) 1 << field)) {
+            len *= 2;
+        }
+        for (size_t i = 0; i < len; i += 4) {
+            uint32_t word = 0;
+            memcpy(&word, value + i, len - i < 4 ? len - i : 4);
+            hash = hash_value(hash, word);
+        }
+    }
+    return hash;
+}
+
+
+/*
+ * Returns true if 'a' and 'b' carry the same fields with the same values and
+ * masks.  Bytes of fields that are absent are not compared.
+ */
+
+template<class Expr, typename Action>
+bool
+Flow_cache<Expr, Action>::same_flow(const Flow& a, const Flow& b)
+{
+    const struct ofl_match *ma = &a.match, *mb = &b.match;
+    unsigned int field;
+
+    if (ma->present != mb->present || ma->masked != mb->masked) {
+        return false;
+    }
+
+    OFL_MATCH_FOR_EACH_FIELD (field, ma) {
+        size_t len = ofl_structs_match_field_len(field);
+        if (ma->masked & ((uint64_t) 1 << field)) {
+            len *= 2;
+        }
+        if (memcmp(ofl_structs_match_field_value(ma, field),
+                   ofl_structs_match_field_value(mb, field), len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace vigil
+
+#endif
@@ -23,6 +23,8 @@
 #include <map>
 #include <cstring>
 #include <iosfwd>
+#include <netinet/in.h>
+#include <boost/static_assert.hpp>
 #include "netinet++/ethernetaddr.hh"
 #include "openflow/openflow.h"
 //#include "openflow-pack-raw.hh"
@@ -33,6 +35,46 @@ namespace vigil {
 
 class Buffer;
 
+/* The C++ type of an OXM field value LEN bytes long. */
+template <size_t LEN> struct Oxm_value;
+template <> struct Oxm_value<1> { typedef uint8_t type; };
+template <> struct Oxm_value<2> { typedef uint16_t type; };
+template <> struct Oxm_value<4> { typedef uint32_t type; };
+template <> struct Oxm_value<8> { typedef uint64_t type; };
+template <> struct Oxm_value<ethernetaddr::LEN> { typedef ethernetaddr type; };
+template <> struct Oxm_value<16> { typedef struct in6_addr type; };
+
+/* Returns the OXM field value of type T whose bytes are at 'p'. */
+template <typename T>
+inline T oxm_value_from_bytes(const uint8_t *p)
+{
+    T value;
+    memcpy(&value, p, sizeof value);
+    return value;
+}
+
+template <>
+inline ethernetaddr oxm_value_from_bytes<ethernetaddr>(const uint8_t *p)
+{
+    return ethernetaddr(p);
+}
+
+/* Compile-time description of the OpenFlow basic class OXM field whose
+ * exact-match header is HEADER, e.g. Oxm_field<OXM_OF_ETH_SRC>. */
+template <uint32_t HEADER>
+struct Oxm_field {
+    BOOST_STATIC_ASSERT(OXM_VENDOR(HEADER) == OFPXMC_OPENFLOW_BASIC
+                        && !OXM_HASMASK(HEADER)
+                        && OXM_FIELD(HEADER) < OFL_MATCH_N_FIELDS);
+
+    static const uint32_t header = HEADER;
+    static const uint32_t masked_header = OXM_MAKE_WILD_HEADER(HEADER);
+    static const unsigned int index = OXM_FIELD(HEADER);
+    static const size_t length = OXM_LENGTH(HEADER);
+    typedef typename Oxm_value<OXM_LENGTH(HEADER)>::type type;
+    BOOST_STATIC_ASSERT(sizeof(type) == OXM_LENGTH(HEADER));
+};
+
 class Flow {
 public:
   struct ofl_match match;
@@ -46,15 +88,70 @@ public:
   /** Constructor from ofl_match
    */
   Flow(const struct ofl_match *match);
+  /** Constructor from an Ethernet frame received on 'in_port'
+   */
+  Flow(uint32_t in_port, const Buffer& packet);
+
+  /** Replaces the match with the fields of the 'len'-byte Ethernet frame
+   *  at 'packet', received on 'in_port', as a switch would extract them:
+   *  Ethernet and the outermost 802.1Q/802.1ad tag, then ARP, IPv4 or IPv6
+   *  with TCP, UDP, SCTP, ICMP or ICMPv6 and IPv6 neighbor discovery, or
+   *  the outermost MPLS label.  Values are kept in the byte order that
+   *  ofl_match keeps decoded matches in.  Truncated headers are left out.
+   */
+  void extract(uint32_t in_port, const uint8_t *packet, size_t len);
+
+  /** Typed access to the field with exact-match OXM header HEADER, e.g.
+   *  flow.get<OXM_OF_ETH_SRC>().  The field's place in the match is known
+   *  at compile time, so these need no lookup.  Values are kept as
+   *  ofl_match keeps them.
+   */
+  template<uint32_t HEADER>
+  bool has() const {
+     return match.present & ((uint64_t) 1 << Oxm_field<HEADER>::index);
+  }
+
+  /** Returns the value of field HEADER, or all-1-bits if it is absent.
+   *  All-1-bits is a valid value for some fields, e.g. OFPP_ANY for
+   *  OXM_OF_IN_PORT or the broadcast address for OXM_OF_ETH_DST, so
+   *  callers to whom a missing field matters must check has<HEADER>().
+   */
+  template<uint32_t HEADER>
+  typename Oxm_field<HEADER>::type get() const {
+     uint8_t bytes[Oxm_field<HEADER>::length];
+     if (has<HEADER>()) {
+          memcpy(bytes, ofl_structs_match_field_value(&match, Oxm_field<HEADER>::index),
+                 sizeof bytes);
+     } else {
+          memset(bytes, 0xff, sizeof bytes);
+     }
+     return oxm_value_from_bytes<typename Oxm_field<HEADER>::type>(bytes);
+  }
+
+  template<uint32_t HEADER>
+  void set(const typename Oxm_field<HEADER>::type& value) {
+     ofl_structs_match_put_bytes(&match, HEADER, &value, NULL);
+  }
+
+  template<uint32_t HEADER>
+  void set(const typename Oxm_field<HEADER>::type& value,
+           const typename Oxm_field<HEADER>::type& mask) {
+     ofl_structs_match_put_bytes(&match, Oxm_field<HEADER>::masked_header,
+                                 &value, &mask);
+  }
+
+  /** String-named access, for scripting and configuration.  Each call
+   *  looks 'name' up in the 'fields' map; use the typed accessors above on
+   *  per-packet paths.
+   */
+
   /** Add an OXM TLV to the match
    */
   template<typename T> 
   void Add_Field(std::string name, T value){
-
-    if(!fields.count(name))
-       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
-    else {
-       ofl_structs_match_put(&this->match, fields[name].first, value);
+    uint32_t header = field_header(name);
+    if (header) {
+       ofl_structs_match_put(&this->match, header, value);
     }
   }
   
@@ -63,38 +160,32 @@ public:
    */  
   template<typename T> 
   void Add_Field(std::string name, T value, T mask){
-    if(!fields.count(name))
-       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
-    else {
-       ofl_structs_match_put_masked(&this->match, OXM_MAKE_WILD_HEADER(fields[name].first), value, mask);
+    uint32_t header = field_header(name);
+    if (header) {
+       ofl_structs_match_put_masked(&this->match, OXM_MAKE_WILD_HEADER(header), value, mask);
     }
   }
 
   void Add_Field(std::string name, uint8_t value[ETH_ADDR_LEN]){
-
-    if(!fields.count(name))
-       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
-    else {
-       ofl_structs_match_put_eth(&this->match, fields[name].first, value);
+    uint32_t header = field_header(name);
+    if (header) {
+       ofl_structs_match_put_eth(&this->match, header, value);
     }
   }
 
   void Add_Field(std::string name, uint8_t value[ETH_ADDR_LEN],uint8_t  mask[ETH_ADDR_LEN]){
-
-    if(!fields.count(name))
-       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
-    else {
-       ofl_structs_match_put_eth_m(&this->match, OXM_MAKE_WILD_HEADER(fields[name].first), value, mask);
+    uint32_t header = field_header(name);
+    if (header) {
+       ofl_structs_match_put_eth_m(&this->match, OXM_MAKE_WILD_HEADER(header), value, mask);
     }
   }
  
   
   template<typename T>
   void get_Field(std::string name, T *value ){
-     struct ofl_match_tlv *omt;
-     HMAP_FOR_EACH_WITH_HASH(omt, struct ofl_match_tlv, hmap_node, hash_int(fields[name].first, 0),
-          &match.match_fields){
-          memcpy(value, omt->value, sizeof(T));
+     uint8_t *v = ofl_structs_match_get(&match, field_header(name));
+     if (v) {
+          memcpy(value, v, sizeof(T));
           return;   
      }
      /* Field is not present in the packet */
@@ -102,10 +193,9 @@ public:
   }
   
   void get_Field(std::string name, uint8_t  value[ETH_ADDR_LEN] ){
-     struct ofl_match_tlv *omt;
-     HMAP_FOR_EACH_WITH_HASH(omt, struct ofl_match_tlv, hmap_node, hash_int(fields[name].first, 0),
-          &match.match_fields){
-          memcpy(value, omt->value, ETH_ADDR_LEN);
+     uint8_t *v = ofl_structs_match_get(&match, field_header(name));
+     if (v) {
+          memcpy(value, v, ETH_ADDR_LEN);
           return;   
      }
       if (!strcmp("eth_src", name.c_str()))
@@ -120,6 +210,17 @@ public:
   uint64_t hash_code() const;
 private:
   void init();
+
+  /* Returns the OXM header of the field called 'name', or 0 with a message
+   * if there is no such field. */
+  static uint32_t field_header(const std::string& name) {
+    std::map<std::string, std::pair<int,int> >::const_iterator i = fields.find(name);
+    if (i == fields.end()) {
+       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
+       return 0;
+    }
+    return i->second.first;
+  }
 };
 bool operator==(const Flow& lhs, const Flow& rhs);
 bool operator!=(const Flow& lhs, const Flow& rhs);
@@ -128,17 +229,16 @@ std::ostream& operator<<(std::ostream&, const Flow&);
 template<> inline
 void Flow::Add_Field<std::string>(std::string name, std::string value){
 
-    if(!fields.count(name))
-       std::cout <<"Match field: "<< name << " is not supported "<< std::endl;
-    else {
-        if(fields[name].second ==  ETH_ADDR_LEN){
+    uint32_t header = field_header(name);
+    if (header) {
+        if(OXM_LENGTH(header) ==  ETH_ADDR_LEN){
             ethernetaddr addr = ethernetaddr(value);
-            ofl_structs_match_put_eth(&this->match, fields[name].first, addr.octet);
+            ofl_structs_match_put_eth(&this->match, header, addr.octet);
         }
         else {
             struct in6_addr addr;
             inet_pton(AF_INET6, value.c_str(), &addr); 
-            ofl_structs_match_put(&this->match, fields[name].first, addr);
+            ofl_structs_match_put(&this->match, header, addr);
         }
     }
 }
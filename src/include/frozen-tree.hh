@@ -0,0 +1,262 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef  FROZEN_TREE_HH
+#define  FROZEN_TREE_HH
+
+#include <stdint.h>
+#include <vector>
+
+#include "cnode.hh"
+#include "cnode-result.hh"
+#include "rule.hh"
+
+/*
+ * Frozen, read-only copy of a Cnode tree, for lookups.
+ *
+ * A Cnode tree allocates every node and bucket array separately and keeps
+ * rules in linked lists, so a lookup chases pointers to scattered memory at
+ * every level.  freeze() lays the tree out again in one allocation: an array
+ * of rule pointers, an array of nodes in breadth-first order, and for each
+ * split node an array of offsets into the node array, one per hash bucket
+ * plus an end.  A node's children are stored next to each other, grouped by
+ * bucket, so the children in bucket b are the nodes from heads[b] up to
+ * heads[b + 1], with no chaining, and a node's rules are one range of the
+ * rule array.  Everything is addressed by 32-bit offsets.
+ *
+ * The copy holds rule pointers but no pointers into the Cnode tree, so it
+ * stays correct while the tree is restructured; it must be frozen again (or
+ * cleared) before any rule it holds is deleted or changes priority.
+ * Classifier tracks that with its generation().
+ */
+
+namespace vigil {
+
+template<class Expr, typename Action>
+class Frozen_tree {
+
+public:
+    typedef Rule<Expr, Action>* Rule_ptr;
+
+    Frozen_tree() : rules(NULL), nodes(NULL), heads(NULL), n_nodes(0) { }
+
+    void freeze(const Cnode<Expr, Action>&);
+    void clear() { n_nodes = 0; }   /* memory is kept for the next freeze() */
+    bool empty() const { return n_nodes == 0; }
+    size_t memory() const { return arena.size() * sizeof arena[0]; }
+
+    template<typename Data>
+    void traverse(Cnode_result<Expr, Action, Data>&) const;
+
+private:
+    struct Node {
+        uint32_t value;
+        uint32_t split_field;   // NONE for a leaf
+        uint32_t bucket_mask;
+        uint32_t heads;         // offset of the bucket_mask + 2 bucket heads
+        uint32_t any;           // offset of the node for ANY, or NONE
+        uint32_t first_rule;    // offset of the node's rules
+        uint32_t n_rules;
+    };
+
+    static const uint32_t NONE = ~(uint32_t) 0;
+
+    std::vector<uint64_t> arena;        // holds all three arrays
+    const Rule_ptr *rules;
+    const Node *nodes;
+    const uint32_t *heads;
+    uint32_t n_nodes;
+    mutable std::vector<uint32_t> to_traverse;
+
+    static void count(const Cnode<Expr, Action>&, size_t&, size_t&, size_t&);
+    static size_t align(size_t n) { return (n + 7) & ~(size_t) 7; }
+
+    Frozen_tree(const Frozen_tree&);
+    Frozen_tree& operator=(const Frozen_tree&);
+};
+
+
+/*
+ * Adds the number of nodes, bucket heads and rules in the sub-tree rooted at
+ * 'node' to 'n_nodes', 'n_heads' and 'n_rules'.
+ */
+
+template<class Expr, typename Action>
+void
+Frozen_tree<Expr, Action>::count(const Cnode<Expr, Action>& node,
+                                 size_t& n_nodes, size_t& n_heads,
+                                 size_t& n_rules)
+{
+    n_nodes++;
+    n_rules += node.rules.size();
+
+    if (node.bucket_mask < 0) {
+        return;
+    }
+
+    n_heads += node.bucket_mask + 2;
+    for (int i = 0; i <= node.bucket_mask; i++) {
+        for (const Cnode<Expr, Action> *child = node.buckets[i];
+             child != NULL; child = child->next)
+        {
+            count(*child, n_nodes, n_heads, n_rules);
+        }
+    }
+
+    if (node.any_node != NULL) {
+        count(*node.any_node, n_nodes, n_heads, n_rules);
+    }
+}
+
+
+/*
+ * Replaces the copy with one of the tree rooted at 'root'.  If an exception is
+ * thrown, the previous copy is left as it was.
+ */
+
+template<class Expr, typename Action>
+void
+Frozen_tree<Expr, Action>::freeze(const Cnode<Expr, Action>& root)
+{
+    size_t n_nodes_ = 0, n_heads = 0, n_rules = 0;
+    count(root, n_nodes_, n_heads, n_rules);
+
+    size_t rules_size = align(n_rules * sizeof(Rule_ptr));
+    size_t nodes_size = align(n_nodes_ * sizeof(Node));
+    size_t heads_size = align(n_heads * sizeof(uint32_t));
+    std::vector<uint64_t> new_arena((rules_size + nodes_size + heads_size)
+                                    / sizeof(uint64_t));
+    std::vector<const Cnode<Expr, Action> *> queue;
+    queue.reserve(n_nodes_);
+
+    char *base = (char *) &new_arena[0];
+    Rule_ptr *new_rules = (Rule_ptr *) base;
+    Node *new_nodes = (Node *) (base + rules_size);
+    uint32_t *new_heads = (uint32_t *) (base + rules_size + nodes_size);
+    uint32_t next_rule = 0, next_head = 0;
+
+    queue.push_back(&root);
+    for (size_t i = 0; i < queue.size(); i++) {
+        const Cnode<Expr, Action>& cnode = *queue[i];
+        Node& node = new_nodes[i];
+
+        node.value = cnode.value;
+        node.first_rule = next_rule;
+        node.n_rules = cnode.rules.size();
+        for (typename Cnode<Expr, Action>::Rule_list::const_iterator rule
+                 = cnode.rules.begin(); rule != cnode.rules.end(); ++rule)
+        {
+            new_rules[next_rule++] = *rule;
+        }
+
+        if (cnode.bucket_mask < 0) {
+            node.split_field = NONE;
+            node.bucket_mask = 0;
+            node.heads = 0;
+            node.any = NONE;
+            continue;
+        }
+
+        node.split_field = cnode.split_field;
+        node.bucket_mask = cnode.bucket_mask;
+        node.heads = next_head;
+        for (int b = 0; b <= cnode.bucket_mask; b++) {
+            new_heads[next_head++] = queue.size();
+            for (const Cnode<Expr, Action> *child = cnode.buckets[b];
+                 child != NULL; child = child->next)
+            {
+                queue.push_back(child);
+            }
+        }
+        new_heads[next_head++] = queue.size();
+
+        node.any = NONE;
+        if (cnode.any_node != NULL) {
+            node.any = queue.size();
+            queue.push_back(cnode.any_node);
+        }
+    }
+
+    arena.swap(new_arena);
+    rules = new_rules;
+    nodes = new_nodes;
+    heads = new_heads;
+    n_nodes = n_nodes_;
+}
+
+
+/*
+ * Does what Cnode::traverse() does for every node of the tree, for 'result's'
+ * data, with a stack instead of the Classifier's queue.
+ */
+
+template<class Expr, typename Action>
+template<typename Data>
+void
+Frozen_tree<Expr, Action>::traverse(Cnode_result<Expr, Action, Data>& result) const
+{
+    uint32_t rule_value;
+
+    to_traverse.push_back(0);
+    while (!to_traverse.empty()) {
+        const Node& node = nodes[to_traverse.back()];
+        to_traverse.pop_back();
+
+        if (node.n_rules != 0) {
+            result.push(rules + node.first_rule,
+                        rules + node.first_rule + node.n_rules);
+        }
+
+        if (node.split_field == NONE) {
+            continue;
+        }
+
+        if (node.any != NONE) {
+            to_traverse.push_back(node.any);
+        }
+
+        const uint32_t *bucket_heads = heads + node.heads;
+        uint32_t idx = 0;
+
+        while (get_field<Expr, Data>(node.split_field, *(result.data), idx,
+                                     rule_value)) {
+            int bucket = Cnode<Expr, Action>::get_bucket(rule_value,
+                                                         node.bucket_mask);
+            for (uint32_t child = bucket_heads[bucket];
+                 child < bucket_heads[bucket + 1]; child++)
+            {
+                if (nodes[child].value == rule_value) {
+                    to_traverse.push_back(child);
+                    break;
+                }
+            }
+            idx++;
+        }
+
+        if (idx == 0) {
+            for (uint32_t child = bucket_heads[0];
+                 child < bucket_heads[node.bucket_mask + 1]; child++)
+            {
+                to_traverse.push_back(child);
+            }
+        }
+    }
+}
+
+} // namespace vigil
+
+#endif
@@ -0,0 +1,67 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAILBOX_HH
+#define MAILBOX_HH 1
+
+#include <boost/function.hpp>
+#include <deque>
+#include "poll-loop.hh"
+#include "threads/native.hh"
+
+namespace vigil {
+
+/* A queue of callbacks that any thread may post to and that runs them, in
+ * order, from the Poll_loop it is added to.
+ *
+ * Co_sema, Co_cond and the other cooperative primitives may only be used
+ * within a single thread group, so Mailbox is the way to hand work from one
+ * thread group (or native thread) to another.  The receiving side is woken up
+ * through a pipe, which is written only when the queue goes from empty to
+ * nonempty. */
+class Mailbox
+    : public Pollable
+{
+public:
+    typedef boost::function<void()> Callback;
+
+    Mailbox();
+    ~Mailbox();
+
+    /* Queues 'callback' to be run by the Poll_loop that polls this Mailbox.
+     * May be called from any thread. */
+    void post(const Callback& callback);
+
+    /* Pollable implementation.  Runs the callbacks queued before the call. */
+    bool poll();
+    void wait();
+
+private:
+    /* Posted callbacks, protected by 'mutex'. */
+    Native_mutex mutex;
+    std::deque<Callback> incoming;
+
+    /* Callbacks taken from 'incoming' but not yet run.  Only touched by the
+     * receiving Poll_loop. */
+    std::deque<Callback> pending;
+
+    int fds[2];
+};
+
+} // namespace vigil
+
+#endif /* mailbox.hh */
@@ -41,9 +41,21 @@ public:
 
     static std::string get_name(enum ofp_type type);
     static std::string get_stats_name(enum ofp_multipart_types type);
+
+    /* Event types for the names above, looked up once per process. */
+    static Event_type get_event_type(enum ofp_type type);
+    static Event_type get_stats_event_type(enum ofp_multipart_types type);
+
+    /* Ofp_msg_events are allocated from a pool, since one is created and
+     * destroyed for every message received.  Subclasses of a different size
+     * use the global allocator. */
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
 protected:
     Ofp_msg_event(std::string name, datapathid _dpid, uint32_t _xid, boost::shared_ptr<Ofp_msg> _msg) :
         Event(name), dpid(_dpid), xid(_xid), msg(_msg) { };
+    Ofp_msg_event(Event_type type, datapathid _dpid, uint32_t _xid, boost::shared_ptr<Ofp_msg> _msg) :
+        Event(type), dpid(_dpid), xid(_xid), msg(_msg) { };
 };
 
 } // namespace vigil
@@ -20,31 +20,171 @@
 #ifndef OFP_MSG_HH
 #define OFP_MSG_HH
 
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include "buffer.hh"
+#include "threads/native.hh"
 #include "../oflib/ofl-messages.h"
 
 namespace vigil
 {
 
+class Ofp_msg;
+
+/* A pool of arenas for Ofp_msg::unpack(), usually one per connection.  Each
+ * message is decoded into an arena of its own, which goes back to the pool
+ * once the message is destroyed.  Since messages are often destroyed in
+ * another thread group than the one that decoded them, any thread may take
+ * arenas from the pool and return them. */
+class Ofp_msg_arenas {
+public:
+    /* Creates a pool that keeps up to 'max_free' unused arenas. */
+    explicit Ofp_msg_arenas(size_t max_free = 16);
+    ~Ofp_msg_arenas();
+
+    struct ::ofl_arena *get();
+    void put(struct ::ofl_arena *);
+
+    /* Sets 'handler' to be called when a message lazily decoded into this
+     * pool's arenas is found to be malformed, with the message and the
+     * error, before the access that found it throws Bad_ofp_msg.  It runs in
+     * the thread group that accessed the message.  Must be set before the
+     * pool is used. */
+    typedef boost::function<void(const Ofp_msg&, ofl_err)> Error_handler;
+    void set_error_handler(const Error_handler& handler)
+        { error_handler = handler; }
+    void report_error(const Ofp_msg& msg, ofl_err error) const {
+        if (error_handler) {
+            error_handler(msg, error);
+        }
+    }
+
+private:
+    Error_handler error_handler;
+
+    /* The arena returned last, if any.  It is exchanged atomically, so that
+     * a connection that is decoding one message at a time never has to lock
+     * 'mutex'. */
+    struct ::ofl_arena *spare;
+
+    Native_mutex mutex;
+    std::vector<struct ::ofl_arena *> free_arenas;
+    const size_t max_free;
+
+    Ofp_msg_arenas(const Ofp_msg_arenas&);
+    Ofp_msg_arenas& operator=(const Ofp_msg_arenas&);
+};
+
+/* Thrown by Ofp_msg when the body of a lazily decoded message is found to be
+ * malformed. */
+class Bad_ofp_msg
+    : public std::runtime_error {
+public:
+    Bad_ofp_msg(ofl_err error_)
+        : std::runtime_error("malformed OpenFlow message"), error(error_) { }
+
+    const ofl_err error;
+};
+
 // wrapper for ofl_msg structures
 class Ofp_msg {
 public:
-    Ofp_msg(struct ::ofl_msg_header *msg_) : msg(msg_) { };
+    Ofp_msg(struct ::ofl_msg_header *msg_)
+        : msg(msg_), arena(NULL), buffer(NULL), error(0) { };
+
+    /* Wraps 'msg_', which was decoded into 'arena_', and returns the arena
+     * to 'arenas_' on destruction. */
+    Ofp_msg(struct ::ofl_msg_header *msg_, struct ::ofl_arena *arena_,
+            const boost::shared_ptr<Ofp_msg_arenas>& arenas_)
+        : msg(msg_), arena(arena_), arenas(arenas_), buffer(NULL),
+          error(0) { };
+
+    /* Wraps the undecoded message in 'buffer_', whose header must have been
+     * checked with ofl_msg_unpack_header(), and deletes 'buffer_' on
+     * destruction.  The message is decoded into an arena from 'arenas_' the
+     * first time it is accessed. */
+    Ofp_msg(Buffer *buffer_, const boost::shared_ptr<Ofp_msg_arenas>& arenas_)
+        : msg(NULL), arena(NULL), arenas(arenas_), buffer(buffer_),
+          error(0) { };
+
+    /* Returns a shared Ofp_msg that owns 'msg'.  The Ofp_msg and its
+     * reference count share one block from a pool. */
+    static boost::shared_ptr<Ofp_msg> create(struct ::ofl_msg_header *msg);
+
+    /* Decodes the 'len'-byte OpenFlow message in 'buf' into an arena from
+     * 'arenas' and stores its transaction id in '*xid'.  Returns the shared
+     * message, or a null pointer if it cannot be decoded.  The message is
+     * released all at once when the last reference to it is dropped. */
+    static boost::shared_ptr<Ofp_msg> unpack(
+        uint8_t *buf, size_t len, uint32_t *xid,
+        const boost::shared_ptr<Ofp_msg_arenas>& arenas);
+
+    /* Like the above, but only checks the message header and stores the
+     * transaction id in '*xid'.  The Ofp_msg takes ownership of 'b' on
+     * success, and decodes the message the first time it is accessed
+     * through operator* or operator->, with the packet data of packet-ins
+     * and other messages that carry data left in 'b'.  So a message that no
+     * handler looks at is never decoded.
+     *
+     * If the message body turns out to be malformed, the access reports the
+     * error to the error handler of 'arenas' and throws Bad_ofp_msg, as does
+     * every later access.  The message is decoded without locking: like the
+     * events that carry it, it may only be used by one thread group at a
+     * time. */
+    static boost::shared_ptr<Ofp_msg> unpack(
+        std::auto_ptr<Buffer>& b, uint32_t *xid,
+        const boost::shared_ptr<Ofp_msg_arenas>& arenas);
+
+    /* Returns the message type, and for a multipart reply its multipart
+     * type, without decoding the message. */
+    enum ofp_type get_type() const;
+    enum ofp_multipart_types get_multipart_type() const;
+
+    /* Returns true if the message has been decoded. */
+    bool is_decoded() const { return msg != NULL; }
+
+    /* Decodes the message now, unless it already has been.  Returns 0 if
+     * successful, otherwise the error, in which case the message stays
+     * undecoded and accessing it throws Bad_ofp_msg.  The error is left to
+     * the caller: it is not passed to the error handler. */
+    ofl_err try_decode() const;
+
+    /* Returns the message as received, or null if the Ofp_msg was built
+     * from a decoded message. */
+    const Buffer *get_buffer() const { return buffer; }
 
     struct ofl_msg_header * operator*() const {
-        return msg;
+        return msg ? msg : decode();
     };
 
     struct ofl_msg_header * operator->() const {
-        return msg;
+        return msg ? msg : decode();
     };
 
 
     ~Ofp_msg(void) {
-        ofl_msg_free(msg, NULL/*ofl_exp*/);
+        if (arena) {
+            arenas->put(arena);
+        } else if (msg) {
+            ofl_msg_free(msg, NULL/*ofl_exp*/);
+        }
+        delete buffer;
     };
 
 private:
-    struct ::ofl_msg_header *msg;
+    mutable struct ::ofl_msg_header *msg;
+    mutable struct ::ofl_arena *arena;
+    boost::shared_ptr<Ofp_msg_arenas> arenas;
+    Buffer *buffer;
+    mutable ofl_err error;      /* Why decoding failed, if it did. */
+
+    struct ::ofl_msg_header *decode() const;
+
+    Ofp_msg(const Ofp_msg&);
+    Ofp_msg& operator=(const Ofp_msg&);
 };
 
 } // namespace vigil
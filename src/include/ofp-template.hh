@@ -0,0 +1,150 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OFP_TEMPLATE_HH
+#define OFP_TEMPLATE_HH 1
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "openflow/openflow.h"
+#include "../oflib/ofl-messages.h"
+
+namespace vigil {
+
+/* A flow-mod or packet-out message packed to wire format once, to be sent
+ * many times with a few fields changed.  A reactive application describes
+ * the shape of the message it sends for each packet-in (match fields,
+ * instructions, actions) once, and then for each packet-in fills in only the
+ * values that vary, such as the match values, the buffer id and the output
+ * port, with Ofp_template_msg:
+ *
+ *     Ofp_template tmpl(&mod.fm_msg.header);       // Once.
+ *     ...
+ *     std::auto_ptr<Buffer> b(new Array_buffer(tmpl.size()));
+ *     Ofp_template_msg msg(tmpl, b->data(), b->size());  // Per packet-in.
+ *     msg.set_field32(OXM_OF_IN_PORT, in_port);
+ *     msg.set(Ofp_template::BUFFER_ID, in->buffer_id);
+ *     msg.set(Ofp_template::OUTPUT_PORT, out_port);
+ *     send_openflow_command(dpid, b, true);
+ *
+ * Apart from the buffer, this does not allocate memory or run the ofl
+ * packers.
+ *
+ * An Ofp_template is not modified once constructed, so it may be shared by
+ * thread groups. */
+class Ofp_template {
+public:
+    /* The fixed-size fields that an Ofp_template_msg can change. */
+    enum Slot {
+        XID,                    /* Transaction id. */
+        COOKIE,                 /* Flow-mod cookie. */
+        PRIORITY,               /* Flow-mod priority. */
+        IDLE_TIMEOUT,           /* Flow-mod idle timeout. */
+        HARD_TIMEOUT,           /* Flow-mod hard timeout. */
+        BUFFER_ID,              /* Flow-mod or packet-out buffer id. */
+        IN_PORT,                /* Packet-out in_port. */
+        OUTPUT_PORT,            /* Port of the first output action. */
+        N_SLOTS
+    };
+
+    /* Maximum size of a template.  A buffer this large also holds any
+     * template with a full-sized Ethernet frame of packet-out data. */
+    static const size_t MAX_SIZE = 2048;
+
+    /* Packs 'msg', which must be an OFPT_FLOW_MOD or OFPT_PACKET_OUT, as
+     * the template's initial contents.  The values in 'msg' serve as the
+     * defaults for each message built from the template.  Throws
+     * std::runtime_error if 'msg' cannot be packed. */
+    explicit Ofp_template(struct ofl_msg_header *msg);
+
+    /* Size of a message built from the template, without packet-out
+     * data. */
+    size_t size() const { return packed.size(); }
+
+    bool has_slot(Slot slot) const { return slots[slot].offset != 0; }
+
+    /* Returns true if the template's match has a field with OXM header
+     * 'oxm_header', so that Ofp_template_msg::set_field() can change it. */
+    bool has_field(uint32_t oxm_header) const;
+
+private:
+    friend class Ofp_template_msg;
+
+    struct Slot_pos {
+        uint16_t offset;        /* Offset in the message, 0 if absent. */
+        uint16_t width;         /* In bytes. */
+    };
+
+    struct Field_pos {
+        uint32_t header;        /* OXM header. */
+        uint16_t offset;        /* Offset of the value in the message. */
+    };
+
+    std::vector<uint8_t> packed;
+    Slot_pos slots[N_SLOTS];
+    std::vector<Field_pos> fields;
+    size_t data_offset;         /* Packet-out data offset, 0 if none. */
+
+    void set_slot(Slot, size_t offset, size_t width);
+    void find_match_fields(size_t match_offset);
+    void find_output_port(size_t actions_offset, size_t actions_len);
+    int find_field(uint32_t oxm_header) const;
+};
+
+/* A message built from an Ofp_template in a buffer supplied by the caller,
+ * which may be the Buffer that is then queued for transmission. */
+class Ofp_template_msg {
+public:
+    /* Copies 'tmpl' into the 'buf_size' bytes at 'buf', which must be at
+     * least tmpl.size() bytes. */
+    Ofp_template_msg(const Ofp_template& tmpl, uint8_t *buf, size_t buf_size);
+
+    /* Sets 'slot' to 'value', in network byte order.  The template must
+     * have the slot. */
+    void set(Ofp_template::Slot slot, uint64_t value);
+
+    /* Sets the value of the match field with OXM header 'oxm_header' to the
+     * OXM_LENGTH(oxm_header) bytes at 'value', which must already be in
+     * network byte order, and returns true.  Returns false if the template's
+     * match has no such field. */
+    bool set_field(uint32_t oxm_header, const void *value);
+    bool set_field8(uint32_t oxm_header, uint8_t value);
+    bool set_field16(uint32_t oxm_header, uint16_t value);
+    bool set_field32(uint32_t oxm_header, uint32_t value);
+    bool set_field64(uint32_t oxm_header, uint64_t value);
+
+    /* Replaces the data of a packet-out message by the 'len' bytes at
+     * 'data'.  Returns false if the message is not a packet-out or the data
+     * does not fit in the buffer. */
+    bool set_data(const void *data, size_t len);
+
+    const struct ofp_header *header() const {
+        return reinterpret_cast<const struct ofp_header *>(buf);
+    }
+    size_t size() const { return len; }
+
+private:
+    const Ofp_template& tmpl;
+    uint8_t *buf;
+    size_t buf_size;
+    size_t len;
+};
+
+} // namespace vigil
+
+#endif /* ofp-template.hh */
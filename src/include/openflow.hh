@@ -20,6 +20,7 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
+#include <boost/ptr_container/ptr_deque.hpp>
 #include <inttypes.h>
 #include <list>
 #include <memory>
@@ -71,6 +72,7 @@ public:
     /* Core functionality. */
     int connect(bool block);
     int send_openflow(const ofp_header*, bool block);
+    int send_openflow(std::auto_ptr<Buffer>&, bool block);
     std::auto_ptr<Buffer> recv_openflow(int& error, bool block);
 
     // Buffer to handle OFMP extended data messages
@@ -113,6 +115,7 @@ public:
 protected:
     virtual int do_connect() = 0;
     virtual int do_send_openflow(const ofp_header*) = 0;
+    virtual int do_send_openflow_buffer(std::auto_ptr<Buffer>&);
     virtual std::auto_ptr<Buffer> do_recv_openflow(int& error) = 0;
     virtual void do_connect_wait() = 0;
     virtual void do_send_openflow_wait() = 0;
@@ -148,6 +151,7 @@ private:
     void s_send_error();
     bool need_to_wait_for_connect();
     int call_send_openflow(const ofp_header*);
+    int call_send_openflow(std::auto_ptr<Buffer>&);
     std::auto_ptr<Buffer> call_recv_openflow(int& error);
     void run();
 };
@@ -169,11 +173,51 @@ public:
     std::string to_string();
     Connection_type get_conn_type(); 
     std::string get_ssl_fingerprint();
-    uint32_t get_local_ip();  
-    uint32_t get_remote_ip();  
+    uint32_t get_local_ip();
+    uint32_t get_remote_ip();
+
+    /* Receive batching.
+     *
+     * By default each connection reads up to 'rx_ring_size' bytes from its
+     * stream at a time and copies every complete message read to an 8-byte
+     * aligned offset in a receive ring of the same size.  Each message is
+     * handed out as a Buffer that shares the ring's storage, so that a single
+     * read system call can yield many messages without a heap allocation
+     * for each.  A ring stays allocated for as long as any message in it is
+     * alive; once a few rings are pinned that way, further messages are
+     * copied into buffers of their own until the rings are released.
+     *
+     * A size of 0 selects the unbatched mode, which reads each message's
+     * header and body separately into a freshly allocated buffer.  Affects
+     * only connections created after the call. */
+    static void set_rx_ring_size(size_t);
+    static size_t get_rx_ring_size();
+
+    /* Number of read system calls that returned data and number of messages
+     * received on this connection.  Their ratio is the number of messages
+     * parsed per read. */
+    uint64_t get_n_rx_reads() const { return n_rx_reads; }
+    uint64_t get_n_rx_msgs() const { return n_rx_msgs; }
+
+    /* Transmit queueing.
+     *
+     * Messages accepted for transmission are queued and written out in
+     * batches with a single gather-write per batch.  Once the queue holds
+     * 'high' bytes or more, further messages are refused with EAGAIN until
+     * the queue drains to 'low' bytes or fewer.  Affects only connections
+     * created after the call. */
+    static void set_tx_watermarks(size_t low, size_t high);
+    static size_t get_tx_low_watermark();
+    static size_t get_tx_high_watermark();
+
+    /* Number of write system calls that wrote data and number of messages
+     * transmitted on this connection. */
+    uint64_t get_n_tx_writes() const { return n_tx_writes; }
+    uint64_t get_n_tx_msgs() const { return n_tx_msgs; }
 private:
     virtual int do_connect();
     virtual int do_send_openflow(const ofp_header*);
+    virtual int do_send_openflow_buffer(std::auto_ptr<Buffer>&);
     virtual std::auto_ptr<Buffer> do_recv_openflow(int& error);
     virtual void do_connect_wait();
     virtual void do_send_openflow_wait();
@@ -181,17 +225,58 @@ private:
 
     Auto_fsm tx_fsm;
     void tx_run();
-    int send_tx_buf();
+    int flush_tx_queue();
+    void clear_tx_queue();
 
     int do_read(void *, size_t);
+    int check_read(ssize_t n, bool partial);
+
+    std::auto_ptr<Buffer> recv_unbatched(int& error);
+    std::auto_ptr<Buffer> recv_batched(int& error);
+    void reserve_rx_in(size_t need);
+    std::auto_ptr<Buffer> copy_rx_msg(const uint8_t *, size_t length);
+    bool next_rx_ring();
 
     std::auto_ptr<Async_stream> stream;
 
+    /* Unbatched receive state. */
     size_t rx_bytes;
     ofp_header rx_header;
     std::auto_ptr<Buffer> rx_buf;
 
-    std::auto_ptr<Buffer> tx_buf;
+    /* Batched receive state.  Bytes [rx_head, rx_tail) of 'rx_in' have been
+     * read from the stream but not yet handed out.  Messages handed out are
+     * copied to 'rx_ring' starting at offset 'rx_used'.  'rx_pinned' holds
+     * earlier rings, up to 'max_rx_pinned' of them, that were still referred
+     * to by messages when they filled up. */
+    std::vector<uint8_t> rx_in;
+    size_t rx_head;
+    size_t rx_tail;
+    boost::shared_array<uint8_t> rx_ring;
+    size_t rx_used;
+    std::vector<boost::shared_array<uint8_t> > rx_pinned;
+    const size_t rx_ring_size;
+    static size_t default_rx_ring_size;
+    static const size_t max_rx_pinned = 4;
+
+    uint64_t n_rx_reads;
+    uint64_t n_rx_msgs;
+
+    /* Transmit queue.  'tx_queued' is the number of bytes in 'tx_queue' not
+     * yet written.  'tx_full' is set when 'tx_queued' reaches 'tx_high' and
+     * cleared when it drops back to 'tx_low'. */
+    boost::ptr_deque<Buffer> tx_queue;
+    size_t tx_queued;
+    const size_t tx_low;
+    const size_t tx_high;
+    bool tx_full;
+    Co_cond tx_drained;
+    static size_t default_tx_low;
+    static size_t default_tx_high;
+
+    uint64_t n_tx_writes;
+    uint64_t n_tx_msgs;
+
     Connection_type conn_type; 
 };
 
@@ -226,6 +311,7 @@ private:
 
     virtual int do_connect();
     virtual int do_send_openflow(const ofp_header*);
+    virtual int do_send_openflow_buffer(std::auto_ptr<Buffer>&);
     virtual std::auto_ptr<Buffer> do_recv_openflow(int& error);
     virtual void do_connect_wait();
     virtual void do_send_openflow_wait();
@@ -21,6 +21,7 @@
 #include <boost/noncopyable.hpp>
 #include <list>
 #include <cassert>
+#include "threads/impl.hh"
 
 namespace vigil {
 
@@ -71,11 +72,14 @@ private:
     std::list<Pollable_ref>::iterator pollables_pos;
 };
 
-/* A loop that polls a set of Pollables in round-robin fashion, forever.  */
+/* A loop that polls a set of Pollables in round-robin fashion, forever.
+ *
+ * The loop's threads belong to 'group', which must be the group of the thread
+ * that calls run(). */
 class Poll_loop
 {
 public:
-    Poll_loop(unsigned int n_threads);
+    Poll_loop(unsigned int n_threads, co_group* group = &co_group_coop);
     ~Poll_loop();
 
     /* Add 'p' to the set of Pollables to poll.  'p' must not currently be in
@@ -24,6 +24,8 @@
 #include <signal.h>
 #include <vector>
 
+struct epoll_event;
+
 namespace vigil {
 
 /* An interface to poll() that can be interrupted by another thread.
@@ -59,6 +61,13 @@ public:
      * On systems that lack ppoll(), the contents of 'pollfds' are modified
      * temporarily for the duration of the call. */
     int poll(std::vector<pollfd>& pollfds, const struct timespec *timeout);
+
+#if defined(HAVE_PPOLL) && defined(HAVE_EPOLL_PWAIT)
+    /* Invokes the epoll_wait() system call on 'epfd' with the given
+     * 'timeout', storing up to 'maxevents' ready events into 'events'. */
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+                   const struct timespec *timeout);
+#endif
 private:
 #ifdef HAVE_PPOLL
     int sig_nr;
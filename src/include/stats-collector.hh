@@ -0,0 +1,73 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STATS_COLLECTOR_HH
+#define STATS_COLLECTOR_HH 1
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "netinet++/datapathid.hh"
+#include "ofp-msg-event.hh"
+#include "../oflib/ofl-stats-columns.h"
+
+namespace vigil {
+
+/* Collects the parts of flow, port or queue statistics replies into
+ * ofl_stats_columns.  Parts are matched up by datapath and transaction id,
+ * so replies from several switches, or to several requests to one switch,
+ * may be interleaved.  Storage of finished replies is reused for later
+ * ones, so that polling the same switches again does not allocate.
+ *
+ * Like the events it is fed, a Stats_collector may only be used by one
+ * thread group at a time. */
+class Stats_collector {
+public:
+    /* Creates a collector for replies of 'type', one of OFPMP_FLOW,
+     * OFPMP_PORT_STATS and OFPMP_QUEUE. */
+    explicit Stats_collector(enum ofp_multipart_types type);
+    ~Stats_collector();
+
+    /* Adds the entries of the reply part in 'e'.  Returns the entries of the
+     * whole reply if 'e' is its last part, valid until the next call, and
+     * otherwise a null pointer.  Throws Bad_ofp_msg if the part is
+     * malformed, after dropping the parts of the reply received so far. */
+    const struct ofl_stats_columns *add(const Ofp_msg_event& e);
+
+    /* Drops the parts of unfinished replies from 'dpid', e.g. when it
+     * leaves. */
+    void forget(const datapathid& dpid);
+
+private:
+    typedef std::pair<datapathid, uint32_t> Key;
+    typedef std::map<Key, struct ofl_stats_columns *> Partial_map;
+
+    const enum ofp_multipart_types type;
+    Partial_map partial;
+    struct ofl_stats_columns *done;
+    std::vector<struct ofl_stats_columns *> spare;
+
+    struct ofl_stats_columns *get_columns();
+    void put_columns(struct ofl_stats_columns *);
+
+    Stats_collector(const Stats_collector&);
+    Stats_collector& operator=(const Stats_collector&);
+};
+
+} // namespace vigil
+
+#endif /* stats-collector.hh */
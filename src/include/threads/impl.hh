@@ -41,9 +41,27 @@ class Co_completion;
 
 /* One-time initialization.
  *
- * Must be called before any other function in this header. */
+ * Must be called before any other function in this header, except
+ * co_set_poll_backend(). */
 void co_init(void);
 
+/* Mechanism used to wait for file descriptor readiness.
+ *
+ * CO_POLL_POLL rebuilds and scans an array of every waited-on file
+ * descriptor on each poll, so its cost grows with the number of file
+ * descriptors.  CO_POLL_EPOLL keeps file descriptors registered with the
+ * kernel across waits and only looks at those that are ready.  It is only
+ * available on Linux, where it is the default.
+ *
+ * co_set_poll_backend() must be called before co_init().  It returns false if
+ * the requested backend is not available on this system. */
+enum co_poll_backend {
+    CO_POLL_POLL,
+    CO_POLL_EPOLL
+};
+bool co_set_poll_backend(enum co_poll_backend);
+enum co_poll_backend co_get_poll_backend(void);
+
 /* Threads.
  *
  * You should know what a thread is.
@@ -0,0 +1,648 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef  TUPLE_SPACE_HH
+#define  TUPLE_SPACE_HH
+
+#include <algorithm>
+#include <errno.h>
+#include <list>
+#include <set>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "cnode-result.hh"
+#include "errno_exception.hh"
+#include "hash_map.hh"
+#include "rule.hh"
+
+/*
+ * Tuple space search packet classifier.
+ *
+ * An alternative to Classifier, with the same interface, for rule sets whose
+ * wildcards are too diverse for a Cnode tree to split well.  Rules are kept in
+ * one subtable per distinct set of fields they are exact on (their "tuple"),
+ * each a hash table from the values of those fields to the rules that have
+ * them.  A lookup probes every subtable once, so its cost grows with the
+ * number of distinct tuples rather than with the number of rules, and adding
+ * or deleting a rule touches one hash table with nothing to rebuild.
+ *
+ * Subtables are kept sorted by the best (lowest) priority value they hold, so
+ * that get_top_rules() can stop probing once no remaining subtable can beat
+ * the best match found.
+ *
+ * Keys are a hash of the Expr::get_field() values, which may themselves be
+ * folded, so a bucket can hold rules with different values: like Cnode, this
+ * relies on Cnode_result calling matches() on every rule it returns.
+ *
+ * Expr should follow the model described by the example in "expr.hh".
+ */
+
+namespace vigil {
+
+template<class Expr, typename Action>
+class Tuple_space {
+
+public:
+    typedef Expr Expr_type;
+    typedef Rule<Expr, Action>* Rule_ptr;
+
+    Tuple_space() : used_fields(0), id_counter(1), n_generation(0),
+                    sorted(true) { }
+    void reset();
+    ~Tuple_space() { reset(); }
+
+    uint32_t add_rule(uint32_t, const Expr&, const Action&);
+    bool change_rule_priority(uint32_t, uint32_t);
+    const Rule_ptr get_rule(uint32_t);
+    bool delete_rule(uint32_t);
+    template<typename Data>
+    uint32_t delete_rules(const Data*);
+    void build() { }    /* nothing to build: subtables are kept up to date */
+    void unbuild() { }
+    void clean() { }    /* empty subtables are deleted as they empty */
+    bool maintain(uint32_t) { return false; } /* nothing is deferred */
+    void freeze() { }   /* subtables are looked up as they are */
+    void thaw() { }
+    bool empty() const { return rules.empty(); }
+    uint64_t generation() const { return n_generation; }
+
+    template<typename Data>
+    void get_rules(Cnode_result<Expr, Action, Data>&);
+    template<typename Data>
+    void get_top_rules(Cnode_result<Expr, Action, Data>&);
+    void print() const;
+
+private:
+    typedef std::list<Rule_ptr> Rule_list;
+    typedef hash_map<uint32_t, Rule_list> Bucket_map;
+
+    struct Subtable {
+        uint32_t mask;                  // MASKS of the fields in 'fields'
+        std::vector<uint32_t> fields;   // fields the rules are exact on
+        Bucket_map buckets;
+        std::multiset<uint32_t> priorities;
+
+        uint32_t best_priority() const { return *priorities.begin(); }
+    };
+
+    /* A rule and where it is kept. */
+    struct Location {
+        Rule_ptr rule;
+        Subtable *subtable;
+        uint32_t key;
+    };
+    typedef hash_map<uint32_t, Location> Id_map;
+
+    std::vector<Subtable *> subtables;  // by best_priority(), if 'sorted'
+    hash_map<uint32_t, Subtable *> masks;
+    uint32_t used_fields;               // union of the subtables' masks
+    Id_map rules;
+    uint32_t id_counter;
+    uint64_t n_generation;              // see Classifier::generation()
+    bool sorted;
+
+    uint32_t get_id();
+    Subtable *get_subtable(const Expr&);
+    void remove_from_subtable(const Location&);
+    void delete_subtable(Subtable *);
+    void sort_subtables();
+    static void insert_sorted(Rule_list&, Rule_ptr);
+    static uint32_t hash_value(uint32_t, uint32_t);
+    static uint32_t expr_key(const Subtable&, const Expr&);
+    template<typename Data>
+    uint32_t get_fields(const Data&, uint32_t[Expr::NUM_FIELDS]) const;
+    static bool get_key(const Subtable&, const uint32_t[Expr::NUM_FIELDS],
+                        uint32_t, uint32_t&);
+
+    static bool compare_subtables(const Subtable *a, const Subtable *b)
+        { return a->best_priority() < b->best_priority(); }
+
+    Tuple_space(const Tuple_space&);
+    Tuple_space& operator=(const Tuple_space&);
+};
+
+
+/*
+ * Removes all rules.
+ */
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::reset()
+{
+    for (typename std::vector<Subtable *>::iterator st = subtables.begin();
+         st != subtables.end(); ++st)
+    {
+        delete *st;
+    }
+    subtables.clear();
+    masks.clear();
+    used_fields = 0;
+    for (typename Id_map::const_iterator id = rules.begin();
+         id != rules.end(); ++id)
+    {
+        delete id->second.rule;
+    }
+    rules.clear();
+    id_counter = 1;
+    n_generation++;
+    sorted = true;
+}
+
+
+/*
+ * Return the next available rule ID.  Throws ENOMEM if ID could not be
+ * allocated.
+ */
+
+template<class Expr, typename Action>
+uint32_t
+Tuple_space<Expr, Action>::get_id()
+{
+    bool loop = false;
+
+    while (rules.find(id_counter) != rules.end()) {
+        if (id_counter == ~((uint32_t)0)) {
+            if (loop == true) {
+                throw errno_exception(ENOMEM, "tuple_space::get_id");
+            }
+            loop = true;
+            id_counter = 1;
+        } else {
+            id_counter++;
+        }
+    }
+
+    uint32_t id = id_counter;
+    if (id_counter == ~((uint32_t)0)) {
+        id_counter = 1;
+    }
+
+    return id;
+}
+
+
+/*
+ * Mixes field value 'value' into key 'hash'.
+ */
+
+template<class Expr, typename Action>
+inline uint32_t
+Tuple_space<Expr, Action>::hash_value(uint32_t hash, uint32_t value)
+{
+    hash ^= value;
+    hash *= 0x9e3779b1;
+    return hash ^ (hash >> 16);
+}
+
+
+/*
+ * Returns the key of 'expr', which is exact on all of 'st's fields, in 'st'.
+ */
+
+template<class Expr, typename Action>
+uint32_t
+Tuple_space<Expr, Action>::expr_key(const Subtable& st, const Expr& expr)
+{
+    uint32_t key = 0;
+    uint32_t value;
+
+    for (std::vector<uint32_t>::const_iterator f = st.fields.begin();
+         f != st.fields.end(); ++f)
+    {
+        expr.get_field(*f, value);
+        key = hash_value(key, value);
+    }
+    return key;
+}
+
+
+/*
+ * Stores in 'values' the value 'data' has for each field some subtable is
+ * exact on, so that each is fetched once per lookup rather than once per
+ * subtable.  Returns the MASKS of the fields 'data' has a single value for:
+ * it may be wildcarded on the others, or have several values for them.
+ */
+
+template<class Expr, typename Action>
+template<typename Data>
+inline uint32_t
+Tuple_space<Expr, Action>::get_fields(const Data& data,
+                                      uint32_t values[Expr::NUM_FIELDS]) const
+{
+    uint32_t valid = 0;
+    uint32_t value;
+
+    for (uint32_t fields = used_fields; fields != 0; fields &= fields - 1) {
+        uint32_t f = __builtin_ctz(fields);
+        if (get_field<Expr, Data>(f, data, 0, values[f])
+            && !get_field<Expr, Data>(f, data, 1, value)) {
+            valid |= 1U << f;
+        }
+    }
+    return valid;
+}
+
+
+/*
+ * Sets 'key' to the key that the data whose fields get_fields() stored in
+ * 'values', with 'valid' as its result, looks up in 'st'.  Returns 'false' if
+ * the data lacks a single value for one of 'st's fields, in which case every
+ * bucket of 'st' may hold matches.
+ */
+
+template<class Expr, typename Action>
+inline bool
+Tuple_space<Expr, Action>::get_key(const Subtable& st,
+                                   const uint32_t values[Expr::NUM_FIELDS],
+                                   uint32_t valid, uint32_t& key)
+{
+    if ((st.mask & ~valid) != 0) {
+        return false;
+    }
+
+    key = 0;
+    for (std::vector<uint32_t>::const_iterator f = st.fields.begin();
+         f != st.fields.end(); ++f)
+    {
+        key = hash_value(key, values[*f]);
+    }
+    return true;
+}
+
+
+/*
+ * Returns the subtable for the fields 'expr' is exact on, creating it if
+ * there is none.
+ */
+
+template<class Expr, typename Action>
+typename Tuple_space<Expr, Action>::Subtable *
+Tuple_space<Expr, Action>::get_subtable(const Expr& expr)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < Expr::NUM_FIELDS; i++) {
+        if (!expr.is_wildcard(i)) {
+            mask |= 1U << i;
+        }
+    }
+
+    typename hash_map<uint32_t, Subtable *>::const_iterator found
+        = masks.find(mask);
+    if (found != masks.end()) {
+        return found->second;
+    }
+
+    Subtable *st = new Subtable;
+    st->mask = mask;
+    for (uint32_t i = 0; i < Expr::NUM_FIELDS; i++) {
+        if (mask & (1U << i)) {
+            st->fields.push_back(i);
+        }
+    }
+    try {
+        masks[mask] = st;
+        subtables.push_back(st);
+    } catch (...) {
+        masks.erase(mask);
+        delete st;
+        throw;
+    }
+    used_fields |= mask;
+    return st;
+}
+
+
+/*
+ * Inserts 'rule' into 'list' after the rules of the same or better priority.
+ */
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::insert_sorted(Rule_list& list, Rule_ptr rule)
+{
+    typename Rule_list::iterator iter = list.begin();
+    while (iter != list.end() && (*iter)->priority <= rule->priority) {
+        ++iter;
+    }
+    list.insert(iter, rule);
+}
+
+
+/*
+ * Creates a rule from the passed in priority, expr, and action and adds it to
+ * its subtable.  Returns the new rule's ID.
+ */
+
+template<class Expr, typename Action>
+uint32_t
+Tuple_space<Expr, Action>::add_rule(uint32_t priority, const Expr& expr,
+                                    const Action& action)
+{
+    uint32_t new_id = get_id();
+    Rule_ptr rule = new Rule<Expr, Action>(new_id, priority, expr, action);
+    Location loc;
+    loc.rule = rule;
+    loc.subtable = NULL;
+    bool counted = false, listed = false;
+
+    try {
+        loc.subtable = get_subtable(expr);
+        loc.key = expr_key(*loc.subtable, expr);
+        loc.subtable->priorities.insert(priority);
+        counted = true;
+        insert_sorted(loc.subtable->buckets[loc.key], rule);
+        listed = true;
+        rules.insert(std::make_pair(new_id, loc));
+    } catch (...) {
+        rules.erase(new_id);
+        if (listed) {
+            remove_from_subtable(loc);
+        } else if (loc.subtable != NULL) {
+            if (counted) {
+                loc.subtable->priorities.erase(
+                    loc.subtable->priorities.find(priority));
+            }
+            if (loc.subtable->priorities.empty()) {
+                delete_subtable(loc.subtable);
+            }
+        }
+        delete rule;
+        throw;
+    }
+    sorted = false;
+    n_generation++;
+
+    return new_id;
+}
+
+
+/*
+ * Takes 'rule' out of the subtable at 'loc', deleting the subtable if it is
+ * left empty.
+ */
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::remove_from_subtable(const Location& loc)
+{
+    Rule_ptr rule = loc.rule;
+    Subtable *st = loc.subtable;
+    typename Bucket_map::iterator bucket = st->buckets.find(loc.key);
+
+    bucket->second.remove(rule);
+    if (bucket->second.empty()) {
+        st->buckets.erase(bucket);
+    }
+    st->priorities.erase(st->priorities.find(rule->priority));
+
+    if (st->priorities.empty()) {
+        delete_subtable(st);
+    }
+    sorted = false;
+}
+
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::delete_subtable(Subtable *st)
+{
+    subtables.erase(std::find(subtables.begin(), subtables.end(), st));
+    masks.erase(st->mask);
+    delete st;
+
+    used_fields = 0;
+    for (typename std::vector<Subtable *>::const_iterator i = subtables.begin();
+         i != subtables.end(); ++i)
+    {
+        used_fields |= (*i)->mask;
+    }
+}
+
+
+template<class Expr, typename Action>
+bool
+Tuple_space<Expr, Action>::change_rule_priority(uint32_t id, uint32_t priority)
+{
+    typename Id_map::iterator entry = rules.find(id);
+
+    if (entry == rules.end()) {
+        return false;
+    }
+
+    Location& loc = entry->second;
+    Rule_ptr rule = loc.rule;
+    Rule_list& list = loc.subtable->buckets[loc.key];
+
+    list.remove(rule);
+    loc.subtable->priorities.erase(loc.subtable->priorities.find(rule->priority));
+    rule->priority = priority;
+    insert_sorted(list, rule);
+    loc.subtable->priorities.insert(priority);
+    sorted = false;
+    n_generation++;
+    return true;
+}
+
+
+template<class Expr, typename Action>
+const typename Tuple_space<Expr, Action>::Rule_ptr
+Tuple_space<Expr, Action>::get_rule(uint32_t id)
+{
+    typename Id_map::iterator entry = rules.find(id);
+
+    if (entry == rules.end()) {
+        return NULL;
+    }
+
+    return entry->second.rule;
+}
+
+
+/*
+ * Deletes the rule with id 'id'.  Returns 'true' if the rule was found and
+ * deleted, 'false' if the rule was not found.
+ */
+
+template<class Expr, typename Action>
+bool
+Tuple_space<Expr, Action>::delete_rule(uint32_t id)
+{
+    typename Id_map::iterator entry = rules.find(id);
+
+    if (entry == rules.end()) {
+        return false;
+    }
+
+    remove_from_subtable(entry->second);
+    delete entry->second.rule;
+    rules.erase(entry);
+    n_generation++;
+    return true;
+}
+
+
+/*
+ * Deletes all rules that match 'data', where data is some matching type
+ * supported by Expr (e.g. a Flow or another Expr).  Returns the number of
+ * rules deleted.
+ */
+
+template<class Expr, typename Action>
+template<typename Data>
+uint32_t
+Tuple_space<Expr, Action>::delete_rules(const Data *data)
+{
+    Cnode_result<Expr, Action, Data> res(data);
+    get_rules(res);
+
+    std::vector<uint32_t> ids;
+    while (const Rule<Expr, Action> *r = res.next()) {
+        ids.push_back(r->id);
+    }
+
+    uint32_t n_del = 0;
+    for (std::vector<uint32_t>::const_iterator id = ids.begin();
+         id != ids.end(); ++id)
+    {
+        if (delete_rule(*id)) {
+            n_del++;
+        }
+    }
+
+    return n_del;
+}
+
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::sort_subtables()
+{
+    if (!sorted) {
+        std::stable_sort(subtables.begin(), subtables.end(),
+                         compare_subtables);
+        sorted = true;
+    }
+}
+
+
+/*
+ * Populates 'result's' priority queue with the rules that may match the data
+ * in 'result', from every subtable.
+ */
+
+template<class Expr, typename Action>
+template<typename Data>
+void
+Tuple_space<Expr, Action>::get_rules(Cnode_result<Expr, Action, Data>& result)
+{
+    uint32_t values[Expr::NUM_FIELDS];
+    uint32_t valid = get_fields(*result.data, values);
+
+    for (typename std::vector<Subtable *>::const_iterator st = subtables.begin();
+         st != subtables.end(); ++st)
+    {
+        uint32_t key;
+        if (get_key(**st, values, valid, key)) {
+            typename Bucket_map::const_iterator bucket = (*st)->buckets.find(key);
+            if (bucket != (*st)->buckets.end()) {
+                result.push(bucket->second);
+            }
+        } else {
+            for (typename Bucket_map::const_iterator bucket = (*st)->buckets.begin();
+                 bucket != (*st)->buckets.end(); ++bucket)
+            {
+                result.push(bucket->second);
+            }
+        }
+    }
+}
+
+
+/*
+ * Like get_rules(), but only guarantees that 'result' holds every matching
+ * rule of the best matching priority: lower priority matches may be left
+ * out.  Probes subtables in order of their best priority and stops at the
+ * first whose best priority is worse than the best match found so far.
+ */
+
+template<class Expr, typename Action>
+template<typename Data>
+void
+Tuple_space<Expr, Action>::get_top_rules(Cnode_result<Expr, Action, Data>& result)
+{
+    const Data& data = *result.data;
+    bool found = false;
+    uint32_t best = 0;
+    uint32_t values[Expr::NUM_FIELDS];
+    uint32_t valid = get_fields(data, values);
+
+    sort_subtables();
+    for (typename std::vector<Subtable *>::const_iterator st = subtables.begin();
+         st != subtables.end(); ++st)
+    {
+        if (found && (*st)->best_priority() > best) {
+            break;
+        }
+
+        uint32_t key;
+        typename Bucket_map::const_iterator bucket, end;
+        if (get_key(**st, values, valid, key)) {
+            bucket = end = (*st)->buckets.find(key);
+            if (end != (*st)->buckets.end()) {
+                ++end;
+            }
+        } else {
+            bucket = (*st)->buckets.begin();
+            end = (*st)->buckets.end();
+        }
+
+        for (; bucket != end; ++bucket) {
+            const Rule_list& list = bucket->second;
+            for (typename Rule_list::const_iterator r = list.begin();
+                 r != list.end() && (!found || (*r)->priority < best); ++r)
+            {
+                if (matches((*r)->id, (*r)->expr, data)) {
+                    best = (*r)->priority;
+                    found = true;
+                    break;
+                }
+            }
+            result.push(list);
+        }
+    }
+}
+
+
+template<class Expr, typename Action>
+void
+Tuple_space<Expr, Action>::print() const
+{
+    for (typename std::vector<Subtable *>::const_iterator st = subtables.begin();
+         st != subtables.end(); ++st)
+    {
+        printf("subtable %08x: %zu rules in %zu buckets, best priority %u\n",
+               (*st)->mask, (*st)->priorities.size(), (*st)->buckets.size(),
+               (*st)->best_priority());
+    }
+}
+
+} // namespace vigil
+
+#endif
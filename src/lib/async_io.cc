@@ -63,6 +63,40 @@ Async_stream::write(const Buffer& buffer, bool block)
     }
 }
 
+/* Attempts to write the 'iovcnt' regions in 'iov', in order, into the stream.
+ * Returns a positive number of bytes written, which may end in the middle of
+ * any region, or a negative errno value.
+ *
+ * If 'block' is false, returns -EAGAIN if no data can be accepted for writing
+ * immediately; otherwise, blocks until data can be written. */
+ssize_t
+Async_stream::writev(const struct iovec* iov, int iovcnt, bool block)
+{
+    co_might_yield_if(block);
+    for (;;) {
+        ssize_t retval = do_writev(iov, iovcnt);
+        if (block && retval == -EAGAIN) {
+            write_wait();
+            co_block();
+        } else if (retval != -EINTR) {
+            return retval;
+        }
+    }
+}
+
+/* Default gather-write implementation for streams that cannot write more
+ * than one region at a time: writes only the first nonempty region. */
+ssize_t
+Async_stream::do_writev(const struct iovec* iov, int iovcnt)
+{
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len) {
+            return do_write(Nonowning_buffer(iov[i].iov_base, iov[i].iov_len));
+        }
+    }
+    return 0;
+}
+
 /* Returns 0 if successful, EOF if no bytes were read at end of file, otherwise
  * a positive errno value.  '*bytes_read' indicates how many bytes were read
  * before end-of-file or the error was reached.  If the return value is 0 and
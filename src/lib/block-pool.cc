@@ -0,0 +1,87 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "block-pool.hh"
+
+#include <algorithm>
+
+namespace vigil {
+
+Block_pool::Block_pool(size_t block_size_, size_t max_free_)
+    : free_list(NULL),
+      block_size(std::max(block_size_, sizeof(Free_block))),
+      max_free(max_free_)
+{
+    stats.n_allocs = 0;
+    stats.n_new = 0;
+    stats.n_free = 0;
+}
+
+Block_pool::~Block_pool()
+{
+    while (free_list) {
+        Free_block* b = free_list;
+        free_list = b->next;
+        ::operator delete(b);
+    }
+}
+
+void*
+Block_pool::allocate()
+{
+    {
+        Scoped_native_mutex lock(&mutex);
+        ++stats.n_allocs;
+        if (free_list) {
+            Free_block* b = free_list;
+            free_list = b->next;
+            --stats.n_free;
+            return b;
+        }
+        ++stats.n_new;
+    }
+    return ::operator new(block_size);
+}
+
+void
+Block_pool::deallocate(void* p)
+{
+    if (!p) {
+        return;
+    }
+
+    {
+        Scoped_native_mutex lock(&mutex);
+        if (stats.n_free < max_free) {
+            Free_block* b = static_cast<Free_block*>(p);
+            b->next = free_list;
+            free_list = b;
+            ++stats.n_free;
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+Block_pool::Stats
+Block_pool::get_stats()
+{
+    Scoped_native_mutex lock(&mutex);
+    return stats;
+}
+
+} // namespace vigil
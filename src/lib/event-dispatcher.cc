@@ -17,26 +17,71 @@
  */
 #include "event-dispatcher.hh"
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <vector>
 
-#include <boost/foreach.hpp>
-#include <boost/ptr_container/ptr_list.hpp>
+#include <boost/shared_ptr.hpp>
 
-#include "hash_map.hh"
 #include "threads/cooperative.hh"
+#include "timeval.hh"
 #include "vlog.hh"
 
 namespace vigil {
 
 static Vlog_module lg("event-dispatcher");
 
-typedef std::multimap<int, Event_dispatcher::Handler> Signal;
+struct Handler_entry
+{
+    int order;
+    Event_dispatcher::Handler_id id;
+    Event_dispatcher::Handler handler;
+};
+
+static bool
+order_less(int order, const Handler_entry& h)
+{
+    return order < h.order;
+}
+
+/* The handlers for one event type, in the order they are to be called.  A
+ * chain is never modified once built.  Adding or removing a handler builds a
+ * new chain instead, so that a dispatch() whose handler blocks can go on
+ * running the chain it started with. */
+typedef std::vector<Handler_entry> Chain;
+typedef boost::shared_ptr<const Chain> Chain_ptr;
+
+struct Queued_event
+{
+    Event* event;
+    timeval posted;
+    bool ordered;               /* Posted with post_in_order()? */
+    uint64_t key;               /* Key passed to post_in_order(). */
+};
+
+/* The number of events queued in each lane with one post_in_order() key. */
+struct Key_queued
+{
+    size_t n[Event_dispatcher::N_LANES];
+};
+
+struct Lane_queue
+{
+    std::deque<Queued_event> queue;
+    unsigned int budget;
+    Event_dispatcher::Lane_stats stats;
+};
 
 struct Event_dispatcher_impl
 {
-    hash_map<Event_name, Signal> table;
-    boost::ptr_list<Event> queue;
+    std::vector<Chain_ptr> table; /* Indexed by Event_type, null if empty. */
+    std::map<Event_dispatcher::Handler_id, Event_type> handlers;
+    Event_dispatcher::Handler_id next_id;
+    std::vector<unsigned char> lanes; /* Indexed by Event_type. */
+    Lane_queue queues[Event_dispatcher::N_LANES];
+    std::map<uint64_t, Key_queued> keys; /* Keys with events queued. */
+    size_t n_queued;
     Co_cond nonempty_queue;
     unsigned int serial;
 };
@@ -44,79 +89,291 @@ struct Event_dispatcher_impl
 Event_dispatcher::Event_dispatcher()
     : p(new Event_dispatcher_impl())
 {
+    p->next_id = 1;
+    p->n_queued = 0;
     p->serial = 0;
+    for (int i = 0; i < N_LANES; i++) {
+        p->queues[i].budget = 0;
+        p->queues[i].stats = Lane_stats();
+    }
 }
 
 Event_dispatcher::~Event_dispatcher()
 {
+    for (int i = 0; i < N_LANES; i++) {
+        std::deque<Queued_event>& q = p->queues[i].queue;
+        for (size_t j = 0; j < q.size(); j++) {
+            delete q[j].event;
+        }
+    }
     delete p;
 }
 
-void
+Event_dispatcher::Handler_id
 Event_dispatcher::add_handler(const Event_name& name, 
                               const Handler& handler,
                               int order)
 {
-    p->table[name].insert(Signal::value_type(order, handler));
+    return add_handler(event_type(name), handler, order);
+}
+
+Event_dispatcher::Handler_id
+Event_dispatcher::add_handler(Event_type type,
+                              const Handler& handler,
+                              int order)
+{
+    if (type >= p->table.size()) {
+        p->table.resize(type + 1);
+    }
+
+    Chain* chain = p->table[type] ? new Chain(*p->table[type]) : new Chain;
+    Handler_entry entry;
+    entry.order = order;
+    entry.id = p->next_id++;
+    entry.handler = handler;
+    chain->insert(std::upper_bound(chain->begin(), chain->end(),
+                                   order, order_less),
+                  entry);
+    p->table[type].reset(chain);
+    p->handlers[entry.id] = type;
+    return entry.id;
+}
+
+bool
+Event_dispatcher::remove_handler(Handler_id id)
+{
+    std::map<Handler_id, Event_type>::iterator i = p->handlers.find(id);
+    if (i == p->handlers.end()) {
+        return false;
+    }
+    Event_type type = i->second;
+    p->handlers.erase(i);
+
+    Chain* chain = new Chain;
+    chain->reserve(p->table[type]->size() - 1);
+    for (Chain::const_iterator j = p->table[type]->begin();
+         j != p->table[type]->end(); ++j) {
+        if (j->id != id) {
+            chain->push_back(*j);
+        }
+    }
+    if (chain->empty()) {
+        delete chain;
+        p->table[type].reset();
+    } else {
+        p->table[type].reset(chain);
+    }
+    return true;
+}
+
+void
+Event_dispatcher::set_lane(Event_type type, Lane lane)
+{
+    if (type >= p->lanes.size()) {
+        p->lanes.resize(type + 1, NORMAL_LANE);
+    }
+    p->lanes[type] = lane;
+}
+
+Event_dispatcher::Lane
+Event_dispatcher::get_lane(Event_type type) const
+{
+    return type < p->lanes.size() ? Lane(p->lanes[type]) : NORMAL_LANE;
+}
+
+void
+Event_dispatcher::set_lane_budget(Lane lane, unsigned int budget)
+{
+    p->queues[lane].budget = budget;
+}
+
+unsigned int
+Event_dispatcher::get_lane_budget(Lane lane) const
+{
+    return p->queues[lane].budget;
+}
+
+Event_dispatcher::Lane_stats
+Event_dispatcher::get_lane_stats(Lane lane) const
+{
+    Lane_stats stats = p->queues[lane].stats;
+    stats.depth = p->queues[lane].queue.size();
+    return stats;
 }
 
 void
 Event_dispatcher::post(Event* event)
 {
-    if (p->queue.empty()) {
+    post(event, get_lane(event->get_type()));
+}
+
+static void
+enqueue(Event_dispatcher_impl* p, Event_dispatcher::Lane lane,
+        const Queued_event& qe)
+{
+    if (!p->n_queued++) {
         p->nonempty_queue.broadcast();
     }
-    p->queue.push_back(event);
+
+    Lane_queue& lq = p->queues[lane];
+    lq.queue.push_back(qe);
+    if (lq.queue.size() > lq.stats.max_depth) {
+        lq.stats.max_depth = lq.queue.size();
+    }
+}
+
+void
+Event_dispatcher::post(Event* event, Lane lane)
+{
+    Queued_event qe;
+    qe.event = event;
+    qe.posted = do_gettimeofday(true);
+    qe.ordered = false;
+    qe.key = 0;
+    enqueue(p, lane, qe);
 }
 
 void
+Event_dispatcher::post_in_order(Event* event, uint64_t key)
+{
+    /* Every earlier event with 'key' is then in this lane or a higher one,
+     * so poll() only has to check the higher lanes. */
+    Lane lane = get_lane(event->get_type());
+    std::map<uint64_t, Key_queued>::iterator i = p->keys.find(key);
+    if (i == p->keys.end()) {
+        Key_queued kq = Key_queued();
+        i = p->keys.insert(std::make_pair(key, kq)).first;
+    }
+    for (int j = N_LANES - 1; j > lane; j--) {
+        if (i->second.n[j]) {
+            lane = Lane(j);
+            break;
+        }
+    }
+    i->second.n[lane]++;
+
+    Queued_event qe;
+    qe.event = event;
+    qe.posted = do_gettimeofday(true);
+    qe.ordered = true;
+    qe.key = key;
+    enqueue(p, lane, qe);
+}
+
+/* Returns true if 'qe', at the head of 'lane', must wait for events posted
+ * before it with the same key that are still queued in higher lanes.
+ * Otherwise, if 'qe' has a key, counts it as no longer queued. */
+static bool
+must_wait(Event_dispatcher_impl* p, int lane, const Queued_event& qe)
+{
+    if (!qe.ordered) {
+        return false;
+    }
+
+    std::map<uint64_t, Key_queued>::iterator i = p->keys.find(qe.key);
+    for (int j = 0; j < lane; j++) {
+        if (i->second.n[j]) {
+            return true;
+        }
+    }
+    if (!--i->second.n[lane]) {
+        size_t total = 0;
+        for (int j = lane + 1; j < Event_dispatcher::N_LANES; j++) {
+            total += i->second.n[j];
+        }
+        if (!total) {
+            p->keys.erase(i);
+        }
+    }
+    return false;
+}
+
+Disposition
 Event_dispatcher::dispatch(const Event& e)
 {
-    const Event_name& name = e.get_name();
-    if (p->table.find(name) != p->table.end()) {
-        BOOST_FOREACH (Signal::value_type& i, p->table[name]) {
-            try {
-                if (i.second(e) == STOP) {
-                    break;
-                }
-            } catch (const std::exception& e) {
-                lg.err("Event %s processing leaked an exception: %s", 
-                name.c_str(), e.what());
-                break;
+    Event_type type = e.get_type();
+    if (type >= p->table.size() || !p->table[type]) {
+        return CONTINUE;
+    }
+
+    /* Hold a reference, in case a handler blocks and the chain is replaced
+     * meanwhile. */
+    Chain_ptr chain(p->table[type]);
+    const Handler_entry* h = &chain->front();
+    const Handler_entry* end = h + chain->size();
+    try {
+        for (; h != end; ++h) {
+            if (h->handler(e) == STOP) {
+                return STOP;
             }
         }
+    } catch (const std::exception& ex) {
+        lg.err("Event %s processing leaked an exception: %s", 
+               e.get_name().c_str(), ex.what());
+        return STOP;
     }
+    return CONTINUE;
 }
 
 bool
 Event_dispatcher::poll()
 {
-    /* Dispatch all the events initially in the queue, but not any events
-     * queued by processing those events, to avoid starving other Pollables.
-     *
-     * XXX We need a scheme for prioritizing event dispatch above other
-     * Pollables.
-     */
-    size_t max = p->queue.size();
+    /* Dispatch the events initially in each lane, up to the lane's budget,
+     * but not any events queued by processing those events, to avoid
+     * starving other Pollables.  Higher lanes go first. */
+    size_t max[N_LANES];
+    size_t total = 0;
+    for (int i = 0; i < N_LANES; i++) {
+        const Lane_queue& lq = p->queues[i];
+        max[i] = lq.queue.size();
+        if (lq.budget && max[i] > lq.budget) {
+            max[i] = lq.budget;
+        }
+        total += max[i];
+    }
+
     unsigned int serial = ++p->serial;
-    for (size_t i = 0; i < max; ++i) {
-        std::auto_ptr<Event> event(p->queue.pop_front().release());
-        dispatch(*event);
-
-        if (serial != p->serial) {
-            /* dispatch(*event) blocked and Event_dispatcher::poll() was
-             * eventually re-entered in another thread.  That other call
-             * already dispatched our events, so we are done. */
-            break;
+    for (int i = 0; i < N_LANES; i++) {
+        Lane_queue& lq = p->queues[i];
+        for (size_t j = 0; j < max[i] && !lq.queue.empty(); ++j) {
+            Queued_event qe = lq.queue.front();
+            if (must_wait(p, i, qe)) {
+                /* The higher lanes go first on the next poll, so it waits
+                 * no longer than their backlog ahead of it. */
+                break;
+            }
+            lq.queue.pop_front();
+            --p->n_queued;
+
+            /* Not operator-(), which warns when no time has passed. */
+            timeval now = do_gettimeofday(true);
+            int64_t waited = ((int64_t) (now.tv_sec - qe.posted.tv_sec)
+                              * 1000000 + (now.tv_usec - qe.posted.tv_usec));
+            uint64_t wait_usecs = waited > 0 ? waited : 0;
+            ++lq.stats.n_dispatched;
+            lq.stats.total_wait_usecs += wait_usecs;
+            if (wait_usecs > lq.stats.max_wait_usecs) {
+                lq.stats.max_wait_usecs = wait_usecs;
+            }
+
+            std::auto_ptr<Event> event(qe.event);
+            dispatch(*event);
+
+            if (serial != p->serial) {
+                /* dispatch(*event) blocked and Event_dispatcher::poll() was
+                 * eventually re-entered in another thread.  That other call
+                 * already dispatched our events, so we are done. */
+                return true;
+            }
         }
     }
-    return max > 0;
+    return total > 0;
 }
 
 void
 Event_dispatcher::wait()
 {
-    if (!p->queue.empty()) {
+    if (p->n_queued) {
         co_immediate_wake(1, NULL);
     } else {
         p->nonempty_queue.wait();
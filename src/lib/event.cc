@@ -16,9 +16,12 @@
  * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "event.hh"
+#include <deque>
 #include <typeinfo>
 #include <vector>
 #include <string>
+#include "hash_map.hh"
+#include "threads/native.hh"
 
 /* Following are for Event::get_name below.
  * Not portable outside GCC's C++ ABI.
@@ -28,8 +31,69 @@
 
 namespace vigil {
 
+/* Event name interning.  Shards construct events in parallel with the main
+ * thread group, so the registry is protected by a mutex.  Names are kept in
+ * a deque so that references returned by event_type_name() stay valid as
+ * more names are added. */
+namespace {
+
+struct Event_types {
+    Native_mutex mutex;
+    hash_map<Event_name, Event_type> types;
+    std::deque<Event_name> names;
+};
+
+Event_types&
+registry()
+{
+    static Event_types r;
+    return r;
+}
+
+} // unnamed namespace
+
+/* Returns the type for events named 'name', assigning a new one if 'name'
+ * has not been seen before. */
+Event_type
+event_type(const Event_name& name)
+{
+    Event_types& r = registry();
+    Scoped_native_mutex lock(&r.mutex);
+    hash_map<Event_name, Event_type>::iterator i = r.types.find(name);
+    if (i != r.types.end()) {
+        return i->second;
+    }
+    Event_type type = r.names.size();
+    r.names.push_back(name);
+    r.types.insert(std::make_pair(name, type));
+    return type;
+}
+
+/* Returns the name that 'type' was assigned to. */
+const Event_name&
+event_type_name(Event_type type)
+{
+    Event_types& r = registry();
+    Scoped_native_mutex lock(&r.mutex);
+    return r.names.at(type);
+}
+
+/* Returns the number of event types assigned so far. */
+Event_type
+n_event_types()
+{
+    Event_types& r = registry();
+    Scoped_native_mutex lock(&r.mutex);
+    return r.names.size();
+}
+
 Event::Event(const Event_name& name_) : 
-    name(name_) { 
+    type(event_type(name_)) { 
+
+}
+
+Event::Event(Event_type type_) :
+    type(type_) {
 
 }
 
@@ -39,12 +103,12 @@ Event::~Event() {
 
 void
 Event::set_name(const Event_name& name_) {
-    name = name_;
+    type = event_type(name_);
 }
 
-Event_name 
+const Event_name&
 Event::get_name() const { 
-    return name; 
+    return event_type_name(type); 
 }
 
 std::string Event::get_class_name() const
@@ -21,14 +21,85 @@
 #include <stdio.h>
 #include "flow.hh"
 
-#include "netinet++/ipaddr.hh"
 #include "vlog.hh"
 #include "cnode.hh"
+#include "../oflib/ofl-print.h"
 
 namespace vigil {
 
 static Vlog_module log("expr");
 
+/* OXM field number of each Packet_expr::Expr_field. */
+static const uint8_t split_oxm_fields[Packet_expr::NUM_FIELDS] = {
+    OFPXMT_OFB_IN_PORT,
+    OFPXMT_OFB_ETH_TYPE,
+    OFPXMT_OFB_IP_PROTO,
+    OFPXMT_OFB_TCP_DST,
+    OFPXMT_OFB_UDP_DST,
+    OFPXMT_OFB_TCP_SRC,
+    OFPXMT_OFB_UDP_SRC,
+    OFPXMT_OFB_IPV4_DST,
+    OFPXMT_OFB_IPV4_SRC,
+    OFPXMT_OFB_IPV6_DST,
+    OFPXMT_OFB_IPV6_SRC,
+    OFPXMT_OFB_ETH_DST,
+    OFPXMT_OFB_ETH_SRC,
+    OFPXMT_OFB_VLAN_VID,
+    OFPXMT_OFB_VLAN_PCP,
+    OFPXMT_OFB_MPLS_LABEL,
+    OFPXMT_OFB_TUNNEL_ID,
+    OFPXMT_OFB_METADATA,
+};
+
+/* Stands in for a split field that a Flow does not have.  No one-, two- or
+ * four-byte field takes it in practice, and matches() drops any rule whose
+ * folded value happens to equal it. */
+static const uint32_t ABSENT_VALUE = 0xffffffff;
+
+/* Folds the 'len'-byte value at 'p' into the 32 bits Cnode splits on.
+ * Fields of up to four bytes keep their value. */
+static inline uint32_t
+fold(const uint8_t *p, size_t len)
+{
+    uint32_t value = 0;
+    uint16_t v16;
+    size_t i;
+
+    switch (len) {
+    case 1:
+        return *p;
+    case 2:
+        memcpy(&v16, p, sizeof v16);
+        return v16;
+    case 4:
+        memcpy(&value, p, sizeof value);
+        return value;
+    }
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        uint32_t word;
+        memcpy(&word, p + i, sizeof word);
+        value ^= word;
+    }
+    for (; i < len; i++) {
+        value ^= (uint32_t) p[i] << (8 * (i % 4));
+    }
+    return value;
+}
+
+unsigned int
+Packet_expr::oxm_field(uint32_t field)
+{
+    assert(field < NUM_FIELDS);
+    return split_oxm_fields[field];
+}
+
+Packet_expr::Packet_expr()
+    : wildcards(~0)
+{
+    ofl_structs_match_init(&match);
+}
+
 template<>
 bool
 get_field<Packet_expr, Flow>(uint32_t field, const Flow& flow,
@@ -38,45 +109,14 @@ get_field<Packet_expr, Flow>(uint32_t field, const Flow& flow,
         return false;
     }
 
-    /*switch (field) {
-    case Packet_expr::AP_SRC:
-        value = flow.match.in_port;
-        return true;
-    case Packet_expr::AP_DST:
-        assert(0);
-    case Packet_expr::DL_VLAN:
-        value = flow.match.dl_vlan;
-        return true;
-    case Packet_expr::DL_VLAN_PCP:
-        value = flow.match.dl_vlan_pcp;
-        return true;
-    case Packet_expr::DL_TYPE:
-        value = flow.match.dl_type;
-        return true;
-    case Packet_expr::DL_SRC:
-        memcpy(&value, flow.match.dl_src + 2, sizeof value);
-        return true;
-    case Packet_expr::DL_DST:
-        memcpy(&value, flow.match.dl_dst + 2, sizeof value);
-        return true;
-    case Packet_expr::NW_SRC:
-        value = flow.match.nw_src;
-        return true;
-    case Packet_expr::NW_DST:
-        value = flow.match.nw_dst;
-        return true;
-    case Packet_expr::NW_PROTO:
-        value = flow.match.nw_proto;
-        return true;
-    case Packet_expr::TP_SRC:
-        value = flow.match.tp_src;
-        return true;
-    case Packet_expr::TP_DST:
-        value = flow.match.tp_dst;
-        return true;
+    unsigned int oxm = split_oxm_fields[field];
+    if (flow.match.present & ((uint64_t) 1 << oxm)) {
+        value = fold(ofl_structs_match_field_value(&flow.match, oxm),
+                     ofl_structs_match_field_len(oxm));
+    } else {
+        value = ABSENT_VALUE;
     }
-    log.warn("unretrievable field %u", field);
-    return false;*/
+    return true;
 }
 
 template<>
@@ -93,110 +133,51 @@ get_field<Packet_expr, Packet_expr>(uint32_t field, const Packet_expr& expr,
 bool
 Packet_expr::get_field(uint32_t field, uint32_t& value) const
 {
+    if (field >= NUM_FIELDS) {
+        log.warn("unretrievable field %u", field);
+        return false;
+    }
     if ((Cnode<Packet_expr, void*>::MASKS[field] & wildcards) != 0)
         return false;
 
-    switch (field) {
-    case AP_SRC:
-        value = ap_src;
-        return true;
-    case AP_DST:
-        value = ap_dst;
-        return true;
-    case DL_VLAN:
-        value = dl_vlan;
-        return true;
-    case DL_VLAN_PCP:
-        value = dl_vlan_pcp;
-        return true;
-    case DL_TYPE:
-        value = dl_proto;
-        return true;
-    case DL_SRC:
-        memcpy(&value, dl_src + 2, sizeof value);
-        return true;
-    case DL_DST:
-        memcpy(&value, dl_dst + 2, sizeof value);
-        return true;
-    case NW_SRC:
-        value = nw_src;
-        return true;
-    case NW_DST:
-        value = nw_dst;
-        return true;
-    case NW_PROTO:
-        value = nw_proto;
-        return true;
-    case TP_SRC:
-        value = tp_src;
-        return true;
-    case TP_DST:
-        value = tp_dst;
-        return true;
-    case GROUP_SRC:
-        value = group_src;
-        return true;
-    case GROUP_DST:
-        value = group_dst;
-        return true;
-    }
-    log.warn("unretrievable field %u", field);
-    return false;
+    unsigned int oxm = split_oxm_fields[field];
+    value = fold(ofl_structs_match_field_value(&match, oxm),
+                 ofl_structs_match_field_len(oxm));
+    return true;
 }
 
 
 void
-Packet_expr::set_field(Expr_field field, const uint32_t value[MAX_FIELD_LEN])
+Packet_expr::set_field(uint32_t header, const void *value, const void *mask)
 {
-    switch (field) {
-    case AP_SRC:
-        ap_src = value[0];
-        break;
-    case AP_DST:
-        ap_dst = value[0];
-        break;
-    case DL_VLAN:
-        dl_vlan = value[0];
-        break;
-    case DL_VLAN_PCP:
-        dl_vlan_pcp = value[0];
-        break;
-    case DL_TYPE:
-        dl_proto = value[0];
-        break;
-    case DL_SRC:
-        memcpy(dl_src, value, sizeof dl_src);
-        break;
-    case DL_DST:
-        memcpy(dl_dst, value, sizeof dl_dst);
-        break;
-    case NW_SRC:
-        nw_src = value[0];
-        break;
-    case NW_DST:
-        nw_dst = value[0];
-        break;
-    case NW_PROTO:
-        nw_proto = value[0];
-        break;
-    case TP_SRC:
-        tp_src = value[0];
-        break;
-    case TP_DST:
-        tp_dst = value[0];
-        break;
-    case GROUP_SRC:
-        group_src = value[0];
-        break;
-    case GROUP_DST:
-        group_dst = value[0];
-        break;
-    default:
-        log.warn("unknown field %u", field);
+    unsigned int oxm = OXM_FIELD(header);
+
+    if (OXM_VENDOR(header) != OFPXMC_OPENFLOW_BASIC
+        || oxm >= OFL_MATCH_N_FIELDS) {
+        log.warn("unknown field %#x", header);
         return;
     }
 
-    wildcards = wildcards & ~(Cnode<Packet_expr, void*>::MASKS[field]);
+    ofl_structs_match_put_bytes(&match, header, value, mask);
+    if (mask) {
+        /* Keep the value masked, so that matches() need not mask it. */
+        uint8_t *v = ofl_structs_match_field_value(&match, oxm);
+        size_t len = ofl_structs_match_field_len(oxm);
+        for (size_t i = 0; i < len; i++) {
+            v[i] &= v[len + i];
+        }
+    }
+
+    for (uint32_t field = 0; field < NUM_FIELDS; field++) {
+        if (split_oxm_fields[field] == oxm) {
+            if (mask) {
+                wildcards |= Cnode<Packet_expr, void*>::MASKS[field];
+            } else {
+                wildcards &= ~Cnode<Packet_expr, void*>::MASKS[field];
+            }
+            break;
+        }
+    }
 }
 
 bool
@@ -217,70 +198,50 @@ template <>
 bool
 matches(uint32_t rule_id, const Packet_expr& expr, const Flow& flow)
 {
-    assert(!((~expr.wildcards) & (Cnode<Packet_expr, void*>::MASKS[Packet_expr::AP_DST]
-                             | Cnode<Packet_expr, void*>::MASKS[Packet_expr::GROUP_SRC]
-                             | Cnode<Packet_expr, void*>::MASKS[Packet_expr::GROUP_DST])));
-
-    return 1;
-    /*return (((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::AP_SRC])
-             || expr.ap_src == flow.match.in_port)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_VLAN])
-                || expr.dl_vlan == flow.match.dl_vlan)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_VLAN_PCP])
-                || expr.dl_vlan_pcp == flow.match.dl_vlan_pcp)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_TYPE])
-                || expr.dl_proto == flow.match.dl_type)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_SRC])
-                || memcmp(expr.dl_src, flow.match.dl_src, sizeof expr.dl_src) == 0)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_DST])
-                || memcmp(expr.dl_dst, flow.match.dl_dst, sizeof expr.dl_dst) == 0)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_SRC])
-                || expr.nw_src == flow.match.nw_src)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_DST])
-                || expr.nw_dst == flow.match.nw_dst)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_PROTO])
-                || expr.nw_proto == flow.match.nw_proto)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::TP_SRC])
-                || expr.tp_src == flow.match.tp_src)
-            && ((expr.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::TP_DST])
-                || expr.tp_dst == flow.match.tp_dst));*/
+    const struct ofl_match& m = expr.match;
+
+    if ((m.present & ~flow.match.present) != 0)
+        return false;
+
+    unsigned int field;
+    OFL_MATCH_FOR_EACH_FIELD (field, &m) {
+        const uint8_t *v = ofl_structs_match_field_value(&m, field);
+        const uint8_t *p = ofl_structs_match_field_value(&flow.match, field);
+        size_t len = ofl_structs_match_field_len(field);
+
+        if (m.masked & ((uint64_t) 1 << field)) {
+            const uint8_t *mask = v + len;
+            for (size_t i = 0; i < len; i++) {
+                if ((p[i] & mask[i]) != v[i])
+                    return false;
+            }
+        } else if (memcmp(v, p, len) != 0) {
+            return false;
+        }
+    }
+    return true;
 }
 
 template <>
 bool
 matches(uint32_t rule_id, const Packet_expr& expr, const Packet_expr& to_match)
 {
-    if ((expr.wildcards | to_match.wildcards) != to_match.wildcards)
+    const struct ofl_match& m = to_match.match;
+
+    if ((m.present & ~expr.match.present) != 0
+        || ((m.masked ^ expr.match.masked) & m.present) != 0)
         return false;
 
-    return (((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::AP_SRC])
-             || expr.ap_src == to_match.ap_src)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::AP_DST])
-                || expr.ap_dst == to_match.ap_dst)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_VLAN])
-                || expr.dl_vlan == to_match.dl_vlan)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_VLAN_PCP])
-                || expr.dl_vlan_pcp == to_match.dl_vlan_pcp)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_TYPE])
-                || expr.dl_proto == to_match.dl_proto)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_SRC])
-                || !memcmp(expr.dl_src, to_match.dl_src, sizeof expr.dl_src))
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::DL_DST])
-                || !memcmp(expr.dl_dst, to_match.dl_dst, sizeof expr.dl_dst))
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_SRC])
-                || expr.nw_src == to_match.nw_src)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_DST])
-                || expr.nw_dst == to_match.nw_dst)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::NW_PROTO])
-                || expr.nw_proto == to_match.nw_proto)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::TP_SRC])
-                || expr.tp_src == to_match.tp_src)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::TP_DST])
-                || expr.tp_dst == to_match.tp_dst)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::GROUP_SRC])
-                || expr.group_src == to_match.group_src)
-            && ((to_match.wildcards & Cnode<Packet_expr, void*>::MASKS[Packet_expr::GROUP_DST])
-                || expr.group_dst == to_match.group_dst));
+    unsigned int field;
+    OFL_MATCH_FOR_EACH_FIELD (field, &m) {
+        size_t len = ofl_structs_match_field_len(field);
+        if (m.masked & ((uint64_t) 1 << field))
+            len *= 2;
+        if (memcmp(ofl_structs_match_field_value(&m, field),
+                   ofl_structs_match_field_value(&expr.match, field), len) != 0)
+            return false;
+    }
+    return true;
 }
 
 
@@ -299,75 +260,33 @@ Packet_expr::print(uint32_t field) const
 const std::string
 Packet_expr::to_string(uint32_t field) const
 {
-    char str[32]; // Yay, magic numbers /mc
-    ethernetaddr ea;
-
-    switch(field) {
-        case AP_SRC:
-            sprintf(str,"apsrc=%hu,", ap_src);
-            break;
-        case AP_DST:
-            sprintf(str,"apdst=%hu,", ap_dst);
-            break;
-        case DL_VLAN:
-            sprintf(str,"dlvlan=%hu,", dl_vlan);
-            break;
-        case DL_VLAN_PCP:
-            sprintf(str,"dlvlanpcp=%hu,", dl_vlan_pcp);
-            break;
-        case DL_TYPE:
-            sprintf(str,"dlproto=%hu,", dl_proto);
-            break;
-        case DL_SRC:
-            sprintf(str,"dlsrc=");
-            ea.set_octet(&dl_src[0]);
-            return str + ea.string();
-            break;
-        case DL_DST:
-            sprintf(str, "dldst=");
-            ea.set_octet(&dl_src[0]);
-            return str + ea.string();
-            break;
-        case NW_SRC:
-            return "nwsrc="+ipaddr(nw_src).string();
-            break;
-        case NW_DST:
-            return "nwdst="+ipaddr(nw_src).string();
-            break;
-        case NW_PROTO:
-            sprintf(str,"nwproto=%hhu,", nw_proto);
-            break;
-        case TP_SRC:
-            sprintf(str,"tpsrc=%hu,", tp_src);
-            break;
-        case TP_DST:
-            sprintf(str,"tpdst=%hu,", tp_dst);
-            break;
-        case GROUP_SRC:
-            sprintf(str,"groupsrc=%u,", group_src);
-            break;
-        case GROUP_DST:
-            sprintf(str,"groupdst=%u,", group_dst);
-            break;
-        default:
-            log.warn("unknown field %u", field);
-            return "";
+    if (field >= NUM_FIELDS) {
+        log.warn("unknown field %u", field);
+        return "";
     }
-    return std::string(str);
+
+    unsigned int oxm = split_oxm_fields[field];
+    if (!(match.present & ((uint64_t) 1 << oxm)))
+        return "";
+
+    char buf[128];
+    struct ofl_fmt fmt;
+    ofl_fmt_init(&fmt, buf, sizeof buf, 0);
+    ofl_structs_oxm_tlv_format(&fmt, ofl_structs_match_field_header(&match, oxm),
+                               ofl_structs_match_field_value(&match, oxm));
+    return ofl_fmt_finish(&fmt);
 }
 
 const std::string
 Packet_expr::to_string() const
 {
-    std::string str("<expr:");
-
-    for (uint32_t i = 1; i <= GROUP_DST; i = i << 1) {
-        if ((Cnode<Packet_expr, void*>::MASKS[i] & wildcards) == 0)
-            str += to_string(i);
-    }
-    str += ">";
-
-    return str;
+    char buf[1024];
+    struct ofl_fmt fmt;
+    ofl_fmt_init(&fmt, buf, sizeof buf, 0);
+    ofl_fmt_str(&fmt, "<expr:");
+    ofl_structs_match_format(&fmt, &match.header);
+    ofl_fmt_str(&fmt, ">");
+    return ofl_fmt_finish(&fmt);
 }
 
 } // namespace vigil
@@ -25,6 +25,7 @@
 #include "netinet++/ip.hh"
 
 #include <netinet/in.h>
+#include <netinet/icmp6.h>
 
 #include "vlog.hh"
 #include "buffer.hh"
@@ -47,18 +48,309 @@ static Vlog_module log("flow");
 Flow::Flow() {
 	init();
 }
+
+Flow::Flow(const Flow& flow_) {
+	memcpy(&match, &flow_.match, sizeof(struct ofl_match));
+}
+
 /** Constructor from ofp_match
  */
 Flow::Flow(const struct ofl_match *match_) {
-	init();
 	memcpy(&match, match_, sizeof(struct ofl_match));
 }
 
+Flow::Flow(uint32_t in_port, const Buffer& packet) {
+	extract(in_port, packet.data(), packet.size());
+}
+
 void
 Flow::init() {
     ofl_structs_match_init(&this->match);
 }
 
+namespace {
+
+/* Header fields are read a byte at a time, since they need not be aligned,
+ * and come out in host byte order. */
+inline uint16_t
+get16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+inline uint32_t
+get32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* Adds field HEADER, which 'm' does not have yet, with 'value'. */
+template<uint32_t HEADER>
+inline void
+put(struct ofl_match& m, typename Oxm_field<HEADER>::type value)
+{
+    memcpy(ofl_structs_match_field_value(&m, Oxm_field<HEADER>::index),
+           &value, sizeof value);
+    m.present |= (uint64_t) 1 << Oxm_field<HEADER>::index;
+    m.header.length += 4 + sizeof value;
+}
+
+/* Adds field HEADER, which 'm' does not have yet, with the value at 'p',
+ * copied as is. */
+template<uint32_t HEADER>
+inline void
+put_raw(struct ofl_match& m, const uint8_t *p)
+{
+    memcpy(ofl_structs_match_field_value(&m, Oxm_field<HEADER>::index),
+           p, Oxm_field<HEADER>::length);
+    m.present |= (uint64_t) 1 << Oxm_field<HEADER>::index;
+    m.header.length += 4 + Oxm_field<HEADER>::length;
+}
+
+/* The eth_type OpenFlow 1.0 gave 802.3 frames without a SNAP type. */
+const uint16_t ETH_TYPE_NOT_ETH_TYPE = 0x05ff;
+
+const size_t IPV6_BASE_HEADER_LEN = 40;
+const size_t ND_HEADER_LEN = 24;    /* ICMPv6 header and target address. */
+
+/* Extracts the neighbor discovery message of 'len' bytes at 'p'. */
+void
+extract_nd(struct ofl_match& m, const uint8_t *p, size_t len)
+{
+    if (len < ND_HEADER_LEN) {
+        return;
+    }
+    put_raw<OXM_OF_IPV6_ND_TARGET>(m, p + 8);
+
+    uint8_t want = (p[0] == ND_NEIGHBOR_SOLICIT
+                    ? ND_OPT_SOURCE_LINKADDR : ND_OPT_TARGET_LINKADDR);
+    for (size_t ofs = ND_HEADER_LEN; ofs + 8 <= len; ) {
+        size_t opt_len = p[ofs + 1] * 8;
+        if (!opt_len || ofs + opt_len > len) {
+            return;
+        }
+        if (p[ofs] == want) {
+            if (want == ND_OPT_SOURCE_LINKADDR) {
+                put_raw<OXM_OF_IPV6_ND_SLL>(m, p + ofs + 2);
+            } else {
+                put_raw<OXM_OF_IPV6_ND_TLL>(m, p + ofs + 2);
+            }
+            return;
+        }
+        ofs += opt_len;
+    }
+}
+
+/* Extracts the transport header of protocol 'proto' of 'len' bytes at 'p'.
+ * Only the first bytes of each header, which hold the ports or the type
+ * and code, are needed. */
+void
+extract_l4(struct ofl_match& m, uint8_t proto, const uint8_t *p, size_t len)
+{
+    switch (proto) {
+    case IP_TYPE_TCP:
+        if (len >= 4) {
+            put<OXM_OF_TCP_SRC>(m, get16(p));
+            put<OXM_OF_TCP_DST>(m, get16(p + 2));
+        }
+        break;
+    case IP_TYPE_UDP:
+        if (len >= 4) {
+            put<OXM_OF_UDP_SRC>(m, get16(p));
+            put<OXM_OF_UDP_DST>(m, get16(p + 2));
+        }
+        break;
+    case IP_TYPE_SCTP:
+        if (len >= 4) {
+            put<OXM_OF_SCTP_SRC>(m, get16(p));
+            put<OXM_OF_SCTP_DST>(m, get16(p + 2));
+        }
+        break;
+    }
+}
+
+void
+extract_ipv4(struct ofl_match& m, const uint8_t *p, size_t len)
+{
+    if (len < IP_HEADER_LEN) {
+        return;
+    }
+    size_t ihl = IP_IHL(p[0]) * 4;
+    uint8_t proto = p[9];
+    put<OXM_OF_IP_DSCP>(m, p[1] >> 2);
+    put<OXM_OF_IP_ECN>(m, p[1] & IP_ECN_MASK);
+    put<OXM_OF_IP_PROTO>(m, proto);
+    put_raw<OXM_OF_IPV4_SRC>(m, p + 12);
+    put_raw<OXM_OF_IPV4_DST>(m, p + 16);
+
+    /* Only the first fragment has the transport header. */
+    if (ihl < IP_HEADER_LEN || ihl > len || get16(p + 6) & IP_FRAG_OFF_MASK) {
+        return;
+    }
+    p += ihl;
+    len -= ihl;
+    if (proto == IP_TYPE_ICMP) {
+        if (len >= 2) {
+            put<OXM_OF_ICMPV4_TYPE>(m, p[0]);
+            put<OXM_OF_ICMPV4_CODE>(m, p[1]);
+        }
+    } else {
+        extract_l4(m, proto, p, len);
+    }
+}
+
+void
+extract_ipv6(struct ofl_match& m, const uint8_t *p, size_t len)
+{
+    if (len < IPV6_BASE_HEADER_LEN) {
+        return;
+    }
+    uint32_t vtf = get32(p);
+    uint8_t tclass = vtf >> 20;
+    uint8_t proto = p[6];
+    put<OXM_OF_IP_DSCP>(m, tclass >> 2);
+    put<OXM_OF_IP_ECN>(m, tclass & IP_ECN_MASK);
+    put<OXM_OF_IPV6_FLABEL>(m, vtf & 0xfffff);
+    put_raw<OXM_OF_IPV6_SRC>(m, p + 8);
+    put_raw<OXM_OF_IPV6_DST>(m, p + 24);
+    p += IPV6_BASE_HEADER_LEN;
+    len -= IPV6_BASE_HEADER_LEN;
+
+    /* Skip extension headers to find the transport protocol.  Only the
+     * first fragment has the transport header. */
+    bool later_fragment = false;
+    for (;;) {
+        size_t ext_len;
+        if (proto == IPPROTO_HOPOPTS || proto == IPPROTO_ROUTING
+            || proto == IPPROTO_DSTOPTS) {
+            ext_len = len >= 2 ? (p[1] + 1) * 8 : 0;
+        } else if (proto == IPPROTO_FRAGMENT) {
+            ext_len = 8;
+            later_fragment = len >= 4 && get16(p + 2) & 0xfff8;
+        } else if (proto == IPPROTO_AH) {
+            ext_len = len >= 2 ? (p[1] + 2) * 4 : 0;
+        } else {
+            break;
+        }
+        if (!ext_len || ext_len > len) {
+            return;
+        }
+        proto = p[0];
+        p += ext_len;
+        len -= ext_len;
+    }
+    put<OXM_OF_IP_PROTO>(m, proto);
+
+    if (later_fragment) {
+        return;
+    }
+    if (proto == IPPROTO_ICMPV6) {
+        if (len >= 2) {
+            put<OXM_OF_ICMPV6_TYPE>(m, p[0]);
+            put<OXM_OF_ICMPV6_CODE>(m, p[1]);
+            if ((p[0] == ND_NEIGHBOR_SOLICIT || p[0] == ND_NEIGHBOR_ADVERT)
+                && p[1] == 0) {
+                extract_nd(m, p, len);
+            }
+        }
+    } else {
+        extract_l4(m, proto, p, len);
+    }
+}
+
+void
+extract_arp(struct ofl_match& m, const uint8_t *p, size_t len)
+{
+    /* Only Ethernet/IPv4 ARP has fields that OpenFlow can match. */
+    if (len < ARP_ETH_HEADER_LEN
+        || get16(p) != ARP_HRD_ETHERNET || get16(p + 2) != ARP_PRO_IP
+        || p[4] != ETH_ADDR_LEN || p[5] != IP_ADDR_LEN) {
+        return;
+    }
+    put<OXM_OF_ARP_OP>(m, get16(p + 6));
+    put_raw<OXM_OF_ARP_SHA>(m, p + 8);
+    put_raw<OXM_OF_ARP_SPA>(m, p + 14);
+    put_raw<OXM_OF_ARP_THA>(m, p + 18);
+    put_raw<OXM_OF_ARP_TPA>(m, p + 24);
+}
+
+void
+extract_mpls(struct ofl_match& m, const uint8_t *p, size_t len)
+{
+    if (len < MPLS_HEADER_LEN) {
+        return;
+    }
+    uint32_t lse = get32(p);
+    put<OXM_OF_MPLS_LABEL>(m, (lse & MPLS_LABEL_MASK) >> MPLS_LABEL_SHIFT);
+    put<OXM_OF_MPLS_TC>(m, (lse & MPLS_TC_MASK) >> MPLS_TC_SHIFT);
+    put<OXM_OF_MPLS_BOS>(m, (lse & MPLS_S_MASK) >> MPLS_S_SHIFT);
+}
+
+} // unnamed namespace
+
+void
+Flow::extract(uint32_t in_port, const uint8_t *p, size_t len)
+{
+    init();
+    put<OXM_OF_IN_PORT>(match, in_port);
+    if (len < ETH_HEADER_LEN) {
+        return;
+    }
+    put_raw<OXM_OF_ETH_DST>(match, p);
+    put_raw<OXM_OF_ETH_SRC>(match, p + ETH_ADDR_LEN);
+    uint16_t type = get16(p + 2 * ETH_ADDR_LEN);
+    p += ETH_HEADER_LEN;
+    len -= ETH_HEADER_LEN;
+
+    /* OpenFlow matches the outermost VLAN tag and the type after the
+     * innermost one. */
+    bool tagged = false;
+    while ((type == ETH_TYPE_VLAN || type == ETH_TYPE_VLAN_PBB)
+           && len >= VLAN_HEADER_LEN) {
+        if (!tagged) {
+            uint16_t tci = get16(p);
+            put<OXM_OF_VLAN_VID>(match, OFPVID_PRESENT | (tci & VLAN_VID_MASK));
+            put<OXM_OF_VLAN_PCP>(match, (tci & VLAN_PCP_MASK) >> VLAN_PCP_SHIFT);
+            tagged = true;
+        }
+        type = get16(p + 2);
+        p += VLAN_HEADER_LEN;
+        len -= VLAN_HEADER_LEN;
+    }
+
+    /* An 802.3 frame has a length instead of a type.  Its type is the one in
+     * its SNAP header, if it has an Ethernet one. */
+    if (type < ETH_TYPE_II_START) {
+        if (len >= LLC_SNAP_HEADER_LEN
+            && p[0] == LLC_DSAP_SNAP && p[1] == LLC_SSAP_SNAP
+            && p[2] == LLC_CNTL_SNAP && !p[3] && !p[4] && !p[5]) {
+            type = get16(p + 6);
+            p += LLC_SNAP_HEADER_LEN;
+            len -= LLC_SNAP_HEADER_LEN;
+        } else {
+            put<OXM_OF_ETH_TYPE>(match, ETH_TYPE_NOT_ETH_TYPE);
+            return;
+        }
+    }
+    put<OXM_OF_ETH_TYPE>(match, type);
+
+    switch (type) {
+    case ETH_TYPE_IP:
+        extract_ipv4(match, p, len);
+        break;
+    case ETH_TYPE_IPV6:
+        extract_ipv6(match, p, len);
+        break;
+    case ETH_TYPE_ARP:
+        extract_arp(match, p, len);
+        break;
+    case ETH_TYPE_MPLS:
+    case ETH_TYPE_MPLS_MCAST:
+        extract_mpls(match, p, len);
+        break;
+    }
+}
+
 const std::string
 Flow::to_string() const
 {
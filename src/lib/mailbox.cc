@@ -0,0 +1,101 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "mailbox.hh"
+
+#include <errno.h>
+#include <unistd.h>
+#include "errno_exception.hh"
+#include "socket-util.hh"
+#include "threads/cooperative.hh"
+
+namespace vigil {
+
+Mailbox::Mailbox()
+{
+    if (pipe(fds)) {
+        throw errno_exception(errno, "pipe");
+    }
+    set_nonblocking(fds[0]);
+    set_nonblocking(fds[1]);
+}
+
+Mailbox::~Mailbox()
+{
+    co_fd_closed(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void
+Mailbox::post(const Callback& callback)
+{
+    bool was_empty;
+    {
+        Scoped_native_mutex lock(&mutex);
+        was_empty = incoming.empty();
+        incoming.push_back(callback);
+    }
+
+    /* If the pipe is full then the receiver has a wakeup pending already. */
+    if (was_empty) {
+        char c = 0;
+        (void) write(fds[1], &c, 1);
+    }
+}
+
+bool
+Mailbox::poll()
+{
+    char buf[64];
+    while (read(fds[0], buf, sizeof buf) > 0) {
+        continue;
+    }
+
+    {
+        Scoped_native_mutex lock(&mutex);
+        if (pending.empty()) {
+            pending.swap(incoming);
+        } else {
+            pending.insert(pending.end(), incoming.begin(), incoming.end());
+            incoming.clear();
+        }
+    }
+
+    /* Callbacks are taken off 'pending' one at a time, so that if one of them
+     * blocks and poll() is re-entered from another thread, the rest still run
+     * in the order they were posted. */
+    size_t max = pending.size();
+    for (size_t i = 0; i < max && !pending.empty(); ++i) {
+        Callback callback(pending.front());
+        pending.pop_front();
+        callback();
+    }
+    return max > 0;
+}
+
+void
+Mailbox::wait()
+{
+    if (!pending.empty()) {
+        co_immediate_wake(1, NULL);
+    } else {
+        co_fd_read_wait(fds[0], NULL);
+    }
+}
+
+} // namespace vigil
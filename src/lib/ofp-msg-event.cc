@@ -1,22 +1,229 @@
 #include "ofp-msg-event.hh"
+#include <boost/make_shared.hpp>
+#include "block-pool.hh"
 #include "ofp-msg.hh"
 
 
 namespace vigil {
 
+boost::shared_ptr<Ofp_msg>
+Ofp_msg::create(struct ::ofl_msg_header *msg) {
+    return boost::allocate_shared<Ofp_msg>(Pool_allocator<Ofp_msg>(), msg);
+}
+
+boost::shared_ptr<Ofp_msg>
+Ofp_msg::unpack(uint8_t *buf, size_t len, uint32_t *xid,
+                const boost::shared_ptr<Ofp_msg_arenas>& arenas) {
+    struct ofl_arena *arena = arenas->get();
+    struct ofl_msg_header *msg;
+    if (ofl_msg_unpack_arena(buf, len, &msg, xid, arena)) {
+        arenas->put(arena);
+        return boost::shared_ptr<Ofp_msg>();
+    }
+    return boost::allocate_shared<Ofp_msg>(Pool_allocator<Ofp_msg>(),
+                                           msg, arena, arenas);
+}
+
+boost::shared_ptr<Ofp_msg>
+Ofp_msg::unpack(std::auto_ptr<Buffer>& b, uint32_t *xid,
+                const boost::shared_ptr<Ofp_msg_arenas>& arenas) {
+    if (ofl_msg_unpack_header(b->data(), b->size(), xid)) {
+        return boost::shared_ptr<Ofp_msg>();
+    }
+    boost::shared_ptr<Ofp_msg> m(boost::allocate_shared<Ofp_msg>(
+                                     Pool_allocator<Ofp_msg>(),
+                                     b.get(), arenas));
+    b.release();
+    return m;
+}
+
+ofl_err
+Ofp_msg::try_decode() const {
+    if (msg || error) {
+        return error;
+    }
+    struct ofl_arena *a = arenas->get();
+    struct ofl_msg_header *m;
+    error = ofl_msg_unpack_borrowed(buffer->data(), buffer->size(),
+                                    &m, NULL, a);
+    if (error) {
+        arenas->put(a);
+        return error;
+    }
+    arena = a;
+    msg = m;
+    return 0;
+}
+
+struct ofl_msg_header *
+Ofp_msg::decode() const {
+    if (error) {
+        throw Bad_ofp_msg(error);
+    }
+    if (try_decode()) {
+        arenas->report_error(*this, error);
+        throw Bad_ofp_msg(error);
+    }
+    return msg;
+}
+
+enum ofp_type
+Ofp_msg::get_type() const {
+    if (msg) {
+        return msg->type;
+    }
+    return (enum ofp_type) buffer->at<struct ofp_header>(0).type;
+}
+
+enum ofp_multipart_types
+Ofp_msg::get_multipart_type() const {
+    if (msg) {
+        return ((struct ofl_msg_multipart_reply_header *) msg)->type;
+    }
+    return (enum ofp_multipart_types)
+        ntohs(buffer->at<struct ofp_multipart_reply>(0).type);
+}
+
+Ofp_msg_arenas::Ofp_msg_arenas(size_t max_free_)
+    : spare(NULL),
+      max_free(max_free_)
+{
+}
+
+Ofp_msg_arenas::~Ofp_msg_arenas()
+{
+    if (spare) {
+        free_arenas.push_back(spare);
+    }
+    for (size_t i = 0; i < free_arenas.size(); i++) {
+        ofl_arena_destroy(free_arenas[i]);
+        delete free_arenas[i];
+    }
+}
+
+struct ofl_arena *
+Ofp_msg_arenas::get()
+{
+    struct ofl_arena *arena = __sync_lock_test_and_set(
+        &spare, (struct ofl_arena *) NULL);
+    if (arena) {
+        return arena;
+    }
+
+    {
+        Scoped_native_mutex lock(&mutex);
+        if (!free_arenas.empty()) {
+            arena = free_arenas.back();
+            free_arenas.pop_back();
+            return arena;
+        }
+    }
+    arena = new ofl_arena;
+    ofl_arena_init(arena);
+    return arena;
+}
+
+void
+Ofp_msg_arenas::put(struct ofl_arena *arena)
+{
+    ofl_arena_reset(arena);
+    if (__sync_bool_compare_and_swap(&spare, (struct ofl_arena *) NULL,
+                                     arena)) {
+        return;
+    }
+
+    {
+        Scoped_native_mutex lock(&mutex);
+        if (free_arenas.size() < max_free) {
+            free_arenas.push_back(arena);
+            return;
+        }
+    }
+    ofl_arena_destroy(arena);
+    delete arena;
+}
+
+void*
+Ofp_msg_event::operator new(size_t size) {
+    return (size == sizeof(Ofp_msg_event)
+            ? block_pool_for<Ofp_msg_event>().allocate()
+            : ::operator new(size));
+}
+
+void
+Ofp_msg_event::operator delete(void* p, size_t size) {
+    if (size == sizeof(Ofp_msg_event)) {
+        block_pool_for<Ofp_msg_event>().deallocate(p);
+    } else {
+        ::operator delete(p);
+    }
+}
+
 Ofp_msg_event *
 Ofp_msg_event::create_event(datapathid dpid, uint32_t xid, boost::shared_ptr<Ofp_msg> msg) {
-    std::string name;
-	switch ((**msg)->type) {
+    Event_type type;
+	switch (msg->get_type()) {
     	case OFPT_MULTIPART_REPLY: {
-    		name = get_stats_name(((struct ofl_msg_multipart_reply_header *)**msg)->type);
+    		type = get_stats_event_type(msg->get_multipart_type());
     		break;
     	}
     	default: {
-    		name = get_name((**msg)->type);
+    		type = get_event_type(msg->get_type());
     	}
     }
-	return new Ofp_msg_event(name, dpid, xid, msg);
+	return new Ofp_msg_event(type, dpid, xid, msg);
+}
+
+/* Event types of the OpenFlow message and multipart reply events, indexed
+ * by message or multipart type.  Built on first use, so that creating an
+ * event does not have to build its name. */
+namespace {
+
+struct Ofp_msg_event_types {
+    Event_type msg[OFPT_METER_MOD + 1];
+    Event_type stats[OFPMP_PORT_DESC + 1];
+    Event_type experimenter_stats;
+    Event_type unknown;
+
+    Ofp_msg_event_types() {
+        for (int i = 0; i <= OFPT_METER_MOD; i++) {
+            msg[i] = event_type(Ofp_msg_event::get_name((enum ofp_type) i));
+        }
+        for (int i = 0; i <= OFPMP_PORT_DESC; i++) {
+            stats[i] = event_type(Ofp_msg_event::get_stats_name(
+                                      (enum ofp_multipart_types) i));
+        }
+        experimenter_stats = event_type(
+            Ofp_msg_event::get_stats_name(OFPMP_EXPERIMENTER));
+        unknown = event_type("");
+    }
+};
+
+const Ofp_msg_event_types&
+ofp_msg_event_types()
+{
+    static const Ofp_msg_event_types types;
+    return types;
+}
+
+} // unnamed namespace
+
+Event_type
+Ofp_msg_event::get_event_type(enum ofp_type type) {
+    const Ofp_msg_event_types& types = ofp_msg_event_types();
+    return (unsigned int) type <= OFPT_METER_MOD ? types.msg[type] : types.unknown;
+}
+
+Event_type
+Ofp_msg_event::get_stats_event_type(enum ofp_multipart_types type) {
+    const Ofp_msg_event_types& types = ofp_msg_event_types();
+    if ((unsigned int) type <= OFPMP_PORT_DESC) {
+        return types.stats[type];
+    } else if (type == OFPMP_EXPERIMENTER) {
+        return types.experimenter_stats;
+    } else {
+        return types.unknown;
+    }
 }
 
 std::string
@@ -0,0 +1,256 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ofp-template.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "../oflib/oxm-match.h"
+
+namespace vigil {
+
+static inline uint16_t
+get_be16(const uint8_t *p)
+{
+    uint16_t x;
+    memcpy(&x, p, sizeof x);
+    return ntohs(x);
+}
+
+static inline uint32_t
+get_be32(const uint8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof x);
+    return ntohl(x);
+}
+
+Ofp_template::Ofp_template(struct ofl_msg_header *msg)
+    : data_offset(0)
+{
+    memset(slots, 0, sizeof slots);
+
+    uint8_t *buf;
+    size_t buf_len;
+    if (msg->type != OFPT_FLOW_MOD && msg->type != OFPT_PACKET_OUT) {
+        throw std::runtime_error("Ofp_template: unsupported message type");
+    }
+    if (ofl_msg_pack(msg, 0, &buf, &buf_len, NULL)) {
+        throw std::runtime_error("Ofp_template: cannot pack message");
+    }
+    if (buf_len > MAX_SIZE) {
+        free(buf);
+        throw std::runtime_error("Ofp_template: message too long");
+    }
+    packed.assign(buf, buf + buf_len);
+    free(buf);
+
+    set_slot(XID, offsetof(struct ofp_header, xid), 4);
+    if (msg->type == OFPT_FLOW_MOD) {
+        set_slot(COOKIE, offsetof(struct ofp_flow_mod, cookie), 8);
+        set_slot(PRIORITY, offsetof(struct ofp_flow_mod, priority), 2);
+        set_slot(IDLE_TIMEOUT, offsetof(struct ofp_flow_mod, idle_timeout), 2);
+        set_slot(HARD_TIMEOUT, offsetof(struct ofp_flow_mod, hard_timeout), 2);
+        set_slot(BUFFER_ID, offsetof(struct ofp_flow_mod, buffer_id), 4);
+
+        size_t match_offset = offsetof(struct ofp_flow_mod, match);
+        find_match_fields(match_offset);
+
+        /* Instructions follow the match, padded to a multiple of 8. */
+        size_t match_len = get_be16(&packed[match_offset
+                                            + offsetof(struct ofp_match,
+                                                       length)]);
+        size_t ofs = match_offset + (match_len + 7) / 8 * 8;
+        while (ofs + sizeof(struct ofp_instruction) <= packed.size()
+               && !has_slot(OUTPUT_PORT)) {
+            uint16_t type = get_be16(&packed[ofs]);
+            uint16_t len = get_be16(&packed[ofs + 2]);
+            if (len < sizeof(struct ofp_instruction)) {
+                break;
+            }
+            if (type == OFPIT_APPLY_ACTIONS || type == OFPIT_WRITE_ACTIONS) {
+                find_output_port(ofs + sizeof(struct ofp_instruction_actions),
+                                 len - sizeof(struct ofp_instruction_actions));
+            }
+            ofs += len;
+        }
+    } else {
+        set_slot(BUFFER_ID, offsetof(struct ofp_packet_out, buffer_id), 4);
+        set_slot(IN_PORT, offsetof(struct ofp_packet_out, in_port), 4);
+
+        size_t actions_len = get_be16(&packed[offsetof(struct ofp_packet_out,
+                                                       actions_len)]);
+        find_output_port(sizeof(struct ofp_packet_out), actions_len);
+        data_offset = sizeof(struct ofp_packet_out) + actions_len;
+    }
+}
+
+void
+Ofp_template::set_slot(Slot slot, size_t offset, size_t width)
+{
+    slots[slot].offset = offset;
+    slots[slot].width = width;
+}
+
+/* Records where the value of each OXM TLV in the match at 'match_offset'
+ * lies. */
+void
+Ofp_template::find_match_fields(size_t match_offset)
+{
+    size_t len = get_be16(&packed[match_offset
+                                  + offsetof(struct ofp_match, length)]);
+    size_t ofs = match_offset + offsetof(struct ofp_match, oxm_fields);
+    size_t end = match_offset + len;
+    while (ofs + 4 <= end) {
+        uint32_t header = get_be32(&packed[ofs]);
+        Field_pos f;
+        f.header = header;
+        f.offset = ofs + 4;
+        fields.push_back(f);
+        ofs += 4 + OXM_LENGTH(header);
+    }
+}
+
+/* Looks for the first output action among the 'actions_len' bytes of
+ * actions at 'actions_offset'. */
+void
+Ofp_template::find_output_port(size_t actions_offset, size_t actions_len)
+{
+    size_t ofs = actions_offset;
+    size_t end = std::min(actions_offset + actions_len, packed.size());
+    while (ofs + sizeof(struct ofp_action_header) <= end) {
+        uint16_t type = get_be16(&packed[ofs]);
+        uint16_t len = get_be16(&packed[ofs + 2]);
+        if (len < sizeof(struct ofp_action_header)) {
+            return;
+        }
+        if (type == OFPAT_OUTPUT) {
+            set_slot(OUTPUT_PORT,
+                     ofs + offsetof(struct ofp_action_output, port), 4);
+            return;
+        }
+        ofs += len;
+    }
+}
+
+int
+Ofp_template::find_field(uint32_t oxm_header) const
+{
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].header == oxm_header) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool
+Ofp_template::has_field(uint32_t oxm_header) const
+{
+    return find_field(oxm_header) >= 0;
+}
+
+Ofp_template_msg::Ofp_template_msg(const Ofp_template& tmpl_, uint8_t *buf_,
+                                   size_t buf_size_)
+    : tmpl(tmpl_), buf(buf_), buf_size(buf_size_), len(tmpl_.size())
+{
+    if (len > buf_size) {
+        throw std::runtime_error("Ofp_template_msg: buffer too small");
+    }
+    memcpy(buf, &tmpl.packed[0], len);
+}
+
+void
+Ofp_template_msg::set(Ofp_template::Slot slot, uint64_t value)
+{
+    const Ofp_template::Slot_pos& s = tmpl.slots[slot];
+    uint8_t *p = buf + s.offset;
+    switch (s.width) {
+    case 2: {
+        uint16_t x = htons(value);
+        memcpy(p, &x, sizeof x);
+        break;
+    }
+    case 4: {
+        uint32_t x = htonl(value);
+        memcpy(p, &x, sizeof x);
+        break;
+    }
+    case 8: {
+        uint64_t x = htonll(value);
+        memcpy(p, &x, sizeof x);
+        break;
+    }
+    default:
+        throw std::runtime_error("Ofp_template_msg: template has no such slot");
+    }
+}
+
+bool
+Ofp_template_msg::set_field(uint32_t oxm_header, const void *value)
+{
+    int i = tmpl.find_field(oxm_header);
+    if (i < 0) {
+        return false;
+    }
+    memcpy(buf + tmpl.fields[i].offset, value, OXM_LENGTH(oxm_header));
+    return true;
+}
+
+bool
+Ofp_template_msg::set_field8(uint32_t oxm_header, uint8_t value)
+{
+    return set_field(oxm_header, &value);
+}
+
+bool
+Ofp_template_msg::set_field16(uint32_t oxm_header, uint16_t value)
+{
+    uint16_t x = htons(value);
+    return set_field(oxm_header, &x);
+}
+
+bool
+Ofp_template_msg::set_field32(uint32_t oxm_header, uint32_t value)
+{
+    uint32_t x = htonl(value);
+    return set_field(oxm_header, &x);
+}
+
+bool
+Ofp_template_msg::set_field64(uint32_t oxm_header, uint64_t value)
+{
+    uint64_t x = htonll(value);
+    return set_field(oxm_header, &x);
+}
+
+bool
+Ofp_template_msg::set_data(const void *data, size_t data_len)
+{
+    if (!tmpl.data_offset || tmpl.data_offset + data_len > buf_size) {
+        return false;
+    }
+    memcpy(buf + tmpl.data_offset, data, data_len);
+    len = tmpl.data_offset + data_len;
+    reinterpret_cast<struct ofp_header *>(buf)->length = htons(len);
+    return true;
+}
+
+} // namespace vigil
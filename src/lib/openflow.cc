@@ -17,6 +17,8 @@
  */
 #include <config.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include "openflow.hh"
 #include "openflow/nicira-ext.h"
 #include <boost/bind.hpp>
@@ -53,6 +55,9 @@ static Vlog_module log("openflow");
 const int Reliable_openflow_connection::backoff_limit = 60;
 const int Openflow_connection::probe_interval = 15;
 
+/* Maximum number of queued messages gathered into a single write. */
+static const int max_tx_iov = 64;
+
 Openflow_connection::Openflow_connection()
     : ext_data_xid(UINT32_MAX),
       datapath_id(),
@@ -240,6 +245,28 @@ int Openflow_connection::send_openflow(const ofp_header* oh, bool block)
     }
 }
 
+/* Tries to queue the OpenFlow message in 'b' for transmission, like
+ * send_openflow() above, except that on success ownership of 'b' passes to the
+ * connection (and 'b' is left null), which spares the connection from having
+ * to copy the message.  On failure the caller retains ownership of 'b'. */
+int Openflow_connection::send_openflow(std::auto_ptr<Buffer>& b, bool block)
+{
+    co_might_yield_if(block);
+    for (;;) {
+        int error = connect(block);
+        if (!error) {
+            error = call_send_openflow(b);
+        }
+        if (block && error == EAGAIN) {
+            co_might_yield();
+            send_openflow_wait();
+            co_block();
+        } else if (error != EINTR) {
+            return error;
+        }
+    }
+}
+
 /* Call do_send_openflow() and log any error. */
 int
 Openflow_connection::call_send_openflow(const ofp_header* oh)
@@ -251,6 +278,30 @@ Openflow_connection::call_send_openflow(const ofp_header* oh)
     return error;
 }
 
+/* Call do_send_openflow_buffer() and log any error. */
+int
+Openflow_connection::call_send_openflow(std::auto_ptr<Buffer>& b)
+{
+    int error = do_send_openflow_buffer(b);
+    if (error && error != EAGAIN) {
+        log.warn("%s: send error: %s", to_string().c_str(), strerror(error));
+    }
+    return error;
+}
+
+/* Default implementation for connections that cannot take ownership of the
+ * messages they send: sends the message in 'b' as if by do_send_openflow()
+ * and then destroys 'b' if that succeeds. */
+int
+Openflow_connection::do_send_openflow_buffer(std::auto_ptr<Buffer>& b)
+{
+    int error = do_send_openflow(&b->at<ofp_header>(0));
+    if (!error) {
+        b.reset();
+    }
+    return error;
+}
+
 /* Call do_recv_openflow() and log any error. */
 std::auto_ptr<Buffer>
 Openflow_connection::call_recv_openflow(int& error)
@@ -450,46 +501,38 @@ int Openflow_connection::send_stats_request(ofp_multipart_types type)
  * Does not block: returns EAGAIN if the message cannot be immediately accepted
  * for transmission. */
 int Openflow_connection::send_echo_request() {
-
-    struct ofl_msg_echo echo;
-    echo.header.type = OFPT_ECHO_REQUEST;
-    echo.data = NULL;
-    echo.data_length = 0;
-
-    uint8_t *buf;
-    size_t buf_len;
-    if (ofl_msg_pack((struct ofl_msg_header *)&echo, 0/*xid*/, &buf, &buf_len, NULL/*ofl_exp*/)) {
-        //TODO log error;
-        return -1;
-    }
-
-    int ret = send_openflow((const ofp_header*)buf, false);
-    free(buf);
-    return ret;
+    std::auto_ptr<Buffer> b(new Array_buffer(OFL_ECHO_LEN(0)));
+    ofl_msg_pack_echo_data(OFPT_ECHO_REQUEST, 0/*xid*/, NULL, 0,
+                           b->data(), b->size());
+    return send_openflow(b, false);
 }
 
 
 /* Does not block: returns EAGAIN if the message cannot be immediately accepted
  * for transmission. */
 int Openflow_connection::send_echo_reply(uint32_t xid, boost::shared_ptr<Ofp_msg> msg) {
-    assert((*msg)->type == OFPT_ECHO_REQUEST);
-    struct ofl_msg_echo *rq = (struct ofl_msg_echo *)*(*msg);
-
-    struct ofl_msg_echo reply;
-    reply.header.type = OFPT_ECHO_REPLY;
-    reply.data = rq->data;
-    reply.data_length = rq->data_length;
-
-    uint8_t *buf;
-    size_t buf_len;
-    if (ofl_msg_pack((struct ofl_msg_header *)&reply, xid, &buf, &buf_len, NULL/*ofl_exp*/)) {
-        //TODO log error;
-        return -1;
+    assert(msg->get_type() == OFPT_ECHO_REQUEST);
+
+    /* Echo the request's data straight from the received message, if there
+     * is one, so that the request is never decoded. */
+    const uint8_t *data;
+    size_t data_len;
+    const Buffer *rq_buffer = msg->get_buffer();
+    if (rq_buffer) {
+        data = rq_buffer->data() + sizeof(struct ofp_header);
+        data_len = rq_buffer->size() - sizeof(struct ofp_header);
+    } else {
+        struct ofl_msg_echo *rq = (struct ofl_msg_echo *)*(*msg);
+        data = rq->data;
+        data_len = rq->data_length;
     }
 
-    int ret = send_openflow((const ofp_header*)buf, false);
-    free(buf);
-    return ret;
+    std::auto_ptr<Buffer> b(new Array_buffer(OFL_ECHO_LEN(data_len)));
+    if (!ofl_msg_pack_echo_data(OFPT_ECHO_REPLY, xid, data, data_len,
+                                b->data(), b->size())) {
+        return EMSGSIZE;
+    }
+    return send_openflow(b, false);
 }
 
 
@@ -499,35 +542,82 @@ int Openflow_connection::send_echo_reply(uint32_t xid, boost::shared_ptr<Ofp_msg
  * for transmission. */
 int Openflow_connection::send_barrier_request()
 {
-    struct ofl_msg_header barrier;
-    barrier.type = OFPT_BARRIER_REQUEST;
-
-    uint8_t *buf;
-    size_t buf_len;
-    if (ofl_msg_pack((struct ofl_msg_header *)&barrier, 0/*xid*/, &buf, &buf_len, NULL/*ofl_exp*/)) {
-        //TODO log error;
-        return -1;
-    }
-
-    int ret = send_openflow((const ofp_header*)buf, false);
-    free(buf);
-    return ret;
+    std::auto_ptr<Buffer> b(new Array_buffer(OFL_BARRIER_REQUEST_LEN));
+    ofl_msg_pack_barrier_request(0/*xid*/, b->data(), b->size());
+    return send_openflow(b, false);
 }
 
 
-
+
 /* Constructs a Openflow connection that takes over ownership of 'stream'. */
 Openflow_stream_connection::Openflow_stream_connection(
     std::auto_ptr<Async_stream> stream_,Connection_type t)
     : tx_fsm(boost::bind(&Openflow_stream_connection::tx_run, this)),
-      stream(stream_), rx_bytes(0), conn_type(t)
+      stream(stream_), rx_bytes(0), rx_head(0), rx_tail(0), rx_used(0),
+      rx_ring_size(default_rx_ring_size), n_rx_reads(0), n_rx_msgs(0),
+      tx_queued(0), tx_low(default_tx_low), tx_high(default_tx_high),
+      tx_full(false), n_tx_writes(0), n_tx_msgs(0), conn_type(t)
+{
+}
+
+size_t Openflow_stream_connection::default_rx_ring_size = 65536;
+
+void
+Openflow_stream_connection::set_rx_ring_size(size_t size)
+{
+    default_rx_ring_size = size;
+}
+
+size_t
+Openflow_stream_connection::get_rx_ring_size()
+{
+    return default_rx_ring_size;
+}
+
+size_t Openflow_stream_connection::default_tx_low = 64 * 1024;
+size_t Openflow_stream_connection::default_tx_high = 256 * 1024;
+
+void
+Openflow_stream_connection::set_tx_watermarks(size_t low, size_t high)
+{
+    default_tx_high = std::max(high, size_t(1));
+    default_tx_low = std::min(low, default_tx_high - 1);
+}
+
+size_t
+Openflow_stream_connection::get_tx_low_watermark()
 {
+    return default_tx_low;
+}
+
+size_t
+Openflow_stream_connection::get_tx_high_watermark()
+{
+    return default_tx_high;
 }
 
 /* Close the stream associated with this connection */
 int
 Openflow_stream_connection::close()
 {
+    /* Give queued messages, e.g. an error message explaining why we are
+     * disconnecting, a last chance to go out. */
+    if (!tx_queue.empty() && flush_tx_queue() == EAGAIN) {
+        log.dbg("%s: dropping %zu queued bytes on close",
+                to_string().c_str(), tx_queued);
+    }
+    clear_tx_queue();
+
+    if (n_rx_reads) {
+        log.dbg("%s: received %"PRIu64" messages in %"PRIu64" reads "
+                "(%.2f messages per read)", to_string().c_str(),
+                n_rx_msgs, n_rx_reads, double(n_rx_msgs) / n_rx_reads);
+    }
+    if (n_tx_writes) {
+        log.dbg("%s: sent %"PRIu64" messages in %"PRIu64" writes "
+                "(%.2f messages per write)", to_string().c_str(),
+                n_tx_msgs, n_tx_writes, double(n_tx_msgs) / n_tx_writes);
+    }
     return stream->close();
 }
 
@@ -546,67 +636,135 @@ Openflow_stream_connection::do_connect_wait()
 void
 Openflow_stream_connection::tx_run()
 {
-    if (tx_buf.get() && send_tx_buf() == EAGAIN) {
-        do_send_openflow_wait();
+    if (!tx_queue.empty() && flush_tx_queue() == EAGAIN) {
+        stream->write_wait();
     }
     co_fsm_block();
 }
 
-int Openflow_stream_connection::send_tx_buf()
+/* Writes as much of the transmit queue as the stream will accept, gathering
+ * up to 'max_tx_iov' queued messages into each write.  Returns 0 if the queue
+ * was emptied, EAGAIN if the stream would block, otherwise a positive errno
+ * value after closing the stream and discarding the queue. */
+int Openflow_stream_connection::flush_tx_queue()
 {
-    ssize_t bytes_written;
-    int error = stream->write_fully(*tx_buf, &bytes_written, false);
-    tx_buf->pull(bytes_written);
+    int error = 0;
+    while (!tx_queue.empty()) {
+        struct iovec iov[max_tx_iov];
+        int n_iov = 0;
+        for (boost::ptr_deque<Buffer>::iterator i = tx_queue.begin();
+             i != tx_queue.end() && n_iov < max_tx_iov; ++i, ++n_iov) {
+            iov[n_iov].iov_base = i->data();
+            iov[n_iov].iov_len = i->size();
+        }
 
-    if (error) {
-        if (error != EAGAIN) {
-            stream->close(); 
+        ssize_t n = stream->writev(iov, n_iov, false);
+        if (n <= 0) {
+            error = n ? -n : EAGAIN;
+            break;
+        }
+        ++n_tx_writes;
+        tx_queued -= n;
+        while (n > 0) {
+            Buffer& front = tx_queue.front();
+            if (n >= front.size()) {
+                n -= front.size();
+                tx_queue.pop_front();
+                ++n_tx_msgs;
+            } else {
+                front.pull(n);
+                n = 0;
+            }
         }
-        return error;
     }
 
-    if (!tx_buf->size()) {
-        tx_buf.reset();
-        return 0;
-    } else {
-        return EAGAIN;
+    if (error && error != EAGAIN) {
+        stream->close();
+        clear_tx_queue();
+    } else if (tx_queued >= tx_high) {
+        tx_full = true;
+    } else if (tx_full && tx_queued <= tx_low) {
+        tx_full = false;
+        tx_drained.broadcast();
+    }
+    return error;
+}
+
+/* Discards the transmit queue, releasing anyone waiting for it to drain. */
+void Openflow_stream_connection::clear_tx_queue()
+{
+    tx_queue.clear();
+    tx_queued = 0;
+    if (tx_full) {
+        tx_full = false;
+        tx_drained.broadcast();
     }
 }
 
 int Openflow_stream_connection::do_send_openflow(const ofp_header* oh)
 {
-    if (tx_buf.get()) {
-        int error = send_tx_buf();
-        if (error) {
+    if (tx_full) {
+        int error = flush_tx_queue();
+        if (tx_full) {
+            return error ? error : EAGAIN;
+        }
+    }
+
+    /* The caller retains ownership of 'oh', so we have to queue a copy.
+     * Callers that can give up their message should use
+     * do_send_openflow_buffer() instead. */
+    size_t length = ntohs(oh->length);
+    std::auto_ptr<Buffer> b(new Array_buffer(length));
+    memcpy(b->data(), oh, length);
+    return do_send_openflow_buffer(b);
+}
+
+int
+Openflow_stream_connection::do_send_openflow_buffer(std::auto_ptr<Buffer>& b)
+{
+    if (tx_full) {
+        int error = flush_tx_queue();
+        if (tx_full) {
+            return error ? error : EAGAIN;
+        } else if (error && error != EAGAIN) {
             return error;
         }
     }
 
-    /* FIXME: shouldn't need a copy here in most cases */
-    tx_buf.reset(new Array_buffer(ntohs(oh->length)));
-    memcpy(tx_buf->data(), oh, ntohs(oh->length));
-    int error = send_tx_buf();
-    if (error == EAGAIN) {
+    tx_queued += b->size();
+    tx_queue.push_back(b.release());
+    if (tx_queued >= tx_high) {
+        /* Don't let the queue grow past the high watermark if the stream can
+         * take some of it right now. */
+        int error = flush_tx_queue();
+        if (error && error != EAGAIN) {
+            return error;
+        }
+    }
+
+    /* Otherwise leave the message for tx_run(), which writes out everything
+     * queued in the meantime with a single system call. */
+    if (!tx_queue.empty()) {
         tx_fsm.wake();
-        return 0;
-    } else {
-        return error;
     }
+    return 0;
 }
 
-int Openflow_stream_connection::do_read(void *p, size_t need_bytes)
+/* Interprets 'n', the return value of a read from 'stream'.  Returns 0 if
+ * data was read, otherwise EAGAIN or the error to report to the caller, in
+ * which case the stream is closed.  'partial' indicates that part of a
+ * message has already been received, which makes end of file an error. */
+int Openflow_stream_connection::check_read(ssize_t n, bool partial)
 {
-    Nonowning_buffer b(p, need_bytes);
-    ssize_t n = stream->read(b, false);
     if (n > 0) {
-        rx_bytes += n;
-        return n < need_bytes ? EAGAIN : 0;
+        ++n_rx_reads;
+        return 0;
     } else if (n == -EAGAIN) {
         return EAGAIN;
     } else {
         stream->close();
         if (n == 0) {
-            if (!rx_bytes) {
+            if (!partial) {
                 return EOF;
             } else {
                 log.warn("%s: unexpected connection drop in middle "
@@ -619,7 +777,29 @@ int Openflow_stream_connection::do_read(void *p, size_t need_bytes)
     }
 }
 
+int Openflow_stream_connection::do_read(void *p, size_t need_bytes)
+{
+    Nonowning_buffer b(p, need_bytes);
+    ssize_t n = stream->read(b, false);
+    int error = check_read(n, rx_bytes > 0);
+    if (!error) {
+        rx_bytes += n;
+        return n < need_bytes ? EAGAIN : 0;
+    }
+    return error;
+}
+
 std::auto_ptr<Buffer> Openflow_stream_connection::do_recv_openflow(int& error)
+{
+    std::auto_ptr<Buffer> b(rx_ring_size ? recv_batched(error)
+                            : recv_unbatched(error));
+    if (!error) {
+        ++n_rx_msgs;
+    }
+    return b;
+}
+
+std::auto_ptr<Buffer> Openflow_stream_connection::recv_unbatched(int& error)
 {
     if (rx_bytes < sizeof rx_header) {
         error = do_read((char *) &rx_header + rx_bytes,
@@ -653,10 +833,130 @@ std::auto_ptr<Buffer> Openflow_stream_connection::do_recv_openflow(int& error)
     return rx_buf;
 }
 
+/* Returns the next complete message read from the stream, reading from the
+ * stream only if 'rx_in' does not already hold one. */
+std::auto_ptr<Buffer> Openflow_stream_connection::recv_batched(int& error)
+{
+    for (;;) {
+        size_t avail = rx_tail - rx_head;
+        size_t need = sizeof(ofp_header);
+        if (avail >= need) {
+            /* Messages follow each other at arbitrary offsets in 'rx_in', so
+             * the header cannot be accessed through an ofp_header here. */
+            uint16_t length_be;
+            memcpy(&length_be, &rx_in[rx_head] + offsetof(ofp_header, length),
+                   sizeof length_be);
+            size_t length = ntohs(length_be);
+            if (length < sizeof(ofp_header)) {
+                log.warn("%s: received length (%zu) claims to be shorter "
+                         "than header", to_string().c_str(), length);
+                stream->close();
+                error = EPROTO;
+                return std::auto_ptr<Buffer>(0);
+            }
+            if (avail >= length) {
+                std::auto_ptr<Buffer> b(copy_rx_msg(&rx_in[rx_head], length));
+                rx_head += length;
+                error = 0;
+                return b;
+            }
+            need = length;
+        }
+
+        reserve_rx_in(need);
+        Nonowning_buffer b(&rx_in[rx_tail], rx_in.size() - rx_tail);
+        ssize_t n = stream->read(b, false);
+        error = check_read(n, rx_tail > rx_head);
+        if (error) {
+            return std::auto_ptr<Buffer>(0);
+        }
+        rx_tail += n;
+    }
+}
+
+/* Makes sure that 'rx_in' can hold 'need' bytes starting at 'rx_head' and has
+ * a reasonable amount of free space after 'rx_tail' to read into, by moving
+ * the partial message at the end of 'rx_in', if any, to its front. */
+void Openflow_stream_connection::reserve_rx_in(size_t need)
+{
+    if (rx_head + need <= rx_in.size()
+        && (rx_in.size() - rx_tail) * 2 >= rx_in.size()) {
+        return;
+    }
+
+    size_t used = rx_tail - rx_head;
+    if (rx_in.size() < std::max(rx_ring_size, need)) {
+        rx_in.resize(std::max(rx_ring_size, need));
+    }
+    if (used) {
+        memmove(&rx_in[0], &rx_in[0] + rx_head, used);
+    }
+    rx_head = 0;
+    rx_tail = used;
+}
+
+/* Returns a buffer holding a copy of the 'length'-byte message at 'p'.  The
+ * copy is placed at the next 8-byte aligned offset in the receive ring, so
+ * that it can be accessed through OpenFlow structures, and shares the ring's
+ * storage.  A message larger than a ring, or one received while too many
+ * rings are pinned, gets a buffer of its own instead. */
+std::auto_ptr<Buffer>
+Openflow_stream_connection::copy_rx_msg(const uint8_t *p, size_t length)
+{
+    size_t slot = (length + 7) & ~size_t(7);
+    if ((!rx_ring || rx_used + slot > rx_ring_size)
+        && (slot > rx_ring_size || !next_rx_ring())) {
+        std::auto_ptr<Buffer> b(new Array_buffer(length));
+        memcpy(b->data(), p, length);
+        return b;
+    }
+
+    memcpy(&rx_ring[rx_used], p, length);
+    std::auto_ptr<Buffer> b(new Shared_array_buffer(rx_ring, rx_used, length));
+    rx_used += slot;
+    return b;
+}
+
+/* Starts over with an empty receive ring.  The current ring is reused if no
+ * message refers to it any longer.  Otherwise it is set aside, and a ring set
+ * aside earlier that has since been released is reused, or a new one is
+ * allocated.  Returns false, leaving no current ring, if 'max_rx_pinned'
+ * rings set aside are all still in use, so that an application that holds on
+ * to messages does not pin more than that many rings per connection. */
+bool Openflow_stream_connection::next_rx_ring()
+{
+    rx_used = 0;
+    if (rx_ring.unique()) {
+        return true;
+    }
+
+    if (rx_ring) {
+        rx_pinned.push_back(rx_ring);
+        rx_ring.reset();
+    }
+    for (size_t i = 0; i < rx_pinned.size(); ++i) {
+        if (rx_pinned[i].unique()) {
+            rx_ring.swap(rx_pinned[i]);
+            rx_pinned[i].swap(rx_pinned.back());
+            rx_pinned.pop_back();
+            return true;
+        }
+    }
+    if (rx_pinned.size() >= max_rx_pinned) {
+        return false;
+    }
+    rx_ring.reset(new uint8_t[rx_ring_size]);
+    return true;
+}
+
 void
 Openflow_stream_connection::do_send_openflow_wait()
 {
-    stream->write_wait();
+    if (tx_full) {
+        tx_drained.wait();
+    } else {
+        co_immediate_wake(1, NULL);
+    }
 }
 
 void
@@ -752,6 +1052,22 @@ Reliable_openflow_connection::do_send_openflow(const ofp_header* oh)
     return 0;
 }
 
+int
+Reliable_openflow_connection::do_send_openflow_buffer(std::auto_ptr<Buffer>& b)
+{
+    if (status == CONN_CONNECTED) {
+        int error = c->send_openflow(b, false);
+        if (error == 0 || error == EAGAIN) {
+            return error;
+        } else {
+            reconnect(error);
+            co_fsm_run(fsm);
+        }
+    }
+    b.reset();
+    return 0;
+}
+
 void
 Reliable_openflow_connection::do_send_openflow_wait()
 {
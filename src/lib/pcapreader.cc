@@ -19,6 +19,7 @@
 #include <boost/bind.hpp>
 
 #include <cerrno>
+#include <cstddef>
 #include <stdint.h>
 #include <netinet/in.h>
 #include <stdexcept>
@@ -28,6 +29,7 @@
 #include "buffer.hh"
 #include "packets.h"
 #include "threads/cooperative.hh"
+#include "../oflib/oxm-match.h"
 #include "vlog.hh"
 
 namespace vigil {
@@ -205,17 +207,27 @@ std::auto_ptr<Buffer> Pcapreader::do_recv_openflow(int& error)
       }
     } 
 
-    std::auto_ptr<Buffer> b(new Array_buffer(sizeof(ofp_packet_in) + delayed_pcap_header.len));
+    /* The packet-in's match holds only an in_port OXM TLV, padded to 8
+     * bytes, and is followed by 2 bytes of padding and the frame. */
+    const size_t oxm_ofs = offsetof(ofp_packet_in, match.oxm_fields);
+    const size_t match_len = offsetof(ofp_match, oxm_fields) + sizeof(uint32_t) * 2;
+    const size_t data_ofs = offsetof(ofp_packet_in, match)
+                            + (match_len + 7) / 8 * 8 + 2;
+    std::auto_ptr<Buffer> b(new Array_buffer(data_ofs + delayed_pcap_header.caplen));
+    memset(b->data(), 0, data_ofs);
     ofp_packet_in* opi = &b->at<ofp_packet_in>(0);
     opi->header.type = OFPT_PACKET_IN;
     opi->header.version = OFP_VERSION;
     opi->header.length = htons(b->size());
     opi->buffer_id = UINT32_MAX;
     opi->total_len = htons(delayed_pcap_header.len);
-    /* TODO: Use OXM and data payload from b */
-    //opi->in_port = htons(0);
     opi->reason = OFPR_NO_MATCH;
-    //::memcpy(opi->data, delayed_pcap_data, delayed_pcap_header.len);
+    opi->table_id = 0;
+    opi->match.type = htons(OFPMT_OXM);
+    opi->match.length = htons(match_len);
+    uint32_t oxm[2] = { htonl(OXM_OF_IN_PORT), htonl(0) };
+    ::memcpy(b->data() + oxm_ofs, oxm, sizeof oxm);
+    ::memcpy(b->data() + data_ofs, delayed_pcap_data, delayed_pcap_header.caplen);
     delayed_pcap_data = NULL; 
     error = 0;
     return b;
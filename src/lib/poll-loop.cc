@@ -39,7 +39,7 @@ struct Poll_thread
 class Poll_loop_impl
 {
 public:
-    Poll_loop_impl(unsigned int n_threads);
+    Poll_loop_impl(unsigned int n_threads, co_group* group);
     ~Poll_loop_impl() { }
     void add_pollable(Pollable*);
     void remove_pollable(Pollable*);
@@ -59,7 +59,7 @@ private:
     void appoint_polling_thread(Pollable_list::iterator i);
 };
 
-Poll_loop_impl::Poll_loop_impl(unsigned int n_threads)
+Poll_loop_impl::Poll_loop_impl(unsigned int n_threads, co_group* group)
 {
     assert(n_threads > 0);
 
@@ -69,7 +69,7 @@ Poll_loop_impl::Poll_loop_impl(unsigned int n_threads)
         Poll_thread* pt = new Poll_thread;
         threads.push_back(pt);
         pt->thread = co_thread_create(
-            &co_group_coop,
+            group,
             boost::bind(&Poll_loop_impl::poll_thread_main, this, pt));
         started.down();
     }
@@ -210,8 +210,8 @@ Poll_loop_impl::appoint_polling_thread(Pollable_list::iterator i)
 
 /* Implement Poll_loop_impl in terms of Poll_loop. */
 
-Poll_loop::Poll_loop(unsigned int n_threads)
-    : pimpl(new Poll_loop_impl(n_threads))
+Poll_loop::Poll_loop(unsigned int n_threads, co_group* group)
+    : pimpl(new Poll_loop_impl(n_threads, group))
 {
 }
 
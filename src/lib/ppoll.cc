@@ -18,7 +18,11 @@
 #include <config.h>
 #include "ppoll.hh"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
+#ifdef HAVE_EPOLL_PWAIT
+#include <sys/epoll.h>
+#endif
 #include "socket-util.hh"
 #include "timeval.hh"
 
@@ -91,6 +95,21 @@ Ppoll::poll(std::vector<pollfd>& pollfds, const struct timespec *timeout)
             ? ::ppoll(&pollfds[0], pollfds.size(), timeout, &unblock_signal)
             : ::ppoll(NULL, 0, timeout, &unblock_signal));
 }
+
+#ifdef HAVE_EPOLL_PWAIT
+int
+Ppoll::epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+                  const struct timespec *timeout)
+{
+    /* Round up, so that we do not wake up before the timeout expires. */
+    int ms = -1;
+    if (timeout) {
+        ms = (timeout->tv_sec >= INT_MAX / 1000 - 1 ? INT_MAX
+              : timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) / 1000000);
+    }
+    return ::epoll_pwait(epfd, events, maxevents, ms, &unblock_signal);
+}
+#endif
 #else /* !HAVE_PPOLL */
 Ppoll::Ppoll(int)
 {
@@ -0,0 +1,120 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "stats-collector.hh"
+
+#include <cstdlib>
+#include "../oflib/ofl-messages.h"
+
+namespace vigil {
+
+Stats_collector::Stats_collector(enum ofp_multipart_types type_)
+    : type(type_), done(NULL)
+{
+}
+
+Stats_collector::~Stats_collector()
+{
+    for (Partial_map::iterator i = partial.begin(); i != partial.end(); ++i) {
+        put_columns(i->second);
+    }
+    if (done) {
+        put_columns(done);
+    }
+    for (size_t i = 0; i < spare.size(); i++) {
+        ofl_stats_columns_destroy(spare[i]);
+        delete spare[i];
+    }
+}
+
+struct ofl_stats_columns *
+Stats_collector::get_columns()
+{
+    struct ofl_stats_columns *cols;
+    if (spare.empty()) {
+        cols = new ofl_stats_columns;
+        ofl_stats_columns_init(cols, type);
+    } else {
+        cols = spare.back();
+        spare.pop_back();
+        ofl_stats_columns_clear(cols);
+    }
+    return cols;
+}
+
+void
+Stats_collector::put_columns(struct ofl_stats_columns *cols)
+{
+    spare.push_back(cols);
+}
+
+const struct ofl_stats_columns *
+Stats_collector::add(const Ofp_msg_event& e)
+{
+    Key key(e.dpid, e.xid);
+    Partial_map::iterator i = partial.find(key);
+    if (i == partial.end()) {
+        i = partial.insert(std::make_pair(key, get_columns())).first;
+    }
+    struct ofl_stats_columns *cols = i->second;
+
+    /* Messages that were handed over already decoded are packed again, which
+     * only happens for replies that do not come from a connection. */
+    const Buffer *b = e.msg->get_buffer();
+    bool more = false;
+    ofl_err error;
+    if (b) {
+        error = ofl_stats_columns_append(cols, b->data(), b->size(), &more);
+    } else {
+        uint8_t *buf;
+        size_t len;
+        if (ofl_msg_pack(**e.msg, e.xid, &buf, &len, NULL)) {
+            error = OFL_ERROR;
+        } else {
+            error = ofl_stats_columns_append(cols, buf, len, &more);
+            free(buf);
+        }
+    }
+
+    if (error) {
+        partial.erase(i);
+        put_columns(cols);
+        throw Bad_ofp_msg(error);
+    }
+    if (more) {
+        return NULL;
+    }
+
+    partial.erase(i);
+    if (done) {
+        put_columns(done);
+    }
+    done = cols;
+    return done;
+}
+
+void
+Stats_collector::forget(const datapathid& dpid)
+{
+    Partial_map::iterator i = partial.lower_bound(Key(dpid, 0));
+    while (i != partial.end() && i->first.first == dpid) {
+        put_columns(i->second);
+        partial.erase(i++);
+    }
+}
+
+} // namespace vigil
@@ -159,6 +159,18 @@ ssize_t Tcp_socket::do_write(const Buffer& buffer)
     return retval >= 0 ? retval : -errno;;
 }
 
+ssize_t Tcp_socket::do_writev(const struct iovec* iov, int iovcnt)
+{
+    ssize_t retval;
+    do {
+        retval = ::writev(fd, iov, iovcnt);
+    } while (retval < 0 && errno == EINTR);
+    if (connect_status == EAGAIN) {
+        connect_status = retval < 0 ? errno : 0;
+    }
+    return retval >= 0 ? retval : -errno;
+}
+
 void Tcp_socket::read_wait() 
 {
     co_fd_read_wait(fd, NULL);
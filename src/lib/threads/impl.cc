@@ -19,6 +19,7 @@
 #include "threads/impl.hh"
 #include <assert.h>
 #include <boost/foreach.hpp>
+#include <boost/static_assert.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <errno.h>
 #include <fcntl.h>
@@ -34,6 +35,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
+#if defined(HAVE_PPOLL) && defined(HAVE_EPOLL_CREATE1) && defined(HAVE_EPOLL_PWAIT)
+#define HAVE_EPOLL 1
+#include <sys/epoll.h>
+#endif
 #include "threads/cooperative.hh"
 #include "timeval.hh"
 #include "fault.hh"
@@ -56,9 +61,12 @@ struct co_event {
 };
 
 struct Co_fd_waiter {
-    int pollfd_idx;
+    int pollfd_idx;             /* Index into pollfds, -1 if none (poll). */
+    bool epoll_registered;      /* Registered with epoll_fd? (epoll) */
+    uint32_t epoll_events;      /* Events armed in epoll_fd (epoll). */
     Co_waitqueue wq[CO_N_FD_WAIT_TYPES];
-    Co_fd_waiter() : pollfd_idx(-1) { }
+    Co_fd_waiter()
+        : pollfd_idx(-1), epoll_registered(false), epoll_events(0) { }
 };
 
 struct Co_timer {
@@ -79,6 +87,12 @@ struct co_group {
     boost::ptr_vector<Co_fd_waiter> fd_waiters;
     std::vector<pollfd> pollfds;
 
+#ifdef HAVE_EPOLL
+    int epoll_fd;               /* -1 until first needed. */
+    size_t n_epoll_armed;       /* Number of fds armed in epoll_fd. */
+    std::vector<epoll_event> epoll_events;
+#endif
+
     std::priority_queue<Co_timer> timers;
 
     bool fsm_thread;
@@ -126,6 +140,13 @@ struct co_group co_group_coop;
 /* Portable implementation of an interruptible poll operation. */
 static Ppoll* ppoll;
 
+/* File descriptor readiness backend. */
+#ifdef HAVE_EPOLL
+static enum co_poll_backend poll_backend = CO_POLL_EPOLL;
+#else
+static enum co_poll_backend poll_backend = CO_POLL_POLL;
+#endif
+
 static void *thread_main(void *);
 static void dont_call_pthread_exit_directly(void *UNUSED);
 static void fsm_thread();
@@ -137,8 +158,17 @@ static co_event* add_event(void);
 static void schedule();
 static void reschedule_while_needed();
 static void do_schedule();
+static int check_fds(struct co_group *);
+static int wait_fds(struct co_group *, const struct timespec *timeout);
 static void process_poll_results(int n_events);
 static void remove_pollfd(Co_fd_waiter *);
+#ifdef HAVE_EPOLL
+static int get_epoll_fd(struct co_group *);
+static bool epoll_arm(struct co_group *, int fd, Co_fd_waiter *,
+                      uint32_t events);
+static void epoll_forget(struct co_group *, int fd, Co_fd_waiter *);
+static void process_epoll_results(int n_events);
+#endif
 static void do_event_wake(struct co_event *, int retval);
 static void cancel_events(struct co_thread *);
 static void dequeue_event(struct co_event *);
@@ -178,6 +208,30 @@ co_init(void)
     /* Don't ignore SIGCHLD here, to allow graceful use of fork. */
 }
 
+/* Selects 'backend' for waiting on file descriptors.  Returns true if
+ * successful, false if 'backend' is not supported on this system.
+ *
+ * Must be called before co_init(). */
+bool
+co_set_poll_backend(enum co_poll_backend backend)
+{
+#ifndef HAVE_EPOLL
+    if (backend == CO_POLL_EPOLL) {
+        return false;
+    }
+#endif
+    assert(!ppoll);
+    poll_backend = backend;
+    return true;
+}
+
+/* Returns the backend in use for waiting on file descriptors. */
+enum co_poll_backend
+co_get_poll_backend(void)
+{
+    return poll_backend;
+}
+
 /* Creates a new thread to run 'start'.  Initially the thread is in thread
  * group 'group', which may be null to make it a native thread (but the new
  * thread can use co_migrate() to change thread groups).
@@ -433,6 +487,11 @@ co_group_create(struct co_group **groupp)
 void
 co_group_destroy(struct co_group *group)
 {
+#ifdef HAVE_EPOLL
+    if (group->epoll_fd >= 0) {
+        close(group->epoll_fd);
+    }
+#endif
     delete group;
 }
 
@@ -520,8 +579,8 @@ co_poll(void)
 
     if (group) {
         wakeup_timers(&timeout, &timeoutp);
-        if (!group->pollfds.empty()) {
-            n_events = poll(&group->pollfds[0], group->pollfds.size(), 0);
+        n_events = check_fds(group);
+        if (n_events > 0) {
             process_poll_results(n_events);
         }
     }
@@ -702,6 +761,26 @@ co_fd_wait(int fd, enum co_fd_wait_type type, int *revents)
     }
 
     Co_fd_waiter* fdw = &group->fd_waiters[fd];
+    short int events;
+    if (type == CO_FD_WAIT_READ) {
+        events = POLLIN;
+    } else if (type == CO_FD_WAIT_WRITE) {
+        events = POLLOUT;
+    } else {
+        NOT_REACHED();
+    }
+
+#ifdef HAVE_EPOLL
+    if (poll_backend == CO_POLL_EPOLL) {
+        fdw->wq[type].wait(revents);
+        if (!(fdw->epoll_events & events)
+            && !epoll_arm(group, fd, fdw, fdw->epoll_events | events)) {
+            fdw->wq[type].wake_all(POLLHUP | POLLNVAL | events);
+        }
+        return;
+    }
+#endif
+
     struct pollfd *pfd;
     if (fdw->pollfd_idx >= 0) {
         pfd = &group->pollfds[fdw->pollfd_idx];
@@ -711,14 +790,7 @@ co_fd_wait(int fd, enum co_fd_wait_type type, int *revents)
         pfd = &group->pollfds.back();
         pfd->fd = fd;
     }
-
-    if (type == CO_FD_WAIT_READ) {
-        pfd->events |= POLLIN;
-    } else if (type == CO_FD_WAIT_WRITE) {
-        pfd->events |= POLLOUT;
-    } else {
-        NOT_REACHED();
-    }
+    pfd->events |= events;
     fdw->wq[type].wait(revents);
 }
 
@@ -774,6 +846,16 @@ co_fd_closed(int fd)
     }
 
     Co_fd_waiter* fdw = &group->fd_waiters[fd];
+#ifdef HAVE_EPOLL
+    if (poll_backend == CO_POLL_EPOLL) {
+        if (fdw->epoll_registered) {
+            fdw->wq[CO_FD_WAIT_READ].wake_all(POLLHUP | POLLNVAL | POLLIN);
+            fdw->wq[CO_FD_WAIT_WRITE].wake_all(POLLHUP | POLLNVAL | POLLOUT);
+            epoll_forget(group, fd, fdw);
+        }
+        return;
+    }
+#endif
     if (fdw->pollfd_idx < 0) {
         return;
     }
@@ -1403,6 +1485,11 @@ co_group::co_group()
     polling = NULL;
     n_threads = 0;
 
+#ifdef HAVE_EPOLL
+    epoll_fd = -1;
+    n_epoll_armed = 0;
+#endif
+
     fsm_thread = false;
 }
 
@@ -1584,15 +1671,13 @@ do_schedule()
             int n_events;
 
             if (wakeup_timers(&timeout, &timeoutp)) {
-                size_t n_pollfds = group->pollfds.size();
-                pollfd* pollfds = n_pollfds ? &group->pollfds[0] : NULL;
-                n_events = poll(pollfds, n_pollfds, 0);
+                n_events = check_fds(group);
             } else {
                 group->polling = thread;
                 pthread_mutex_unlock(&group->mutex);
 
                 /* We use a signal to wake up, thus no loop on EINTR here. */
-                n_events = ppoll->poll(group->pollfds, timeoutp);
+                n_events = wait_fds(group, timeoutp);
                 if (n_events == 0) {
                     wakeup_timers(&timeout, &timeoutp);
                 }
@@ -1673,12 +1758,53 @@ run_fsm(struct co_thread *fsm)
     }
 }
 
+/* Checks the file descriptors that threads in 'group' are waiting on, without
+ * blocking.  Returns the number of ready file descriptors, to be passed to
+ * process_poll_results(). */
+static int
+check_fds(struct co_group *group)
+{
+#ifdef HAVE_EPOLL
+    if (poll_backend == CO_POLL_EPOLL) {
+        return (group->n_epoll_armed
+                ? epoll_wait(group->epoll_fd, &group->epoll_events[0],
+                             group->epoll_events.size(), 0)
+                : 0);
+    }
+#endif
+    size_t n_pollfds = group->pollfds.size();
+    return n_pollfds ? poll(&group->pollfds[0], n_pollfds, 0) : 0;
+}
+
+/* Like check_fds(), but blocks until a file descriptor becomes ready, until
+ * 'timeout' expires (if it is nonnull), or until the polling thread is
+ * interrupted with Ppoll::interrupt(). */
+static int
+wait_fds(struct co_group *group, const struct timespec *timeout)
+{
+#ifdef HAVE_EPOLL
+    if (poll_backend == CO_POLL_EPOLL) {
+        int epfd = get_epoll_fd(group);
+        return ppoll->epoll_wait(epfd, &group->epoll_events[0],
+                                 group->epoll_events.size(), timeout);
+    }
+#endif
+    return ppoll->poll(group->pollfds, timeout);
+}
+
 static void
 process_poll_results(int n_events)
 {
     struct co_group *group = co_group_self();
     size_t i;
 
+#ifdef HAVE_EPOLL
+    if (poll_backend == CO_POLL_EPOLL) {
+        process_epoll_results(n_events);
+        return;
+    }
+#endif
+
     for (i = 0; n_events > 0 && i < group->pollfds.size(); ) {
         struct pollfd *pfd = &group->pollfds[i];
 
@@ -1731,6 +1857,138 @@ remove_pollfd(Co_fd_waiter *fdw)
     fdw->pollfd_idx = -1;
 }
 
+#ifdef HAVE_EPOLL
+/* poll() and epoll share the same bit assignments on Linux, so revents values
+ * reported to waiters are the same regardless of backend. */
+BOOST_STATIC_ASSERT(EPOLLIN == POLLIN && EPOLLOUT == POLLOUT
+                    && EPOLLERR == POLLERR && EPOLLHUP == POLLHUP);
+
+/* Returns 'group''s epoll file descriptor, creating it if necessary. */
+static int
+get_epoll_fd(struct co_group *group)
+{
+    if (group->epoll_fd < 0) {
+        group->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (group->epoll_fd < 0) {
+            ::fprintf(stderr, "epoll_create1");
+            ::fprintf(stderr, " (%s)", strerror(errno));
+            ::exit(EXIT_FAILURE);
+        }
+        group->epoll_events.resize(64);
+    }
+    return group->epoll_fd;
+}
+
+/* Arms 'fd', whose waiter is 'fdw', in 'group''s epoll instance to report
+ * the next occurrence of any of 'events'.  Returns true if successful, false
+ * on error (e.g. 'fd' is not open).
+ *
+ * File descriptors stay registered across waits, so that a thread that waits
+ * on the same fd over and over again (the common case) costs one epoll_ctl()
+ * per wait, regardless of how many other fds are idle.  Registrations are
+ * one-shot: the kernel disarms an fd as soon as it reports it ready, so that
+ * an fd that stays ready after its waiters have moved on is not reported over
+ * and over. */
+static bool
+epoll_arm(struct co_group *group, int fd, Co_fd_waiter *fdw, uint32_t events)
+{
+    int epfd = get_epoll_fd(group);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = events | EPOLLONESHOT;
+    ev.data.fd = fd;
+
+    int retval = epoll_ctl(epfd, fdw->epoll_registered ? EPOLL_CTL_MOD
+                           : EPOLL_CTL_ADD, fd, &ev);
+    if (retval < 0) {
+        /* If 'fd' was closed without calling co_fd_closed(), the kernel has
+         * already dropped our registration, and if its number has since been
+         * reused we might not know about the new registration either. */
+        if (errno == ENOENT) {
+            retval = epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        } else if (errno == EEXIST) {
+            retval = epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+    if (retval < 0) {
+        lg.dbg("epoll_ctl on fd %d failed (%s)", fd, strerror(errno));
+        if (fdw->epoll_events) {
+            group->n_epoll_armed--;
+        }
+        fdw->epoll_registered = false;
+        fdw->epoll_events = 0;
+        return false;
+    }
+
+    if (!fdw->epoll_events) {
+        group->n_epoll_armed++;
+    }
+    fdw->epoll_registered = true;
+    fdw->epoll_events = events;
+    return true;
+}
+
+/* Removes 'fd', whose waiter is 'fdw', from 'group''s epoll instance. */
+static void
+epoll_forget(struct co_group *group, int fd, Co_fd_waiter *fdw)
+{
+    /* Fails harmlessly if 'fd' has already been closed. */
+    struct epoll_event ev;
+    epoll_ctl(get_epoll_fd(group), EPOLL_CTL_DEL, fd, &ev);
+
+    if (fdw->epoll_events) {
+        group->n_epoll_armed--;
+    }
+    fdw->epoll_registered = false;
+    fdw->epoll_events = 0;
+}
+
+static void
+process_epoll_results(int n_events)
+{
+    struct co_group *group = co_group_self();
+    const uint32_t err_mask = EPOLLERR | EPOLLHUP;
+    const uint32_t in_mask = EPOLLIN | err_mask;
+    const uint32_t out_mask = EPOLLOUT | err_mask;
+
+    for (int i = 0; i < n_events; i++) {
+        const struct epoll_event *ev = &group->epoll_events[i];
+        int fd = ev->data.fd;
+        Co_fd_waiter* fdw = &group->fd_waiters[fd];
+        if (!fdw->epoll_events) {
+            continue;
+        }
+
+        /* The kernel disarmed 'fd' when it reported it. */
+        fdw->epoll_events = 0;
+        group->n_epoll_armed--;
+
+        Co_waitqueue& rwq = fdw->wq[CO_FD_WAIT_READ];
+        Co_waitqueue& wwq = fdw->wq[CO_FD_WAIT_WRITE];
+        if (ev->events & in_mask) {
+            rwq.wake_all(ev->events & in_mask);
+        }
+        if (ev->events & out_mask) {
+            wwq.wake_all(ev->events & out_mask);
+        }
+
+        /* Re-arm for whatever is still being waited for. */
+        uint32_t events = ((rwq.empty() ? 0 : EPOLLIN)
+                           | (wwq.empty() ? 0 : EPOLLOUT));
+        if (events && !epoll_arm(group, fd, fdw, events)) {
+            rwq.wake_all(POLLHUP | POLLNVAL | POLLIN);
+            wwq.wake_all(POLLHUP | POLLNVAL | POLLOUT);
+        }
+    }
+
+    /* If every slot was used, there might have been more ready fds than we
+     * could retrieve at once; allow for more next time. */
+    if (n_events == (int) group->epoll_events.size()) {
+        group->epoll_events.resize(2 * n_events);
+    }
+}
+#endif /* HAVE_EPOLL */
+
 /* Wakes up all the timers that have expired and returns the number of expired
  * timers.  Stores in '*timeoutp' a timeout value to pass to ppoll(); if this
  * is non-null, then '*timeout' is used for storage. */
@@ -26,6 +26,7 @@
 #include <vector>
 #include "hash_map.hh"
 #include "string.hh"
+#include "threads/native.hh"
 
 namespace vigil {
 
@@ -115,6 +116,10 @@ typedef hash_map<Vlog::Level*, Vlog::Module> Cache_map;
 
 struct Vlog_impl
 {
+    /* Shard threads log in parallel with the main thread group, so output
+     * and changes to the modules and their levels are serialized. */
+    Native_mutex mutex;
+
     int msg_num;
 
     /* Module names. */
@@ -182,6 +187,7 @@ Vlog::Module
 Vlog::get_module_val(const char* name, bool create)
 {
     std::string short_name = std::string(name).substr(0,MAX_MODULE_NAME_LEN); 
+    Scoped_native_mutex lock(&pimpl->mutex);
     Name_to_module::iterator i = pimpl->name_to_module.find(short_name);
     if (i == pimpl->name_to_module.end()) {
         if (!create) {
@@ -223,6 +229,7 @@ void
 Vlog::set_levels(Facility facility, Module module, Level level)
 {
     assert(facility < N_FACILITIES || facility == ANY_FACILITY);
+    Scoped_native_mutex lock(&pimpl->mutex);
     if (facility == ANY_FACILITY) {
         for (Facility facility = 0; facility < N_FACILITIES; ++facility) {
             set_facility_level(pimpl, facility, module, level);
@@ -392,10 +399,11 @@ Vlog::get_levels()
 void
 Vlog::output(Module module, Level level, const char* log_msg)
 {
-    pimpl->msg_num++;
-
     int save_errno = errno;
 
+    Scoped_native_mutex lock(&pimpl->mutex);
+    pimpl->msg_num++;
+
     const char* module_name = get_module_name(module);
     const char* level_name = get_level_name(level);
     if (pimpl->levels[FACILITY_CONSOLE][module] >= level) {
@@ -24,6 +24,7 @@
 #define PUBLIC_CONTAINER_HH 1
 
 #include <list>
+#include <memory>
 #include <vector>
 #include <string>
 #include <typeinfo>
@@ -138,6 +139,17 @@ public:
     /* Register an event handler */
     void register_handler(const Event_name&, const Event_handler&) const;
 
+    /* Register an event handler that is safe to run in a datapath's shard,
+     * see nox::register_shard_handler(). */
+    template <typename T>
+    inline 
+    void register_shard_handler(const Event_handler& h) const {
+        register_shard_handler(T::static_get_name(), h);
+    }
+
+    /* Register an event handler that is safe to run in a datapath's shard. */
+    void register_shard_handler(const Event_name&, const Event_handler&) const;
+
     /* Post an event */
     void post(Event*) const;
 
@@ -161,7 +173,9 @@ public:
     typedef uint32_t Rule_id;
 
     /**
-     * Register a packet match handler.
+     * Register a packet match handler, called with the Packet_in_event of
+     * each packet-in whose OXM fields match the expression.  Of the
+     * matching handlers, only those with the lowest priority value run.
      *
      * Returns a rule id.
      */ 
@@ -181,6 +195,11 @@ public:
 			      boost::shared_array<uint8_t>& of_raw, 
                               bool block) const;
 
+    /* On success takes ownership of the command in 'b', leaving it null, so
+     * that it is queued for transmission without being copied. */
+    int send_openflow_command(const datapathid&, std::auto_ptr<Buffer>& b,
+                              bool block) const;
+
     int
     send_openflow_msg(const datapathid&, struct ::ofl_msg_header *msg, uint32_t xid, bool block) const;
 
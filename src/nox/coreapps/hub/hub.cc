@@ -54,11 +54,10 @@ public:
         const Ofp_msg_event& pi = assert_cast<const Ofp_msg_event&>(e);
         struct ofl_msg_packet_in *in = (struct ofl_msg_packet_in *)**pi.msg;
 
-       Flow *flow = new Flow((struct ofl_match*) in->match);
+        Flow flow((struct ofl_match*) in->match);
 
         /* drop all LLDP packets */
-        uint16_t dl_type;
-        flow->get_Field("eth_type",&dl_type);
+        uint16_t dl_type = flow.get<OXM_OF_ETH_TYPE>();
         if (dl_type == ethernet::LLDP){
             return CONTINUE;
         }
@@ -76,8 +75,9 @@ public:
 
         if (in->buffer_id == UINT32_MAX) {
             if (in->total_len == in->data_length) {
-                uint32_t in_port;
-                flow->get_Field("in_port", &in_port);
+                uint32_t in_port = (flow.has<OXM_OF_IN_PORT>()
+                                    ? flow.get<OXM_OF_IN_PORT>()
+                                    : (uint32_t) OFPP_CONTROLLER);
                 send_openflow_pkt(pi.dpid, Array_buffer(in->data, in->data_length), in_port, OFPP_FLOOD, true/*block*/);
             } else {
                 /* Control path didn't buffer the packet and didn't send us
@@ -91,7 +91,9 @@ public:
 
     void install()
     {
-        register_handler(Ofp_msg_event::get_name(OFPT_PACKET_IN), boost::bind(&Hub::handler, this, _1));
+        /* The hub keeps no state, so it can handle packet-ins in the
+         * datapath's shard. */
+        register_shard_handler(Ofp_msg_event::get_name(OFPT_PACKET_IN), boost::bind(&Hub::handler, this, _1));
     }
 };
 
@@ -16,18 +16,22 @@
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <cstring>
+#include <memory>
 #include <netinet/in.h>
 #include <stdexcept>
 #include <stdint.h>
 
 #include "openflow-default.hh"
 #include "assert.hh"
+#include "buffer.hh"
 #include "component.hh"
 #include "flow.hh"
 #include "fnv_hash.hh"
 #include "hash_set.hh"
 #include "ofp-msg-event.hh"
+#include "ofp-template.hh"
 #include "vlog.hh"
 #include "flowmod.hh"
 #include "datapath-join.hh"
@@ -104,6 +108,13 @@ private:
     /* Set up a flow when we know the destination of a packet?  This should
      * ordinarily be true; it is only usefully false for debugging purposes. */
     bool setup_flows;
+
+    /* Messages sent for each packet-in, packed once in configure(). */
+    boost::scoped_ptr<Ofp_template> flow_tmpl;       /* Learned flow. */
+    boost::scoped_ptr<Ofp_template> buffered_out_tmpl; /* Buffered packet. */
+    boost::scoped_ptr<Ofp_template> data_out_tmpl;   /* Unbuffered packet. */
+
+    void make_templates();
 };
 
 void 
@@ -117,11 +128,47 @@ Switch::configure(const Configuration* conf) {
         }
     }
 
+    make_templates();
+
     register_handler(Datapath_join_event::static_get_name(), boost::bind(&Switch::handle_dp_join, this, _1));
     register_handler(Ofp_msg_event::get_name(OFPT_PACKET_IN), boost::bind(&Switch::handle, this, _1));
     
 }
 
+/* Builds the messages that handle() sends, with placeholder values for the
+ * fields that it patches for each packet-in. */
+void
+Switch::make_templates() {
+    Flow f;
+    f.set<OXM_OF_IN_PORT>(0);
+    f.set<OXM_OF_ETH_SRC>(ethernetaddr());
+    f.set<OXM_OF_ETH_DST>(ethernetaddr());
+    Actions acts;
+    acts.CreateOutput(0);
+    Instruction inst;
+    inst.CreateApply(&acts);
+    FlowMod mod(0x00ULL,0x00ULL, 0,OFPFC_ADD, 1, OFP_FLOW_PERMANENT, OFP_DEFAULT_PRIORITY, OFP_NO_BUFFER,
+                OFPP_ANY, OFPG_ANY, ofd_flow_mod_flags());
+    mod.AddMatch(&f.match);
+    mod.AddInstructions(&inst);
+    flow_tmpl.reset(new Ofp_template((struct ofl_msg_header *)&mod.fm_msg));
+
+    struct ofl_action_output output =
+            {{/*.type = */OFPAT_OUTPUT}, /*.port = */OFPP_FLOOD, /*.max_len = */0};
+    struct ofl_action_header *actions[] =
+            { (struct ofl_action_header *)&output };
+    struct ofl_msg_packet_out out =
+            {{/*.type       = */OFPT_PACKET_OUT},
+             /*.buffer_id   = */OFP_NO_BUFFER,
+             /*.in_port     = */OFPP_CONTROLLER,
+             /*.actions_num = */1,
+             /*.actions     = */actions,
+             /*.data_length = */0,
+             /*.data        = */NULL};
+    buffered_out_tmpl.reset(new Ofp_template((struct ofl_msg_header *)&out));
+    data_out_tmpl.reset(new Ofp_template((struct ofl_msg_header *)&out));
+}
+
 void
 Switch::install() {
 
@@ -156,23 +203,25 @@ Switch::handle(const Event& e)
     const Ofp_msg_event& pi = assert_cast<const Ofp_msg_event&>(e);
 
     struct ofl_msg_packet_in *in = (struct ofl_msg_packet_in *)**pi.msg;
-    Flow *flow = new Flow((struct ofl_match*) in->match);
+    Flow flow((struct ofl_match*) in->match);
 
     /* drop all LLDP packets */
-        uint16_t dl_type;
-        flow->get_Field<uint16_t>("eth_type",&dl_type);
-        if (dl_type == ethernet::LLDP){
-            return CONTINUE;
-        }
-       
-    uint32_t in_port;
-    flow->get_Field<uint32_t>("in_port", &in_port);        
+    if (flow.get<OXM_OF_ETH_TYPE>() == ethernet::LLDP){
+        return CONTINUE;
+    }
+
+    /* Without the ingress port there is nothing to learn, and no flow to set
+     * up that would not also match packets from other ports. */
+    if (!flow.has<OXM_OF_IN_PORT>()) {
+        VLOG_DBG(log, "packet-in from datapath %s without in_port",
+                 pi.dpid.string().c_str());
+        return CONTINUE;
+    }
+    uint32_t in_port = flow.get<OXM_OF_IN_PORT>();
 	
    
     /* Learn the source. */
-    uint8_t eth_src[6];
-    flow->get_Field("eth_src", eth_src);
-    ethernetaddr dl_src(eth_src);
+    ethernetaddr dl_src = flow.get<OXM_OF_ETH_SRC>();
     if (!dl_src.is_multicast()) {
         Mac_source src(pi.dpid, dl_src);
         Source_table::iterator i = sources.insert(src).first;
@@ -189,9 +238,7 @@ Switch::handle(const Event& e)
 
     /* Figure out the destination. */
     int out_port = -1;        /* Flood by default. */
-    uint8_t eth_dst[6];
-    flow->get_Field("eth_dst", eth_dst);
-    ethernetaddr dl_dst(eth_dst);
+    ethernetaddr dl_dst = flow.get<OXM_OF_ETH_DST>();
     if (!dl_dst.is_multicast()) {
         Mac_source dst(pi.dpid, dl_dst);
 	Source_table::iterator i(sources.find(dst));
@@ -202,24 +249,18 @@ Switch::handle(const Event& e)
 		
     /* Set up a flow if the output port is known. */
     if (setup_flows && out_port != -1) {
-
-        
-	Flow  f;
-	f.Add_Field("in_port", in_port);
-	f.Add_Field("eth_src", eth_src);
-	f.Add_Field("eth_dst",eth_dst);
-	Actions *acts = new Actions();
-    acts->CreateOutput(out_port);
-    Instruction *inst =  new Instruction();
-    inst->CreateApply(acts);
-    FlowMod *mod = new FlowMod(0x00ULL,0x00ULL, 0,OFPFC_ADD, 1, OFP_FLOW_PERMANENT, OFP_DEFAULT_PRIORITY,in->buffer_id, 
-                                    OFPP_ANY, OFPG_ANY, ofd_flow_mod_flags());
-    mod->AddMatch(&f.match);
-	mod->AddInstructions(inst);
-    send_openflow_msg(pi.dpid, (struct ofl_msg_header *)&mod->fm_msg, 0/*xid*/, true/*block*/);
+        std::auto_ptr<Buffer> b(new Array_buffer(flow_tmpl->size()));
+        Ofp_template_msg mod(*flow_tmpl, b->data(), b->size());
+        mod.set_field32(OXM_OF_IN_PORT, in_port);
+        mod.set_field(OXM_OF_ETH_SRC, dl_src.octet);
+        mod.set_field(OXM_OF_ETH_DST, dl_dst.octet);
+        mod.set(Ofp_template::BUFFER_ID, in->buffer_id);
+        mod.set(Ofp_template::OUTPUT_PORT, out_port);
+        send_openflow_command(pi.dpid, b, true/*block*/);
     }
     /* Send out packet if necessary. */
     if (!setup_flows || out_port == -1 || in->buffer_id == UINT32_MAX) {
+        uint32_t port = out_port == -1 ? OFPP_FLOOD : out_port;
         if (in->buffer_id == UINT32_MAX) {
             if (in->total_len != in->data_length) {
                 /* Control path didn't buffer the packet and didn't send us
@@ -228,9 +269,19 @@ Switch::handle(const Event& e)
                         in->total_len, in->data_length);
                 return CONTINUE;
             }
-            send_openflow_pkt(pi.dpid, Nonowning_buffer(in->data, in->data_length), in_port, out_port == -1 ? OFPP_FLOOD : out_port, true/*block*/);
+            std::auto_ptr<Buffer> b(new Array_buffer(data_out_tmpl->size() + in->data_length));
+            Ofp_template_msg out(*data_out_tmpl, b->data(), b->size());
+            out.set_data(in->data, in->data_length);
+            out.set(Ofp_template::IN_PORT, in_port);
+            out.set(Ofp_template::OUTPUT_PORT, port);
+            send_openflow_command(pi.dpid, b, true/*block*/);
         } else {
-            send_openflow_pkt(pi.dpid, in->buffer_id, in_port, out_port == -1 ? OFPP_FLOOD : out_port, true/*block*/);
+            std::auto_ptr<Buffer> b(new Array_buffer(buffered_out_tmpl->size()));
+            Ofp_template_msg out(*buffered_out_tmpl, b->data(), b->size());
+            out.set(Ofp_template::BUFFER_ID, in->buffer_id);
+            out.set(Ofp_template::IN_PORT, in_port);
+            out.set(Ofp_template::OUTPUT_PORT, port);
+            send_openflow_command(pi.dpid, b, true/*block*/);
         }
     }
     return CONTINUE;
@@ -37,12 +37,14 @@
 #ifndef nox_HH__ 
 #define nox_HH__
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <boost/function.hpp>
 #include "netinet++/datapathid.hh"
 #include "netinet++/ethernetaddr.hh"
+#include "event-dispatcher.hh"
 #include "packet-classifier.hh"
 #include "timer-dispatcher.hh"
 #include "switch_auth.hh" 
@@ -70,13 +72,32 @@ void connect(Openflow_connection_factory*, bool reliable);
 void register_conn(Openflow_connection*, Co_sema*);
 void run();
 
-void register_handler(const Event_name& name,
-                      boost::function<Disposition(const Event&)>,
-                      int order);
+Event_dispatcher::Handler_id
+register_handler(const Event_name& name,
+                 boost::function<Disposition(const Event&)>,
+                 int order);
+Event_dispatcher::Handler_id
+register_handler(Event_type type,
+                 boost::function<Disposition(const Event&)>,
+                 int order);
+bool remove_handler(Event_dispatcher::Handler_id);
 bool unregister_handler (uint32_t rule_id);
 
+/* Sharded mode, see register_shard_handler(). */
+void set_shards(unsigned int n);
+unsigned int get_shards();
+void register_shard_handler(const Event_name& name,
+                            boost::function<Disposition(const Event&)>,
+                            int order);
+
 uint32_t register_handler_on_match(uint32_t priority, const Packet_expr &expr, 
                                    Pexpr_action callback);
+
+/* Exact-match cache in front of register_handler_on_match() lookups, see
+ * set_flow_cache(). */
+void set_flow_cache(size_t capacity);
+size_t get_flow_cache();
+Flow_cache_stats get_flow_cache_stats();
 // TODO unregister_handler_on_match
 
 // global hook to register a class to determine if a switch is
@@ -97,9 +118,31 @@ Timer post_timer(const Callback& callback);
 Timer post_timer(const Callback& callback, const timeval& duration);
 void timer_debug();
 
+/* Per-connection dispatch budget, see set_dispatch_budget(). */
+struct Dispatch_stats {
+    uint64_t n_polls;           /* Connection polls. */
+    uint64_t n_msgs;            /* Messages dispatched. */
+    uint64_t n_exhausted;       /* Polls cut short by the budget. */
+};
+
+void set_dispatch_budget(unsigned int max_msgs, unsigned int max_usecs);
+unsigned int get_dispatch_budget_msgs();
+unsigned int get_dispatch_budget_usecs();
+Dispatch_stats get_dispatch_stats();
+
+/* Priority lanes of the main event queue, see set_lane_budget().
+ * set_default_lanes() assigns the core's event types to the lanes of
+ * 'dispatcher' as init() does for the main event queue. */
+void set_default_lanes(Event_dispatcher& dispatcher);
+void set_lane_budget(Event_dispatcher::Lane, unsigned int budget);
+unsigned int get_lane_budget(Event_dispatcher::Lane);
+Event_dispatcher::Lane_stats get_lane_stats(Event_dispatcher::Lane);
+
 uint32_t allocate_openflow_xid();
 int send_openflow_command(const datapathid&, const ofp_header* oh,
                           bool block);
+int send_openflow_command(const datapathid&, std::auto_ptr<Buffer>&,
+                          bool block);
 
 int
 send_openflow_msg(const datapathid& dpid, struct ::ofl_msg_header *msg, uint32_t xid, bool block);
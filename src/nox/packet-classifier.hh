@@ -18,9 +18,11 @@
 #ifndef PACKET_CLASSIFIER_HH
 #define PACKET_CLASSIFIER_HH 1
 
+#include <boost/scoped_ptr.hpp>
 #include "classifier.hh"
 #include "event.hh"
 #include "expr.hh"
+#include "flow-cache.hh"
 
 namespace vigil {
 
@@ -39,8 +41,19 @@ public:
     void register_packet_in();
     Disposition handle_packet_in(const Event& e);
 
+    /* Puts an exact-match cache of 'capacity' flows in front of lookups, or
+     * removes it if 'capacity' is 0.  Off by default. */
+    void set_flow_cache(size_t capacity);
+    size_t get_flow_cache_capacity() const
+        { return cache ? cache->capacity() : 0; }
+    /* Statistics of the current cache, all 0 without one. */
+    Flow_cache_stats get_flow_cache_stats() const;
+
 private:
+    typedef Flow_cache<Packet_expr, Pexpr_action> Cache;
+
     Cnode_result<Packet_expr, Pexpr_action, Flow> result;
+    boost::scoped_ptr<Cache> cache;
 
     Packet_classifier(const Packet_classifier&);
     Packet_classifier& operator=(const Packet_classifier&);
@@ -165,8 +165,39 @@ void usage(const char* program_name)
            "  -i pcapt:FILE[:OUTFILE] same as \"pcap\", but delay packets based on pcap timestamps\n"
            "  -i pgen:                continuously generate packet-in events\n"
            "\nNetwork control options (must also specify an interface):\n"
-           "  -u, --unreliable        do not reconnect to interfaces on error\n",
-	   program_name, program_name, OFP_TCP_PORT, OFP_SSL_PORT);
+           "  -u, --unreliable        do not reconnect to interfaces on error\n"
+           "  --rx-buffer=BYTES       per-connection receive ring size, 0 to read\n"
+           "                          one message at a time (default: %zu)\n"
+           "  --tx-watermarks=LOW,HIGH\n"
+           "                          stop accepting messages for a connection\n"
+           "                          once HIGH bytes are queued, until the queue\n"
+           "                          drains to LOW bytes (default: %zu,%zu)\n"
+           "  --dispatch-budget=MSGS[,USECS]\n"
+           "                          dispatch at most MSGS messages or USECS\n"
+           "                          microseconds per connection before\n"
+           "                          servicing other connections, USECS 0 for\n"
+           "                          no time limit (default: %u,%u)\n"
+           "  --lane-budgets=HIGH,NORMAL,LOW\n"
+           "                          dispatch at most this many queued events\n"
+           "                          from each priority lane per pass of the\n"
+           "                          poll loop, 0 for no limit (default:\n"
+           "                          %u,%u,%u)\n"
+           "  --shards=K              hash datapaths over K threads for message\n"
+           "                          decoding and shard-safe handlers, 0 to\n"
+           "                          handle everything in the main thread\n"
+           "                          (default: %u)\n"
+           "  --flow-cache=N          remember how the last N flows seen in\n"
+           "                          packet-ins were classified, 0 to classify\n"
+           "                          every packet-in (default: %zu)\n",
+	   program_name, program_name, OFP_TCP_PORT, OFP_SSL_PORT,
+           Openflow_stream_connection::get_rx_ring_size(),
+           Openflow_stream_connection::get_tx_low_watermark(),
+           Openflow_stream_connection::get_tx_high_watermark(),
+           nox::get_dispatch_budget_msgs(), nox::get_dispatch_budget_usecs(),
+           nox::get_lane_budget(Event_dispatcher::HIGH_LANE),
+           nox::get_lane_budget(Event_dispatcher::NORMAL_LANE),
+           nox::get_lane_budget(Event_dispatcher::LOW_LANE),
+           nox::get_shards(), nox::get_flow_cache());
     leak_checker_usage();
     printf("\nOther options:\n"
            "  -c, --conf=FILE         set configuration file\n"
@@ -174,12 +205,16 @@ void usage(const char* program_name)
            "  -l, --libdir=DIRECTORY  add a directory to the search path for application libraries\n"
            "  -p, --pid=FILE          set pid file\n"
            "  -n, --info=FILE         set controller info file\n"
+           "  --poll-backend=poll|epoll\n"
+           "                          wait for file descriptors with poll() or\n"
+           "                          epoll (default: %s)\n"
 	   "  -v, --verbose           set maximum verbosity level (for console)\n"
 #ifndef LOG4CXX_ENABLED
 	   "  -v, --verbose=CONFIG    configure verbosity\n"
 #endif
 	   "  -h, --help              display this help message\n"
-	   "  -V, --version           display version information\n");
+	   "  -V, --version           display version information\n",
+           co_get_poll_backend() == CO_POLL_EPOLL ? "epoll" : "poll");
     exit(EXIT_SUCCESS);
 }
 
@@ -309,7 +344,14 @@ int main(int argc, char *argv[])
     for (;;) {
         enum {
             OPT_CHECK_LEAKS = UCHAR_MAX + 1,
-            OPT_LEAK_LIMIT
+            OPT_LEAK_LIMIT,
+            OPT_RX_BUFFER,
+            OPT_TX_WATERMARKS,
+            OPT_DISPATCH_BUDGET,
+            OPT_LANE_BUDGETS,
+            OPT_SHARDS,
+            OPT_FLOW_CACHE,
+            OPT_POLL_BACKEND
         };
         static struct option long_options[] = {
             {"daemon",      no_argument, 0, 'd'},
@@ -317,11 +359,18 @@ int main(int argc, char *argv[])
             {"unreliable",  no_argument, 0, 'u'},
 
             {"interface",   required_argument, 0, 'i'},
+            {"rx-buffer",   required_argument, 0, OPT_RX_BUFFER},
+            {"tx-watermarks", required_argument, 0, OPT_TX_WATERMARKS},
+            {"dispatch-budget", required_argument, 0, OPT_DISPATCH_BUDGET},
+            {"lane-budgets", required_argument, 0, OPT_LANE_BUDGETS},
+            {"shards",      required_argument, 0, OPT_SHARDS},
+            {"flow-cache",  required_argument, 0, OPT_FLOW_CACHE},
 
             {"conf",        required_argument, 0, 'c'},
             {"libdir",      required_argument, 0, 'l'},
             {"pid",         required_argument, 0, 'p'},
             {"info",        required_argument, 0, 'n'},
+            {"poll-backend", required_argument, 0, OPT_POLL_BACKEND},
 
             {"check-leaks", required_argument, 0, OPT_CHECK_LEAKS},
             {"leak-limit",  required_argument, 0, OPT_LEAK_LIMIT},
@@ -395,6 +444,21 @@ int main(int argc, char *argv[])
             info_file = optarg;
             break;
 
+        case OPT_POLL_BACKEND: {
+            bool ok = false;
+            if (!strcmp(optarg, "poll")) {
+                ok = co_set_poll_backend(CO_POLL_POLL);
+            } else if (!strcmp(optarg, "epoll")) {
+                ok = co_set_poll_backend(CO_POLL_EPOLL);
+            }
+            if (!ok) {
+                fprintf(stderr, "--poll-backend: \"%s\" is not supported\n",
+                        optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        }
+
         case OPT_CHECK_LEAKS:
             leak_checker_start(optarg);
             break;
@@ -403,6 +467,53 @@ int main(int argc, char *argv[])
             leak_checker_set_limit(strtoll(optarg,NULL,10));
             break;
 
+        case OPT_RX_BUFFER:
+            Openflow_stream_connection::set_rx_ring_size(
+                strtoul(optarg, NULL, 10));
+            break;
+
+        case OPT_TX_WATERMARKS: {
+            size_t low, high;
+            if (sscanf(optarg, "%zu,%zu", &low, &high) != 2 || low >= high) {
+                fprintf(stderr, "--tx-watermarks: expected LOW,HIGH with "
+                        "LOW < HIGH\n");
+                exit(EXIT_FAILURE);
+            }
+            Openflow_stream_connection::set_tx_watermarks(low, high);
+            break;
+        }
+
+        case OPT_DISPATCH_BUDGET: {
+            unsigned int msgs, usecs = nox::get_dispatch_budget_usecs();
+            if (sscanf(optarg, "%u,%u", &msgs, &usecs) < 1 || !msgs) {
+                fprintf(stderr, "--dispatch-budget: expected MSGS[,USECS] "
+                        "with nonzero MSGS\n");
+                exit(EXIT_FAILURE);
+            }
+            nox::set_dispatch_budget(msgs, usecs);
+            break;
+        }
+
+        case OPT_LANE_BUDGETS: {
+            unsigned int high, normal, low;
+            if (sscanf(optarg, "%u,%u,%u", &high, &normal, &low) != 3) {
+                fprintf(stderr, "--lane-budgets: expected HIGH,NORMAL,LOW\n");
+                exit(EXIT_FAILURE);
+            }
+            nox::set_lane_budget(Event_dispatcher::HIGH_LANE, high);
+            nox::set_lane_budget(Event_dispatcher::NORMAL_LANE, normal);
+            nox::set_lane_budget(Event_dispatcher::LOW_LANE, low);
+            break;
+        }
+
+        case OPT_SHARDS:
+            nox::set_shards(strtoul(optarg, NULL, 10));
+            break;
+
+        case OPT_FLOW_CACHE:
+            nox::set_flow_cache(strtoul(optarg, NULL, 10));
+            break;
+
         case 'V':
             hello(program_name);
             exit(EXIT_SUCCESS);
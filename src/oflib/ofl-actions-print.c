@@ -159,3 +159,88 @@ ofl_action_print(FILE *stream, struct ofl_action_header *act, struct ofl_exp *ex
         }
     }
 }
+
+void
+ofl_action_format(struct ofl_fmt *fmt, const struct ofl_action_header *act) {
+
+    ofl_fmt_enum(fmt, ofl_action_type_name(act->type), act->type);
+
+    switch (act->type) {
+        case OFPAT_OUTPUT: {
+            struct ofl_action_output *a = (struct ofl_action_output *)act;
+
+            ofl_fmt_str(fmt, "{port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(a->port), a->port);
+            if (a->port == OFPP_CONTROLLER) {
+                ofl_fmt_printf(fmt, "\", mlen=\"%u\"}", a->max_len);
+            } else {
+                ofl_fmt_str(fmt, "\"}");
+            }
+            break;
+        }
+        case OFPAT_SET_FIELD: {
+            struct ofl_action_set_field *a = (struct ofl_action_set_field *)act;
+
+            ofl_fmt_str(fmt, "{field:");
+            ofl_structs_oxm_tlv_format(fmt, a->field->header, a->field->value);
+            ofl_fmt_str(fmt, "}");
+            break;
+        }
+        case OFPAT_COPY_TTL_OUT:
+        case OFPAT_COPY_TTL_IN:
+        case OFPAT_DEC_MPLS_TTL:
+        case OFPAT_POP_VLAN:
+        case OFPAT_POP_PBB:
+        case OFPAT_DEC_NW_TTL: {
+            break;
+        }
+        case OFPAT_SET_MPLS_TTL: {
+            struct ofl_action_mpls_ttl *a = (struct ofl_action_mpls_ttl *)act;
+
+            ofl_fmt_printf(fmt, "{ttl=\"%u\"}", a->mpls_ttl);
+            break;
+        }
+        case OFPAT_PUSH_VLAN:
+        case OFPAT_PUSH_MPLS:
+        case OFPAT_PUSH_PBB: {
+            struct ofl_action_push *a = (struct ofl_action_push *)act;
+
+            ofl_fmt_printf(fmt, "{eth=\"0x%04"PRIx16"\"}", a->ethertype);
+            break;
+        }
+        case OFPAT_POP_MPLS: {
+            struct ofl_action_pop_mpls *a = (struct ofl_action_pop_mpls *)act;
+
+            ofl_fmt_printf(fmt, "{eth=\"0x%04"PRIx16"\"}", a->ethertype);
+            break;
+        }
+        case OFPAT_SET_QUEUE: {
+            struct ofl_action_set_queue *a = (struct ofl_action_set_queue *)act;
+
+            ofl_fmt_str(fmt, "{q=\"");
+            ofl_fmt_id(fmt, ofl_queue_name(a->queue_id), a->queue_id);
+            ofl_fmt_str(fmt, "\"}");
+            break;
+        }
+        case OFPAT_GROUP: {
+            struct ofl_action_group *a = (struct ofl_action_group *)act;
+
+            ofl_fmt_str(fmt, "{id=\"");
+            ofl_fmt_id(fmt, ofl_group_name(a->group_id), a->group_id);
+            ofl_fmt_str(fmt, "\"}");
+            break;
+        }
+        case OFPAT_SET_NW_TTL: {
+            struct ofl_action_set_nw_ttl *a = (struct ofl_action_set_nw_ttl *)act;
+
+            ofl_fmt_printf(fmt, "{ttl=\"%u\"}", a->nw_ttl);
+            break;
+        }
+        case OFPAT_EXPERIMENTER: {
+            struct ofl_action_experimenter *a = (struct ofl_action_experimenter *)act;
+
+            ofl_fmt_printf(fmt, "{id=\"0x%"PRIx32"\"}", a->experimenter_id);
+            break;
+        }
+    }
+}
@@ -35,6 +35,7 @@
 #include <string.h>
 #include "ofl.h"
 #include "ofl-utils.h"
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-structs.h"
 #include "ofl-messages.h"
@@ -82,14 +83,14 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 (ntohl(sa->port) > OFPP_MAX && ntohl(sa->port) < OFPP_IN_PORT) ||
                 ntohl(sa->port) == OFPP_ANY) {
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-                    char *ps = ofl_port_to_string(ntohl(sa->port));
-                    OFL_LOG_WARN(LOG_MODULE, "Received OUTPUT action has invalid port (%s).", ps);
-                    free(ps);
+                    char ps[OFL_ID_BUF_LEN];
+                    OFL_LOG_WARN(LOG_MODULE, "Received OUTPUT action has invalid port (%s).",
+                                 ofl_id_to_buf(ofl_port_name(ntohl(sa->port)), ntohl(sa->port), ps));
                 }
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_PORT);
             }
 
-            da = (struct ofl_action_output *)malloc(sizeof(struct ofl_action_output));
+            da = (struct ofl_action_output *)ofl_malloc(sizeof(struct ofl_action_output));
             da->port = ntohl(sa->port);
             da->max_len = ntohs(sa->max_len);
 
@@ -100,14 +101,14 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_COPY_TTL_OUT: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
         case OFPAT_COPY_TTL_IN: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -122,7 +123,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_mpls_ttl *)src;
 
-            da = (struct ofl_action_mpls_ttl *)malloc(sizeof(struct ofl_action_mpls_ttl));
+            da = (struct ofl_action_mpls_ttl *)ofl_malloc(sizeof(struct ofl_action_mpls_ttl));
             da->mpls_ttl = sa->mpls_ttl;
 
             *len -= sizeof(struct ofp_action_mpls_ttl);
@@ -133,7 +134,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_MPLS_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_mpls_ttl);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -162,7 +163,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_push *)malloc(sizeof(struct ofl_action_push));
+            da = (struct ofl_action_push *)ofl_malloc(sizeof(struct ofl_action_push));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_push);
@@ -174,7 +175,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_POP_PBB: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
                 
@@ -189,7 +190,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_pop_mpls *)src;
 
-            da = (struct ofl_action_pop_mpls *)malloc(sizeof(struct ofl_action_pop_mpls));
+            da = (struct ofl_action_pop_mpls *)ofl_malloc(sizeof(struct ofl_action_pop_mpls));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_pop_mpls);
@@ -208,7 +209,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_set_queue *)src;
 
-            da = (struct ofl_action_set_queue *)malloc(sizeof(struct ofl_action_set_queue));
+            da = (struct ofl_action_set_queue *)ofl_malloc(sizeof(struct ofl_action_set_queue));
             da->queue_id = ntohl(sa->queue_id);
 
             *len -= sizeof(struct ofp_action_set_queue);
@@ -229,14 +230,14 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             if (ntohl(sa->group_id) > OFPG_MAX) {
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-                    char *gs = ofl_group_to_string(ntohl(sa->group_id));
-                    OFL_LOG_WARN(LOG_MODULE, "Received GROUP action has invalid group id (%s).", gs);
-                    free(gs);
+                    char gs[OFL_ID_BUF_LEN];
+                    OFL_LOG_WARN(LOG_MODULE, "Received GROUP action has invalid group id (%s).",
+                                 ofl_id_to_buf(ofl_group_name(ntohl(sa->group_id)), ntohl(sa->group_id), gs));
                 }
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_group *)malloc(sizeof(struct ofl_action_group));
+            da = (struct ofl_action_group *)ofl_malloc(sizeof(struct ofl_action_group));
             da->group_id = ntohl(sa->group_id);
 
             *len -= sizeof(struct ofp_action_group);
@@ -255,7 +256,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_nw_ttl *)src;
 
-            da = (struct ofl_action_set_nw_ttl *)malloc(sizeof(struct ofl_action_set_nw_ttl));
+            da = (struct ofl_action_set_nw_ttl *)ofl_malloc(sizeof(struct ofl_action_set_nw_ttl));
             da->nw_ttl = sa->nw_ttl;
 
             *len -= sizeof(struct ofp_action_nw_ttl);
@@ -266,7 +267,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_NW_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -276,13 +277,13 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
             uint8_t *value;
             
             sa = (struct ofp_action_set_field*) src;
-            da = (struct ofl_action_set_field *)malloc(sizeof(struct ofl_action_set_field));
-            da->field = (struct ofl_match_tlv*) malloc(sizeof(struct ofl_match_tlv));
+            da = (struct ofl_action_set_field *)ofl_malloc(sizeof(struct ofl_action_set_field));
+            da->field = (struct ofl_match_tlv*) ofl_malloc(sizeof(struct ofl_match_tlv));
             
             memcpy(&da->field->header,sa->field,4);
             da->field->header = ntohl(da->field->header);
             value = (uint8_t *) src + sizeof (struct ofp_action_set_field);
-            da->field->value = (uint8_t*) malloc(OXM_LENGTH(da->field->header));
+            da->field->value = (uint8_t*) ofl_malloc(OXM_LENGTH(da->field->header));
             switch(OXM_LENGTH(da->field->header)){
                 case 1:
                 case 6:
@@ -33,6 +33,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-log.h"
 
@@ -44,9 +45,9 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
     switch (act->type) {
         case OFPAT_SET_FIELD:{
             struct ofl_action_set_field *a = (struct ofl_action_set_field*) act;
-            free(a->field->value);
-            free(a->field);
-            free(a);
+            ofl_free(a->field->value);
+            ofl_free(a->field);
+            ofl_free(a);
             return;
             break;        
         }
@@ -78,7 +79,7 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
         default: {
         }
     }
-    free(act);
+    ofl_free(act);
 }
 
 ofl_err
@@ -41,6 +41,7 @@
 //#include "nbee_link/nbee_link.h"
 
 struct ofl_exp;
+struct ofl_fmt;
 
 /****************************************************************************
  * Action structure definitions
@@ -180,6 +181,11 @@ ofl_action_to_string(struct ofl_action_header *act, struct ofl_exp *exp);
 void
 ofl_action_print(FILE *stream, struct ofl_action_header *act, struct ofl_exp *exp);
 
+/* Prints the passed in action into 'fmt' (see ofl-print.h).  Experimenter
+ * actions print as their id. */
+void
+ofl_action_format(struct ofl_fmt *fmt, const struct ofl_action_header *act);
+
 
 
 #endif /* OFL_ACTIONS */
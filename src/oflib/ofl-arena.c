@@ -0,0 +1,149 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * Copyright (c) 2012, CPqD, Brazil 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "ofl-arena.h"
+
+/* Default chunk size, and the size above which ofl_arena_reset() gives the
+   chunks beyond the first one back to the heap. */
+#define OFL_ARENA_CHUNK_SIZE 4096
+#define OFL_ARENA_MAX_KEEP   (64 * 1024)
+
+/* Every block handed out is aligned to this. */
+#define OFL_ARENA_ALIGN 16
+#define OFL_ARENA_ROUND_UP(X) \
+    (((X) + OFL_ARENA_ALIGN - 1) & ~(size_t)(OFL_ARENA_ALIGN - 1))
+
+struct ofl_arena_chunk {
+    struct ofl_arena_chunk *next;
+    size_t size;                /* Usable bytes, following the header. */
+};
+
+#define OFL_ARENA_CHUNK_HDR OFL_ARENA_ROUND_UP(sizeof(struct ofl_arena_chunk))
+
+static __thread struct ofl_arena *current_arena
+    __attribute__((tls_model("initial-exec")));
+
+void
+ofl_arena_init(struct ofl_arena *arena) {
+    arena->chunks = NULL;
+    arena->cur = NULL;
+    arena->used = 0;
+    arena->size = 0;
+}
+
+static void
+free_chunks(struct ofl_arena_chunk *chunk) {
+    while (chunk != NULL) {
+        struct ofl_arena_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void
+ofl_arena_destroy(struct ofl_arena *arena) {
+    free_chunks(arena->chunks);
+    ofl_arena_init(arena);
+}
+
+/* Moves on to the first chunk after 'cur' with room for 'size' bytes, adding
+   a new chunk after 'cur' if there is none. */
+static void *
+alloc_slow(struct ofl_arena *arena, size_t size) {
+    struct ofl_arena_chunk *chunk;
+
+    chunk = arena->cur != NULL ? arena->cur->next : arena->chunks;
+    while (chunk != NULL && chunk->size < size) {
+        chunk = chunk->next;
+    }
+    if (chunk == NULL) {
+        size_t chunk_size = size > OFL_ARENA_CHUNK_SIZE
+                            ? size : OFL_ARENA_CHUNK_SIZE;
+        chunk = (struct ofl_arena_chunk *)malloc(OFL_ARENA_CHUNK_HDR
+                                                 + chunk_size);
+        chunk->size = chunk_size;
+        if (arena->cur != NULL) {
+            chunk->next = arena->cur->next;
+            arena->cur->next = chunk;
+        } else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+        arena->size += chunk_size;
+    }
+    arena->cur = chunk;
+    arena->used = size;
+    return (uint8_t *)chunk + OFL_ARENA_CHUNK_HDR;
+}
+
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size) {
+    size = OFL_ARENA_ROUND_UP(size);
+    if (arena->cur != NULL && arena->cur->size - arena->used >= size) {
+        void *p = (uint8_t *)arena->cur + OFL_ARENA_CHUNK_HDR + arena->used;
+        arena->used += size;
+        return p;
+    }
+    return alloc_slow(arena, size);
+}
+
+void
+ofl_arena_reset(struct ofl_arena *arena) {
+    if (arena->size > OFL_ARENA_MAX_KEEP && arena->chunks != NULL) {
+        free_chunks(arena->chunks->next);
+        arena->chunks->next = NULL;
+        arena->size = arena->chunks->size;
+    }
+    arena->cur = arena->chunks;
+    arena->used = 0;
+}
+
+struct ofl_arena *
+ofl_arena_set_current(struct ofl_arena *arena) {
+    struct ofl_arena *old = current_arena;
+    current_arena = arena;
+    return old;
+}
+
+void *
+ofl_malloc(size_t size) {
+    return (current_arena != NULL
+            ? ofl_arena_alloc(current_arena, size)
+            : malloc(size));
+}
+
+void
+ofl_free(void *p) {
+    if (current_arena == NULL) {
+        free(p);
+    }
+}
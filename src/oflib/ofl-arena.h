@@ -0,0 +1,79 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * Copyright (c) 2012, CPqD, Brazil 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OFL_ARENA_H
+#define OFL_ARENA_H 1
+
+#include <stddef.h>
+
+struct ofl_arena_chunk;
+
+/* A region of memory that a decoded message can be allocated from in one
+   piece.  Memory is handed out by advancing a pointer through a list of
+   chunks and is never freed block by block: ofl_arena_reset() takes back
+   everything that was allocated from the arena at once, and keeps the chunks
+   for the next message. */
+struct ofl_arena {
+    struct ofl_arena_chunk *chunks; /* All chunks of the arena. */
+    struct ofl_arena_chunk *cur;    /* Chunk being allocated from. */
+    size_t used;                    /* Bytes allocated from 'cur'. */
+    size_t size;                    /* Total size of the chunks. */
+};
+
+void
+ofl_arena_init(struct ofl_arena *arena);
+
+void
+ofl_arena_destroy(struct ofl_arena *arena);
+
+/* Returns 'size' bytes of memory from the arena, aligned for any type. */
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size);
+
+/* Releases all memory allocated from the arena.  The chunks are kept for
+   reuse, unless the arena has grown unusually large. */
+void
+ofl_arena_reset(struct ofl_arena *arena);
+
+/* Makes ofl_malloc() on the calling thread allocate from 'arena', or from the
+   heap if it is null.  Returns the arena that was in use before. */
+struct ofl_arena *
+ofl_arena_set_current(struct ofl_arena *arena);
+
+/* The allocator used by the unpack and free functions.  While the calling
+   thread has a current arena, ofl_malloc() allocates from it and ofl_free()
+   does nothing; otherwise they are malloc() and free(). */
+void *
+ofl_malloc(size_t size);
+
+void
+ofl_free(void *p);
+
+#endif /* OFL_ARENA_H */
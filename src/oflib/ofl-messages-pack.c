@@ -1125,3 +1125,145 @@ ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *bu
 
     return 0;
 }
+
+
+static void
+pack_header(uint8_t *buf, enum ofp_type type, size_t len, uint32_t xid) {
+    struct ofp_header *oh = (struct ofp_header *)buf;
+    oh->version = OFP_VERSION;
+    oh->type    = type;
+    oh->length  = htons(len);
+    oh->xid     = htonl(xid);
+}
+
+static void
+pack_output(uint8_t *buf, uint32_t port, uint16_t max_len) {
+    struct ofp_action_output *output = (struct ofp_action_output *)buf;
+    output->type    = htons(OFPAT_OUTPUT);
+    output->len     = htons(sizeof(struct ofp_action_output));
+    output->port    = htonl(port);
+    output->max_len = htons(max_len);
+    memset(output->pad, 0x00, 6);
+}
+
+size_t
+ofl_msg_pack_barrier_request(uint32_t xid, uint8_t *buf, size_t buf_len) {
+    if (buf_len < OFL_BARRIER_REQUEST_LEN) {
+        return 0;
+    }
+    pack_header(buf, OFPT_BARRIER_REQUEST, OFL_BARRIER_REQUEST_LEN, xid);
+    return OFL_BARRIER_REQUEST_LEN;
+}
+
+size_t
+ofl_msg_pack_echo_data(enum ofp_type type, uint32_t xid,
+                       const uint8_t *data, size_t data_len,
+                       uint8_t *buf, size_t buf_len) {
+    size_t len = OFL_ECHO_LEN(data_len);
+
+    if (buf_len < len || len > 0xffff) {
+        return 0;
+    }
+    pack_header(buf, type, len, xid);
+    if (data_len > 0) {
+        memcpy(buf + sizeof(struct ofp_header), data, data_len);
+    }
+    return len;
+}
+
+size_t
+ofl_msg_pack_packet_out_output(uint32_t xid, uint32_t buffer_id,
+                               uint32_t in_port, uint32_t out_port,
+                               const uint8_t *data, size_t data_len,
+                               uint8_t *buf, size_t buf_len) {
+    struct ofp_packet_out *packet_out;
+    size_t len = OFL_PACKET_OUT_OUTPUT_LEN(data_len);
+
+    if (buf_len < len || len > 0xffff) {
+        return 0;
+    }
+    pack_header(buf, OFPT_PACKET_OUT, len, xid);
+    packet_out = (struct ofp_packet_out *)buf;
+    packet_out->buffer_id   = htonl(buffer_id);
+    packet_out->in_port     = htonl(in_port);
+    packet_out->actions_len = htons(sizeof(struct ofp_action_output));
+    memset(packet_out->pad, 0x00, 6);
+
+    pack_output(buf + sizeof(struct ofp_packet_out), out_port, 0);
+    if (data_len > 0) {
+        memcpy(buf + OFL_PACKET_OUT_OUTPUT_LEN(0), data, data_len);
+    }
+    return len;
+}
+
+size_t
+ofl_msg_pack_flow_mod_output(const struct ofl_msg_flow_mod *msg, uint32_t xid,
+                             uint32_t out_port, uint16_t max_len,
+                             uint8_t *buf, size_t buf_len) {
+    struct ofp_flow_mod *flow_mod;
+    struct ofp_instruction_actions *inst;
+    struct ofl_match *match = (struct ofl_match *)msg->match;
+    size_t oxm_len = msg->match->length;
+    size_t match_end = sizeof(struct ofp_flow_mod) - 4 + oxm_len;
+    size_t inst_ofs = ROUND_UP(match_end, 8);
+    size_t len = OFL_FLOW_MOD_OUTPUT_LEN(oxm_len);
+    struct ofpbuf b;
+
+    if (msg->match->type != OFPMT_OXM || buf_len < len) {
+        return 0;
+    }
+    pack_header(buf, OFPT_FLOW_MOD, len, xid);
+    flow_mod = (struct ofp_flow_mod *)buf;
+    flow_mod->cookie       = hton64(msg->cookie);
+    flow_mod->cookie_mask  = hton64(msg->cookie_mask);
+    flow_mod->table_id     =        msg->table_id;
+    flow_mod->command      =        msg->command;
+    flow_mod->idle_timeout = htons( msg->idle_timeout);
+    flow_mod->hard_timeout = htons( msg->hard_timeout);
+    flow_mod->priority     = htons( msg->priority);
+    flow_mod->buffer_id    = htonl( msg->buffer_id);
+    flow_mod->out_port     = htonl( msg->out_port);
+    flow_mod->out_group    = htonl( msg->out_group);
+    flow_mod->flags        = htons( msg->flags);
+    memset(flow_mod->pad, 0x00, 2);
+
+    flow_mod->match.type   = htons(OFPMT_OXM);
+    flow_mod->match.length = htons(sizeof(struct ofp_match) - 4 + oxm_len);
+    /* The fields are put into the rest of 'buf', which is longer than the
+     * fields by at least the instruction, so that the ofpbuf never has to
+     * grow. */
+    ofpbuf_use(&b, buf + sizeof(struct ofp_flow_mod) - 4,
+               buf_len - (sizeof(struct ofp_flow_mod) - 4));
+    if (oxm_len > 0 && (size_t) oxm_put_match(&b, match) != oxm_len) {
+        OFL_LOG_WARN(LOG_MODULE, "Match length does not match its fields.");
+        return 0;
+    }
+    memset(buf + match_end, 0x00, inst_ofs - match_end);
+
+    inst = (struct ofp_instruction_actions *)(buf + inst_ofs);
+    inst->type = htons(OFPIT_APPLY_ACTIONS);
+    inst->len  = htons(sizeof(struct ofp_instruction_actions)
+                       + sizeof(struct ofp_action_output));
+    memset(inst->pad, 0x00, 4);
+    pack_output(buf + inst_ofs + sizeof(struct ofp_instruction_actions),
+                out_port, max_len);
+    return len;
+}
+
+bool
+ofl_msg_flow_mod_is_output(const struct ofl_msg_flow_mod *msg,
+                           const struct ofl_action_output **output) {
+    struct ofl_instruction_actions *ia;
+
+    if (msg->instructions_num != 1
+        || msg->instructions[0]->type != OFPIT_APPLY_ACTIONS
+        || msg->match->type != OFPMT_OXM) {
+        return false;
+    }
+    ia = (struct ofl_instruction_actions *)msg->instructions[0];
+    if (ia->actions_num != 1 || ia->actions[0]->type != OFPAT_OUTPUT) {
+        return false;
+    }
+    *output = (const struct ofl_action_output *)ia->actions[0];
+    return true;
+}
@@ -736,3 +736,312 @@ ofl_msg_print(FILE *stream, struct ofl_msg_header *msg, struct ofl_exp *exp) {
 	}
 }
 
+
+
+
+static void
+ofl_msg_format_flow_mod(struct ofl_fmt *fmt, const struct ofl_msg_flow_mod *msg) {
+    size_t i;
+
+    ofl_fmt_str(fmt, "{table=\"");
+    ofl_fmt_id(fmt, ofl_table_name(msg->table_id), msg->table_id);
+    ofl_fmt_str(fmt, "\", cmd=\"");
+    ofl_fmt_enum(fmt, ofl_flow_mod_command_name(msg->command), msg->command);
+    ofl_fmt_hex_field(fmt, "\", cookie=", msg->cookie);
+    ofl_fmt_hex_field(fmt, ", mask=", msg->cookie_mask);
+    ofl_fmt_uint_field(fmt, ", idle=", msg->idle_timeout);
+    ofl_fmt_uint_field(fmt, ", hard=", msg->hard_timeout);
+    ofl_fmt_uint_field(fmt, ", prio=", msg->priority);
+    ofl_fmt_str(fmt, ", buf=\"");
+    ofl_fmt_id(fmt, ofl_buffer_name(msg->buffer_id), msg->buffer_id);
+    ofl_fmt_str(fmt, "\", port=\"");
+    ofl_fmt_id(fmt, ofl_port_name(msg->out_port), msg->out_port);
+    ofl_fmt_str(fmt, "\", group=\"");
+    ofl_fmt_id(fmt, ofl_group_name(msg->out_group), msg->out_group);
+    ofl_fmt_hex_field(fmt, "\", flags=", msg->flags);
+    ofl_fmt_str(fmt, ", match=");
+    ofl_structs_match_format(fmt, msg->match);
+    ofl_fmt_str(fmt, ", insts=[");
+    for (i = 0; i < msg->instructions_num && ofl_fmt_entry(fmt, i, msg->instructions_num); i++) {
+        ofl_structs_instruction_format(fmt, msg->instructions[i]);
+    }
+    ofl_fmt_str(fmt, "]}");
+}
+
+static void
+ofl_msg_format_multipart_request(struct ofl_fmt *fmt, const struct ofl_msg_multipart_request_header *msg) {
+    ofl_fmt_str(fmt, "{type=\"");
+    ofl_fmt_enum(fmt, ofl_stats_type_name(msg->type), msg->type);
+    ofl_fmt_printf(fmt, "\", flags=\"0x%"PRIx32"\"", msg->flags);
+
+    switch (msg->type) {
+        case OFPMP_FLOW:
+        case OFPMP_AGGREGATE: {
+            struct ofl_msg_multipart_request_flow *m = (struct ofl_msg_multipart_request_flow *)msg;
+
+            ofl_fmt_str(fmt, ", table=\"");
+            ofl_fmt_id(fmt, ofl_table_name(m->table_id), m->table_id);
+            ofl_fmt_str(fmt, "\", oport=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->out_port), m->out_port);
+            ofl_fmt_str(fmt, "\", ogrp=\"");
+            ofl_fmt_id(fmt, ofl_group_name(m->out_group), m->out_group);
+            ofl_fmt_printf(fmt, "\", cookie=\"0x%"PRIx64"\", mask=\"0x%"PRIx64"\", match=",
+                           m->cookie, m->cookie_mask);
+            ofl_structs_match_format(fmt, m->match);
+            break;
+        }
+        case OFPMP_PORT_STATS: {
+            struct ofl_msg_multipart_request_port *m = (struct ofl_msg_multipart_request_port *)msg;
+
+            ofl_fmt_str(fmt, ", port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->port_no), m->port_no);
+            ofl_fmt_str(fmt, "\"");
+            break;
+        }
+        case OFPMP_QUEUE: {
+            struct ofl_msg_multipart_request_queue *m = (struct ofl_msg_multipart_request_queue *)msg;
+
+            ofl_fmt_str(fmt, ", port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->port_no), m->port_no);
+            ofl_fmt_str(fmt, "\", q=\"");
+            ofl_fmt_id(fmt, ofl_queue_name(m->queue_id), m->queue_id);
+            ofl_fmt_str(fmt, "\"");
+            break;
+        }
+        case OFPMP_GROUP: {
+            struct ofl_msg_multipart_request_group *m = (struct ofl_msg_multipart_request_group *)msg;
+
+            ofl_fmt_str(fmt, ", group=\"");
+            ofl_fmt_id(fmt, ofl_group_name(m->group_id), m->group_id);
+            ofl_fmt_str(fmt, "\"");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    ofl_fmt_str(fmt, "}");
+}
+
+static void
+ofl_msg_format_multipart_reply(struct ofl_fmt *fmt, const struct ofl_msg_multipart_reply_header *msg) {
+    size_t i;
+
+    ofl_fmt_str(fmt, "{type=\"");
+    ofl_fmt_enum(fmt, ofl_stats_type_name(msg->type), msg->type);
+    ofl_fmt_printf(fmt, "\", flags=\"0x%"PRIx32"\"", msg->flags);
+
+    switch (msg->type) {
+        case OFPMP_DESC: {
+            struct ofl_msg_reply_desc *m = (struct ofl_msg_reply_desc *)msg;
+
+            ofl_fmt_printf(fmt, ", mfr=\"%s\", hw=\"%s\", sw=\"%s\", sn=\"%s\", dp=\"%s\"",
+                           m->mfr_desc, m->hw_desc, m->sw_desc, m->serial_num, m->dp_desc);
+            break;
+        }
+        case OFPMP_FLOW: {
+            struct ofl_msg_multipart_reply_flow *m = (struct ofl_msg_multipart_reply_flow *)msg;
+
+            ofl_fmt_str(fmt, ", stats=[");
+            for (i = 0; i < m->stats_num && ofl_fmt_entry(fmt, i, m->stats_num); i++) {
+                ofl_structs_flow_stats_format(fmt, m->stats[i]);
+            }
+            ofl_fmt_str(fmt, "]");
+            break;
+        }
+        case OFPMP_AGGREGATE: {
+            struct ofl_msg_multipart_reply_aggregate *m = (struct ofl_msg_multipart_reply_aggregate *)msg;
+
+            ofl_fmt_printf(fmt, ", pkt_cnt=\"%"PRIu64"\", byte_cnt=\"%"PRIu64"\", flow_cnt=\"%u\"",
+                           m->packet_count, m->byte_count, m->flow_count);
+            break;
+        }
+        case OFPMP_TABLE: {
+            struct ofl_msg_multipart_reply_table *m = (struct ofl_msg_multipart_reply_table *)msg;
+
+            ofl_fmt_str(fmt, ", stats=[");
+            for (i = 0; i < m->stats_num && ofl_fmt_entry(fmt, i, m->stats_num); i++) {
+                ofl_structs_table_stats_format(fmt, m->stats[i]);
+            }
+            ofl_fmt_str(fmt, "]");
+            break;
+        }
+        case OFPMP_PORT_STATS: {
+            struct ofl_msg_multipart_reply_port *m = (struct ofl_msg_multipart_reply_port *)msg;
+
+            ofl_fmt_str(fmt, ", stats=[");
+            for (i = 0; i < m->stats_num && ofl_fmt_entry(fmt, i, m->stats_num); i++) {
+                ofl_structs_port_stats_format(fmt, m->stats[i]);
+            }
+            ofl_fmt_str(fmt, "]");
+            break;
+        }
+        case OFPMP_QUEUE: {
+            struct ofl_msg_multipart_reply_queue *m = (struct ofl_msg_multipart_reply_queue *)msg;
+
+            ofl_fmt_str(fmt, ", stats=[");
+            for (i = 0; i < m->stats_num && ofl_fmt_entry(fmt, i, m->stats_num); i++) {
+                ofl_structs_queue_stats_format(fmt, m->stats[i]);
+            }
+            ofl_fmt_str(fmt, "]");
+            break;
+        }
+        case OFPMP_PORT_DESC: {
+            struct ofl_msg_multipart_reply_port_desc *m = (struct ofl_msg_multipart_reply_port_desc *)msg;
+
+            ofl_fmt_str(fmt, ", stats=[");
+            for (i = 0; i < m->stats_num && ofl_fmt_entry(fmt, i, m->stats_num); i++) {
+                ofl_structs_port_format(fmt, m->stats[i]);
+            }
+            ofl_fmt_str(fmt, "]");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    ofl_fmt_str(fmt, "}");
+}
+
+void
+ofl_msg_format(struct ofl_fmt *fmt, const struct ofl_msg_header *msg) {
+    ofl_fmt_enum(fmt, ofl_message_type_name(msg->type), msg->type);
+
+    switch (msg->type) {
+        case OFPT_ERROR: {
+            struct ofl_msg_error *m = (struct ofl_msg_error *)msg;
+
+            ofl_fmt_str(fmt, "{type=\"");
+            ofl_fmt_enum(fmt, ofl_error_type_name(m->type), m->type);
+            ofl_fmt_str(fmt, "\", code=\"");
+            ofl_fmt_enum(fmt, ofl_error_code_name(m->type, m->code), m->code);
+            ofl_fmt_printf(fmt, "\", dlen=\"%zu\"}", m->data_length);
+            return;
+        }
+        case OFPT_ECHO_REQUEST:
+        case OFPT_ECHO_REPLY: {
+            ofl_fmt_printf(fmt, "{dlen=\"%zu\"}", ((struct ofl_msg_echo *)msg)->data_length);
+            return;
+        }
+        case OFPT_EXPERIMENTER: {
+            ofl_fmt_printf(fmt, "{id=\"0x%"PRIx32"\"}",
+                           ((struct ofl_msg_experimenter *)msg)->experimenter_id);
+            return;
+        }
+        case OFPT_FEATURES_REPLY: {
+            struct ofl_msg_features_reply *m = (struct ofl_msg_features_reply *)msg;
+
+            ofl_fmt_printf(fmt, "{dpid=\"0x%016"PRIx64"\", buffs=\"%u\", tabs=\"%u\", "
+                                "caps=\"0x%"PRIx32"\"}",
+                           m->datapath_id, m->n_buffers, m->n_tables, m->capabilities);
+            return;
+        }
+        case OFPT_GET_CONFIG_REPLY:
+        case OFPT_SET_CONFIG: {
+            /* Both messages hold only the configuration. */
+            struct ofl_config *c = ((struct ofl_msg_set_config *)msg)->config;
+
+            ofl_fmt_printf(fmt, "{conf={flags=\"0x%"PRIx16"\", mlen=\"%u\"}}",
+                           c->flags, c->miss_send_len);
+            return;
+        }
+        case OFPT_PACKET_IN: {
+            struct ofl_msg_packet_in *m = (struct ofl_msg_packet_in *)msg;
+
+            ofl_fmt_str(fmt, "{buffer=\"");
+            ofl_fmt_id(fmt, ofl_buffer_name(m->buffer_id), m->buffer_id);
+            ofl_fmt_uint_field(fmt, "\", tlen=", m->total_len);
+            ofl_fmt_str(fmt, ", reas=\"");
+            ofl_fmt_enum(fmt, ofl_packet_in_reason_name(m->reason), m->reason);
+            ofl_fmt_str(fmt, "\", table=\"");
+            ofl_fmt_id(fmt, ofl_table_name(m->table_id), m->table_id);
+            ofl_fmt_uint_field(fmt, "\", dlen=", m->data_length);
+            ofl_fmt_str(fmt, "}");
+            return;
+        }
+        case OFPT_FLOW_REMOVED: {
+            struct ofl_msg_flow_removed *m = (struct ofl_msg_flow_removed *)msg;
+
+            ofl_fmt_str(fmt, "{reas=\"");
+            ofl_fmt_enum(fmt, ofl_flow_removed_reason_name(m->reason), m->reason);
+            ofl_fmt_str(fmt, "\", stats=");
+            ofl_structs_flow_stats_format(fmt, m->stats);
+            ofl_fmt_str(fmt, "}");
+            return;
+        }
+        case OFPT_PORT_STATUS: {
+            struct ofl_msg_port_status *m = (struct ofl_msg_port_status *)msg;
+
+            ofl_fmt_str(fmt, "{reas=");
+            ofl_fmt_enum(fmt, ofl_port_status_reason_name(m->reason), m->reason);
+            ofl_fmt_str(fmt, ", desc=");
+            ofl_structs_port_format(fmt, m->desc);
+            ofl_fmt_str(fmt, "}");
+            return;
+        }
+        case OFPT_PACKET_OUT: {
+            struct ofl_msg_packet_out *m = (struct ofl_msg_packet_out *)msg;
+            size_t i;
+
+            ofl_fmt_str(fmt, "{buffer=\"");
+            ofl_fmt_id(fmt, ofl_buffer_name(m->buffer_id), m->buffer_id);
+            ofl_fmt_str(fmt, "\", port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->in_port), m->in_port);
+            ofl_fmt_str(fmt, "\", actions=[");
+            for (i = 0; i < m->actions_num && ofl_fmt_entry(fmt, i, m->actions_num); i++) {
+                ofl_action_format(fmt, m->actions[i]);
+            }
+            ofl_fmt_str(fmt, "]}");
+            return;
+        }
+        case OFPT_FLOW_MOD: {
+            ofl_msg_format_flow_mod(fmt, (struct ofl_msg_flow_mod *)msg);
+            return;
+        }
+        case OFPT_PORT_MOD: {
+            struct ofl_msg_port_mod *m = (struct ofl_msg_port_mod *)msg;
+
+            ofl_fmt_str(fmt, "{port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->port_no), m->port_no);
+            ofl_fmt_printf(fmt, "\", hwaddr=\""ETH_ADDR_FMT"\", config=\"0x%08"PRIx32"\", "
+                                "mask=\"0x%"PRIx32"\", adv=\"0x%"PRIx32"\"}",
+                           ETH_ADDR_ARGS(m->hw_addr), m->config, m->mask, m->advertise);
+            return;
+        }
+        case OFPT_TABLE_MOD: {
+            struct ofl_msg_table_mod *m = (struct ofl_msg_table_mod *)msg;
+
+            ofl_fmt_str(fmt, "{id=\"");
+            ofl_fmt_id(fmt, ofl_table_name(m->table_id), m->table_id);
+            ofl_fmt_printf(fmt, "\", config=\"0x%08"PRIx32"\"}", m->config);
+            return;
+        }
+        case OFPT_MULTIPART_REQUEST: {
+            ofl_msg_format_multipart_request(fmt, (struct ofl_msg_multipart_request_header *)msg);
+            return;
+        }
+        case OFPT_MULTIPART_REPLY: {
+            ofl_msg_format_multipart_reply(fmt, (struct ofl_msg_multipart_reply_header *)msg);
+            return;
+        }
+        case OFPT_ROLE_REQUEST:
+        case OFPT_ROLE_REPLY: {
+            struct ofl_msg_role_request *m = (struct ofl_msg_role_request *)msg;
+
+            ofl_fmt_printf(fmt, "{role=\"%u\", generation_id=\"%"PRIu64"\"}",
+                           m->role, m->generation_id);
+            return;
+        }
+        case OFPT_QUEUE_GET_CONFIG_REQUEST: {
+            struct ofl_msg_queue_get_config_request *m = (struct ofl_msg_queue_get_config_request *)msg;
+
+            ofl_fmt_str(fmt, "{port=\"");
+            ofl_fmt_id(fmt, ofl_port_name(m->port), m->port);
+            ofl_fmt_str(fmt, "\"}");
+            return;
+        }
+        default: {
+            return;
+        }
+    }
+}
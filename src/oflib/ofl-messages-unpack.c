@@ -32,6 +32,7 @@
 #include <string.h>
 #include <netinet/in.h>
 #include <endian.h>
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-messages.h"
 #include "ofl-structs.h"
@@ -49,6 +50,19 @@ OFL_LOG_INIT(LOG_MODULE)
  * Functions for unpacking ofp wire format to ofl structures.
  ****************************************************************************/
 
+/* Set by ofl_msg_unpack_borrowed() while it runs. */
+static __thread bool borrow_data __attribute__((tls_model("initial-exec")));
+
+/* Returns the 'len' bytes of payload at 'data' for a decoded message: 'data'
+   itself when borrowing from the receive buffer, otherwise a copy. */
+static uint8_t *
+unpack_data(uint8_t *data, size_t len) {
+    if (len == 0) {
+        return NULL;
+    }
+    return borrow_data ? data : (uint8_t *)memcpy(ofl_malloc(len), data, len);
+}
+
 
 static ofl_err
 ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header **msg) {
@@ -63,12 +77,12 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 
     se = (struct ofp_error_msg *)src;
 
-    de = (struct ofl_msg_error *)malloc(sizeof(struct ofl_msg_error));
+    de = (struct ofl_msg_error *)ofl_malloc(sizeof(struct ofl_msg_error));
 
     de->type = (enum ofp_error_type)ntohs(se->type);
     de->code = ntohs(se->code);
     de->data_length = *len;
-    de->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), se->data, *len) : NULL;
+    de->data = unpack_data(se->data, *len);
     *len = 0;
 
     (*msg) = (struct ofl_msg_header *)de;
@@ -78,7 +92,7 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 
 static ofl_err
 ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header **msg) {
-    struct ofl_msg_echo *e = (struct ofl_msg_echo *)malloc(sizeof(struct ofl_msg_echo));
+    struct ofl_msg_echo *e = (struct ofl_msg_echo *)ofl_malloc(sizeof(struct ofl_msg_echo));
     uint8_t *data;
 
     // ofp_header length was checked at ofl_msg_unpack
@@ -86,7 +100,7 @@ ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header *
 
     data = (uint8_t *)src + sizeof(struct ofp_header);
     e->data_length = *len;
-    e->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
+    e->data = unpack_data(data, *len);
     *len = 0;
 
     *msg = (struct ofl_msg_header *)e;
@@ -105,7 +119,7 @@ ofl_msg_unpack_role_request(struct ofp_header *src, size_t *len, struct ofl_msg_
     *len -= sizeof(struct ofp_role_request);    
     
     srl = (struct ofp_role_request *) src;
-    drl = (struct ofl_msg_role_request *) malloc(sizeof(struct ofl_msg_role_request));
+    drl = (struct ofl_msg_role_request *) ofl_malloc(sizeof(struct ofl_msg_role_request));
     
     drl->role = ntohl(srl->role);
     drl->generation_id = ntoh64(srl->generation_id);
@@ -126,7 +140,7 @@ ofl_msg_unpack_features_reply(struct ofp_header *src, size_t *len, struct ofl_ms
     *len -= sizeof(struct ofp_switch_features);
 
     sr = (struct ofp_switch_features *)src;
-    dr = (struct ofl_msg_features_reply *)malloc(sizeof(struct ofl_msg_features_reply));
+    dr = (struct ofl_msg_features_reply *)ofl_malloc(sizeof(struct ofl_msg_features_reply));
 
     dr->datapath_id  = ntoh64(sr->datapath_id);
     dr->n_buffers    = ntohl( sr->n_buffers);
@@ -151,9 +165,9 @@ ofl_msg_unpack_get_config_reply(struct ofp_header *src, size_t *len, struct ofl_
     *len -= sizeof(struct ofp_switch_config);
 
     sr = (struct ofp_switch_config *)src;
-    dr = (struct ofl_msg_get_config_reply *)malloc(sizeof(struct ofl_msg_get_config_reply));
+    dr = (struct ofl_msg_get_config_reply *)ofl_malloc(sizeof(struct ofl_msg_get_config_reply));
 
-    dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+    dr->config = (struct ofl_config *)ofl_malloc(sizeof(struct ofl_config));
     dr->config->miss_send_len = ntohs(sr->miss_send_len);
     dr->config->flags = ntohs(sr->flags);
 
@@ -173,9 +187,9 @@ ofl_msg_unpack_set_config(struct ofp_header *src, size_t *len, struct ofl_msg_he
      *len -= sizeof(struct ofp_switch_config);
 
      sr = (struct ofp_switch_config *)src;
-     dr = (struct ofl_msg_set_config *)malloc(sizeof(struct ofl_msg_set_config));
+     dr = (struct ofl_msg_set_config *)ofl_malloc(sizeof(struct ofl_msg_set_config));
 
-     dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+     dr->config = (struct ofl_config *)ofl_malloc(sizeof(struct ofl_config));
      // TODO Zoltan: validate flags
      dr->config->miss_send_len = ntohs(sr->miss_send_len);
      dr->config->flags = ntohs(sr->flags);
@@ -198,8 +212,8 @@ ofl_msg_unpack_async_config(struct ofp_header *src, size_t *len, struct ofl_msg_
     *len -= sizeof(struct ofp_async_config);
     
     sac = (struct ofp_async_config*)src;
-    dac = (struct ofl_msg_async_config*)malloc(sizeof(struct ofl_msg_async_config));
-    dac->config = (struct ofl_async_config*) malloc(sizeof(struct ofl_async_config));
+    dac = (struct ofl_msg_async_config*)ofl_malloc(sizeof(struct ofl_msg_async_config));
+    dac->config = (struct ofl_async_config*) ofl_malloc(sizeof(struct ofl_async_config));
     for(i = 0; i < 2; i++){
         dac->config->packet_in_mask[i] = sac->packet_in_mask[i];
         dac->config->port_status_mask[i] = sac->port_status_mask[i];
@@ -228,23 +242,23 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, uint8_t* buf, size_t *len, stru
         (ntohl(sp->in_port) > OFPP_MAX &&
          ntohl(sp->in_port) != OFPP_LOCAL)) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *ps = ofl_port_to_string(ntohl(sp->in_port));
-            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN message has invalid in_port (%s).", ps);
-            free(ps);
+            char ps[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN message has invalid in_port (%s).",
+                         ofl_id_to_buf(ofl_port_name(ntohl(sp->in_port)), ntohl(sp->in_port), ps));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBAC_BAD_ARGUMENT);
     }*/
 
     if (sp->table_id == 0xff) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *ts = ofl_table_to_string(sp->table_id);
-            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN has invalid table_id (%s).", ts);
-            free(ts);
+            char ts[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN has invalid table_id (%s).",
+                         ofl_id_to_buf(ofl_table_name(sp->table_id), sp->table_id, ts));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBAC_BAD_ARGUMENT);
     }
     *len -= sizeof(struct ofp_packet_in) - sizeof(struct ofp_match);
-    dp = (struct ofl_msg_packet_in *)malloc(sizeof(struct ofl_msg_packet_in));
+    dp = (struct ofl_msg_packet_in *)ofl_malloc(sizeof(struct ofl_msg_packet_in));
     dp->buffer_id = ntohl(sp->buffer_id);
     dp->total_len = ntohs(sp->total_len);
     dp->reason = (enum ofp_packet_in_reason)sp->reason;
@@ -258,7 +272,7 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, uint8_t* buf, size_t *len, stru
     /* Minus padding bytes */
     *len -= 2;
     dp->data_length = *len;
-    dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), ptr, *len) : NULL;
+    dp->data = unpack_data(ptr, *len);
     *len = 0;
 
     *msg = (struct ofl_msg_header *)dp;
@@ -281,18 +295,18 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src,uint8_t *buf, size_t *len, st
 
     if (sr->table_id == 0xff) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *ts = ofl_table_to_string(sr->table_id);
-            OFL_LOG_WARN(LOG_MODULE, "Received FLOW_REMOVED message has invalid table_id (%s).", ts);
-            free(ts);
+            char ts[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received FLOW_REMOVED message has invalid table_id (%s).",
+                         ofl_id_to_buf(ofl_table_name(sr->table_id), sr->table_id, ts));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBAC_BAD_ARGUMENT);
     }
     *len -=  sizeof(struct ofp_flow_removed) - sizeof(struct ofp_match) ;
 
-    dr = (struct ofl_msg_flow_removed *)malloc(sizeof(struct ofl_msg_flow_removed));
+    dr = (struct ofl_msg_flow_removed *)ofl_malloc(sizeof(struct ofl_msg_flow_removed));
     dr->reason = (enum ofp_flow_removed_reason)sr->reason;
 
-    dr->stats = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+    dr->stats = (struct ofl_flow_stats *)ofl_malloc(sizeof(struct ofl_flow_stats));
     dr->stats->table_id         =        sr->table_id;
     dr->stats->duration_sec     = ntohl( sr->duration_sec);
     dr->stats->duration_nsec    = ntohl( sr->duration_nsec);
@@ -309,8 +323,8 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src,uint8_t *buf, size_t *len, st
 
     error = ofl_structs_match_unpack(&(sr->match),buf + match_pos, len, &(dr->stats->match), exp);
     if (error) {
-        free(dr->stats);
-        free(dr);
+        ofl_free(dr->stats);
+        ofl_free(dr);
         return error;
     }
     *msg = (struct ofl_msg_header *)dr;
@@ -330,13 +344,13 @@ ofl_msg_unpack_port_status(struct ofp_header *src, size_t *len, struct ofl_msg_h
     *len -= (sizeof(struct ofp_port_status) - sizeof(struct ofp_port));
 
     ss = (struct ofp_port_status *)src;
-    ds = (struct ofl_msg_port_status *)malloc(sizeof(struct ofl_msg_port_status));
+    ds = (struct ofl_msg_port_status *)ofl_malloc(sizeof(struct ofl_msg_port_status));
 
     ds->reason = (enum ofp_port_reason) ss->reason;
 
     error = ofl_structs_port_unpack(&(ss->desc), len, &(ds->desc));
     if (error) {
-        free(ds);
+        ofl_free(ds);
         return error;
     }
 
@@ -363,9 +377,9 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
     /*if (ntohl(sp->in_port) == 0 ||
         (ntohl(sp->in_port) > OFPP_MAX && ntohl(sp->in_port) != OFPP_CONTROLLER)) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *ps = ofl_port_to_string(ntohl(sp->in_port));
-            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with invalid in_port (%s).", ps);
-            free(ps);
+            char ps[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with invalid in_port (%s).",
+                         ofl_id_to_buf(ofl_port_name(ntohl(sp->in_port)), ntohl(sp->in_port), ps));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBAC_BAD_ARGUMENT);
     }*/
@@ -373,31 +387,32 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
     if (ntohl(sp->buffer_id) != 0xffffffff &&
         *len != sizeof(struct ofp_packet_out) + ntohs(sp->actions_len)) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *bs = ofl_buffer_to_string(ntohl(sp->buffer_id));
-            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with data and buffer_id (%s).", bs);
-            free(bs);
+            char bs[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with data and buffer_id (%s).",
+                         ofl_id_to_buf(ofl_buffer_name(ntohl(sp->buffer_id)), ntohl(sp->buffer_id), bs));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_packet_out);
 
-    dp = (struct ofl_msg_packet_out *)malloc(sizeof(struct ofl_msg_packet_out));
+    dp = (struct ofl_msg_packet_out *)ofl_malloc(sizeof(struct ofl_msg_packet_out));
 
     dp->buffer_id = ntohl(sp->buffer_id);
+    dp->in_port = ntohl(sp->in_port);
 
     if (*len < ntohs(sp->actions_len)) {
         OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message has invalid action length (%zu).", *len);
-        free(dp);
+        ofl_free(dp);
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
 
     error = ofl_utils_count_ofp_actions(&(sp->actions), ntohs(sp->actions_len), &actions_num);
     if (error) {
-        free(dp);
+        ofl_free(dp);
         return error;
     }
     dp->actions_num = actions_num;
-    dp->actions = (struct ofl_action_header **)malloc(dp->actions_num * sizeof(struct ofp_action_header *));
+    dp->actions = (struct ofl_action_header **)ofl_malloc(dp->actions_num * sizeof(struct ofp_action_header *));
 
     // TODO Zoltan: Output actions can contain OFPP_TABLE
     act = sp->actions;
@@ -406,14 +421,14 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dp->actions, i,
                                     ofl_actions_free, exp);
-            free(dp);
+            ofl_free(dp);
         }
         act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
     }
 
     data = ((uint8_t *)sp->actions) + ntohs(sp->actions_len);
     dp->data_length = *len;
-    dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
+    dp->data = unpack_data(data, *len);
     *len = 0;
 
     *msg = (struct ofl_msg_header *)dp;
@@ -438,7 +453,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
     *len -= (sizeof(struct ofp_flow_mod) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_mod *)src;
-    dm = (struct ofl_msg_flow_mod *)malloc(sizeof(struct ofl_msg_flow_mod));
+    dm = (struct ofl_msg_flow_mod *)ofl_malloc(sizeof(struct ofl_msg_flow_mod));
 
     dm->cookie =       ntoh64(sm->cookie);
     dm->cookie_mask =  ntoh64(sm->cookie_mask);
@@ -455,18 +470,18 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
     match_pos = sizeof(struct ofp_flow_mod) - 4;
     error = ofl_structs_match_unpack(&(sm->match), buf + match_pos, len, &(dm->match), exp);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
     
     error = ofl_utils_count_ofp_instructions((struct ofp_instruction *)(buf + ROUND_UP(match_pos + dm->match->length,8)), *len, &dm->instructions_num);
     if (error) {
         ofl_structs_free_match(dm->match, exp);
-        free(dm);
+        ofl_free(dm);
         return error;
     }
         
-    dm->instructions = (struct ofl_instruction_header **)malloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
+    dm->instructions = (struct ofl_instruction_header **)ofl_malloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
     inst = (struct ofp_instruction *) (buf + ROUND_UP(match_pos + dm->match->length,8));
     for (i = 0; i < dm->instructions_num; i++) {
         error = ofl_structs_instructions_unpack(inst, len, &(dm->instructions[i]), exp);
@@ -474,7 +489,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
             OFL_UTILS_FREE_ARR_FUN2(dm->instructions, i,
                     ofl_structs_free_instruction, exp);
             ofl_structs_free_match(dm->match, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         inst = (struct ofp_instruction *)((uint8_t *)inst + ntohs(inst->len));
@@ -512,14 +527,14 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     if (ntohl(sm->group_id) > OFPG_MAX &&
                        !(ntohs(sm->command) == OFPGC_DELETE && ntohl(sm->group_id) == OFPG_ALL)) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *gs = ofl_group_to_string(ntohl(sm->group_id));
-            OFL_LOG_WARN(LOG_MODULE, "Received GROUP_MOD message with invalid group id (%s).", gs);
-            free(gs);
+            char gs[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received GROUP_MOD message with invalid group id (%s).",
+                         ofl_id_to_buf(ofl_group_name(ntohl(sm->group_id)), ntohl(sm->group_id), gs));
         }
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm = (struct ofl_msg_group_mod *)malloc(sizeof(struct ofl_msg_group_mod));
+    dm = (struct ofl_msg_group_mod *)ofl_malloc(sizeof(struct ofl_msg_group_mod));
 
     dm->command = (enum ofp_group_mod_command)ntohs(sm->command);
     dm->type = sm->type;
@@ -527,23 +542,23 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
 
     error = ofl_utils_count_ofp_buckets(&(sm->buckets), *len, &dm->buckets_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
     if (dm->command == OFPGC_DELETE && dm->buckets_num > 0) {
         OFL_LOG_WARN(LOG_MODULE, "Received DELETE group command with buckets (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
     if (dm->type == OFPGT_INDIRECT && dm->buckets_num != 1) {
         OFL_LOG_WARN(LOG_MODULE, "Received INDIRECT group doesn't have exactly one bucket (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm->buckets = (struct ofl_bucket **)malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
+    dm->buckets = (struct ofl_bucket **)ofl_malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
 
     bucket = sm->buckets;
     for (i = 0; i < dm->buckets_num; i++) {
@@ -551,7 +566,7 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->buckets, i,
                                     ofl_structs_free_bucket, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         bucket = (struct ofp_bucket *)((uint8_t *)bucket + ntohs(bucket->len));
@@ -592,7 +607,7 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_INVALID_METER);
     }
 
-    dm = (struct ofl_msg_meter_mod *)malloc(sizeof(struct ofl_msg_meter_mod));
+    dm = (struct ofl_msg_meter_mod *)ofl_malloc(sizeof(struct ofl_msg_meter_mod));
 
     dm->command = ntohs(sm->command);
     dm->flags = ntohs(sm->flags);
@@ -600,11 +615,11 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
 
     error = ofl_utils_count_ofp_meter_bands(&(sm->bands), *len, &dm->meter_bands_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->bands = (struct ofl_meter_band_header **)malloc(dm->meter_bands_num * sizeof(struct ofl_meter_band_header *));
+    dm->bands = (struct ofl_meter_band_header **)ofl_malloc(dm->meter_bands_num * sizeof(struct ofl_meter_band_header *));
 
     band = sm->bands;
     for (i = 0; i < dm->meter_bands_num; i++) {
@@ -612,7 +627,7 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(dm->bands, i,
             		ofl_structs_free_meter_bands);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         band = (struct ofp_meter_band_header *)((uint8_t *)band + ntohs(band->len));
@@ -636,15 +651,15 @@ ofl_msg_unpack_port_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
 
     /*if (ntohl(sm->port_no) == 0 || ntohl(sm->port_no) > OFPP_MAX) {
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
-            char *ps = ofl_port_to_string(ntohl(sm->port_no));
-            OFL_LOG_WARN(LOG_MODULE, "Received PORT_MOD message has invalid in_port (%s).", ps);
-            free(ps);
+            char ps[OFL_ID_BUF_LEN];
+            OFL_LOG_WARN(LOG_MODULE, "Received PORT_MOD message has invalid in_port (%s).",
+                         ofl_id_to_buf(ofl_port_name(ntohl(sm->port_no)), ntohl(sm->port_no), ps));
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBAC_BAD_ARGUMENT);
     }*/
     *len -= sizeof(struct ofp_port_mod);
 
-    dm = (struct ofl_msg_port_mod *)malloc(sizeof(struct ofl_msg_port_mod));
+    dm = (struct ofl_msg_port_mod *)ofl_malloc(sizeof(struct ofl_msg_port_mod));
 
     dm->port_no =   ntohl(sm->port_no);
     memcpy(dm->hw_addr, sm->hw_addr, OFP_ETH_ALEN);
@@ -668,7 +683,7 @@ ofl_msg_unpack_table_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     *len -= sizeof(struct ofp_table_mod);
 
     sm = (struct ofp_table_mod *)src;
-    dm = (struct ofl_msg_table_mod *)malloc(sizeof(struct ofl_msg_table_mod));
+    dm = (struct ofl_msg_table_mod *)ofl_malloc(sizeof(struct ofl_msg_table_mod));
 
     dm->table_id = sm->table_id;
     dm->config = ntohl(sm->config);
@@ -693,7 +708,7 @@ ofl_msg_unpack_multipart_request_flow(struct ofp_multipart_request *os, uint8_t*
     *len -= (sizeof(struct ofp_flow_stats_request) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_stats_request *)os->body;
-    dm = (struct ofl_msg_multipart_request_flow *) malloc(sizeof(struct ofl_msg_multipart_request_flow));
+    dm = (struct ofl_msg_multipart_request_flow *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_flow));
 
     dm->table_id = sm->table_id;
     dm->out_port = ntohl(sm->out_port);
@@ -704,7 +719,7 @@ ofl_msg_unpack_multipart_request_flow(struct ofp_multipart_request *os, uint8_t*
     match_pos = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_flow_stats_request) - 4;
     error = ofl_structs_match_unpack(&(sm->match),buf + match_pos, len, &(dm->match), exp);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
@@ -734,7 +749,7 @@ ofl_msg_unpack_multipart_request_port(struct ofp_multipart_request *os, size_t *
 
     *len -= sizeof(struct ofp_port_stats_request);
 
-    dm = (struct ofl_msg_multipart_request_port *) malloc(sizeof(struct ofl_msg_multipart_request_port));
+    dm = (struct ofl_msg_multipart_request_port *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_port));
 
     dm->port_no = ntohl(sm->port_no);
 
@@ -747,7 +762,7 @@ ofl_msg_unpack_multipart_request_empty(struct ofp_multipart_request *os UNUSED,
     // ofp_multipart_request length was checked at ofl_msg_unpack_multipart_request
     len -= sizeof(struct ofp_multipart_request);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_multipart_request_header));
+    *msg = (struct ofl_msg_header *)ofl_malloc(sizeof(struct ofl_msg_multipart_request_header));
     return 0;
 }
 
@@ -758,7 +773,7 @@ ofl_msg_unpack_multipart_request_table_features(struct ofp_multipart_request *os
     uint8_t *features;
     size_t i;
     
-    dm = (struct ofl_msg_multipart_request_table_features*) malloc(sizeof(struct ofl_msg_multipart_request_table_features));
+    dm = (struct ofl_msg_multipart_request_table_features*) ofl_malloc(sizeof(struct ofl_msg_multipart_request_table_features));
     if (!(*len)){
         dm->tables_num = 0;
         dm->table_features = NULL;
@@ -768,10 +783,10 @@ ofl_msg_unpack_multipart_request_table_features(struct ofp_multipart_request *os
     
     error = ofl_utils_count_ofp_table_features((uint8_t*) os->body, *len, &dm->tables_num);  
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->table_features = (struct ofl_table_features **) malloc(sizeof(struct ofl_table_features) * dm->tables_num);
+    dm->table_features = (struct ofl_table_features **) ofl_malloc(sizeof(struct ofl_table_features) * dm->tables_num);
     features = (uint8_t* ) os->body;
 
     for(i = 0; i < dm->tables_num; i++){
@@ -807,7 +822,7 @@ ofl_msg_unpack_multipart_request_queue(struct ofp_multipart_request *os, size_t
     }
     *len -= sizeof(struct ofp_queue_stats_request);
 
-    dm = (struct ofl_msg_multipart_request_queue *) malloc(sizeof(struct ofl_msg_multipart_request_queue));
+    dm = (struct ofl_msg_multipart_request_queue *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_queue));
 
     dm->port_no = ntohl(sm->port_no);
     dm->queue_id = ntohl(sm->queue_id);
@@ -830,7 +845,7 @@ ofl_msg_unpack_multipart_request_group(struct ofp_multipart_request *os, size_t
     *len -= sizeof(struct ofp_group_stats_request);
 
     sm = (struct ofp_group_stats_request *)os->body;
-    dm = (struct ofl_msg_multipart_request_group *) malloc(sizeof(struct ofl_msg_multipart_request_group));
+    dm = (struct ofl_msg_multipart_request_group *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_group));
 
     dm->group_id = ntohl(sm->group_id);
 
@@ -852,7 +867,7 @@ ofl_msg_unpack_meter_multipart_request(struct ofp_multipart_request *os, size_t
     *len -= sizeof(struct ofp_meter_multipart_request);
 
     sm = (struct ofp_meter_multipart_request *)os->body;
-    dm = (struct ofl_msg_multipart_meter_request *) malloc(sizeof(struct ofl_msg_multipart_meter_request));
+    dm = (struct ofl_msg_multipart_meter_request *) ofl_malloc(sizeof(struct ofl_msg_multipart_meter_request));
 
     dm->meter_id = ntohl(sm->meter_id);
 
@@ -958,13 +973,13 @@ ofl_msg_unpack_reply_desc(struct ofp_multipart_reply *os, size_t *len, struct of
     *len -= sizeof(struct ofp_desc);
 
     sm = (struct ofp_desc *)os->body;
-    dm = (struct ofl_msg_reply_desc *) malloc(sizeof(struct ofl_msg_reply_desc));
+    dm = (struct ofl_msg_reply_desc *) ofl_malloc(sizeof(struct ofl_msg_reply_desc));
 
-    dm->mfr_desc =   (char *)strcpy((char *)malloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
-    dm->hw_desc =    (char *)strcpy((char *)malloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
-    dm->sw_desc =    (char *)strcpy((char *)malloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
-    dm->serial_num = (char *)strcpy((char *)malloc(strlen(sm->serial_num) + 1), sm->serial_num);
-    dm->dp_desc =    (char *)strcpy((char *)malloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
+    dm->mfr_desc =   (char *)strcpy((char *)ofl_malloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
+    dm->hw_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
+    dm->sw_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
+    dm->serial_num = (char *)strcpy((char *)ofl_malloc(strlen(sm->serial_num) + 1), sm->serial_num);
+    dm->dp_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
 
     *msg = (struct ofl_msg_header *)dm;
     return 0;
@@ -981,14 +996,14 @@ ofl_msg_unpack_multipart_reply_flow(struct ofp_multipart_reply *os, uint8_t *buf
 
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
     stat = (struct ofp_flow_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_flow *)malloc(sizeof(struct ofl_msg_multipart_reply_flow));
+    dm = (struct ofl_msg_multipart_reply_flow *)ofl_malloc(sizeof(struct ofl_msg_multipart_reply_flow));
 
     error = ofl_utils_count_ofp_flow_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_flow_stats **)malloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
+    dm->stats = (struct ofl_flow_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
 
     ini_len = *len;
     ptr = buf + sizeof(struct ofp_multipart_reply);
@@ -999,7 +1014,7 @@ ofl_msg_unpack_multipart_reply_flow(struct ofp_multipart_reply *os, uint8_t *buf
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->stats, i,
                                     ofl_structs_free_flow_stats, exp);
-            free (dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_flow_stats *)((uint8_t *)stat + ntohs(stat->length));
@@ -1023,7 +1038,7 @@ ofl_msg_unpack_multipart_reply_aggregate(struct ofp_multipart_reply *os, size_t
     *len -= sizeof(struct ofp_aggregate_stats_reply);
 
     sm = (struct ofp_aggregate_stats_reply *)os->body;
-    dm = (struct ofl_msg_multipart_reply_aggregate *) malloc(sizeof(struct ofl_msg_multipart_reply_aggregate));
+    dm = (struct ofl_msg_multipart_reply_aggregate *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_aggregate));
 
     dm->packet_count = ntoh64(sm->packet_count);
     dm->byte_count =   ntoh64(sm->byte_count);
@@ -1043,20 +1058,20 @@ ofl_msg_unpack_multipart_reply_table(struct ofp_multipart_reply *os, size_t *len
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_table_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_table *) malloc(sizeof(struct ofl_msg_multipart_reply_table));
+    dm = (struct ofl_msg_multipart_reply_table *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_table));
 
     error = ofl_utils_count_ofp_table_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_table_stats **)malloc(dm->stats_num * sizeof(struct ofl_table_stats *));
+    dm->stats = (struct ofl_table_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_table_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_table_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_table_stats *)((uint8_t *)stat + sizeof(struct ofp_table_stats));
@@ -1069,28 +1084,28 @@ ofl_msg_unpack_multipart_reply_table(struct ofp_multipart_reply *os, size_t *len
 static ofl_err
 ofl_msg_unpack_multipart_reply_port(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_header **msg) {
     struct ofp_port_stats *stat = (struct ofp_port_stats *)os->body;
-    struct ofl_msg_multipart_reply_port *dm = (struct ofl_msg_multipart_reply_port *) malloc(sizeof(struct ofl_msg_multipart_reply_port));
+    struct ofl_msg_multipart_reply_port *dm = (struct ofl_msg_multipart_reply_port *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_port));
     ofl_err error;
     size_t i;
 
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_port_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_port *) malloc(sizeof(struct ofl_msg_multipart_reply_port));
+    dm = (struct ofl_msg_multipart_reply_port *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_port));
 
     error = ofl_utils_count_ofp_port_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->stats = (struct ofl_port_stats **)malloc(dm->stats_num * sizeof(struct ofl_port_stats *));
+    dm->stats = (struct ofl_port_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_port_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_port_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_port_stats *)((uint8_t *)stat + sizeof(struct ofp_port_stats));
@@ -1103,26 +1118,26 @@ ofl_msg_unpack_multipart_reply_port(struct ofp_multipart_reply *os, size_t *len,
 static ofl_err
 ofl_msg_unpack_multipart_reply_queue(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_header **msg) {
     struct ofp_queue_stats *stat = (struct ofp_queue_stats *)os->body;
-    struct ofl_msg_multipart_reply_queue *dm = (struct ofl_msg_multipart_reply_queue *) malloc(sizeof(struct ofl_msg_multipart_reply_queue));
+    struct ofl_msg_multipart_reply_queue *dm = (struct ofl_msg_multipart_reply_queue *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_queue));
     ofl_err error;
     size_t i;
 
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_queue_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_queue *) malloc(sizeof(struct ofl_msg_multipart_reply_queue));
+    dm = (struct ofl_msg_multipart_reply_queue *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_queue));
 
     error = ofl_utils_count_ofp_queue_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_queue_stats **)malloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
+    dm->stats = (struct ofl_queue_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_queue_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_queue_stats *)((uint8_t *)stat + sizeof(struct ofp_queue_stats));
@@ -1142,21 +1157,21 @@ ofl_msg_unpack_multipart_reply_group(struct ofp_multipart_reply *os, size_t *len
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_group_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group *) malloc(sizeof(struct ofl_msg_multipart_reply_group));
+    dm = (struct ofl_msg_multipart_reply_group *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group));
 
     error = ofl_utils_count_ofp_group_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_stats *));
+    dm->stats = (struct ofl_group_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_group_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(dm->stats, i,
                                    ofl_structs_free_group_stats);
-            free (dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_group_stats *)((uint8_t *)stat + ntohs(stat->length));
@@ -1176,21 +1191,21 @@ ofl_msg_unpack_multipart_reply_group_desc(struct ofp_multipart_reply *os, size_t
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_group_desc_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group_desc *) malloc(sizeof(struct ofl_msg_multipart_reply_group_desc));
+    dm = (struct ofl_msg_multipart_reply_group_desc *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group_desc));
 
     error = ofl_utils_count_ofp_group_desc_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_desc_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
+    dm->stats = (struct ofl_group_desc_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_desc_stats_unpack(stat, len, &(dm->stats[i]), exp);
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->stats, i,
                                     ofl_structs_free_group_desc_stats, exp);
-            free (dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_group_desc_stats *)((uint8_t *)stat + ntohs(stat->length));
@@ -1212,7 +1227,7 @@ ofl_msg_unpack_multipart_reply_group_features(struct ofp_multipart_reply *os, si
     *len -= sizeof(struct ofp_group_features_stats);
 
     sm = (struct ofp_group_features_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group_features *) malloc(sizeof(struct ofl_msg_multipart_reply_group_features));
+    dm = (struct ofl_msg_multipart_reply_group_features *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group_features));
     
     dm->types = ntohl(sm->types);
     dm->capabilities = ntohl(sm->capabilities);
@@ -1232,14 +1247,14 @@ ofl_msg_unpack_multipart_reply_table_features(struct ofp_multipart_reply *src, s
 	ofl_err error;
 	uint8_t *features; 
 	
-    dm = (struct ofl_msg_multipart_reply_table_features*) malloc(sizeof(struct ofl_msg_multipart_reply_table_features) );
+    dm = (struct ofl_msg_multipart_reply_table_features*) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_table_features) );
     
     error = ofl_utils_count_ofp_table_features((uint8_t*) src->body, *len, &dm->tables_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->table_features = (struct ofl_table_features **) malloc(sizeof(struct ofl_table_features) * dm->tables_num);
+    dm->table_features = (struct ofl_table_features **) ofl_malloc(sizeof(struct ofl_table_features) * dm->tables_num);
     features = (uint8_t* ) src->body;
 
     for(i = 0; i < dm->tables_num; i++){
@@ -1260,21 +1275,21 @@ ofl_msg_unpack_multipart_reply_meter_stats(struct ofp_multipart_reply *os, size_
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_meter_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_meter *) malloc(sizeof(struct ofl_msg_multipart_reply_meter));
+    dm = (struct ofl_msg_multipart_reply_meter *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_meter));
 
     error = ofl_utils_count_ofp_meter_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_meter_stats **)malloc(dm->stats_num * sizeof(struct ofl_meter_stats *));
+    dm->stats = (struct ofl_meter_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_meter_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_meter_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
            OFL_UTILS_FREE_ARR_FUN(dm->stats, i,
                                    ofl_structs_free_meter_stats);
-            free (dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_meter_stats *)((uint8_t *)stat + ntohs(stat->len));
@@ -1292,22 +1307,22 @@ ofl_msg_unpack_multipart_reply_meter_config(struct ofp_multipart_reply *os, size
     size_t i;
     
     conf = (struct ofp_meter_config*) os->body;
-    dm =  (struct ofl_msg_multipart_reply_meter_conf *) malloc(sizeof(struct ofl_msg_multipart_reply_meter_conf));
+    dm =  (struct ofl_msg_multipart_reply_meter_conf *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_meter_conf));
    
     error = ofl_utils_count_ofp_meter_config(conf, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }    
     
-    dm->stats = (struct ofl_meter_config **)malloc(dm->stats_num * sizeof(struct ofl_meter_config *));
+    dm->stats = (struct ofl_meter_config **)ofl_malloc(dm->stats_num * sizeof(struct ofl_meter_config *));
     
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_meter_config_unpack(conf, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(dm->stats, i,
                                    ofl_structs_free_meter_config);
-            free (dm);
+            ofl_free(dm);
             return error;
         }
         conf = (struct ofp_meter_config *)((uint8_t *)conf + ntohs(conf->length));
@@ -1325,21 +1340,21 @@ ofl_msg_unpack_multipart_reply_port_desc(struct ofp_multipart_reply *src, size_t
     ofl_err error;
 	size_t i;
 	port = (struct ofp_port* )src->body;
-	pd = (struct ofl_msg_multipart_reply_port_desc*) malloc(sizeof(struct ofl_msg_multipart_reply_port_desc));
+	pd = (struct ofl_msg_multipart_reply_port_desc*) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_port_desc));
     
 	error = ofl_utils_count_ofp_ports(port, *len, &pd->stats_num);
     if (error) {
-        free(pd);
+        ofl_free(pd);
         return error;
     }    
     	
-    pd->stats = (struct ofl_port**) malloc(pd->stats_num * sizeof(struct ofl_port));
+    pd->stats = (struct ofl_port**) ofl_malloc(pd->stats_num * sizeof(struct ofl_port));
 	for(i = 0; i < pd->stats_num; i++){
 		error = ofl_structs_port_unpack(port, len, &pd->stats[i]); 
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(pd->stats, i,
                                    ofl_structs_free_port);
-            free (pd);
+            ofl_free(pd);
             return error;
         }
         port = (struct ofp_port *)((uint8_t *)port + sizeof(struct ofp_port));		
@@ -1456,7 +1471,7 @@ ofl_msg_unpack_queue_get_config_request(struct ofp_header *src, size_t *len, str
     }
     *len -= sizeof(struct ofp_queue_get_config_request);
 
-    dr = (struct ofl_msg_queue_get_config_request *)malloc(sizeof(struct ofl_msg_queue_get_config_request));
+    dr = (struct ofl_msg_queue_get_config_request *)ofl_malloc(sizeof(struct ofl_msg_queue_get_config_request));
 
     dr->port = ntohl(sr->port);
 
@@ -1479,16 +1494,16 @@ ofl_msg_unpack_queue_get_config_reply(struct ofp_header *src, size_t *len, struc
     *len -= sizeof(struct ofp_queue_get_config_reply);
 
     sr = (struct ofp_queue_get_config_reply *)src;
-    dr = (struct ofl_msg_queue_get_config_reply *)malloc(sizeof(struct ofl_msg_queue_get_config_reply));
+    dr = (struct ofl_msg_queue_get_config_reply *)ofl_malloc(sizeof(struct ofl_msg_queue_get_config_reply));
 
     dr->port = ntohl(sr->port);
 
     error = ofl_utils_count_ofp_packet_queues(&(sr->queues), *len, &dr->queues_num);
     if (error) {
-        free(dr);
+        ofl_free(dr);
         return error;
     }
-    dr->queues = (struct ofl_packet_queue **)malloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
+    dr->queues = (struct ofl_packet_queue **)ofl_malloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
 
     queue = sr->queues;
     for (i = 0; i < dr->queues_num; i++) {
@@ -1496,7 +1511,7 @@ ofl_msg_unpack_queue_get_config_reply(struct ofp_header *src, size_t *len, struc
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(dr->queues, i,
                                    ofl_structs_free_packet_queue);
-            free (dr);
+            ofl_free(dr);
             return error;
         }
         queue = (struct ofp_packet_queue *)((uint8_t *)queue + ntohs(queue->len));
@@ -1512,17 +1527,16 @@ ofl_msg_unpack_empty(struct ofp_header *src UNUSED, size_t *len, struct ofl_msg_
     // ofp_header length was checked at ofl_msg_unpack
     *len -= sizeof(struct ofp_header);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_header));
+    *msg = (struct ofl_msg_header *)ofl_malloc(sizeof(struct ofl_msg_header));
     return 0;
 }
 
 
 ofl_err
-ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp) {
+ofl_msg_unpack_header(uint8_t *buf, size_t buf_len, uint32_t *xid) {
     struct ofp_header *oh;
-    size_t len = buf_len;
-    ofl_err error = 0;
-    if (len < sizeof(struct ofp_header)) {
+
+    if (buf_len < sizeof(struct ofp_header)) {
         OFL_LOG_WARN(LOG_MODULE, "Received message is shorter than ofp_header.");
         if (xid != NULL) {
             *xid = 0x00000000;
@@ -1541,11 +1555,32 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
         *xid = ntohl(oh->xid);
     }
 
-    if (len != ntohs(oh->length)) {
+    if (buf_len != ntohs(oh->length)) {
         OFL_LOG_WARN(LOG_MODULE, "Received message length does not match the length field.");
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
 
+    if ((oh->type == OFPT_MULTIPART_REQUEST
+         || oh->type == OFPT_MULTIPART_REPLY)
+        && buf_len < sizeof(struct ofp_multipart_reply)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received MULTIPART message has invalid length (%zu).", buf_len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    return 0;
+}
+
+ofl_err
+ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp) {
+    struct ofp_header *oh;
+    size_t len = buf_len;
+    ofl_err error;
+
+    error = ofl_msg_unpack_header(buf, buf_len, xid);
+    if (error) {
+        return error;
+    }
+    oh = (struct ofp_header *)buf;
+
     switch (oh->type) {
         case OFPT_HELLO:
             error = ofl_msg_unpack_empty(oh, &len, msg);
@@ -1683,3 +1718,24 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
 
     return 0;
 }
+
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_arena *arena) {
+    struct ofl_arena *old = ofl_arena_set_current(arena);
+    ofl_err error = ofl_msg_unpack(buf, buf_len, msg, xid, NULL);
+    ofl_arena_set_current(old);
+    return error;
+}
+
+ofl_err
+ofl_msg_unpack_borrowed(uint8_t *buf, size_t buf_len,
+                        struct ofl_msg_header **msg, uint32_t *xid,
+                        struct ofl_arena *arena) {
+    ofl_err error;
+
+    borrow_data = true;
+    error = ofl_msg_unpack_arena(buf, buf_len, msg, xid, arena);
+    borrow_data = false;
+    return error;
+}
@@ -40,6 +40,7 @@
 #include "ofl.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 
 
 /****************************************************************************
@@ -485,6 +486,66 @@ struct ofl_msg_queue_get_config_reply {
 int
 ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *buf_len, struct ofl_exp *exp);
 
+/* Packers for the messages a controller sends most often, which write the
+ * message, header included, straight into the buf_len bytes at buf instead
+ * of a newly allocated buffer, and allocate no memory.  Each returns the
+ * length of the message, or 0 without writing anything if it does not fit.
+ *
+ * The OFL_*_LEN macros give the length of each message as a constant
+ * expression of its variable parts, so that a buffer can be sized before
+ * anything is packed, or declared with a fixed size. */
+
+#define OFL_BARRIER_REQUEST_LEN sizeof(struct ofp_header)
+
+#define OFL_ECHO_LEN(DATA_LEN) (sizeof(struct ofp_header) + (DATA_LEN))
+
+/* A packet-out with one output action, carrying DATA_LEN bytes of frame. */
+#define OFL_PACKET_OUT_OUTPUT_LEN(DATA_LEN) \
+    (sizeof(struct ofp_packet_out) + sizeof(struct ofp_action_output) \
+     + (DATA_LEN))
+
+/* A flow-mod whose match has OXM_LEN bytes of OXM fields (the header.length
+ * of an ofl_match), with one apply-actions instruction holding one output
+ * action. */
+#define OFL_FLOW_MOD_OUTPUT_LEN(OXM_LEN) \
+    ((sizeof(struct ofp_flow_mod) - 4 + (OXM_LEN) + 7) / 8 * 8 \
+     + sizeof(struct ofp_instruction_actions) \
+     + sizeof(struct ofp_action_output))
+
+size_t
+ofl_msg_pack_barrier_request(uint32_t xid, uint8_t *buf, size_t buf_len);
+
+/* Packs an OFPT_ECHO_REQUEST or OFPT_ECHO_REPLY, according to type. */
+size_t
+ofl_msg_pack_echo_data(enum ofp_type type, uint32_t xid,
+                       const uint8_t *data, size_t data_len,
+                       uint8_t *buf, size_t buf_len);
+
+/* Packs a packet-out that outputs the packet in buffer_id, or if that is
+ * 0xffffffff the data_len bytes at data, to out_port. */
+size_t
+ofl_msg_pack_packet_out_output(uint32_t xid, uint32_t buffer_id,
+                               uint32_t in_port, uint32_t out_port,
+                               const uint8_t *data, size_t data_len,
+                               uint8_t *buf, size_t buf_len);
+
+/* Packs msg, which must have an OXM match, as if its only instruction were
+ * an apply-actions instruction with an output action to out_port with the
+ * given max_len.  The instructions in msg are ignored.  Whether the match's
+ * fields pack to its header.length bytes is only known once they are packed,
+ * so if they do not, this returns 0 after writing to buf. */
+size_t
+ofl_msg_pack_flow_mod_output(const struct ofl_msg_flow_mod *msg, uint32_t xid,
+                             uint32_t out_port, uint16_t max_len,
+                             uint8_t *buf, size_t buf_len);
+
+/* Returns true if the instructions of msg are exactly one apply-actions
+ * instruction holding one output action, which is stored in *output, so
+ * that ofl_msg_pack_flow_mod_output() can pack msg. */
+bool
+ofl_msg_flow_mod_is_output(const struct ofl_msg_flow_mod *msg,
+                           const struct ofl_action_output **output);
+
 /* Unpacks the wire format message in buf to a new OFLib message pointed at by
  * msg. If xid is not null, it will hold the transaction ID of the received
  * message. Returns zero on success. In case of experimenter features, the
@@ -493,6 +554,31 @@ ofl_err
 ofl_msg_unpack(uint8_t *buf, size_t buf_len,
                struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp);
 
+/* Checks the ofp_header of the wire format message in buf: its version, and
+ * that its length field matches buf_len.  For multipart messages, also checks
+ * that the multipart header is present.  If xid is not null, it will hold the
+ * transaction ID of the message.  Returns zero if the header is valid.  This
+ * is the part of ofl_msg_unpack() that does not decode the message body. */
+ofl_err
+ofl_msg_unpack_header(uint8_t *buf, size_t buf_len, uint32_t *xid);
+
+/* Like ofl_msg_unpack(), but allocates the whole message from arena, which
+ * the caller must reset or destroy to release it; the message must not be
+ * passed to ofl_msg_free().  If an error occurs, any memory used is released
+ * together with the rest of the arena.  Experimenter messages are not
+ * supported. */
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_arena *arena);
+
+/* Like ofl_msg_unpack_arena(), but the data carried by packet-in, packet-out,
+ * echo and error messages is not copied: the message's data pointer points
+ * into buf, which must outlive the message. */
+ofl_err
+ofl_msg_unpack_borrowed(uint8_t *buf, size_t buf_len,
+                        struct ofl_msg_header **msg, uint32_t *xid,
+                        struct ofl_arena *arena);
+
 
 
 
@@ -580,5 +666,13 @@ ofl_msg_to_string(struct ofl_msg_header *msg, struct ofl_exp *exp);
 void
 ofl_msg_print(FILE *stream, struct ofl_msg_header *msg, struct ofl_exp *exp);
 
+/* Prints the passed in message into 'fmt' (see ofl-print.h), without
+ * allocating memory, for logging messages on busy connections.  Lists in the
+ * message are cut to fmt->max_entries entries.  Experimenter features print
+ * as their id.  Group, meter, async and queue configuration replies print as
+ * their type only; ofl_msg_print() prints them in full. */
+void
+ofl_msg_format(struct ofl_fmt *fmt, const struct ofl_msg_header *msg);
+
 
 #endif /* OFL_MESSAGES_H */
@@ -28,6 +28,7 @@
  *
  */
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -52,18 +53,29 @@ ofl_port_to_string(uint32_t port) {
     return str;
 }
 
+const char *
+ofl_port_name(uint32_t port) {
+    switch (port) {
+        case (OFPP_IN_PORT): {    return "in_port"; }
+        case (OFPP_TABLE): {      return "table"; }
+        case (OFPP_NORMAL): {     return "normal"; }
+        case (OFPP_FLOOD): {      return "flood"; }
+        case (OFPP_ALL): {        return "all"; }
+        case (OFPP_CONTROLLER): { return "ctrl"; }
+        case (OFPP_LOCAL): {      return "local"; }
+        case (OFPP_ANY): {        return "any"; }
+        default: {                return NULL; }
+    }
+}
+
 void
 ofl_port_print(FILE *stream, uint32_t port) {
-    switch (port) {
-        case (OFPP_IN_PORT): {    fprintf(stream, "in_port"); return; }
-        case (OFPP_TABLE): {      fprintf(stream, "table"); return; }
-        case (OFPP_NORMAL): {     fprintf(stream, "normal"); return; }
-        case (OFPP_FLOOD): {      fprintf(stream, "flood"); return; }
-        case (OFPP_ALL): {        fprintf(stream, "all"); return; }
-        case (OFPP_CONTROLLER): { fprintf(stream, "ctrl"); return; }
-        case (OFPP_LOCAL): {      fprintf(stream, "local"); return; }
-        case (OFPP_ANY): {        fprintf(stream, "any"); return; }
-        default: {                fprintf(stream, "%u", port); return; }
+    const char *name = ofl_port_name(port);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "%u", port);
     }
 }
 
@@ -103,11 +115,22 @@ ofl_queue_to_string(uint32_t queue) {
     return str;
 }
 
+const char *
+ofl_queue_name(uint32_t queue) {
+    switch (queue) {
+        case (OFPQ_ALL): {        return "all"; }
+        default: {                return NULL; }
+    }
+}
+
 void
 ofl_queue_print(FILE *stream, uint32_t queue) {
-    switch (queue) {
-        case (OFPQ_ALL): {        fprintf(stream, "all"); return; }
-        default: {                fprintf(stream, "%u", queue); return; }
+    const char *name = ofl_queue_name(queue);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "%u", queue);
     }
 }
 
@@ -123,12 +146,23 @@ ofl_group_to_string(uint32_t group) {
     return str;
 }
 
+const char *
+ofl_group_name(uint32_t group) {
+    switch (group) {
+        case (OFPG_ALL): { return "all"; }
+        case (OFPG_ANY): { return "any"; }
+        default: {         return NULL; }
+    }
+}
+
 void
 ofl_group_print(FILE *stream, uint32_t group) {
-    switch (group) {
-        case (OFPG_ALL): { fprintf(stream, "all"); return; }
-        case (OFPG_ANY): { fprintf(stream, "any"); return; }
-        default: {         fprintf(stream, "%u", group); return; }
+    const char *name = ofl_group_name(group);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "%u", group);
     }
 }
 
@@ -145,11 +179,22 @@ ofl_table_to_string(uint8_t table) {
     return str;
 }
 
+const char *
+ofl_table_name(uint8_t table) {
+    switch (table) {
+        case (0xff): { return "all"; }
+        default: {     return NULL; }
+    }
+}
+
 void
 ofl_table_print(FILE *stream, uint8_t table) {
-    switch (table) {
-        case (0xff): { fprintf(stream, "all"); return; }
-        default: {     fprintf(stream, "%u", table); return; }
+    const char *name = ofl_table_name(table);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "%u", table);
     }
 }
 
@@ -188,27 +233,38 @@ ofl_action_type_to_string(uint16_t type) {
     return str;
 }
 
+const char *
+ofl_action_type_name(uint16_t type) {
+    switch (type) {
+        case OFPAT_OUTPUT: {   return "out"; }
+        case OFPAT_SET_FIELD: {   return "set_field"; }
+        case OFPAT_COPY_TTL_OUT: {   return "ttl_out"; }
+        case OFPAT_COPY_TTL_IN: {    return "ttl_in"; }
+        case OFPAT_SET_MPLS_TTL: {   return "mpls_ttl"; }
+        case OFPAT_DEC_MPLS_TTL: {   return "mpls_dec"; }
+        case OFPAT_PUSH_VLAN: {      return "vlan_psh"; }
+        case OFPAT_POP_VLAN: {       return "vlan_pop"; }
+        case OFPAT_PUSH_MPLS: {      return "mpls_psh"; }
+        case OFPAT_POP_MPLS: {       return "mpls_pop"; }
+        case OFPAT_SET_QUEUE: {      return "queue"; }
+        case OFPAT_GROUP: {          return "group"; }
+        case OFPAT_PUSH_PBB:  {      return "pbb_psh"; }
+        case OFPAT_POP_PBB:   {      return "pbb_pop"; }
+        case OFPAT_SET_NW_TTL: {     return "nw_ttl"; }
+        case OFPAT_DEC_NW_TTL: {     return "nw_dec"; }
+        case OFPAT_EXPERIMENTER: {   return "exp"; }
+        default: {                   return NULL; }
+    }
+}
+
 void
 ofl_action_type_print(FILE *stream, uint16_t type) {
-    switch (type) {
-        case OFPAT_OUTPUT: {   fprintf(stream, "out"); return; }
-        case OFPAT_SET_FIELD: {   fprintf(stream, "set_field"); return; }
-        case OFPAT_COPY_TTL_OUT: {   fprintf(stream, "ttl_out"); return; }
-        case OFPAT_COPY_TTL_IN: {    fprintf(stream, "ttl_in"); return; }
-        case OFPAT_SET_MPLS_TTL: {   fprintf(stream, "mpls_ttl"); return; }
-        case OFPAT_DEC_MPLS_TTL: {   fprintf(stream, "mpls_dec"); return; }
-        case OFPAT_PUSH_VLAN: {      fprintf(stream, "vlan_psh"); return; }
-        case OFPAT_POP_VLAN: {       fprintf(stream, "vlan_pop"); return; }
-        case OFPAT_PUSH_MPLS: {      fprintf(stream, "mpls_psh"); return; }
-        case OFPAT_POP_MPLS: {       fprintf(stream, "mpls_pop"); return; }
-        case OFPAT_SET_QUEUE: {      fprintf(stream, "queue"); return; }
-        case OFPAT_GROUP: {          fprintf(stream, "group"); return; }
-        case OFPAT_PUSH_PBB:  {      fprintf(stream, "pbb_psh"); return; }
-        case OFPAT_POP_PBB:   {      fprintf(stream, "pbb_pop"); return; }
-        case OFPAT_SET_NW_TTL: {     fprintf(stream, "nw_ttl"); return; }
-        case OFPAT_DEC_NW_TTL: {     fprintf(stream, "nw_dec"); return; }
-        case OFPAT_EXPERIMENTER: {   fprintf(stream, "exp"); return; }
-        default: {                   fprintf(stream, "?(%u)", type); return; }
+    const char *name = ofl_action_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", type);
     }
 }
 
@@ -223,55 +279,66 @@ ofl_oxm_type_to_string(uint16_t type) {
     return str;
 }
 
-void
-ofl_oxm_type_print(FILE *stream, uint32_t type){
+const char *
+ofl_oxm_type_name(uint32_t type) {
     switch(type){
-    case OXM_OF_IN_PORT:            {fprintf(stream, "in_port"); return; }
-    case OXM_OF_IN_PHY_PORT:        {fprintf(stream, "in_phy_port"); return; }
-    case OXM_OF_METADATA:           {fprintf(stream, "metadata"); return; }
-    case OXM_OF_ETH_DST:            {fprintf(stream, "eth_dst"); return; }
-    case OXM_OF_ETH_SRC:            {fprintf(stream, "eth_src"); return; }
-    case OXM_OF_ETH_TYPE:           {fprintf(stream, "eth_type"); return; }
-    case OXM_OF_VLAN_VID:           {fprintf(stream, "vlan_vid"); return; }
-    case OXM_OF_VLAN_PCP:           {fprintf(stream, "vlan_pcp"); return; }
-    case OXM_OF_IP_DSCP:            {fprintf(stream, "ip_dscp"); return; }
-    case OXM_OF_IP_ECN:             {fprintf(stream, "ip_ecn"); return; }
-    case OXM_OF_IP_PROTO:           {fprintf(stream, "ip_proto"); return; }
-    case OXM_OF_IPV4_SRC:           {fprintf(stream, "ipv4_src"); return; }
-    case OXM_OF_IPV4_DST:           {fprintf(stream, "ipv4_dst"); return; }
-    case OXM_OF_TCP_SRC:            {fprintf(stream, "tcp_src"); return; }
-    case OXM_OF_TCP_DST:            {fprintf(stream, "tcp_dst"); return; }
-    case OXM_OF_UDP_SRC:            {fprintf(stream, "udp_src"); return; }
-    case OXM_OF_UDP_DST:            {fprintf(stream, "udp_dst"); return; }
-    case OXM_OF_SCTP_SRC:           {fprintf(stream, "sctp_src"); return; }
-    case OXM_OF_SCTP_DST:           {fprintf(stream, "udp_dst"); return; }
-    case OXM_OF_ICMPV4_CODE:        {fprintf(stream, "icmpv4_code"); return; }
-    case OXM_OF_ICMPV4_TYPE:        {fprintf(stream, "icmpv4_type"); return; }
-    case OXM_OF_ARP_OP:             {fprintf(stream, "arp_op"); return; }
-    case OXM_OF_ARP_SPA:            {fprintf(stream, "arp_spa"); return; }
-    case OXM_OF_ARP_TPA:            {fprintf(stream, "arp_tpa"); return; }
-    case OXM_OF_ARP_SHA:            {fprintf(stream, "arp_sha"); return; }
-    case OXM_OF_ARP_THA:            {fprintf(stream, "arp_tha"); return; }
-    case OXM_OF_IPV6_SRC:           {fprintf(stream, "ipv6_src"); return; }
-    case OXM_OF_IPV6_DST:           {fprintf(stream, "ipv6_dst"); return; }
-    case OXM_OF_IPV6_FLABEL:        {fprintf(stream, "ipv6_flabel"); return; }
-    case OXM_OF_ICMPV6_TYPE:        {fprintf(stream, "icmpv6_type"); return; }
-    case OXM_OF_ICMPV6_CODE:        {fprintf(stream, "icmpv6_code"); return; }
-    case OXM_OF_IPV6_ND_TARGET:     {fprintf(stream, "ipv6_nd_target"); return; }
-    case OXM_OF_IPV6_ND_SLL:        {fprintf(stream, "ipv6_nd_sll"); return; }
-    case OXM_OF_IPV6_ND_TLL:        {fprintf(stream, "ipv6_nd_tll"); return; }
-    case OXM_OF_MPLS_LABEL:         {fprintf(stream, "mpls_label"); return; }
-    case OXM_OF_MPLS_TC:            {fprintf(stream, "mpls_tc"); return; }
-    case OXM_OF_MPLS_BOS:           {fprintf(stream, "mpls_bos"); return; }
-    case OXM_OF_PBB_ISID:           {fprintf(stream, "pbb_isid"); return; }
-    case OXM_OF_TUNNEL_ID:          {fprintf(stream, "tunnel_id"); return; }
-    case OXM_OF_IPV6_EXTHDR:        {fprintf(stream, "ipv6_exthdr"); return; }
-    default: {                       fprintf(stream, "?(%d)", type); return; }    
+    case OXM_OF_IN_PORT:            {return "in_port"; }
+    case OXM_OF_IN_PHY_PORT:        {return "in_phy_port"; }
+    case OXM_OF_METADATA:           {return "metadata"; }
+    case OXM_OF_ETH_DST:            {return "eth_dst"; }
+    case OXM_OF_ETH_SRC:            {return "eth_src"; }
+    case OXM_OF_ETH_TYPE:           {return "eth_type"; }
+    case OXM_OF_VLAN_VID:           {return "vlan_vid"; }
+    case OXM_OF_VLAN_PCP:           {return "vlan_pcp"; }
+    case OXM_OF_IP_DSCP:            {return "ip_dscp"; }
+    case OXM_OF_IP_ECN:             {return "ip_ecn"; }
+    case OXM_OF_IP_PROTO:           {return "ip_proto"; }
+    case OXM_OF_IPV4_SRC:           {return "ipv4_src"; }
+    case OXM_OF_IPV4_DST:           {return "ipv4_dst"; }
+    case OXM_OF_TCP_SRC:            {return "tcp_src"; }
+    case OXM_OF_TCP_DST:            {return "tcp_dst"; }
+    case OXM_OF_UDP_SRC:            {return "udp_src"; }
+    case OXM_OF_UDP_DST:            {return "udp_dst"; }
+    case OXM_OF_SCTP_SRC:           {return "sctp_src"; }
+    case OXM_OF_SCTP_DST:           {return "sctp_dst"; }
+    case OXM_OF_ICMPV4_CODE:        {return "icmpv4_code"; }
+    case OXM_OF_ICMPV4_TYPE:        {return "icmpv4_type"; }
+    case OXM_OF_ARP_OP:             {return "arp_op"; }
+    case OXM_OF_ARP_SPA:            {return "arp_spa"; }
+    case OXM_OF_ARP_TPA:            {return "arp_tpa"; }
+    case OXM_OF_ARP_SHA:            {return "arp_sha"; }
+    case OXM_OF_ARP_THA:            {return "arp_tha"; }
+    case OXM_OF_IPV6_SRC:           {return "ipv6_src"; }
+    case OXM_OF_IPV6_DST:           {return "ipv6_dst"; }
+    case OXM_OF_IPV6_FLABEL:        {return "ipv6_flabel"; }
+    case OXM_OF_ICMPV6_TYPE:        {return "icmpv6_type"; }
+    case OXM_OF_ICMPV6_CODE:        {return "icmpv6_code"; }
+    case OXM_OF_IPV6_ND_TARGET:     {return "ipv6_nd_target"; }
+    case OXM_OF_IPV6_ND_SLL:        {return "ipv6_nd_sll"; }
+    case OXM_OF_IPV6_ND_TLL:        {return "ipv6_nd_tll"; }
+    case OXM_OF_MPLS_LABEL:         {return "mpls_label"; }
+    case OXM_OF_MPLS_TC:            {return "mpls_tc"; }
+    case OXM_OF_MPLS_BOS:           {return "mpls_bos"; }
+    case OXM_OF_PBB_ISID:           {return "pbb_isid"; }
+    case OXM_OF_TUNNEL_ID:          {return "tunnel_id"; }
+    case OXM_OF_IPV6_EXTHDR:        {return "ipv6_exthdr"; }
+    default: {                       return NULL; }    
     }
 
 
 }
 
+void
+ofl_oxm_type_print(FILE *stream, uint32_t type) {
+    const char *name = ofl_oxm_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%d)", type);
+    }
+}
+
 char *
 ofl_instruction_type_to_string(uint16_t type) {
     char *str;
@@ -283,17 +350,28 @@ ofl_instruction_type_to_string(uint16_t type) {
     return str;
 }
 
+const char *
+ofl_instruction_type_name(uint16_t type) {
+    switch (type) {
+        case OFPIT_GOTO_TABLE: {    return "goto"; }
+        case OFPIT_WRITE_METADATA: { return "meta"; }
+        case OFPIT_WRITE_ACTIONS: {  return "write"; }
+        case OFPIT_APPLY_ACTIONS: {  return "apply"; }
+        case OFPIT_CLEAR_ACTIONS: {  return "clear"; }
+        case OFPIT_METER:         {  return "meter"; }
+        case OFPIT_EXPERIMENTER: {   return "exp"; }
+        default: {                   return NULL; }
+    }
+}
+
 void
 ofl_instruction_type_print(FILE *stream, uint16_t type) {
-    switch (type) {
-        case OFPIT_GOTO_TABLE: {    fprintf(stream, "goto"); return; }
-        case OFPIT_WRITE_METADATA: { fprintf(stream, "meta"); return; }
-        case OFPIT_WRITE_ACTIONS: {  fprintf(stream, "write"); return; }
-        case OFPIT_APPLY_ACTIONS: {  fprintf(stream, "apply"); return; }
-        case OFPIT_CLEAR_ACTIONS: {  fprintf(stream, "clear"); return; }
-        case OFPIT_METER:         {  fprintf(stream, "meter"); return; }
-        case OFPIT_EXPERIMENTER: {   fprintf(stream, "exp"); return; }
-        default: {                   fprintf(stream, "?(%u)", type); return; }
+    const char *name = ofl_instruction_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", type);
     }
 }
 
@@ -330,21 +408,32 @@ ofl_error_type_to_string(uint16_t type) {
     return str;
 }
 
+const char *
+ofl_error_type_name(uint16_t type) {
+    switch (type) {
+        case (OFPET_HELLO_FAILED): {         return "HELLO_FAILED"; }
+        case (OFPET_BAD_REQUEST): {          return "BAD_REQUEST"; }
+        case (OFPET_BAD_ACTION): {           return "BAD_ACTION"; }
+        case (OFPET_BAD_INSTRUCTION): {      return "BAD_INSTRUCTION"; }
+        case (OFPET_BAD_MATCH): {            return "BAD_MATCH"; }
+        case (OFPET_FLOW_MOD_FAILED): {      return "FLOW_MOD_FAILED"; }
+        case (OFPET_GROUP_MOD_FAILED): {     return "GROUP_MOD_FAILED"; }
+        case (OFPET_PORT_MOD_FAILED): {      return "PORT_MOD_FAILED"; }
+        case (OFPET_TABLE_MOD_FAILED): {     return "TABLE_MOD_FAILED"; }
+        case (OFPET_QUEUE_OP_FAILED): {      return "QUEUE_OP_FAILED"; }
+        case (OFPET_SWITCH_CONFIG_FAILED): { return "SWITCH_CONFIG_FAILED"; }
+        default: {                           return NULL; }
+    }
+}
+
 void
 ofl_error_type_print(FILE *stream, uint16_t type) {
-    switch (type) {
-        case (OFPET_HELLO_FAILED): {         fprintf(stream, "HELLO_FAILED"); return; }
-        case (OFPET_BAD_REQUEST): {          fprintf(stream, "BAD_REQUEST"); return; }
-        case (OFPET_BAD_ACTION): {           fprintf(stream, "BAD_ACTION"); return; }
-        case (OFPET_BAD_INSTRUCTION): {      fprintf(stream, "BAD_INSTRUCTION"); return; }
-        case (OFPET_BAD_MATCH): {            fprintf(stream, "BAD_MATCH"); return; }
-        case (OFPET_FLOW_MOD_FAILED): {      fprintf(stream, "FLOW_MOD_FAILED"); return; }
-        case (OFPET_GROUP_MOD_FAILED): {     fprintf(stream, "GROUP_MOD_FAILED"); return; }
-        case (OFPET_PORT_MOD_FAILED): {      fprintf(stream, "PORT_MOD_FAILED"); return; }
-        case (OFPET_TABLE_MOD_FAILED): {     fprintf(stream, "TABLE_MOD_FAILED"); return; }
-        case (OFPET_QUEUE_OP_FAILED): {      fprintf(stream, "QUEUE_OP_FAILED"); return; }
-        case (OFPET_SWITCH_CONFIG_FAILED): { fprintf(stream, "SWITCH_CONFIG_FAILED"); return; }
-        default: {                           fprintf(stream, "?(%u)", type); return; }
+    const char *name = ofl_error_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", type);
     }
 }
 
@@ -361,125 +450,136 @@ ofl_error_code_to_string(uint16_t type, uint16_t code) {
     return str;
 }
 
-void
-ofl_error_code_print(FILE *stream, uint16_t type, uint16_t code) {
+const char *
+ofl_error_code_name(uint16_t type, uint16_t code) {
     switch (type) {
         case (OFPET_HELLO_FAILED): {
             switch (code) {
-                case (OFPHFC_INCOMPATIBLE) : { fprintf(stream, "INCOMPATIBLE"); return; }
-                case (OFPHFC_EPERM) :        { fprintf(stream, "EPERM"); return; }
+                case (OFPHFC_INCOMPATIBLE) : { return "INCOMPATIBLE"; }
+                case (OFPHFC_EPERM) :        { return "EPERM"; }
             }
             break;
         }
         case (OFPET_BAD_REQUEST): {
             switch (code) {
-                case (OFPBRC_BAD_VERSION) :      { fprintf(stream, "BAD_VERSION"); return; }
-                case (OFPBRC_BAD_TYPE) :         { fprintf(stream, "BAD_TYPE"); return; }
-                case (OFPBRC_BAD_MULTIPART) :         { fprintf(stream, "BAD_STAT"); return; }
-                case (OFPBRC_BAD_EXPERIMENTER) : { fprintf(stream, "BAD_EXPERIMENTER"); return; }
-                case (OFPBRC_EPERM) :            { fprintf(stream, "EPERM"); return; }
-                case (OFPBRC_BAD_LEN) :          { fprintf(stream, "BAD_LEN"); return; }
-                case (OFPBRC_BUFFER_EMPTY) :     { fprintf(stream, "BUFFER_EMPTY"); return; }
-                case (OFPBRC_BUFFER_UNKNOWN) :   { fprintf(stream, "BUFFER_UNKNOWN"); return; }
-                case (OFPBRC_BAD_TABLE_ID) :     { fprintf(stream, "BAD_TABLE_ID"); return; }
+                case (OFPBRC_BAD_VERSION) :      { return "BAD_VERSION"; }
+                case (OFPBRC_BAD_TYPE) :         { return "BAD_TYPE"; }
+                case (OFPBRC_BAD_MULTIPART) :         { return "BAD_STAT"; }
+                case (OFPBRC_BAD_EXPERIMENTER) : { return "BAD_EXPERIMENTER"; }
+                case (OFPBRC_EPERM) :            { return "EPERM"; }
+                case (OFPBRC_BAD_LEN) :          { return "BAD_LEN"; }
+                case (OFPBRC_BUFFER_EMPTY) :     { return "BUFFER_EMPTY"; }
+                case (OFPBRC_BUFFER_UNKNOWN) :   { return "BUFFER_UNKNOWN"; }
+                case (OFPBRC_BAD_TABLE_ID) :     { return "BAD_TABLE_ID"; }
             }
             break;
         }
         case (OFPET_BAD_ACTION): {
             switch (code) {
-                case (OFPBAC_BAD_TYPE) :              { fprintf(stream, "BAD_TYPE"); return; }
-                case (OFPBAC_BAD_LEN) :               { fprintf(stream, "BAD_LEN"); return; }
-                case (OFPBAC_BAD_EXPERIMENTER) :      { fprintf(stream, "BAD_EXPERIMENTER"); return; }
-                case (OFPBAC_BAD_OUT_PORT) :          { fprintf(stream, "BAD_OUT_PORT"); return; }
-                case (OFPBAC_BAD_ARGUMENT) :          { fprintf(stream, "BAD_ARGUMENT"); return; }
-                case (OFPBAC_EPERM) :                 { fprintf(stream, "EPERM"); return; }
-                case (OFPBAC_TOO_MANY) :              { fprintf(stream, "TOO_MANY"); return; }
-                case (OFPBAC_BAD_QUEUE) :             { fprintf(stream, "BAD_QUEUE"); return; }
-                case (OFPBAC_BAD_OUT_GROUP) :         { fprintf(stream, "BAD_OUT_GROUP"); return; }
-                case (OFPBAC_UNSUPPORTED_ORDER) :     { fprintf(stream, "UNSUPPORTED_ORDER"); return; }
-                case (OFPBAC_BAD_TAG) :               { fprintf(stream, "BAD_TAG"); return; }
+                case (OFPBAC_BAD_TYPE) :              { return "BAD_TYPE"; }
+                case (OFPBAC_BAD_LEN) :               { return "BAD_LEN"; }
+                case (OFPBAC_BAD_EXPERIMENTER) :      { return "BAD_EXPERIMENTER"; }
+                case (OFPBAC_BAD_OUT_PORT) :          { return "BAD_OUT_PORT"; }
+                case (OFPBAC_BAD_ARGUMENT) :          { return "BAD_ARGUMENT"; }
+                case (OFPBAC_EPERM) :                 { return "EPERM"; }
+                case (OFPBAC_TOO_MANY) :              { return "TOO_MANY"; }
+                case (OFPBAC_BAD_QUEUE) :             { return "BAD_QUEUE"; }
+                case (OFPBAC_BAD_OUT_GROUP) :         { return "BAD_OUT_GROUP"; }
+                case (OFPBAC_UNSUPPORTED_ORDER) :     { return "UNSUPPORTED_ORDER"; }
+                case (OFPBAC_BAD_TAG) :               { return "BAD_TAG"; }
             }
             break;
         }
         case (OFPET_BAD_INSTRUCTION): {
             switch (code) {
-                case (OFPBIC_UNKNOWN_INST) :        { fprintf(stream, "UNKNOWN_INST"); return; }
-                case (OFPBIC_BAD_TABLE_ID) :        { fprintf(stream, "BAD_TABLE_ID"); return; }
-                case (OFPBIC_UNSUP_METADATA) :      { fprintf(stream, "UNSUP_METADATA"); return; }
-                case (OFPBIC_UNSUP_METADATA_MASK) : { fprintf(stream, "UNSUP_METADATA_MASK"); return; }
+                case (OFPBIC_UNKNOWN_INST) :        { return "UNKNOWN_INST"; }
+                case (OFPBIC_BAD_TABLE_ID) :        { return "BAD_TABLE_ID"; }
+                case (OFPBIC_UNSUP_METADATA) :      { return "UNSUP_METADATA"; }
+                case (OFPBIC_UNSUP_METADATA_MASK) : { return "UNSUP_METADATA_MASK"; }
             }
             break;
         }
         case (OFPET_BAD_MATCH): {
             switch (code) {
-                case (OFPBMC_BAD_TYPE) :         { fprintf(stream, "BAD_TYPE"); return; }
-                case (OFPBMC_BAD_LEN) :          { fprintf(stream, "BAD_LEN"); return; }
-                case (OFPBMC_BAD_TAG) :          { fprintf(stream, "BAD_TAG"); return; }
-                case (OFPBMC_BAD_DL_ADDR_MASK) : { fprintf(stream, "BAD_DL_ADDR_MASK"); return; }
-                case (OFPBMC_BAD_NW_ADDR_MASK) : { fprintf(stream, "BAD_NW_ADDR_MASK"); return; }
-                case (OFPBMC_BAD_WILDCARDS) :    { fprintf(stream, "BAD_WILDCARDS"); return; }
-                case (OFPBMC_BAD_FIELD) :        { fprintf(stream, "BAD_FIELD"); return; }
-                case (OFPBMC_BAD_VALUE) :        { fprintf(stream, "BAD_VALUE"); return; }
+                case (OFPBMC_BAD_TYPE) :         { return "BAD_TYPE"; }
+                case (OFPBMC_BAD_LEN) :          { return "BAD_LEN"; }
+                case (OFPBMC_BAD_TAG) :          { return "BAD_TAG"; }
+                case (OFPBMC_BAD_DL_ADDR_MASK) : { return "BAD_DL_ADDR_MASK"; }
+                case (OFPBMC_BAD_NW_ADDR_MASK) : { return "BAD_NW_ADDR_MASK"; }
+                case (OFPBMC_BAD_WILDCARDS) :    { return "BAD_WILDCARDS"; }
+                case (OFPBMC_BAD_FIELD) :        { return "BAD_FIELD"; }
+                case (OFPBMC_BAD_VALUE) :        { return "BAD_VALUE"; }
             }
             break;
         }
         case (OFPET_FLOW_MOD_FAILED): {
             switch (code) {
-                case (OFPFMFC_UNKNOWN) :      { fprintf(stream, "UNKNOWN"); return; }
-                case (OFPFMFC_TABLE_FULL) :   { fprintf(stream, "TABLE_FULL"); return; }
-                case (OFPFMFC_BAD_TABLE_ID) : { fprintf(stream, "BAD_TABLE_ID"); return; }
-                case (OFPFMFC_OVERLAP) :      { fprintf(stream, "OVERLAP"); return; }
-                case (OFPFMFC_EPERM) :        { fprintf(stream, "EPERM"); return; }
-                case (OFPFMFC_BAD_TIMEOUT) :  { fprintf(stream, "BAD_TIMEOUT"); return; }
-                case (OFPFMFC_BAD_COMMAND) :  { fprintf(stream, "BAD_COMMAND"); return; }
+                case (OFPFMFC_UNKNOWN) :      { return "UNKNOWN"; }
+                case (OFPFMFC_TABLE_FULL) :   { return "TABLE_FULL"; }
+                case (OFPFMFC_BAD_TABLE_ID) : { return "BAD_TABLE_ID"; }
+                case (OFPFMFC_OVERLAP) :      { return "OVERLAP"; }
+                case (OFPFMFC_EPERM) :        { return "EPERM"; }
+                case (OFPFMFC_BAD_TIMEOUT) :  { return "BAD_TIMEOUT"; }
+                case (OFPFMFC_BAD_COMMAND) :  { return "BAD_COMMAND"; }
             }
             break;
         }
         case (OFPET_GROUP_MOD_FAILED): {
             switch (code) {
-                case (OFPGMFC_GROUP_EXISTS) :         { fprintf(stream, "GROUP_EXISTS"); return; }
-                case (OFPGMFC_INVALID_GROUP) :        { fprintf(stream, "INVALID_GROUP"); return; }
-                case (OFPGMFC_OUT_OF_BUCKETS) :       { fprintf(stream, "OUT_OF_BUCKETS"); return; }
-                case (OFPGMFC_CHAINING_UNSUPPORTED) : { fprintf(stream, "CHAINING_UNSUPPORTED"); return; }
-                case (OFPGMFC_WATCH_UNSUPPORTED) :    { fprintf(stream, "UNSUPPORTED"); return; }
-                case (OFPGMFC_LOOP) :                 { fprintf(stream, "LOOP"); return; }
-                case (OFPGMFC_UNKNOWN_GROUP) :        { fprintf(stream, "UNKNOWN_GROUP"); return; }
+                case (OFPGMFC_GROUP_EXISTS) :         { return "GROUP_EXISTS"; }
+                case (OFPGMFC_INVALID_GROUP) :        { return "INVALID_GROUP"; }
+                case (OFPGMFC_OUT_OF_BUCKETS) :       { return "OUT_OF_BUCKETS"; }
+                case (OFPGMFC_CHAINING_UNSUPPORTED) : { return "CHAINING_UNSUPPORTED"; }
+                case (OFPGMFC_WATCH_UNSUPPORTED) :    { return "UNSUPPORTED"; }
+                case (OFPGMFC_LOOP) :                 { return "LOOP"; }
+                case (OFPGMFC_UNKNOWN_GROUP) :        { return "UNKNOWN_GROUP"; }
             }
             break;
         }
         case (OFPET_PORT_MOD_FAILED): {
             switch (code) {
-                case (OFPPMFC_BAD_PORT) :      { fprintf(stream, "BAD_PORT"); return; }
-                case (OFPPMFC_BAD_HW_ADDR) :   { fprintf(stream, "BAD_HW_ADDR"); return; }
-                case (OFPPMFC_BAD_CONFIG) :    { fprintf(stream, "BAD_CONFIG"); return; }
-                case (OFPPMFC_BAD_ADVERTISE) : { fprintf(stream, "BAD_ADVERTISE"); return; }
+                case (OFPPMFC_BAD_PORT) :      { return "BAD_PORT"; }
+                case (OFPPMFC_BAD_HW_ADDR) :   { return "BAD_HW_ADDR"; }
+                case (OFPPMFC_BAD_CONFIG) :    { return "BAD_CONFIG"; }
+                case (OFPPMFC_BAD_ADVERTISE) : { return "BAD_ADVERTISE"; }
             }
             break;
         }
         case (OFPET_TABLE_MOD_FAILED): {
             switch (code) {
-                case (OFPTMFC_BAD_TABLE) :     { fprintf(stream, "BAD_TABLE"); return; }
-                case (OFPTMFC_BAD_CONFIG) :    { fprintf(stream, "BAD_CONFIG"); return; }
+                case (OFPTMFC_BAD_TABLE) :     { return "BAD_TABLE"; }
+                case (OFPTMFC_BAD_CONFIG) :    { return "BAD_CONFIG"; }
             }
             break;
         }
         case (OFPET_QUEUE_OP_FAILED): {
             switch (code) {
-                case (OFPQOFC_BAD_PORT) :  { fprintf(stream, "BAD_PORT"); return; }
-                case (OFPQOFC_BAD_QUEUE) : { fprintf(stream, "BAD_QUEUE"); return; }
-                case (OFPQOFC_EPERM) :     { fprintf(stream, "EPERM"); return; }
+                case (OFPQOFC_BAD_PORT) :  { return "BAD_PORT"; }
+                case (OFPQOFC_BAD_QUEUE) : { return "BAD_QUEUE"; }
+                case (OFPQOFC_EPERM) :     { return "EPERM"; }
             }
             break;
         }
         case (OFPET_SWITCH_CONFIG_FAILED): {
             switch (code) {
-                case (OFPSCFC_BAD_FLAGS) : { fprintf(stream, "BAD_FLAGS"); return; }
-                case (OFPSCFC_BAD_LEN) :   { fprintf(stream, "BAD_LEN"); return; }
+                case (OFPSCFC_BAD_FLAGS) : { return "BAD_FLAGS"; }
+                case (OFPSCFC_BAD_LEN) :   { return "BAD_LEN"; }
             }
             break;
         }
     }
-    fprintf(stream, "?(%u)", type);
+    return NULL;
+}
+
+void
+ofl_error_code_print(FILE *stream, uint16_t type, uint16_t code) {
+    const char *name = ofl_error_code_name(type, code);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", code);
+    }
 }
 
 
@@ -495,38 +595,49 @@ ofl_message_type_to_string(uint16_t type) {
     return str;
 }
 
+const char *
+ofl_message_type_name(uint16_t type) {
+    switch (type) {
+        case OFPT_HELLO: {                    return "hello"; }
+        case OFPT_ERROR: {                    return "error"; }
+        case OFPT_ECHO_REQUEST: {             return "echo_req"; }
+        case OFPT_ECHO_REPLY: {               return "echo_repl"; }
+        case OFPT_EXPERIMENTER: {             return "exp"; }
+        case OFPT_FEATURES_REQUEST: {         return "feat_req"; }
+        case OFPT_FEATURES_REPLY: {           return "feat_repl"; }
+        case OFPT_GET_CONFIG_REQUEST: {       return "conf_req"; }
+        case OFPT_GET_CONFIG_REPLY: {         return "conf_repl"; }
+        case OFPT_SET_CONFIG: {               return "set_conf"; }
+        case OFPT_PACKET_IN: {                return "pkt_in"; }
+        case OFPT_FLOW_REMOVED: {             return "flow_rem"; }
+        case OFPT_PORT_STATUS: {              return "port_stat"; }
+        case OFPT_PACKET_OUT: {               return "pkt_out"; }
+        case OFPT_FLOW_MOD: {                 return "flow_mod"; }
+        case OFPT_GROUP_MOD: {                return "grp_mod"; }
+        case OFPT_PORT_MOD: {                 return "port_mod"; }
+        case OFPT_TABLE_MOD: {                return "tab_mod"; }
+        case OFPT_MULTIPART_REQUEST: {            return "stat_req"; }
+        case OFPT_MULTIPART_REPLY: {              return "stat_repl"; }
+        case OFPT_BARRIER_REQUEST: {          return "barr_req"; }
+        case OFPT_BARRIER_REPLY: {            return "barr_repl"; }
+        case OFPT_QUEUE_GET_CONFIG_REQUEST: { return "q_cnf_req"; }
+        case OFPT_QUEUE_GET_CONFIG_REPLY:   { return "q_cnf_repl"; }
+		case OFPT_GET_ASYNC_REQUEST:        { return "get_async_req"; }
+		case OFPT_GET_ASYNC_REPLY:          { return "get_async_rep"; }
+		case OFPT_SET_ASYNC:                { return "set_async"; }
+		case OFPT_METER_MOD:				{ return "meter_mod"; }        
+		default: {                            return NULL; }
+    }
+}
+
 void
 ofl_message_type_print(FILE *stream, uint16_t type) {
-    switch (type) {
-        case OFPT_HELLO: {                    fprintf(stream, "hello"); return; }
-        case OFPT_ERROR: {                    fprintf(stream, "error"); return; }
-        case OFPT_ECHO_REQUEST: {             fprintf(stream, "echo_req"); return; }
-        case OFPT_ECHO_REPLY: {               fprintf(stream, "echo_repl"); return; }
-        case OFPT_EXPERIMENTER: {             fprintf(stream, "exp"); return; }
-        case OFPT_FEATURES_REQUEST: {         fprintf(stream, "feat_req"); return; }
-        case OFPT_FEATURES_REPLY: {           fprintf(stream, "feat_repl"); return; }
-        case OFPT_GET_CONFIG_REQUEST: {       fprintf(stream, "conf_req"); return; }
-        case OFPT_GET_CONFIG_REPLY: {         fprintf(stream, "conf_repl"); return; }
-        case OFPT_SET_CONFIG: {               fprintf(stream, "set_conf"); return; }
-        case OFPT_PACKET_IN: {                fprintf(stream, "pkt_in"); return; }
-        case OFPT_FLOW_REMOVED: {             fprintf(stream, "flow_rem"); return; }
-        case OFPT_PORT_STATUS: {              fprintf(stream, "port_stat"); return; }
-        case OFPT_PACKET_OUT: {               fprintf(stream, "pkt_out"); return; }
-        case OFPT_FLOW_MOD: {                 fprintf(stream, "flow_mod"); return; }
-        case OFPT_GROUP_MOD: {                fprintf(stream, "grp_mod"); return; }
-        case OFPT_PORT_MOD: {                 fprintf(stream, "port_mod"); return; }
-        case OFPT_TABLE_MOD: {                fprintf(stream, "tab_mod"); return; }
-        case OFPT_MULTIPART_REQUEST: {            fprintf(stream, "stat_req"); return; }
-        case OFPT_MULTIPART_REPLY: {              fprintf(stream, "stat_repl"); return; }
-        case OFPT_BARRIER_REQUEST: {          fprintf(stream, "barr_req"); return; }
-        case OFPT_BARRIER_REPLY: {            fprintf(stream, "barr_repl"); return; }
-        case OFPT_QUEUE_GET_CONFIG_REQUEST: { fprintf(stream, "q_cnf_req"); return; }
-        case OFPT_QUEUE_GET_CONFIG_REPLY:   { fprintf(stream, "q_cnf_repl"); return; }
-		case OFPT_GET_ASYNC_REQUEST:        { fprintf(stream, "get_async_req"); return;}
-		case OFPT_GET_ASYNC_REPLY:          { fprintf(stream, "get_async_rep"); return;}
-		case OFPT_SET_ASYNC:                { fprintf(stream, "set_async"); return;}
-		case OFPT_METER_MOD:				{ fprintf(stream, "meter_mod"); return;}        
-		default: {                            fprintf(stream, "?(%u)", type); return; }
+    const char *name = ofl_message_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", type);
     }
 }
 
@@ -543,11 +654,22 @@ ofl_buffer_to_string(uint32_t buffer) {
     return str;
 }
 
+const char *
+ofl_buffer_name(uint32_t buffer) {
+    switch (buffer) {
+        case (0xffffffff): { return "none"; }
+        default: {           return NULL; }
+    }
+}
+
 void
 ofl_buffer_print(FILE *stream, uint32_t buffer) {
-    switch (buffer) {
-        case (0xffffffff): { fprintf(stream, "none"); return; }
-        default: {           fprintf(stream, "%u", buffer); return; }
+    const char *name = ofl_buffer_name(buffer);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "%u", buffer);
     }
 }
 
@@ -564,12 +686,23 @@ ofl_packet_in_reason_to_string(uint8_t reason) {
     return str;
 }
 
+const char *
+ofl_packet_in_reason_name(uint8_t reason) {
+    switch (reason) {
+        case (OFPR_NO_MATCH): { return "no_match"; }
+        case (OFPR_ACTION): {   return "action"; }
+        default: {              return NULL; }
+    }
+}
+
 void
 ofl_packet_in_reason_print(FILE *stream, uint8_t reason) {
-    switch (reason) {
-        case (OFPR_NO_MATCH): { fprintf(stream, "no_match"); return; }
-        case (OFPR_ACTION): {   fprintf(stream, "action"); return; }
-        default: {              fprintf(stream, "?(%u)", reason); return; }
+    const char *name = ofl_packet_in_reason_name(reason);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", reason);
     }
 }
 
@@ -586,15 +719,26 @@ ofl_flow_removed_reason_to_string(uint8_t reason) {
     return str;
 }
 
+const char *
+ofl_flow_removed_reason_name(uint8_t reason) {
+    switch(reason) {
+        case (OFPRR_IDLE_TIMEOUT): { return "idle"; }
+        case (OFPRR_HARD_TIMEOUT): { return "hard"; }
+        case (OFPRR_DELETE):       { return "del"; }
+        case (OFPRR_GROUP_DELETE): { return "group"; }
+        case (OFPRR_METER_DELETE): { return "meter"; }        
+        default:                   { return NULL; }
+    }
+}
+
 void
 ofl_flow_removed_reason_print(FILE *stream, uint8_t reason) {
-    switch(reason) {
-        case (OFPRR_IDLE_TIMEOUT): { fprintf(stream, "idle"); return; }
-        case (OFPRR_HARD_TIMEOUT): { fprintf(stream, "hard"); return; }
-        case (OFPRR_DELETE):       { fprintf(stream, "del"); return; }
-        case (OFPRR_GROUP_DELETE): { fprintf(stream, "group"); return; }
-        case (OFPRR_METER_DELETE): { fprintf(stream, "meter"); return; }        
-        default:                   { fprintf(stream, "?(%u)", reason); return; }
+    const char *name = ofl_flow_removed_reason_name(reason);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", reason);
     }
 }
 
@@ -611,13 +755,24 @@ ofl_port_status_reason_to_string(uint8_t reason) {
     return str;
 }
 
+const char *
+ofl_port_status_reason_name(uint8_t reason) {
+    switch (reason) {
+        case (OFPPR_ADD):  {   return "add"; }
+        case (OFPPR_DELETE): { return "del"; }
+        case (OFPPR_MODIFY): { return "mod"; }
+        default: {             return NULL; }
+    }
+}
+
 void
 ofl_port_status_reason_print(FILE *stream, uint8_t reason) {
-    switch (reason) {
-        case (OFPPR_ADD):  {   fprintf(stream, "add"); return; }
-        case (OFPPR_DELETE): { fprintf(stream, "del"); return; }
-        case (OFPPR_MODIFY): { fprintf(stream, "mod"); return; }
-        default: {             fprintf(stream, "?(%u)", reason); return; }
+    const char *name = ofl_port_status_reason_name(reason);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", reason);
     }
 }
 
@@ -634,15 +789,26 @@ ofl_flow_mod_command_to_string(uint8_t command) {
     return str;
 }
 
+const char *
+ofl_flow_mod_command_name(uint8_t command) {
+    switch (command) {
+        case (OFPFC_ADD):  {           return "add"; }
+        case (OFPFC_MODIFY):  {        return "mod"; }
+        case (OFPFC_MODIFY_STRICT):  { return "mods"; }
+        case (OFPFC_DELETE):       {   return "del"; }
+        case (OFPFC_DELETE_STRICT):  { return "dels"; }
+        default:  {                    return NULL; }
+    }
+}
+
 void
 ofl_flow_mod_command_print(FILE *stream, uint8_t command) {
-    switch (command) {
-        case (OFPFC_ADD):  {           fprintf(stream, "add"); return; }
-        case (OFPFC_MODIFY):  {        fprintf(stream, "mod"); return; }
-        case (OFPFC_MODIFY_STRICT):  { fprintf(stream, "mods"); return; }
-        case (OFPFC_DELETE):       {   fprintf(stream, "del"); return; }
-        case (OFPFC_DELETE_STRICT):  { fprintf(stream, "dels"); return; }
-        default:  {                    fprintf(stream, "?(%u)", command); return; }
+    const char *name = ofl_flow_mod_command_name(command);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", command);
     }
 }
 
@@ -744,24 +910,35 @@ ofl_stats_type_to_string(uint16_t type) {
     return str;
 }
 
+const char *
+ofl_stats_type_name(uint16_t type) {
+    switch (type) {
+        case (OFPMP_DESC):          { return "desc"; }
+        case (OFPMP_FLOW):          { return "flow"; }
+        case (OFPMP_AGGREGATE):     { return "aggr"; }
+        case (OFPMP_TABLE):         { return "table"; }
+        case (OFPMP_TABLE_FEATURES):{ return "table-features"; }
+        case (OFPMP_PORT_STATS):    { return "port"; }
+        case (OFPMP_QUEUE):         { return "queue"; }
+        case (OFPMP_GROUP):         { return "grp"; }
+        case (OFPMP_GROUP_DESC):    { return "gdesc"; }
+        case (OFPMP_METER):         { return "mstats"; }
+        case (OFPMP_METER_CONFIG):  { return "mconf"; }
+        case (OFPMP_METER_FEATURES):{ return "mfeat"; }
+        case (OFPMP_PORT_DESC):     { return "port-desc"; }   
+        case (OFPMP_EXPERIMENTER):  { return "exp"; }
+        default: {                    return NULL; }
+    }
+}
+
 void
 ofl_stats_type_print(FILE *stream, uint16_t type) {
-    switch (type) {
-        case (OFPMP_DESC):          { fprintf(stream, "desc"); return; }
-        case (OFPMP_FLOW):          { fprintf(stream, "flow"); return; }
-        case (OFPMP_AGGREGATE):     { fprintf(stream, "aggr"); return; }
-        case (OFPMP_TABLE):         { fprintf(stream, "table"); return; }
-        case (OFPMP_TABLE_FEATURES):{ fprintf(stream, "table-features"); return; }
-        case (OFPMP_PORT_STATS):    { fprintf(stream, "port"); return; }
-        case (OFPMP_QUEUE):         { fprintf(stream, "queue"); return; }
-        case (OFPMP_GROUP):         { fprintf(stream, "grp"); return; }
-        case (OFPMP_GROUP_DESC):    { fprintf(stream, "gdesc"); return; }
-        case (OFPMP_METER):         { fprintf(stream, "mstats"); return; }
-        case (OFPMP_METER_CONFIG):  { fprintf(stream, "mconf"); return; }
-        case (OFPMP_METER_FEATURES):{ fprintf(stream, "mfeat"); return; }
-        case (OFPMP_PORT_DESC):     { fprintf(stream, "port-desc"); return; }   
-        case (OFPMP_EXPERIMENTER):  { fprintf(stream, "exp"); return; }
-        default: {                    fprintf(stream, "?(%u)", type); return; }
+    const char *name = ofl_stats_type_name(type);
+
+    if (name != NULL) {
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "?(%u)", type);
     }
 }
 
@@ -909,3 +1086,166 @@ ofl_hex_print(FILE *stream, uint8_t *buf, size_t buf_size) {
         }
     }
 }
+
+
+
+void
+ofl_fmt_init(struct ofl_fmt *fmt, char *buf, size_t size, size_t max_entries) {
+    fmt->buf = buf;
+    fmt->size = size;
+    fmt->max_entries = max_entries;
+    ofl_fmt_clear(fmt);
+}
+
+void
+ofl_fmt_clear(struct ofl_fmt *fmt) {
+    fmt->len = 0;
+    fmt->truncated = fmt->size == 0;
+    if (fmt->size > 0) {
+        fmt->buf[0] = '\0';
+    }
+}
+
+const char *
+ofl_fmt_finish(struct ofl_fmt *fmt) {
+    if (fmt->size == 0) {
+        return "";
+    }
+    if (fmt->truncated && fmt->size > 3) {
+        memcpy(fmt->buf + fmt->size - 4, "...", 4);
+    }
+    return fmt->buf;
+}
+
+/* Notes that the text no longer fits, keeping as much of it as does. */
+static void
+fmt_overflow(struct ofl_fmt *fmt) {
+    fmt->truncated = true;
+    fmt->len = fmt->size - 1;
+    fmt->buf[fmt->len] = '\0';
+}
+
+static void
+fmt_append(struct ofl_fmt *fmt, const char *s, size_t n) {
+    if (fmt->truncated) {
+        return;
+    }
+    if (n >= fmt->size - fmt->len) {
+        memcpy(fmt->buf + fmt->len, s, fmt->size - fmt->len - 1);
+        fmt_overflow(fmt);
+        return;
+    }
+    memcpy(fmt->buf + fmt->len, s, n);
+    fmt->len += n;
+    fmt->buf[fmt->len] = '\0';
+}
+
+void
+ofl_fmt_str(struct ofl_fmt *fmt, const char *s) {
+    fmt_append(fmt, s, strlen(s));
+}
+
+void
+ofl_fmt_uint(struct ofl_fmt *fmt, uint64_t value) {
+    char digits[20];
+    char *p = digits + sizeof digits;
+
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    fmt_append(fmt, p, digits + sizeof digits - p);
+}
+
+void
+ofl_fmt_hex(struct ofl_fmt *fmt, uint64_t value) {
+    static const char hex_digits[] = "0123456789abcdef";
+    char digits[18];
+    char *p = digits + sizeof digits;
+
+    do {
+        *--p = hex_digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    *--p = 'x';
+    *--p = '0';
+    fmt_append(fmt, p, digits + sizeof digits - p);
+}
+
+void
+ofl_fmt_uint_field(struct ofl_fmt *fmt, const char *name, uint64_t value) {
+    ofl_fmt_str(fmt, name);
+    fmt_append(fmt, "\"", 1);
+    ofl_fmt_uint(fmt, value);
+    fmt_append(fmt, "\"", 1);
+}
+
+void
+ofl_fmt_hex_field(struct ofl_fmt *fmt, const char *name, uint64_t value) {
+    ofl_fmt_str(fmt, name);
+    fmt_append(fmt, "\"", 1);
+    ofl_fmt_hex(fmt, value);
+    fmt_append(fmt, "\"", 1);
+}
+
+void
+ofl_fmt_printf(struct ofl_fmt *fmt, const char *format, ...) {
+    size_t avail = fmt->size - fmt->len;
+    va_list args;
+    int n;
+
+    if (fmt->truncated) {
+        return;
+    }
+    va_start(args, format);
+    n = vsnprintf(fmt->buf + fmt->len, avail, format, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= avail) {
+        fmt_overflow(fmt);
+    } else {
+        fmt->len += n;
+    }
+}
+
+void
+ofl_fmt_id(struct ofl_fmt *fmt, const char *name, uint32_t value) {
+    if (name != NULL) {
+        ofl_fmt_str(fmt, name);
+    } else {
+        ofl_fmt_uint(fmt, value);
+    }
+}
+
+void
+ofl_fmt_enum(struct ofl_fmt *fmt, const char *name, uint32_t value) {
+    if (name != NULL) {
+        ofl_fmt_str(fmt, name);
+    } else {
+        ofl_fmt_printf(fmt, "?(%"PRIu32")", value);
+    }
+}
+
+bool
+ofl_fmt_entry(struct ofl_fmt *fmt, size_t i, size_t n) {
+    if (fmt->truncated) {
+        return false;
+    }
+    if (fmt->max_entries != 0 && i == fmt->max_entries) {
+        ofl_fmt_printf(fmt, ", ... %zu more", n - i);
+        return false;
+    }
+    if (i > 0) {
+        ofl_fmt_str(fmt, ", ");
+    }
+    return true;
+}
+
+const char *
+ofl_id_to_buf(const char *name, uint32_t value, char buf[OFL_ID_BUF_LEN]) {
+    if (name != NULL) {
+        return name;
+    }
+    snprintf(buf, OFL_ID_BUF_LEN, "%"PRIu32, value);
+    return buf;
+}
@@ -34,9 +34,11 @@
 
 #include <sys/types.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "ofl.h"
+#include "../libopenflow/compiler.h"
 #include "ofl-print.h"
 
 
@@ -44,6 +46,12 @@
  * Functions for printing enum values
  ****************************************************************************/
 
+/* The ofl_*_name() functions return the name of a known value, or NULL for
+ * values without one, which the print functions print as numbers. */
+
+const char *
+ofl_port_name(uint32_t port);
+
 char *
 ofl_port_to_string(uint32_t port);
 
@@ -56,18 +64,27 @@ ofl_ipv6_ext_hdr_to_string(uint16_t ext_hdr);
 void
 ofl_ipv6_ext_hdr_print(FILE *stream, uint16_t ext_hdr);
 
+const char *
+ofl_queue_name(uint32_t queue);
+
 char *
 ofl_queue_to_string(uint32_t queue);
 
 void
 ofl_queue_print(FILE *stream, uint32_t queue);
 
+const char *
+ofl_group_name(uint32_t group);
+
 char *
 ofl_group_to_string(uint32_t group);
 
 void
 ofl_group_print(FILE *stream, uint32_t group);
 
+const char *
+ofl_table_name(uint8_t table);
+
 char *
 ofl_table_to_string(uint8_t table);
 
@@ -80,18 +97,27 @@ ofl_vlan_vid_to_string(uint32_t vid);
 void
 ofl_vlan_vid_print(FILE *stream, uint32_t vid);
 
+const char *
+ofl_action_type_name(uint16_t type);
+
 char *
 ofl_action_type_to_string(uint16_t type);
 
 void
 ofl_action_type_print(FILE *stream, uint16_t type);
 
+const char *
+ofl_oxm_type_name(uint32_t type);
+
 char *
 ofl_oxm_type_to_string(uint16_t type);
 
 void
 ofl_oxm_type_print(FILE *stream, uint32_t type);
 
+const char *
+ofl_instruction_type_name(uint16_t type);
+
 char *
 ofl_instruction_type_to_string(uint16_t type);
 
@@ -104,48 +130,72 @@ ofl_queue_prop_type_to_string(uint16_t type);
 void
 ofl_queue_prop_type_print(FILE *stream, uint16_t type);
 
+const char *
+ofl_error_type_name(uint16_t type);
+
 char *
 ofl_error_type_to_string(uint16_t type);
 
 void
 ofl_error_type_print(FILE *stream, uint16_t type);
 
+const char *
+ofl_error_code_name(uint16_t type, uint16_t code);
+
 char *
 ofl_error_code_to_string(uint16_t type, uint16_t code);
 
 void
 ofl_error_code_print(FILE *stream, uint16_t type, uint16_t code);
 
+const char *
+ofl_message_type_name(uint16_t type);
+
 char *
 ofl_message_type_to_string(uint16_t type);
 
 void
 ofl_message_type_print(FILE *stream, uint16_t type);
 
+const char *
+ofl_buffer_name(uint32_t buffer);
+
 char *
 ofl_buffer_to_string(uint32_t buffer);
 
 void
 ofl_buffer_print(FILE *stream, uint32_t buffer);
 
+const char *
+ofl_packet_in_reason_name(uint8_t reason);
+
 char *
 ofl_packet_in_reason_to_string(uint8_t reason);
 
 void
 ofl_packet_in_reason_print(FILE *stream, uint8_t reason);
 
+const char *
+ofl_flow_removed_reason_name(uint8_t reason);
+
 char *
 ofl_flow_removed_reason_to_string(uint8_t reason);
 
 void
 ofl_flow_removed_reason_print(FILE *stream, uint8_t reason);
 
+const char *
+ofl_port_status_reason_name(uint8_t reason);
+
 char *
 ofl_port_status_reason_to_string(uint8_t reason);
 
 void
 ofl_port_status_reason_print(FILE *stream, uint8_t reason);
 
+const char *
+ofl_flow_mod_command_name(uint8_t command);
+
 char *
 ofl_flow_mod_command_to_string(uint8_t command);
 
@@ -176,6 +226,9 @@ ofl_group_type_to_string(uint8_t type);
 void
 ofl_group_type_print(FILE *stream, uint8_t type);
 
+const char *
+ofl_stats_type_name(uint16_t type);
+
 char *
 ofl_stats_type_to_string(uint16_t type);
 
@@ -200,4 +253,79 @@ ofl_hex_to_string(uint8_t *buf, size_t buf_size);
 void
 ofl_hex_print(FILE *stream, uint8_t *buf, size_t buf_size);
 
+/****************************************************************************
+ * Functions for printing into a fixed buffer
+ ****************************************************************************/
+
+/* Text built in a caller supplied buffer, for printing messages on paths where
+ * open_memstream() and the temporaries of the *_to_string() functions would
+ * cost more than the work being logged.  Nothing is allocated: text that does
+ * not fit is dropped and 'truncated' is set.  Lists print at most
+ * 'max_entries' entries and then the number left out, so that tracing a large
+ * multipart reply costs no more than tracing a small one. */
+struct ofl_fmt {
+    char *buf;
+    size_t size;        /* Size of 'buf', including the null terminator. */
+    size_t len;         /* Length of the text in 'buf'. */
+    size_t max_entries; /* Entries printed per list, or 0 for all of them. */
+    bool truncated;     /* Whether text was dropped for lack of space. */
+};
+
+/* Makes 'fmt' print into the 'size' bytes at 'buf', which the caller keeps
+ * and may reuse after ofl_fmt_clear(). */
+void
+ofl_fmt_init(struct ofl_fmt *fmt, char *buf, size_t size, size_t max_entries);
+
+void
+ofl_fmt_clear(struct ofl_fmt *fmt);
+
+/* Returns the text printed into 'fmt', ending in "..." if it was truncated. */
+const char *
+ofl_fmt_finish(struct ofl_fmt *fmt);
+
+void
+ofl_fmt_str(struct ofl_fmt *fmt, const char *s);
+
+void
+ofl_fmt_printf(struct ofl_fmt *fmt, const char *format, ...) PRINTF_FORMAT(2, 3);
+
+/* Print 'value' in decimal, and in hexadecimal with a "0x" prefix, several
+ * times faster than ofl_fmt_printf(). */
+void
+ofl_fmt_uint(struct ofl_fmt *fmt, uint64_t value);
+
+void
+ofl_fmt_hex(struct ofl_fmt *fmt, uint64_t value);
+
+/* Print 'name' followed by 'value' in double quotes, as in ", prio=\"5\"" for
+ * name ", prio=". */
+void
+ofl_fmt_uint_field(struct ofl_fmt *fmt, const char *name, uint64_t value);
+
+void
+ofl_fmt_hex_field(struct ofl_fmt *fmt, const char *name, uint64_t value);
+
+/* Prints 'name', or 'value' in decimal if 'name' is NULL, for the ports,
+ * queues, groups, tables and buffers that the ofl_*_name() functions name. */
+void
+ofl_fmt_id(struct ofl_fmt *fmt, const char *name, uint32_t value);
+
+/* Prints 'name', or 'value' as an unknown value if 'name' is NULL. */
+void
+ofl_fmt_enum(struct ofl_fmt *fmt, const char *name, uint32_t value);
+
+/* Starts entry 'i' of a list of 'n' entries, printing the separator before it,
+ * and returns true.  Returns false once the rest of the list is to be left
+ * out, after printing how many entries that is. */
+bool
+ofl_fmt_entry(struct ofl_fmt *fmt, size_t i, size_t n);
+
+/* Enough for any string returned by ofl_id_to_buf(). */
+#define OFL_ID_BUF_LEN 12
+
+/* Returns 'name', or 'value' printed into 'buf' if 'name' is NULL.  For log
+ * messages that name a port, group or table without allocating. */
+const char *
+ofl_id_to_buf(const char *name, uint32_t value, char buf[OFL_ID_BUF_LEN]);
+
 #endif /* OFL_PRINT_H */
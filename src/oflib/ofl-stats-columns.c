@@ -0,0 +1,370 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * Copyright (c) 2012, CPqD, Brazil 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include "ofl.h"
+#include "ofl-print.h"
+#include "ofl-stats-columns.h"
+#include "ofl-structs.h"
+#include "ofl-utils.h"
+#include "ofl-log.h"
+#include "oxm-match.h"
+#include "openflow/openflow.h"
+#include "../libopenflow/ofpbuf.h"
+#include "../libopenflow/util.h"
+
+#define LOG_MODULE ofl_stats_c
+OFL_LOG_INIT(LOG_MODULE)
+
+/* Where a column lives in struct ofl_stats_columns and the size of its
+   elements. */
+struct column {
+    size_t offset;
+    size_t size;
+};
+
+#define COLUMN(MEMBER) \
+    { offsetof(struct ofl_stats_columns, MEMBER), \
+      sizeof *((struct ofl_stats_columns *) 0)->MEMBER }
+
+static const struct column flow_columns[] = {
+    COLUMN(flow.table_id),
+    COLUMN(flow.duration_sec),
+    COLUMN(flow.duration_nsec),
+    COLUMN(flow.priority),
+    COLUMN(flow.idle_timeout),
+    COLUMN(flow.hard_timeout),
+    COLUMN(flow.cookie),
+    COLUMN(flow.packet_count),
+    COLUMN(flow.byte_count),
+    COLUMN(flow.match),
+};
+
+static const struct column port_columns[] = {
+    COLUMN(port.port_no),
+    COLUMN(port.rx_packets),
+    COLUMN(port.tx_packets),
+    COLUMN(port.rx_bytes),
+    COLUMN(port.tx_bytes),
+    COLUMN(port.rx_dropped),
+    COLUMN(port.tx_dropped),
+    COLUMN(port.rx_errors),
+    COLUMN(port.tx_errors),
+    COLUMN(port.rx_frame_err),
+    COLUMN(port.rx_over_err),
+    COLUMN(port.rx_crc_err),
+    COLUMN(port.collisions),
+    COLUMN(port.duration_sec),
+    COLUMN(port.duration_nsec),
+};
+
+static const struct column queue_columns[] = {
+    COLUMN(queue.port_no),
+    COLUMN(queue.queue_id),
+    COLUMN(queue.tx_bytes),
+    COLUMN(queue.tx_packets),
+    COLUMN(queue.tx_errors),
+    COLUMN(queue.duration_sec),
+    COLUMN(queue.duration_nsec),
+};
+
+static const struct column *
+columns_of(enum ofp_multipart_types type, size_t *n) {
+    switch (type) {
+        case OFPMP_FLOW: {
+            *n = ARRAY_SIZE(flow_columns);
+            return flow_columns;
+        }
+        case OFPMP_PORT_STATS: {
+            *n = ARRAY_SIZE(port_columns);
+            return port_columns;
+        }
+        case OFPMP_QUEUE: {
+            *n = ARRAY_SIZE(queue_columns);
+            return queue_columns;
+        }
+        default: {
+            *n = 0;
+            return NULL;
+        }
+    }
+}
+
+static void **
+column_ptr(struct ofl_stats_columns *cols, const struct column *c) {
+    return (void **)((uint8_t *)cols + c->offset);
+}
+
+/* Makes room in the columns of 'cols' for 'extra' more entries. */
+static void
+reserve(struct ofl_stats_columns *cols, size_t extra) {
+    const struct column *c;
+    size_t i, n, allocated;
+
+    if (cols->n + extra <= cols->allocated) {
+        return;
+    }
+    allocated = cols->allocated ? cols->allocated : 64;
+    while (allocated < cols->n + extra) {
+        allocated *= 2;
+    }
+    c = columns_of(cols->type, &n);
+    for (i = 0; i < n; i++) {
+        void **col = column_ptr(cols, &c[i]);
+        *col = xrealloc(*col, allocated * c[i].size);
+    }
+    cols->allocated = allocated;
+}
+
+void
+ofl_stats_columns_init(struct ofl_stats_columns *cols,
+                       enum ofp_multipart_types type) {
+    memset(cols, 0, sizeof *cols);
+    cols->type = type;
+}
+
+void
+ofl_stats_columns_clear(struct ofl_stats_columns *cols) {
+    cols->n = 0;
+}
+
+void
+ofl_stats_columns_destroy(struct ofl_stats_columns *cols) {
+    const struct column *c;
+    size_t i, n;
+
+    c = columns_of(cols->type, &n);
+    for (i = 0; i < n; i++) {
+        free(*column_ptr(cols, &c[i]));
+    }
+    ofl_stats_columns_init(cols, cols->type);
+}
+
+static ofl_err
+append_flow(struct ofl_stats_columns *cols, const uint8_t *body, size_t len) {
+    struct ofl_flow_stats_columns *f = &cols->flow;
+    ofl_err error;
+    size_t count;
+
+    error = ofl_utils_count_ofp_flow_stats((void *)body, len, &count);
+    if (error) {
+        return error;
+    }
+    reserve(cols, count);
+
+    for (; count > 0; count--) {
+        const struct ofp_flow_stats *src = (const struct ofp_flow_stats *)body;
+        size_t i = cols->n;
+        uint16_t mlen = ntohs(src->match.length);
+
+        if (ntohs(src->length) < (sizeof(struct ofp_flow_stats) - sizeof(struct ofp_match)) + ROUND_UP(mlen, 8)) {
+            OFL_LOG_WARN(LOG_MODULE, "Received flow stats has invalid length (%u).", ntohs(src->length));
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+        }
+        if (src->table_id == 0xff) {
+            if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
+                char ts[OFL_ID_BUF_LEN];
+                OFL_LOG_WARN(LOG_MODULE, "Received flow stats has invalid table_id (%s).",
+                             ofl_id_to_buf(ofl_table_name(src->table_id), src->table_id, ts));
+            }
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
+        }
+        if (ntohs(src->match.type) != OFPMT_OXM) {
+            OFL_LOG_WARN(LOG_MODULE, "Received flow stats has a non-OXM match.");
+            return ofl_error(OFPET_BAD_MATCH, OFPBMC_BAD_TYPE);
+        }
+
+        f->table_id[i] =             src->table_id;
+        f->duration_sec[i] =  ntohl( src->duration_sec);
+        f->duration_nsec[i] = ntohl( src->duration_nsec);
+        f->priority[i] =      ntohs( src->priority);
+        f->idle_timeout[i] =  ntohs( src->idle_timeout);
+        f->hard_timeout[i] =  ntohs( src->hard_timeout);
+        f->cookie[i] =        ntoh64(src->cookie);
+        f->packet_count[i] =  ntoh64(src->packet_count);
+        f->byte_count[i] =    ntoh64(src->byte_count);
+
+        if (mlen > sizeof(struct ofp_match)) {
+            struct ofpbuf b;
+
+            /* The fields follow the 4-byte ofp_match header, which starts
+               4 bytes before the end of the fixed part of ofp_flow_stats. */
+            ofpbuf_use(&b, (void *)(body + sizeof(struct ofp_flow_stats) - 4), mlen - 4);
+            b.size = b.allocated;
+            error = oxm_pull_match(&b, &f->match[i], mlen - 4);
+            if (error) {
+                return error;
+            }
+            f->match[i].header.length = mlen - 4;
+        } else {
+            ofl_structs_match_init(&f->match[i]);
+            f->match[i].header.length = 0;
+        }
+        f->match[i].header.type = OFPMT_OXM;
+
+        cols->n++;
+        body += ntohs(src->length);
+    }
+    return 0;
+}
+
+static ofl_err
+append_port(struct ofl_stats_columns *cols, const uint8_t *body, size_t len) {
+    struct ofl_port_stats_columns *p = &cols->port;
+
+    if (len % sizeof(struct ofp_port_stats) != 0) {
+        OFL_LOG_WARN(LOG_MODULE, "Received port stats reply has invalid length (%zu).", len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    reserve(cols, len / sizeof(struct ofp_port_stats));
+
+    for (; len > 0; len -= sizeof(struct ofp_port_stats)) {
+        const struct ofp_port_stats *src = (const struct ofp_port_stats *)body;
+        size_t i = cols->n;
+
+        if (ntohl(src->port_no) == 0 ||
+            (ntohl(src->port_no) > OFPP_MAX && ntohl(src->port_no) != OFPP_LOCAL)) {
+            if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
+                char ps[OFL_ID_BUF_LEN];
+                OFL_LOG_WARN(LOG_MODULE, "Received port stats has invalid port_id (%s).",
+                             ofl_id_to_buf(ofl_port_name(ntohl(src->port_no)), ntohl(src->port_no), ps));
+            }
+            return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
+        }
+
+        p->port_no[i]      = ntohl(src->port_no);
+        p->rx_packets[i]   = ntoh64(src->rx_packets);
+        p->tx_packets[i]   = ntoh64(src->tx_packets);
+        p->rx_bytes[i]     = ntoh64(src->rx_bytes);
+        p->tx_bytes[i]     = ntoh64(src->tx_bytes);
+        p->rx_dropped[i]   = ntoh64(src->rx_dropped);
+        p->tx_dropped[i]   = ntoh64(src->tx_dropped);
+        p->rx_errors[i]    = ntoh64(src->rx_errors);
+        p->tx_errors[i]    = ntoh64(src->tx_errors);
+        p->rx_frame_err[i] = ntoh64(src->rx_frame_err);
+        p->rx_over_err[i]  = ntoh64(src->rx_over_err);
+        p->rx_crc_err[i]   = ntoh64(src->rx_crc_err);
+        p->collisions[i]   = ntoh64(src->collisions);
+        p->duration_sec[i] = ntohl(src->duration_sec);
+        p->duration_nsec[i] = ntohl(src->duration_nsec);
+
+        cols->n++;
+        body += sizeof(struct ofp_port_stats);
+    }
+    return 0;
+}
+
+static ofl_err
+append_queue(struct ofl_stats_columns *cols, const uint8_t *body, size_t len) {
+    struct ofl_queue_stats_columns *q = &cols->queue;
+
+    if (len % sizeof(struct ofp_queue_stats) != 0) {
+        OFL_LOG_WARN(LOG_MODULE, "Received queue stats reply has invalid length (%zu).", len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    reserve(cols, len / sizeof(struct ofp_queue_stats));
+
+    for (; len > 0; len -= sizeof(struct ofp_queue_stats)) {
+        const struct ofp_queue_stats *src = (const struct ofp_queue_stats *)body;
+        size_t i = cols->n;
+
+        if (ntohl(src->port_no) == 0 || ntohl(src->port_no) > OFPP_MAX) {
+            if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
+                char ps[OFL_ID_BUF_LEN];
+                OFL_LOG_WARN(LOG_MODULE, "Received queue stats has invalid port_id (%s).",
+                             ofl_id_to_buf(ofl_port_name(ntohl(src->port_no)), ntohl(src->port_no), ps));
+            }
+            return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
+        }
+
+        q->port_no[i] =    ntohl(src->port_no);
+        q->queue_id[i] =   ntohl(src->queue_id);
+        q->tx_bytes[i] =   ntoh64(src->tx_bytes);
+        q->tx_packets[i] = ntoh64(src->tx_packets);
+        q->tx_errors[i] =  ntoh64(src->tx_errors);
+        q->duration_sec[i] = ntohl(src->duration_sec);
+        q->duration_nsec[i] = ntohl(src->duration_nsec);
+
+        cols->n++;
+        body += sizeof(struct ofp_queue_stats);
+    }
+    return 0;
+}
+
+ofl_err
+ofl_stats_columns_append(struct ofl_stats_columns *cols, const uint8_t *buf,
+                         size_t len, bool *more) {
+    const struct ofp_multipart_reply *os = (const struct ofp_multipart_reply *)buf;
+    const uint8_t *body = buf + sizeof(struct ofp_multipart_reply);
+    size_t blen;
+    size_t n = cols->n;
+    ofl_err error;
+
+    if (len < sizeof(struct ofp_multipart_reply) || ntohs(os->header.length) != len) {
+        OFL_LOG_WARN(LOG_MODULE, "Received multipart reply has invalid length (%zu).", len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    if (os->header.type != OFPT_MULTIPART_REPLY) {
+        OFL_LOG_WARN(LOG_MODULE, "Received message is not a multipart reply (type %u).", os->header.type);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TYPE);
+    }
+    if (ntohs(os->type) != cols->type) {
+        OFL_LOG_WARN(LOG_MODULE, "Received multipart reply has unexpected type (%u).", ntohs(os->type));
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_MULTIPART);
+    }
+    blen = len - sizeof(struct ofp_multipart_reply);
+
+    switch (cols->type) {
+        case OFPMP_FLOW: {
+            error = append_flow(cols, body, blen);
+            break;
+        }
+        case OFPMP_PORT_STATS: {
+            error = append_port(cols, body, blen);
+            break;
+        }
+        case OFPMP_QUEUE: {
+            error = append_queue(cols, body, blen);
+            break;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Multipart reply type %u cannot be decoded into columns.", cols->type);
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_MULTIPART);
+        }
+    }
+    if (error) {
+        cols->n = n;
+        return error;
+    }
+    *more = (ntohs(os->flags) & OFPMPF_REPLY_MORE) != 0;
+    return 0;
+}
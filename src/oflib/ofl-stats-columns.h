@@ -0,0 +1,129 @@
+/* Copyright (c) 2011, TrafficLab, Ericsson Research, Hungary
+ * Copyright (c) 2012, CPqD, Brazil 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Ericsson Research nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OFL_STATS_COLUMNS_H
+#define OFL_STATS_COLUMNS_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/openflow/openflow.h"
+#include "ofl.h"
+#include "ofl-structs.h"
+
+/* Columnar decoding of flow, port and queue statistics replies.
+
+   ofl_msg_unpack() turns each entry of a statistics reply into a structure
+   of its own, and a reply that the switch splits into several
+   OFPMPF_REPLY_MORE parts into as many messages.  ofl_stats_columns instead
+   decodes the parts of one reply straight from the wire into arrays, one per
+   field, so that the entries of the whole reply lie in a few contiguous
+   blocks that are kept from one request to the next.  Instructions of flow
+   entries are not decoded. */
+
+struct ofl_flow_stats_columns {
+    uint8_t          *table_id;
+    uint32_t         *duration_sec;
+    uint32_t         *duration_nsec;
+    uint16_t         *priority;
+    uint16_t         *idle_timeout;
+    uint16_t         *hard_timeout;
+    uint64_t         *cookie;
+    uint64_t         *packet_count;
+    uint64_t         *byte_count;
+    struct ofl_match *match;
+};
+
+struct ofl_port_stats_columns {
+    uint32_t *port_no;
+    uint64_t *rx_packets;
+    uint64_t *tx_packets;
+    uint64_t *rx_bytes;
+    uint64_t *tx_bytes;
+    uint64_t *rx_dropped;
+    uint64_t *tx_dropped;
+    uint64_t *rx_errors;
+    uint64_t *tx_errors;
+    uint64_t *rx_frame_err;
+    uint64_t *rx_over_err;
+    uint64_t *rx_crc_err;
+    uint64_t *collisions;
+    uint32_t *duration_sec;
+    uint32_t *duration_nsec;
+};
+
+struct ofl_queue_stats_columns {
+    uint32_t *port_no;
+    uint32_t *queue_id;
+    uint64_t *tx_bytes;
+    uint64_t *tx_packets;
+    uint64_t *tx_errors;
+    uint32_t *duration_sec;
+    uint32_t *duration_nsec;
+};
+
+/* The entries of a statistics reply of type 'type'.  Entry i of the reply is
+   made of element i of each column of the member for 'type'; the columns of
+   the other members are null. */
+struct ofl_stats_columns {
+    enum ofp_multipart_types type; /* OFPMP_FLOW, OFPMP_PORT_STATS or
+                                      OFPMP_QUEUE. */
+    size_t n;                      /* Number of entries. */
+    size_t allocated;              /* Entries the columns have room for. */
+
+    struct ofl_flow_stats_columns  flow;
+    struct ofl_port_stats_columns  port;
+    struct ofl_queue_stats_columns queue;
+};
+
+/* Initializes 'cols' to hold no entries of replies of 'type', which must be
+   OFPMP_FLOW, OFPMP_PORT_STATS or OFPMP_QUEUE. */
+void
+ofl_stats_columns_init(struct ofl_stats_columns *cols,
+                       enum ofp_multipart_types type);
+
+/* Removes all entries from 'cols', keeping the memory of the columns. */
+void
+ofl_stats_columns_clear(struct ofl_stats_columns *cols);
+
+void
+ofl_stats_columns_destroy(struct ofl_stats_columns *cols);
+
+/* Appends the entries of the 'len'-byte multipart reply message 'buf', as
+   received from the switch, to 'cols', and sets '*more' to whether more
+   parts of the reply follow.  The reply must be of the type 'cols' was
+   initialized with.  On error, returns an OpenFlow error code and leaves
+   'cols' as it was. */
+ofl_err
+ofl_stats_columns_append(struct ofl_stats_columns *cols, const uint8_t *buf,
+                         size_t len, bool *more);
+
+#endif /* OFL_STATS_COLUMNS_H */
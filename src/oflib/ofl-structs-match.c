@@ -32,173 +32,200 @@
 #include "../libopenflow/hash.h"
 #include "oxm-match.h"
 
+/* Length of the value of each field, indexed by field number. */
+const uint8_t ofl_match_field_lens[OFL_MATCH_N_FIELDS] = {
+    4,                          /* IN_PORT */
+    4,                          /* IN_PHY_PORT */
+    8,                          /* METADATA */
+    ETH_ADDR_LEN,               /* ETH_DST */
+    ETH_ADDR_LEN,               /* ETH_SRC */
+    2,                          /* ETH_TYPE */
+    2,                          /* VLAN_VID */
+    1,                          /* VLAN_PCP */
+    1,                          /* IP_DSCP */
+    1,                          /* IP_ECN */
+    1,                          /* IP_PROTO */
+    4,                          /* IPV4_SRC */
+    4,                          /* IPV4_DST */
+    2,                          /* TCP_SRC */
+    2,                          /* TCP_DST */
+    2,                          /* UDP_SRC */
+    2,                          /* UDP_DST */
+    2,                          /* SCTP_SRC */
+    2,                          /* SCTP_DST */
+    1,                          /* ICMPV4_TYPE */
+    1,                          /* ICMPV4_CODE */
+    2,                          /* ARP_OP */
+    4,                          /* ARP_SPA */
+    4,                          /* ARP_TPA */
+    ETH_ADDR_LEN,               /* ARP_SHA */
+    ETH_ADDR_LEN,               /* ARP_THA */
+    IPv6_ADDR_LEN,              /* IPV6_SRC */
+    IPv6_ADDR_LEN,              /* IPV6_DST */
+    4,                          /* IPV6_FLABEL */
+    1,                          /* ICMPV6_TYPE */
+    1,                          /* ICMPV6_CODE */
+    IPv6_ADDR_LEN,              /* IPV6_ND_TARGET */
+    ETH_ADDR_LEN,               /* IPV6_ND_SLL */
+    ETH_ADDR_LEN,               /* IPV6_ND_TLL */
+    4,                          /* MPLS_LABEL */
+    1,                          /* MPLS_TC */
+    1,                          /* MPLS_BOS */
+    4,                          /* PBB_ISID */
+    8,                          /* TUNNEL_ID */
+    2,                          /* IPV6_EXTHDR */
+};
+
+/* Offset of each field's value in ofl_match's 'values', that is, the sum of
+ * twice the lengths of the fields before it, to leave room for masks. */
+const uint16_t ofl_match_field_offsets[OFL_MATCH_N_FIELDS] = {
+      0,   8,  16,  32,  44,  56,  60,  64,  66,  68,
+     70,  72,  80,  88,  92,  96, 100, 104, 108, 112,
+    114, 116, 120, 128, 136, 148, 160, 192, 224, 232,
+    234, 236, 268, 280, 292, 300, 302, 304, 312, 328
+};
+
 void
 ofl_structs_match_init(struct ofl_match *match){
 
+    memset(match, 0, sizeof *match);
     match->header.type = OFPMT_OXM;
     match->header.length = 0;
-    match->match_fields = (struct hmap) HMAP_INITIALIZER(&match->match_fields);
+}
+
+void
+ofl_structs_match_put_bytes(struct ofl_match *match, uint32_t header,
+                            const void *value, const void *mask){
+    unsigned int field = OXM_FIELD(header);
+    uint64_t bit;
+    uint8_t *dst;
+    int len;
+
+    if (OXM_VENDOR(header) != OFPXMC_OPENFLOW_BASIC
+        || field >= OFL_MATCH_N_FIELDS) {
+        return;
+    }
+
+    bit = (uint64_t) 1 << field;
+    len = ofl_match_field_lens[field];
+    if (match->present & bit) {
+        match->header.length -= (match->masked & bit ? len * 2 : len) + 4;
+    }
+
+    dst = ofl_structs_match_field_value(match, field);
+    memcpy(dst, value, len);
+    if (mask) {
+        memcpy(dst + len, mask, len);
+        match->masked |= bit;
+    } else {
+        memset(dst + len, 0, len);
+        match->masked &= ~bit;
+    }
+    match->present |= bit;
+    match->header.length += (mask ? len * 2 : len) + 4;
+}
+
+uint8_t *
+ofl_structs_match_get(const struct ofl_match *match, uint32_t header){
+    unsigned int field = OXM_FIELD(header);
+
+    if (OXM_VENDOR(header) != OFPXMC_OPENFLOW_BASIC
+        || field >= OFL_MATCH_N_FIELDS
+        || !(match->present & ((uint64_t) 1 << field))) {
+        return NULL;
+    }
+    return ofl_structs_match_field_value(match, field);
+}
+
+uint32_t
+ofl_structs_match_field_header(const struct ofl_match *match, unsigned int field){
+    int len = ofl_match_field_lens[field];
+
+    return (match->masked & ((uint64_t) 1 << field)
+            ? OXM_HEADER_W(OFPXMC_OPENFLOW_BASIC, field, len)
+            : OXM_HEADER(OFPXMC_OPENFLOW_BASIC, field, len));
+}
+
+void
+ofl_structs_match_to_hmap(const struct ofl_match *match, struct hmap *fields){
+    unsigned int field;
+
+    hmap_init(fields);
+    OFL_MATCH_FOR_EACH_FIELD (field, match) {
+        struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
+
+        m->header = ofl_structs_match_field_header(match, field);
+        m->value = ofl_structs_match_field_value(match, field);
+        hmap_insert(fields, &m->hmap_node, hash_int(m->header, 0));
+    }
+}
+
+void
+ofl_structs_match_hmap_destroy(struct hmap *fields){
+    struct ofl_match_tlv *tlv, *next;
+
+    HMAP_FOR_EACH_SAFE (tlv, next, struct ofl_match_tlv, hmap_node, fields) {
+        free(tlv);
+    }
+    hmap_destroy(fields);
 }
 
 void
 ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint8_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    ofl_structs_match_put_bytes(match, header, &value, NULL);
 }
 
 void
 ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value, uint8_t mask){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint8_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    ofl_structs_match_put_bytes(match, header, &value, &mask);
 }
 
 void
 ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint16_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    ofl_structs_match_put_bytes(match, header, &value, NULL);
 }
 
-
 void
 ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t value, uint16_t mask){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint16_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    ofl_structs_match_put_bytes(match, header, &value, &mask);
 }
 
 void
 ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-
-    int len = sizeof(uint32_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put_bytes(match, header, &value, NULL);
 }
 
 void
 ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t value, uint32_t mask){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint32_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
-
+    ofl_structs_match_put_bytes(match, header, &value, &mask);
 }
 
 void
 ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint64_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put_bytes(match, header, &value, NULL);
 }
 
 void
 ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t value, uint64_t mask){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint64_t);
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
-
+    ofl_structs_match_put_bytes(match, header, &value, &mask);
 }
 
 void
 ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = ETH_ADDR_LEN;
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put_bytes(match, header, value, NULL);
 }
 
 void
 ofl_structs_match_put_eth_m(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN], uint8_t mask[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = ETH_ADDR_LEN;
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, value, len);
-    memcpy(m->value + len, mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
-
+    ofl_structs_match_put_bytes(match, header, value, mask);
 }
 
 void 
 ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN]){
-
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = IPv6_ADDR_LEN;
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put_bytes(match, header, value, NULL);
 }
 
 void 
 ofl_structs_match_put_ipv6m(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN], uint8_t mask[IPv6_ADDR_LEN]){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv*) malloc(sizeof (struct ofl_match_tlv));
-    int len = IPv6_ADDR_LEN;
-    
-    m->header = header;
-    m->value = (uint8_t*) malloc(len*2);
-    memcpy(m->value, value, len);
-    memcpy(m->value + len, mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
-
+    ofl_structs_match_put_bytes(match, header, value, mask);
 }
-
-
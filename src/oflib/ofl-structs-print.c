@@ -451,13 +451,16 @@ print_oxm_tlv(FILE *stream, struct ofl_match_tlv *f, size_t *size){
 }
 
 static void print_oxm_match(FILE *stream, struct ofl_match *m){
-        struct ofl_match_tlv   *f;
+        struct ofl_match_tlv   f;
+        unsigned int field;
         size_t size = m->header.length;
         fprintf(stream, "oxm{");
         if (size) {
             /*TODO: Create a mapping of header values and names to avoid so many comparisons */ 
-            HMAP_FOR_EACH(f, struct ofl_match_tlv, hmap_node, &m->match_fields){                             
-                print_oxm_tlv(stream, f, &size);
+            OFL_MATCH_FOR_EACH_FIELD (field, m) {
+                f.header = ofl_structs_match_field_header(m, field);
+                f.value = ofl_structs_match_field_value(m, field);
+                print_oxm_tlv(stream, &f, &size);
             }
         }    
         else fprintf(stream, "all match");
@@ -1008,3 +1011,224 @@ ofl_structs_async_config_print(FILE * stream, struct ofl_async_config *s){
     ofl_async_flow_removed(stream, s->flow_removed_mask[1]);
     fprintf(stream, "]}");        
 }
+
+
+
+/* Prints the 'len' byte value or mask of OXM field number 'field'.  Values
+ * are as ofl_match keeps them: integers in host byte order, IPv4 addresses
+ * in network byte order and other addresses as they are on the wire. */
+static void
+fmt_oxm_value(struct ofl_fmt *fmt, unsigned int field, const uint8_t *v,
+              size_t len, bool is_mask) {
+    uint64_t x;
+
+    switch (field) {
+        case OFPXMT_OFB_ETH_DST:
+        case OFPXMT_OFB_ETH_SRC:
+        case OFPXMT_OFB_ARP_SHA:
+        case OFPXMT_OFB_ARP_THA:
+        case OFPXMT_OFB_IPV6_ND_SLL:
+        case OFPXMT_OFB_IPV6_ND_TLL: {
+            ofl_fmt_printf(fmt, ETH_ADDR_FMT, ETH_ADDR_ARGS(v));
+            return;
+        }
+        case OFPXMT_OFB_IPV4_SRC:
+        case OFPXMT_OFB_IPV4_DST:
+        case OFPXMT_OFB_ARP_SPA:
+        case OFPXMT_OFB_ARP_TPA: {
+            ofl_fmt_printf(fmt, IP_FMT, IP_ARGS(v));
+            return;
+        }
+        case OFPXMT_OFB_IPV6_SRC:
+        case OFPXMT_OFB_IPV6_DST:
+        case OFPXMT_OFB_IPV6_ND_TARGET: {
+            char addr_str[INET6_ADDRSTRLEN];
+
+            inet_ntop(AF_INET6, v, addr_str, INET6_ADDRSTRLEN);
+            ofl_fmt_str(fmt, addr_str);
+            return;
+        }
+    }
+
+    switch (len) {
+        case 1: { x = *v; break; }
+        case 2: { uint16_t y; memcpy(&y, v, 2); x = y; break; }
+        case 4: { uint32_t y; memcpy(&y, v, 4); x = y; break; }
+        case 8: { memcpy(&x, v, 8); break; }
+        default: { ofl_fmt_str(fmt, "?"); return; }
+    }
+    if (is_mask || field == OFPXMT_OFB_ETH_TYPE || field == OFPXMT_OFB_METADATA) {
+        ofl_fmt_hex(fmt, x);
+    } else {
+        ofl_fmt_uint(fmt, x);
+    }
+}
+
+void
+ofl_structs_oxm_tlv_format(struct ofl_fmt *fmt, uint32_t header, const uint8_t *value) {
+    unsigned int field = OXM_FIELD(header);
+    size_t len = OXM_HASMASK(header) ? OXM_LENGTH(header) / 2 : OXM_LENGTH(header);
+    uint32_t type = OXM_HEADER(OXM_VENDOR(header), field, len);
+
+    ofl_fmt_enum(fmt, ofl_oxm_type_name(type), type);
+    ofl_fmt_str(fmt, "=\"");
+    fmt_oxm_value(fmt, field, value, len, false);
+    if (OXM_HASMASK(header)) {
+        ofl_fmt_str(fmt, "/");
+        fmt_oxm_value(fmt, field, value + len, len, true);
+    }
+    ofl_fmt_str(fmt, "\"");
+}
+
+void
+ofl_structs_match_format(struct ofl_fmt *fmt, const struct ofl_match_header *match) {
+    const struct ofl_match *m = (const struct ofl_match *) match;
+    unsigned int field;
+    bool first = true;
+
+    if (match->type != OFPMT_OXM) {
+        ofl_fmt_printf(fmt, "?(%u)", match->type);
+        return;
+    }
+
+    ofl_fmt_str(fmt, "oxm{");
+    OFL_MATCH_FOR_EACH_FIELD (field, m) {
+        if (!first) {
+            ofl_fmt_str(fmt, ", ");
+        }
+        first = false;
+        ofl_structs_oxm_tlv_format(fmt, ofl_structs_match_field_header(m, field),
+                                   ofl_structs_match_field_value(m, field));
+    }
+    if (first) {
+        ofl_fmt_str(fmt, "all match");
+    }
+    ofl_fmt_str(fmt, "}");
+}
+
+void
+ofl_structs_instruction_format(struct ofl_fmt *fmt, const struct ofl_instruction_header *inst) {
+    ofl_fmt_enum(fmt, ofl_instruction_type_name(inst->type), inst->type);
+
+    switch(inst->type) {
+        case (OFPIT_GOTO_TABLE): {
+            struct ofl_instruction_goto_table *i = (struct ofl_instruction_goto_table*)inst;
+
+            ofl_fmt_uint_field(fmt, "{table=", i->table_id);
+            ofl_fmt_str(fmt, "}");
+            break;
+        }
+        case (OFPIT_WRITE_METADATA): {
+            struct ofl_instruction_write_metadata *i = (struct ofl_instruction_write_metadata *)inst;
+
+            ofl_fmt_printf(fmt, "{meta=\"0x%"PRIx64"\", mask=\"0x%"PRIx64"\"}",
+                           i->metadata, i->metadata_mask);
+            break;
+        }
+        case (OFPIT_WRITE_ACTIONS):
+        case (OFPIT_APPLY_ACTIONS): {
+            struct ofl_instruction_actions *i = (struct ofl_instruction_actions *)inst;
+            size_t j;
+
+            ofl_fmt_str(fmt, "{acts=[");
+            for (j = 0; j < i->actions_num && ofl_fmt_entry(fmt, j, i->actions_num); j++) {
+                ofl_action_format(fmt, i->actions[j]);
+            }
+            ofl_fmt_str(fmt, "]}");
+            break;
+        }
+        case (OFPIT_CLEAR_ACTIONS): {
+            break;
+        }
+        case (OFPIT_METER): {
+            struct ofl_instruction_meter *i = (struct ofl_instruction_meter *)inst;
+
+            ofl_fmt_printf(fmt, "{meter=\"%u\"}", i->meter_id);
+            break;
+        }
+        case (OFPIT_EXPERIMENTER): {
+            struct ofl_instruction_experimenter *i = (struct ofl_instruction_experimenter *)inst;
+
+            ofl_fmt_printf(fmt, "{id=\"0x%"PRIx32"\"}", i->experimenter_id);
+            break;
+        }
+    }
+}
+
+void
+ofl_structs_port_format(struct ofl_fmt *fmt, const struct ofl_port *port) {
+    ofl_fmt_str(fmt, "{no=\"");
+    ofl_fmt_id(fmt, ofl_port_name(port->port_no), port->port_no);
+    ofl_fmt_printf(fmt, "\", hw_addr=\""ETH_ADDR_FMT"\", name=\"%s\", "
+                        "config=\"0x%"PRIx32"\", state=\"0x%"PRIx32"\", curr=\"0x%"PRIx32"\", "
+                        "adv=\"0x%"PRIx32"\", supp=\"0x%"PRIx32"\", peer=\"0x%"PRIx32"\", "
+                        "curr_spd=\"%ukbps\", max_spd=\"%ukbps\"}",
+                   ETH_ADDR_ARGS(port->hw_addr), port->name,
+                   port->config, port->state, port->curr,
+                   port->advertised, port->supported, port->peer,
+                   port->curr_speed, port->max_speed);
+}
+
+void
+ofl_structs_flow_stats_format(struct ofl_fmt *fmt, const struct ofl_flow_stats *s) {
+    size_t i;
+
+    ofl_fmt_str(fmt, "{table=\"");
+    ofl_fmt_id(fmt, ofl_table_name(s->table_id), s->table_id);
+    ofl_fmt_str(fmt, "\", match=\"");
+    ofl_structs_match_format(fmt, s->match);
+    ofl_fmt_uint_field(fmt, "\", dur_s=", s->duration_sec);
+    ofl_fmt_uint_field(fmt, ", dur_ns=", s->duration_nsec);
+    ofl_fmt_uint_field(fmt, ", prio=", s->priority);
+    ofl_fmt_uint_field(fmt, ", idle_to=", s->idle_timeout);
+    ofl_fmt_uint_field(fmt, ", hard_to=", s->hard_timeout);
+    ofl_fmt_hex_field(fmt, ", cookie=", s->cookie);
+    ofl_fmt_uint_field(fmt, ", pkt_cnt=", s->packet_count);
+    ofl_fmt_uint_field(fmt, ", byte_cnt=", s->byte_count);
+    ofl_fmt_str(fmt, ", insts=[");
+    for (i = 0; i < s->instructions_num && ofl_fmt_entry(fmt, i, s->instructions_num); i++) {
+        ofl_structs_instruction_format(fmt, s->instructions[i]);
+    }
+    ofl_fmt_str(fmt, "]}");
+}
+
+void
+ofl_structs_table_stats_format(struct ofl_fmt *fmt, const struct ofl_table_stats *s) {
+    ofl_fmt_str(fmt, "{table=\"");
+    ofl_fmt_id(fmt, ofl_table_name(s->table_id), s->table_id);
+    ofl_fmt_uint_field(fmt, "\", active=", s->active_count);
+    ofl_fmt_uint_field(fmt, ", lookup=", s->lookup_count);
+    ofl_fmt_uint_field(fmt, ", match=", s->matched_count);
+    ofl_fmt_str(fmt, "}");
+}
+
+void
+ofl_structs_port_stats_format(struct ofl_fmt *fmt, const struct ofl_port_stats *s) {
+    ofl_fmt_str(fmt, "{port=\"");
+    ofl_fmt_id(fmt, ofl_port_name(s->port_no), s->port_no);
+    ofl_fmt_uint_field(fmt, "\", rx_pkt=", s->rx_packets);
+    ofl_fmt_uint_field(fmt, ", tx_pkt=", s->tx_packets);
+    ofl_fmt_uint_field(fmt, ", rx_bytes=", s->rx_bytes);
+    ofl_fmt_uint_field(fmt, ", tx_bytes=", s->tx_bytes);
+    ofl_fmt_uint_field(fmt, ", rx_drops=", s->rx_dropped);
+    ofl_fmt_uint_field(fmt, ", tx_drops=", s->tx_dropped);
+    ofl_fmt_uint_field(fmt, ", rx_errs=", s->rx_errors);
+    ofl_fmt_uint_field(fmt, ", tx_errs=", s->tx_errors);
+    ofl_fmt_uint_field(fmt, ", rx_frm=", s->rx_frame_err);
+    ofl_fmt_uint_field(fmt, ", rx_over=", s->rx_over_err);
+    ofl_fmt_uint_field(fmt, ", rx_crc=", s->rx_crc_err);
+    ofl_fmt_uint_field(fmt, ", coll=", s->collisions);
+    ofl_fmt_str(fmt, "}");
+}
+
+void
+ofl_structs_queue_stats_format(struct ofl_fmt *fmt, const struct ofl_queue_stats *s) {
+    ofl_fmt_str(fmt, "{port=\"");
+    ofl_fmt_id(fmt, ofl_port_name(s->port_no), s->port_no);
+    ofl_fmt_str(fmt, "\", q=\"");
+    ofl_fmt_id(fmt, ofl_queue_name(s->queue_id), s->queue_id);
+    ofl_fmt_uint_field(fmt, "\", tx_bytes=", s->tx_bytes);
+    ofl_fmt_uint_field(fmt, ", tx_pkt=", s->tx_packets);
+    ofl_fmt_uint_field(fmt, ", tx_err=", s->tx_errors);
+    ofl_fmt_str(fmt, "}");
+}
@@ -47,6 +47,7 @@
 
 
 struct ofl_exp;
+struct ofl_fmt;
 
 /****************************************************************************
  * Supplementary structure definitions.
@@ -229,9 +230,26 @@ struct ofl_match_header {
     uint16_t   length;           /* Match length */
 };
 
+/* Number of OXM fields of the OpenFlow basic class, which an ofl_match holds
+ * at fixed places indexed by field number, that is, OXM_FIELD(header). */
+#define OFL_MATCH_N_FIELDS (OFPXMT_OFB_IPV6_EXTHDR + 1)
+
+/* Bytes needed for the value and the mask of every field. */
+#define OFL_MATCH_VALUES_LEN 332
+
+/* An OXM match.  Each field's value, followed by its mask if it has one, is
+ * kept in 'values' at the offset for its field number, so that building and
+ * reading a match needs no allocation and an ofl_match can be copied and
+ * compared bytewise.  Fields of other OXM classes are not supported.
+ *
+ * Use ofl_structs_match_get() and OFL_MATCH_FOR_EACH_FIELD to read the
+ * fields, or ofl_structs_match_to_hmap() for code that still expects a
+ * hash map of ofl_match_tlv. */
 struct ofl_match {
     struct ofl_match_header   header; /* Match header */
-    struct hmap match_fields;         /* Match fields. Contain OXM TLV's  */
+    uint64_t present;                 /* 1 << field, for each field present. */
+    uint64_t masked;                  /* 1 << field, for each masked field. */
+    uint8_t values[OFL_MATCH_VALUES_LEN];
 };
 
 struct ofl_match_tlv{
@@ -396,46 +414,82 @@ struct ofl_meter_features {
     uint8_t max_color; /* Maximum color value */
 };
 
-/* 
-* Hackish solution for a generic put match
-*
-*/
-template <typename T>
-void ofl_structs_match_put(struct ofl_match *match, uint32_t header, T value){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv *) malloc(sizeof (struct ofl_match_tlv));
-    int len = ((header) & 0xff);
-    m->header = header;
-    m->value = (uint8_t*) malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-}
-
-template <typename T>
-void ofl_structs_match_put_masked(struct ofl_match *match, uint32_t header, T value, T mask){
-    struct ofl_match_tlv *m = (struct ofl_match_tlv *) malloc(sizeof (struct ofl_match_tlv));
-    int len = ((header) & 0xff);
+/****************************************************************************
+ * Utility functions to match structure
+ ****************************************************************************/
+void
+ofl_structs_match_init(struct ofl_match *match);
 
-    m->header = header & 0xffffff00;
+/* Sets the field that 'header' refers to, to 'value', or to 'value' with
+ * 'mask' if 'mask' is nonnull.  Only the field number in 'header' is used:
+ * the value and mask are as long as the field is.  A field that is already
+ * present is replaced.  Fields outside the OpenFlow basic class are ignored. */
+void
+ofl_structs_match_put_bytes(struct ofl_match *match, uint32_t header,
+                            const void *value, const void *mask);
+
+/* Returns the value of the field that 'header' refers to, followed by its
+ * mask if it has one, or NULL if the field is not present. */
+uint8_t *
+ofl_structs_match_get(const struct ofl_match *match, uint32_t header);
+
+/* Returns the OXM header of present field number 'field'. */
+uint32_t
+ofl_structs_match_field_header(const struct ofl_match *match, unsigned int field);
+
+/* Returns the value of present field number 'field', followed by its mask if
+ * it has one. */
+static inline uint8_t *
+ofl_structs_match_field_value(const struct ofl_match *match, unsigned int field)
+{
+    extern const uint16_t ofl_match_field_offsets[OFL_MATCH_N_FIELDS];
+    return (uint8_t *) match->values + ofl_match_field_offsets[field];
+}
 
-    /*set the masked bit */
-    m->header |= 1 << 8;
+/* Returns the length of the value of field number 'field'.  A masked field's
+ * mask follows its value and is as long. */
+static inline size_t
+ofl_structs_match_field_len(unsigned int field)
+{
+    extern const uint8_t ofl_match_field_lens[OFL_MATCH_N_FIELDS];
+    return ofl_match_field_lens[field];
+}
 
-    /* multiply the header len by 2 */
-    m->header |= ((header & 0xff) << 1);
-    m->value = (uint8_t*) malloc(len*2);    
-    memcpy(m->value, &value, len/2);
-    memcpy(m->value + len/2, &mask, len/2);
-    hmap_insert(&match->match_fields,&m->hmap_node, hash_int(header, 0));
-    match->header.length += len * 2  + 4;
+/* Returns the first field number at or after 'field' that is present in
+ * 'match', or OFL_MATCH_N_FIELDS if there is none. */
+static inline unsigned int
+ofl_structs_match_next_field(const struct ofl_match *match, unsigned int field)
+{
+    uint64_t rest = field < 64 ? match->present >> field << field : 0;
+    return rest ? __builtin_ctzll(rest) : OFL_MATCH_N_FIELDS;
 }
 
+/* Iterates FIELD over the numbers of the fields present in MATCH, in
+ * ascending order. */
+#define OFL_MATCH_FOR_EACH_FIELD(FIELD, MATCH)                          \
+    for ((FIELD) = ofl_structs_match_next_field(MATCH, 0);              \
+         (FIELD) < OFL_MATCH_N_FIELDS;                                  \
+         (FIELD) = ofl_structs_match_next_field(MATCH, (FIELD) + 1))
 
-/****************************************************************************
- * Utility functions to match structure
- ****************************************************************************/
+/* Fills 'fields', which must be uninitialized, with one ofl_match_tlv per
+ * field of 'match', for code written against the hash map representation
+ * that ofl_match used to have.  The values point into 'match'.  Free with
+ * ofl_structs_match_hmap_destroy(). */
 void
-ofl_structs_match_init(struct ofl_match *match);
+ofl_structs_match_to_hmap(const struct ofl_match *match, struct hmap *fields);
+
+void
+ofl_structs_match_hmap_destroy(struct hmap *fields);
+
+template <typename T>
+void ofl_structs_match_put(struct ofl_match *match, uint32_t header, T value){
+    ofl_structs_match_put_bytes(match, header, &value, NULL);
+}
+
+template <typename T>
+void ofl_structs_match_put_masked(struct ofl_match *match, uint32_t header, T value, T mask){
+    ofl_structs_match_put_bytes(match, header, &value, &mask);
+}
 
 void
 ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value);
@@ -917,4 +971,34 @@ ofl_structs_async_config_to_string(struct ofl_async_config *s);
 void
 ofl_structs_async_config_print(FILE * stream, struct ofl_async_config *s);
 
+
+/* Counterparts of the print functions above that print into a fixed buffer
+ * (see struct ofl_fmt in ofl-print.h).  Experimenter instructions print as
+ * their id, without calling back into the experimenter, and a match prints
+ * each field as name="value" or name="value/mask". */
+
+void
+ofl_structs_oxm_tlv_format(struct ofl_fmt *fmt, uint32_t header, const uint8_t *value);
+
+void
+ofl_structs_match_format(struct ofl_fmt *fmt, const struct ofl_match_header *match);
+
+void
+ofl_structs_instruction_format(struct ofl_fmt *fmt, const struct ofl_instruction_header *inst);
+
+void
+ofl_structs_port_format(struct ofl_fmt *fmt, const struct ofl_port *port);
+
+void
+ofl_structs_flow_stats_format(struct ofl_fmt *fmt, const struct ofl_flow_stats *s);
+
+void
+ofl_structs_table_stats_format(struct ofl_fmt *fmt, const struct ofl_table_stats *s);
+
+void
+ofl_structs_port_stats_format(struct ofl_fmt *fmt, const struct ofl_port_stats *s);
+
+void
+ofl_structs_queue_stats_format(struct ofl_fmt *fmt, const struct ofl_queue_stats *s);
+
 #endif /* OFL_STRUCTS_H */
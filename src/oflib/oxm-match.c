@@ -49,8 +49,6 @@
 
 #include <netinet/icmp6.h>
 #include "boost/assign.hpp"
-#include "../libopenflow/hmap.h"
-#include "../libopenflow/hash.h"
 #include "../libopenflow/ofpbuf.h"
 #include "../libopenflow/byte-order.h"
 #include "../libopenflow/packets.h"
@@ -113,136 +111,272 @@ enum oxm_field_index {
     N_OXM_FIELDS
 };
 
+/* Prerequisites of a field that depend on the values of other fields of the
+ * match, as bits that oxm_pull_match() sets as it parses ETH_TYPE and
+ * IP_PROTO.  A field's dl_prereqs is satisfied if any of its bits is set, and
+ * so is its nw_prereq, unless IP_PROTO was parsed and set none of them. */
+enum {
+    OXM_PRE_DL_IP        = 1 << 0,      /* ETH_TYPE is IPv4. */
+    OXM_PRE_DL_IPV6      = 1 << 1,      /* ETH_TYPE is IPv6. */
+    OXM_PRE_DL_ARP       = 1 << 2,      /* ETH_TYPE is ARP. */
+    OXM_PRE_DL_MPLS      = 1 << 3,      /* ETH_TYPE is MPLS unicast. */
+    OXM_PRE_DL_MPLS_MC   = 1 << 4,      /* ETH_TYPE is MPLS multicast. */
+    OXM_PRE_DL_PBB       = 1 << 5,      /* ETH_TYPE is PBB. */
+    OXM_PRE_NW_ANY       = 1 << 6,      /* IP_PROTO is present. */
+    OXM_PRE_NW_TCP       = 1 << 7,      /* IP_PROTO is TCP. */
+    OXM_PRE_NW_UDP       = 1 << 8,      /* IP_PROTO is UDP. */
+    OXM_PRE_NW_SCTP      = 1 << 9,      /* IP_PROTO is SCTP. */
+    OXM_PRE_NW_ICMP      = 1 << 10,     /* IP_PROTO is ICMP. */
+    OXM_PRE_NW_ICMPV6    = 1 << 11      /* IP_PROTO is ICMPv6. */
+};
+
 struct oxm_field {
-    struct hmap_node hmap_node;
     enum oxm_field_index index;       /* OFI_* value. */
     uint32_t header;                  /* OXM_* value. */
     uint16_t dl_type[N_OXM_DL_TYPES]; /* dl_type prerequisites. */
     uint8_t nw_proto;                 /* nw_proto prerequisite, if nonzero. */
     bool maskable;                    /* Writable with OXAST_REG_{MOVE,LOAD}? */
+
+    /* Computed by oxm_init() from the above. */
+    uint32_t dl_prereqs;              /* OXM_PRE_DL_* bits, 0 if none. */
+    uint32_t nw_prereq;               /* OXM_PRE_NW_* bit, 0 if none. */
+    uint64_t field_prereqs;           /* 1 << OXM_FIELD, for each field that
+                                       * must precede this one. */
 };
 
 /* All the known fields. */
 static struct oxm_field oxm_fields[N_OXM_FIELDS] = {
 #define DEFINE_FIELD(HEADER, DL_TYPES, NW_PROTO, MASKABLE)     \
-    { HMAP_NODE_NULL_INITIALIZER, OFI_OXM_##HEADER, OXM_##HEADER, \
-        DL_CONVERT DL_TYPES, NW_PROTO, MASKABLE },
+    { OFI_OXM_##HEADER, OXM_##HEADER, \
+        DL_CONVERT DL_TYPES, NW_PROTO, MASKABLE, 0, 0, 0 },
 #define DL_CONVERT(T1, T2) { CONSTANT_HTONS(T1), CONSTANT_HTONS(T2) }
 #include "oxm-match.def"
 };
 
-/* Hash table of 'oxm_fields'. */
-static struct hmap all_oxm_fields = HMAP_INITIALIZER(&all_oxm_fields);
+/* The known fields of the OpenFlow basic class, indexed by the field number
+ * and mask bit of their headers, that is, by OXM_TYPE_INDEX(header), or NULL
+ * for unknown headers. */
+#define OXM_TYPE_INDEX(HEADER) (((HEADER) >> 8) & 0x7f)
+static const struct oxm_field *oxm_field_table[OFL_MATCH_N_FIELDS * 2];
 
-static void
+/* Returns the OXM_PRE_DL_* bit for an ETH_TYPE of 'dl_type', in host byte
+ * order, or 0 if no field has it as prerequisite. */
+static uint32_t
+oxm_dl_type_prereq(uint16_t dl_type)
+{
+    switch (dl_type) {
+    case ETH_TYPE_IP:         return OXM_PRE_DL_IP;
+    case ETH_TYPE_IPV6:       return OXM_PRE_DL_IPV6;
+    case ETH_TYPE_ARP:        return OXM_PRE_DL_ARP;
+    case ETH_TYPE_MPLS:       return OXM_PRE_DL_MPLS;
+    case ETH_TYPE_MPLS_MCAST: return OXM_PRE_DL_MPLS_MC;
+    case ETH_TYPE_PBB:        return OXM_PRE_DL_PBB;
+    default:                  return 0;
+    }
+}
+
+/* Returns the OXM_PRE_NW_* bit for an IP_PROTO of 'nw_proto', or 0 if no
+ * field has it as prerequisite. */
+static uint32_t
+oxm_nw_proto_prereq(uint8_t nw_proto)
+{
+    switch (nw_proto) {
+    case IPPROTO_TCP:    return OXM_PRE_NW_TCP;
+    case IPPROTO_UDP:    return OXM_PRE_NW_UDP;
+    case IPPROTO_SCTP:   return OXM_PRE_NW_SCTP;
+    case IPPROTO_ICMP:   return OXM_PRE_NW_ICMP;
+    case IPPROTO_ICMPV6: return OXM_PRE_NW_ICMPV6;
+    default:             return 0;
+    }
+}
+
+static bool
 oxm_init(void)
 {
-    if (hmap_is_empty(&all_oxm_fields)) {
-        int i;
+    int i;
+
+    for (i = 0; i < N_OXM_FIELDS; i++) {
+        struct oxm_field *f = &oxm_fields[i];
+        int j;
 
-        for (i = 0; i < N_OXM_FIELDS; i++) {
-            struct oxm_field *f = &oxm_fields[i];
-            hmap_insert(&all_oxm_fields, &f->hmap_node,
-                        hash_int(f->header, 0));
+        for (j = 0; j < N_OXM_DL_TYPES; j++) {
+            if (f->dl_type[j]) {
+                f->dl_prereqs |= oxm_dl_type_prereq(ntohs(f->dl_type[j]));
+            }
+        }
+        if (f->nw_proto) {
+            f->nw_prereq = oxm_nw_proto_prereq(f->nw_proto);
+        }
+        if (f->index == OFI_OXM_OF_IN_PHY_PORT) {
+            f->field_prereqs = (uint64_t) 1 << OXM_FIELD(OXM_OF_IN_PORT);
+        } else if (f->index == OFI_OXM_OF_VLAN_PCP) {
+            f->field_prereqs = (uint64_t) 1 << OXM_FIELD(OXM_OF_VLAN_VID);
         }
+        oxm_field_table[OXM_TYPE_INDEX(f->header)] = f;
+    }
 
-        /* Verify that the header values are unique (duplicate "case" values
-         * cause a compile error). */
-        switch (0) {
+    /* Verify that the header values are unique (duplicate "case" values
+     * cause a compile error). */
+    switch (0) {
 #define DEFINE_FIELD(HEADER, DL_TYPE, NW_PROTO, MASKABLE)  \
-        case OXM_##HEADER: break;
+    case OXM_##HEADER: break;
 #include "oxm-match.def"
-        }
     }
+    return true;
 }
 
-static const struct oxm_field *
+/* Filled in before main() runs, so that threads may parse matches without
+ * locking. */
+static const bool oxm_initialized = oxm_init();
+
+static inline const struct oxm_field *
 oxm_field_lookup(uint32_t header)
 {
-    struct oxm_field *f;
+    const struct oxm_field *f;
 
-    oxm_init();
+    if (OXM_VENDOR(header) != OFPXMC_OPENFLOW_BASIC
+        || OXM_FIELD(header) >= OFL_MATCH_N_FIELDS) {
+        return NULL;
+    }
+    f = oxm_field_table[OXM_TYPE_INDEX(header)];
+    return f && f->header == header ? f : NULL;
+}
 
-    HMAP_FOR_EACH_WITH_HASH(f, struct oxm_field, hmap_node ,hash_int(header, 0),
-                             &all_oxm_fields) {
-        if (f->header == header) {
-            return f;
-        }
+/* Returns true if the prerequisites of 'field' are met by a match that has
+ * the fields in 'present' and whose ETH_TYPE and IP_PROTO set the
+ * OXM_PRE_* bits in 'prereqs'. */
+static inline bool
+oxm_prereqs_ok(const struct oxm_field *field, uint64_t present,
+               uint32_t prereqs)
+{
+    if (field->nw_prereq && prereqs & OXM_PRE_NW_ANY
+        && !(prereqs & field->nw_prereq)) {
+        return false;
+    }
+    if (field->dl_prereqs && !(prereqs & field->dl_prereqs)) {
+        return false;
     }
+    return (present & field->field_prereqs) == field->field_prereqs;
+}
+
+static uint8_t* get_oxm_value(struct ofl_match *m, uint32_t header){
 
+     return ofl_structs_match_get(m, header);
+}
+
+/* Returns the value of the field with exactly 'header', that is, with a mask
+ * only if 'header' has one, or NULL if there is no such field. */
+static uint8_t *
+get_oxm_exact(struct ofl_match *m, uint32_t header){
+
+    uint8_t *value = ofl_structs_match_get(m, header);
+    if (value && ofl_structs_match_field_header(m, OXM_FIELD(header)) == header)
+        return value;
     return NULL;
 }
+ 
+/* Adds the field with 'header' to 'match', which oxm_pull_match() has
+ * checked does not have it yet, with the value at 'value'.  'header' must not
+ * have a mask.  A cheaper ofl_structs_match_put_bytes() for the parser's
+ * use. */
+static inline void
+oxm_set_bytes(struct ofl_match *match, uint32_t header, const void *value)
+{
+    uint64_t bit = (uint64_t) 1 << OXM_FIELD(header);
+    uint8_t *dst = ofl_structs_match_field_value(match, OXM_FIELD(header));
 
-static bool
-check_present_prereq(const struct ofl_match *match, uint32_t header){
+    memcpy(dst, value, OXM_LENGTH(header));
+    match->present |= bit;
+    match->header.length += OXM_LENGTH(header) + 4;
+}
 
-    struct ofl_match_tlv *omt;
-    
-    /* Check for header */
-    HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(header, 0),
-          &match->match_fields) {
-         return true;        
-    }    
-    return false;
+/* Like oxm_set_bytes() for a 'header' with a mask, which is at 'mask'. */
+static inline void
+oxm_set_bytes_masked(struct ofl_match *match, uint32_t header,
+                     const void *value, const void *mask)
+{
+    uint64_t bit = (uint64_t) 1 << OXM_FIELD(header);
+    uint8_t *dst = ofl_structs_match_field_value(match, OXM_FIELD(header));
+    unsigned int len = OXM_LENGTH(header) / 2;
+
+    memcpy(dst, value, len);
+    memcpy(dst + len, mask, len);
+    match->present |= bit;
+    match->masked |= bit;
+    match->header.length += OXM_LENGTH(header) + 4;
 }
 
-static bool
-oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
+static inline void
+oxm_set8(struct ofl_match *match, uint32_t header, uint8_t value)
 {
-    
-    struct ofl_match_tlv *omt = NULL;
-    
-    /*Check for IP_PROTO */
-    if (field->nw_proto)
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IP_PROTO, 0),
-            &rule->match_fields) {
-            uint8_t ip_proto;
-            memcpy(&ip_proto,omt->value, sizeof(uint8_t));
-            if (field->nw_proto != ip_proto)
-                return false;
-    }  
-    
-    /* Check for eth_type */
-    if (!field->dl_type[0])
-        return true;
-    else {
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0),
-              &rule->match_fields) {
-              uint16_t eth_type;
-              memcpy(&eth_type, omt->value, sizeof(uint16_t));
-              if (field->dl_type[0] == htons(eth_type)) {
-                return true;
-              } else if (field->dl_type[1] && field->dl_type[1] ==  htons(eth_type)) {
-                return true;
-              }
-        }
-    }    
-    return false;
+    oxm_set_bytes(match, header, &value);
 }
 
-static bool
-check_oxm_dup(struct ofl_match *match,const struct oxm_field *om){
+static inline void
+oxm_set16(struct ofl_match *match, uint32_t header, uint16_t value)
+{
+    oxm_set_bytes(match, header, &value);
+}
 
-    struct ofl_match_tlv *t;
-    HMAP_FOR_EACH_WITH_HASH(t, struct ofl_match_tlv, hmap_node ,hash_int(om->header, 0),
-                             &match->match_fields) {
-        return true;
-    }
-    return false;
+static inline void
+oxm_set16m(struct ofl_match *match, uint32_t header, uint16_t value,
+           uint16_t mask)
+{
+    oxm_set_bytes_masked(match, header, &value, &mask);
+}
 
+static inline void
+oxm_set32(struct ofl_match *match, uint32_t header, uint32_t value)
+{
+    oxm_set_bytes(match, header, &value);
 }
 
-static uint8_t* get_oxm_value(struct ofl_match *m, uint32_t header){
+static inline void
+oxm_set32m(struct ofl_match *match, uint32_t header, uint32_t value,
+           uint32_t mask)
+{
+    oxm_set_bytes_masked(match, header, &value, &mask);
+}
 
-     struct ofl_match_tlv *t;
-     HMAP_FOR_EACH_WITH_HASH (t, struct ofl_match_tlv, hmap_node, hash_int(header, 0),
-          &m->match_fields) {
-         return t->value;        
-     }    
+static inline void
+oxm_set64(struct ofl_match *match, uint32_t header, uint64_t value)
+{
+    oxm_set_bytes(match, header, &value);
+}
 
-     return NULL;
+static inline void
+oxm_set64m(struct ofl_match *match, uint32_t header, uint64_t value,
+           uint64_t mask)
+{
+    oxm_set_bytes_masked(match, header, &value, &mask);
 }
- 
+
+static inline void
+oxm_set_eth(struct ofl_match *match, uint32_t header, const uint8_t *value)
+{
+    oxm_set_bytes(match, header, value);
+}
+
+static inline void
+oxm_set_eth_m(struct ofl_match *match, uint32_t header, const uint8_t *value,
+              const uint8_t *mask)
+{
+    oxm_set_bytes_masked(match, header, value, mask);
+}
+
+static inline void
+oxm_set_ipv6(struct ofl_match *match, uint32_t header, const uint8_t *value)
+{
+    oxm_set_bytes(match, header, value);
+}
+
+static inline void
+oxm_set_ipv6m(struct ofl_match *match, uint32_t header, const uint8_t *value,
+              const uint8_t *mask)
+{
+    oxm_set_bytes_masked(match, header, value, mask);
+}
+
 static int
 parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
                 const void *value, const void *mask){
@@ -250,38 +384,36 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
     switch (f->index) {
         case OFI_OXM_OF_IN_PORT: {
             uint32_t* in_port = (uint32_t*) value;
-            ofl_structs_match_put32(match, f->header, htonl(*in_port));
+            oxm_set32(match, f->header, htonl(*in_port));
             return 0;
         }
         case OFI_OXM_OF_IN_PHY_PORT:{
-            /* Check for inport presence */
-            if (check_present_prereq(match,OXM_OF_IN_PORT))
-                ofl_structs_match_put32(match, f->header, htonl(*((uint32_t*) value)));
-            else return ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_PREREQ);
-
+            /* oxm_prereqs_ok() checked for IN_PORT. */
+            oxm_set32(match, f->header, htonl(*((uint32_t*) value)));
+            return 0;
         }
         case OFI_OXM_OF_METADATA:{
-            ofl_structs_match_put64(match, f->header, hton64(*((uint64_t*) value)));
+            oxm_set64(match, f->header, hton64(*((uint64_t*) value)));
             return 0;
         }
         case OFI_OXM_OF_METADATA_W:{
-            ofl_structs_match_put64m(match, f->header,hton64(*((uint64_t*) value)),hton64(*((uint64_t*) mask)));
+            oxm_set64m(match, f->header,hton64(*((uint64_t*) value)),hton64(*((uint64_t*) mask)));
             return 0;
         }
         /* Ethernet header. */
         case OFI_OXM_OF_ETH_DST:
         case OFI_OXM_OF_ETH_SRC:{
-            ofl_structs_match_put_eth(match, f->header,(uint8_t* )value);
+            oxm_set_eth(match, f->header,(uint8_t* )value);
             return 0;
         }
         case OFI_OXM_OF_ETH_DST_W:
         case OFI_OXM_OF_ETH_SRC_W:{
-            ofl_structs_match_put_eth_m(match, f->header,(uint8_t* )value, (uint8_t* )mask );
+            oxm_set_eth_m(match, f->header,(uint8_t* )value, (uint8_t* )mask );
             return 0;
         }
         case OFI_OXM_OF_ETH_TYPE:{
             uint16_t* eth_type = (uint16_t*) value;
-            ofl_structs_match_put16(match, f->header, ntohs(*eth_type));
+            oxm_set16(match, f->header, ntohs(*eth_type));
             return 0;
         }
         /* 802.1Q header. */
@@ -291,7 +423,7 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
                 return ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_VALUE);
             }
             else
-                ofl_structs_match_put16(match, f->header, ntohs(*vlan_id));
+                oxm_set16(match, f->header, ntohs(*vlan_id));
             return 0;
         }
 
@@ -302,22 +434,18 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
             if (ntohs(*vlan_id) > OFPVID_PRESENT+VLAN_VID_MAX)
                 return ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_VALUE);
             else 
-                ofl_structs_match_put16m(match, f->header, ntohs(*vlan_id), ntohs(*vlan_mask));
+                oxm_set16m(match, f->header, ntohs(*vlan_id), ntohs(*vlan_mask));
             return 0;
         }
 
         case OFI_OXM_OF_VLAN_PCP:{
-            /* Check for VLAN_VID presence */
-            if (check_present_prereq(match,OXM_OF_VLAN_VID)){
-                uint8_t *p = get_oxm_value(match,OXM_OF_VLAN_VID);
-                if (*(uint16_t*) p != OFPVID_NONE ){
-                    uint8_t *v = (uint8_t*) value;
-                    ofl_structs_match_put8(match, f->header, *v);
-                }
-                return 0;
+            /* oxm_prereqs_ok() checked for VLAN_VID. */
+            uint8_t *p = get_oxm_value(match,OXM_OF_VLAN_VID);
+            if (*(uint16_t*) p != OFPVID_NONE ){
+                uint8_t *v = (uint8_t*) value;
+                oxm_set8(match, f->header, *v);
             }
-            else
-                return ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_PREREQ);
+            return 0;
         }
             /* IP header. */
         case OFI_OXM_OF_IP_DSCP:{
@@ -326,14 +454,14 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
                 return ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_VALUE);
             }
             else{
-                ofl_structs_match_put8(match, f->header, *v);
+                oxm_set8(match, f->header, *v);
                 return 0;
             }
         }
         case OFI_OXM_OF_IP_ECN:
         case OFI_OXM_OF_IP_PROTO:{
             uint8_t *v = (uint8_t*) value;
-            ofl_structs_match_put8(match, f->header, *v);
+            oxm_set8(match, f->header, *v);
             return 0;
         }
 
@@ -342,41 +470,41 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
         case OFI_OXM_OF_IPV4_DST:
         case OFI_OXM_OF_ARP_TPA:
         case OFI_OXM_OF_ARP_SPA:
-             ofl_structs_match_put32(match, f->header, *((uint32_t*) value));
+             oxm_set32(match, f->header, *((uint32_t*) value));
              return 0;
         case OFI_OXM_OF_IPV4_DST_W:
         case OFI_OXM_OF_IPV4_SRC_W:
         case OFI_OXM_OF_ARP_SPA_W:
         case OFI_OXM_OF_ARP_TPA_W:
-             ofl_structs_match_put32m(match, f->header, *((uint32_t*) value), *((uint32_t*) mask));
+             oxm_set32m(match, f->header, *((uint32_t*) value), *((uint32_t*) mask));
              return 0;
         case OFI_OXM_OF_ARP_SHA:
         case OFI_OXM_OF_ARP_THA:
-            ofl_structs_match_put_eth(match, f->header,(uint8_t* )value);
+            oxm_set_eth(match, f->header,(uint8_t* )value);
             return 0;
 
         case OFI_OXM_OF_ARP_SHA_W:
         case OFI_OXM_OF_ARP_THA_W:
-            ofl_structs_match_put_eth_m(match, f->header,(uint8_t* )value, (uint8_t* )mask );
+            oxm_set_eth_m(match, f->header,(uint8_t* )value, (uint8_t* )mask );
             return 0;
 
             /* IPv6 addresses. */
         case OFI_OXM_OF_IPV6_SRC:
         case OFI_OXM_OF_IPV6_DST:{
-            ofl_structs_match_put_ipv6(match, f->header,(uint8_t* ) value);
+            oxm_set_ipv6(match, f->header,(uint8_t* ) value);
             return 0;
         }
         case OFI_OXM_OF_IPV6_SRC_W:
         case OFI_OXM_OF_IPV6_DST_W:{
-            ofl_structs_match_put_ipv6m(match, f->header,(uint8_t* ) value,(uint8_t* ) mask);
+            oxm_set_ipv6m(match, f->header,(uint8_t* ) value,(uint8_t* ) mask);
             return 0;
         }
         case OFI_OXM_OF_IPV6_FLABEL:{
-            ofl_structs_match_put32(match, f->header, ntohl(*((uint32_t*) value)));
+            oxm_set32(match, f->header, ntohl(*((uint32_t*) value)));
             return 0;
         }
         case OFI_OXM_OF_IPV6_FLABEL_W:{
-            ofl_structs_match_put32m(match, f->header, ntohl(*((uint32_t*) value)), ntohl(*((uint32_t*) mask)));
+            oxm_set32m(match, f->header, ntohl(*((uint32_t*) value)), ntohl(*((uint32_t*) mask)));
             return 0;
         }
         /* TCP header. */
@@ -388,7 +516,7 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
             /* SCTP header. */
         case OFI_OXM_OF_SCTP_SRC:
         case OFI_OXM_OF_SCTP_DST:
-                ofl_structs_match_put16(match, f->header, ntohs(*((uint16_t*) value)));
+                oxm_set16(match, f->header, ntohs(*((uint16_t*) value)));
                 return 0;
 
             /* ICMP header. */
@@ -398,54 +526,54 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
         case OFI_OXM_OF_ICMPV6_TYPE:
         case OFI_OXM_OF_ICMPV6_CODE:{
                 uint8_t *v = (uint8_t*) value;
-                ofl_structs_match_put8(match, f->header, *v);
+                oxm_set8(match, f->header, *v);
                 return 0;
         }
             /* IPv6 Neighbor Discovery. */
         case OFI_OXM_OF_IPV6_ND_TARGET:
-            ofl_structs_match_put_ipv6(match, f->header,(uint8_t* ) value);
+            oxm_set_ipv6(match, f->header,(uint8_t* ) value);
             return 0;
         case OFI_OXM_OF_IPV6_ND_SLL:
         case OFI_OXM_OF_IPV6_ND_TLL:
-            ofl_structs_match_put_eth(match, f->header,(uint8_t* )value);
+            oxm_set_eth(match, f->header,(uint8_t* )value);
             return 0;
             /* ARP header. */
         case OFI_OXM_OF_ARP_OP:{
-                ofl_structs_match_put16(match, f->header, ntohs(*((uint16_t*) value)));
+                oxm_set16(match, f->header, ntohs(*((uint16_t*) value)));
             return 0;
         }
         case OFI_OXM_OF_MPLS_LABEL:
-                ofl_structs_match_put32(match, f->header, ntohl(*((uint32_t*) value)));
+                oxm_set32(match, f->header, ntohl(*((uint32_t*) value)));
                 return 0;
         case OFI_OXM_OF_MPLS_TC:{
             uint8_t *v = (uint8_t*) value;
-            ofl_structs_match_put8(match, f->header, *v);
+            oxm_set8(match, f->header, *v);
             return 0;
         }
         case OFI_OXM_OF_MPLS_BOS:{
              uint8_t *v = (uint8_t*) value;
-             ofl_structs_match_put8(match, f->header, *v);
+             oxm_set8(match, f->header, *v);
              return 0;
         }
         case OFI_OXM_OF_PBB_ISID:
-             ofl_structs_match_put32(match, f->header, ntohl(*((uint32_t*) value)));
+             oxm_set32(match, f->header, ntohl(*((uint32_t*) value)));
              return 0;
         case OFI_OXM_OF_PBB_ISID_W:
-             ofl_structs_match_put32m(match, f->header, ntohl(*((uint32_t*) value)), ntohl(*((uint32_t*) mask)));
+             oxm_set32m(match, f->header, ntohl(*((uint32_t*) value)), ntohl(*((uint32_t*) mask)));
              return 0;
         case OFI_OXM_OF_TUNNEL_ID:{
-            ofl_structs_match_put64(match, f->header, *((uint64_t*) value));
+            oxm_set64(match, f->header, *((uint64_t*) value));
             return 0;
         }
         case OFI_OXM_OF_TUNNEL_ID_W:{
-            ofl_structs_match_put64m(match, f->header,*((uint64_t*) value),*((uint64_t*) mask));
+            oxm_set64m(match, f->header,*((uint64_t*) value),*((uint64_t*) mask));
             return 0;
         }
         case OFI_OXM_OF_IPV6_EXTHDR:
-            ofl_structs_match_put16(match, f->header, ntohs(*((uint16_t*) value)));
+            oxm_set16(match, f->header, ntohs(*((uint16_t*) value)));
             return 0;
         case OFI_OXM_OF_IPV6_EXTHDR_W:
-            ofl_structs_match_put16m(match, f->header, ntohs(*((uint16_t*) value)),ntohs(*((uint16_t*) mask)));
+            oxm_set16m(match, f->header, ntohs(*((uint16_t*) value)),ntohs(*((uint16_t*) mask)));
             return 0;
         case N_OXM_FIELDS:
             NOT_REACHED();
@@ -460,13 +588,15 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
 
 
 
-/* Puts the match in a hash_map structure */
+/* Puts the match in 'match_dst' */
 int 
 oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
 {
 
     uint32_t header;
+    uint32_t prereqs = 0;       /* OXM_PRE_* bits. */
     uint8_t *p;
+    ofl_structs_match_init(match_dst);
     p = (uint8_t*) ofpbuf_try_pull(buf, match_len);
     
     if (!p) {
@@ -476,7 +606,6 @@ oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
         
         return ofp_mkerr(OFPET_BAD_MATCH, OFPBRC_BAD_LEN);
     }
-    ofl_structs_match_init(match_dst);
     while ((header = oxm_entry_ok(p, match_len)) != 0) {
         
         unsigned length = OXM_LENGTH(header);
@@ -490,10 +619,10 @@ oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
         else if (OXM_HASMASK(header) && !f->maskable){
             error = ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_MASK);
         }      
-        else if (!oxm_prereqs_ok(f, match_dst)) {
+        else if (!oxm_prereqs_ok(f, match_dst->present, prereqs)) {
             error = ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_PREREQ);
         }
-        else if (check_oxm_dup(match_dst,f)){            
+        else if (match_dst->present & ((uint64_t) 1 << OXM_FIELD(header))) {
             error = ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_DUP_FIELD);
         }
         else {
@@ -501,6 +630,11 @@ oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
              * because they are included in 'header' and oxm_field_lookup()
              * checked them already. */
             error = parse_oxm_entry(match_dst, f, p + 4, p + 4 + length / 2);
+            if (f->index == OFI_OXM_OF_ETH_TYPE) {
+                prereqs |= oxm_dl_type_prereq(ntohs(get_unaligned_u16((const uint16_t *) (p + 4))));
+            } else if (f->index == OFI_OXM_OF_IP_PROTO) {
+                prereqs |= OXM_PRE_NW_ANY | oxm_nw_proto_prereq(p[4]);
+            }
         }
         if (error) {
             VLOG_DBG_RL(LOG_MODULE,&rl, "bad oxm_entry with vendor=%"PRIu32", "
@@ -690,102 +824,101 @@ is_requisite(uint32_t header){
 /* Puts the match in the buffer */
 int oxm_put_match(struct ofpbuf *buf, struct ofl_match *omt){
 
-    struct ofl_match_tlv *oft;
+    uint8_t *value_p;
+    unsigned int field;
     int start_len = buf->size;
     int match_len;
     
     
     /* We put all pre-requisites fields first */
     /* In port present */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IN_PORT, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_IN_PORT))) {
         uint32_t value;
-        memcpy(&value, oft->value,sizeof(uint32_t)); 
-        oxm_put_32(buf,oft->header, htonl(value));
+        memcpy(&value, value_p,sizeof(uint32_t)); 
+        oxm_put_32(buf,OXM_OF_IN_PORT, htonl(value));
     }
     
     /* L2 Pre-requisites */
     
     /* Ethernet type */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_ETH_TYPE))) {
         uint16_t value;
-        memcpy(&value, oft->value,sizeof(uint16_t));
-        oxm_put_16(buf,oft->header, htons(value));           
+        memcpy(&value, value_p,sizeof(uint16_t));
+        oxm_put_16(buf,OXM_OF_ETH_TYPE, htons(value));           
     }
     
      /* VLAN ID */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_VLAN_VID, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_VLAN_VID))) {
          uint16_t value;
-         memcpy(&value, oft->value,sizeof(uint16_t));
-         oxm_put_16(buf,oft->header, htons(value));
+         memcpy(&value, value_p,sizeof(uint16_t));
+         oxm_put_16(buf,OXM_OF_VLAN_VID, htons(value));
     }
     
     /* L3 Pre-requisites */   
-     HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IP_PROTO, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_IP_PROTO))) {
          uint8_t value;
-         memcpy(&value, oft->value,sizeof(uint8_t));
-         oxm_put_8(buf,oft->header, value);
+         memcpy(&value, value_p,sizeof(uint8_t));
+         oxm_put_8(buf,OXM_OF_IP_PROTO, value);
     }    
 
     /* Loop through the remaining fields */   
-    HMAP_FOR_EACH(oft, struct ofl_match_tlv, hmap_node, &omt->match_fields){
-        
-        if (is_requisite(oft->header))
+    OFL_MATCH_FOR_EACH_FIELD (field, omt) {
+        uint32_t header = ofl_structs_match_field_header(omt, field);
+        uint8_t *oft_value = ofl_structs_match_field_value(omt, field);
+
+        if (is_requisite(header))
             /*We already inserted  fields that are pre requisites to others */           
              continue;
         else {
-            uint8_t length = OXM_LENGTH(oft->header) ;
+            uint8_t length = OXM_LENGTH(header) ;
             bool has_mask =false;
-            if (OXM_HASMASK(oft->header)){
+            if (OXM_HASMASK(header)){
                length = length / 2;
                has_mask = true;
             }               
             switch (length){
                 case (sizeof(uint8_t)):{
                     uint8_t value;
-                    memcpy(&value, oft->value,sizeof(uint8_t));
+                    memcpy(&value, oft_value,sizeof(uint8_t));
                     if(!has_mask) 
-                        oxm_put_8(buf,oft->header, value);
+                        oxm_put_8(buf,header, value);
                     else {
                         uint8_t mask;
-                        memcpy(&mask,oft->value + length ,sizeof(uint8_t));
-                        oxm_put_8w(buf, oft->header,value,mask);
+                        memcpy(&mask,oft_value + length ,sizeof(uint8_t));
+                        oxm_put_8w(buf, header,value,mask);
                     }
                     break;
                   }
                 case (sizeof(uint16_t)):{ 
                     uint16_t value;
-                    memcpy(&value, oft->value,sizeof(uint16_t));
+                    memcpy(&value, oft_value,sizeof(uint16_t));
                     if(!has_mask) 
-                        oxm_put_16(buf,oft->header, htons(value));
+                        oxm_put_16(buf,header, htons(value));
                     else {
                         uint16_t mask;
-                        memcpy(&mask,oft->value + length ,sizeof(uint16_t));
-                        oxm_put_16w(buf, oft->header,htons(value),htons(mask));
+                        memcpy(&mask,oft_value + length ,sizeof(uint16_t));
+                        oxm_put_16w(buf, header,htons(value),htons(mask));
                     }   
                     break;     
                 }    
                 case (sizeof(uint32_t)):{
                     uint32_t value;
-                    memcpy(&value, oft->value,sizeof(uint32_t));
+                    memcpy(&value, oft_value,sizeof(uint32_t));
 					if(!has_mask)
-						if (oft->header == OXM_OF_IPV4_DST || oft->header == OXM_OF_IPV4_SRC
-							||oft->header == OXM_OF_ARP_SPA || oft->header == OXM_OF_ARP_TPA)
-							oxm_put_32(buf,oft->header, value);
+						if (header == OXM_OF_IPV4_DST || header == OXM_OF_IPV4_SRC
+							||header == OXM_OF_ARP_SPA || header == OXM_OF_ARP_TPA)
+							oxm_put_32(buf,header, value);
 						else
-							oxm_put_32(buf,oft->header, htonl(value));
+							oxm_put_32(buf,header, htonl(value));
                     else {
                          uint32_t mask;
-                         memcpy(&mask,oft->value + length ,sizeof(uint32_t));
-						 if (oft->header == OXM_OF_IPV4_DST_W|| oft->header == OXM_OF_IPV4_SRC_W
-							||oft->header == OXM_OF_ARP_SPA_W || oft->header == OXM_OF_ARP_TPA_W){
-                            oxm_put_32w(buf, oft->header, value, mask);
+                         memcpy(&mask,oft_value + length ,sizeof(uint32_t));
+						 if (header == OXM_OF_IPV4_DST_W|| header == OXM_OF_IPV4_SRC_W
+							||header == OXM_OF_ARP_SPA_W || header == OXM_OF_ARP_TPA_W){
+                            oxm_put_32w(buf, header, value, mask);
                             }
 						 else {
-							oxm_put_32w(buf, oft->header, htonl(value),htonl(mask));
+							oxm_put_32w(buf, header, htonl(value),htonl(mask));
                          }
                     }
                       break;     
@@ -793,37 +926,37 @@ int oxm_put_match(struct ofpbuf *buf, struct ofl_match *omt){
                 }
                 case (sizeof(uint64_t)):{ 
                      uint64_t value;
-                     memcpy(&value, oft->value,sizeof(uint64_t));
+                     memcpy(&value, oft_value,sizeof(uint64_t));
                      if(!has_mask) 
-                         oxm_put_64(buf,oft->header, hton64(value));
+                         oxm_put_64(buf,header, hton64(value));
                      else {
                          uint64_t mask;
-                         memcpy(&mask,oft->value + length ,sizeof(uint64_t));
-                         oxm_put_64w(buf, oft->header,hton64(value),hton64(mask));
+                         memcpy(&mask,oft_value + length ,sizeof(uint64_t));
+                         oxm_put_64w(buf, header,hton64(value),hton64(mask));
                      }
                      break;      
                 }                 
                 case (ETH_ADDR_LEN):{ 
                      uint8_t value[ETH_ADDR_LEN];
-                     memcpy(&value, oft->value,ETH_ADDR_LEN);
+                     memcpy(&value, oft_value,ETH_ADDR_LEN);
                      if(!has_mask) 
-                         oxm_put_eth(buf,oft->header, value);
+                         oxm_put_eth(buf,header, value);
                      else {
                          uint8_t mask[ETH_ADDR_LEN];
-                         memcpy(&mask,oft->value + length ,ETH_ADDR_LEN);
-                         oxm_put_ethm(buf, oft->header,value,mask);
+                         memcpy(&mask,oft_value + length ,ETH_ADDR_LEN);
+                         oxm_put_ethm(buf, header,value,mask);
                       }  
                       break;    
                    }
                case (IPv6_ADDR_LEN):{ 
                      uint8_t value[IPv6_ADDR_LEN];
-                     memcpy(value, oft->value,IPv6_ADDR_LEN);
+                     memcpy(value, oft_value,IPv6_ADDR_LEN);
                      if(!has_mask) 
-                         oxm_put_ipv6(buf,oft->header, value);
+                         oxm_put_ipv6(buf,header, value);
                      else {
                          uint8_t mask[IPv6_ADDR_LEN];
-                         memcpy(&mask,oft->value + length ,IPv6_ADDR_LEN);
-                         oxm_put_ipv6m(buf, oft->header,value,mask);
+                         memcpy(&mask,oft_value + length ,IPv6_ADDR_LEN);
+                         oxm_put_ipv6m(buf, header,value,mask);
                       }  
                       break;    
                    }
@@ -843,130 +976,129 @@ already comes in the network byte order, so if we use the other function, values
 will not be in the desired format. */
 int oxm_put_packet_match(struct ofpbuf *buf, struct ofl_match *omt){
 
-    struct ofl_match_tlv *oft;
+    uint8_t *value_p;
+    unsigned int field;
     int start_len = buf->size;
     int match_len;
     
     
     /* We put all pre-requisites fields first */
     /* In port present */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IN_PORT, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_IN_PORT))) {
         uint32_t value;
-        memcpy(&value, oft->value,sizeof(uint32_t)); 
-        oxm_put_32(buf,oft->header, value);
+        memcpy(&value, value_p,sizeof(uint32_t)); 
+        oxm_put_32(buf,OXM_OF_IN_PORT, value);
     }
     
     /* L2 Pre-requisites */
     
     /* Ethernet type */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_ETH_TYPE))) {
         uint16_t value;
-        memcpy(&value, oft->value,sizeof(uint16_t));
-        oxm_put_16(buf,oft->header, value);           
+        memcpy(&value, value_p,sizeof(uint16_t));
+        oxm_put_16(buf,OXM_OF_ETH_TYPE, value);           
     }
     
      /* VLAN ID */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_VLAN_VID, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_VLAN_VID))) {
          uint16_t value;
-         memcpy(&value, oft->value,sizeof(uint16_t));
-         oxm_put_16(buf,oft->header, value);
+         memcpy(&value, value_p,sizeof(uint16_t));
+         oxm_put_16(buf,OXM_OF_VLAN_VID, value);
     }
     
     /* L3 Pre-requisites */   
-     HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IP_PROTO, 0),
-          &omt->match_fields) {
+    if ((value_p = get_oxm_exact(omt, OXM_OF_IP_PROTO))) {
          uint8_t value;
-         memcpy(&value, oft->value,sizeof(uint8_t));
-         oxm_put_8(buf,oft->header, value);
+         memcpy(&value, value_p,sizeof(uint8_t));
+         oxm_put_8(buf,OXM_OF_IP_PROTO, value);
     }    
 
     /* Loop through the remaining fields */   
-    HMAP_FOR_EACH(oft, struct ofl_match_tlv, hmap_node, &omt->match_fields){
-        
-        if (is_requisite(oft->header))
+    OFL_MATCH_FOR_EACH_FIELD (field, omt) {
+        uint32_t header = ofl_structs_match_field_header(omt, field);
+        uint8_t *oft_value = ofl_structs_match_field_value(omt, field);
+
+        if (is_requisite(header))
             /*We already inserted  fields that are pre requisites to others */           
              continue;
         else {
-            uint8_t length = OXM_LENGTH(oft->header) ;
+            uint8_t length = OXM_LENGTH(header) ;
             bool has_mask =false;
-            if (OXM_HASMASK(oft->header)){
+            if (OXM_HASMASK(header)){
                length = length / 2;
                has_mask = true;
             }               
             switch (length){
                 case (sizeof(uint8_t)):{
                     uint8_t value;
-                    memcpy(&value, oft->value,sizeof(uint8_t));
+                    memcpy(&value, oft_value,sizeof(uint8_t));
                     if(!has_mask) 
-                        oxm_put_8(buf,oft->header, value);
+                        oxm_put_8(buf,header, value);
                     else {
                         uint8_t mask;
-                        memcpy(&mask,oft->value + length ,sizeof(uint8_t));
-                        oxm_put_8w(buf, oft->header,value,mask);
+                        memcpy(&mask,oft_value + length ,sizeof(uint8_t));
+                        oxm_put_8w(buf, header,value,mask);
                     }
                     break;
                   }
                 case (sizeof(uint16_t)):{ 
                     uint16_t value;
-                    memcpy(&value, oft->value,sizeof(uint16_t));
+                    memcpy(&value, oft_value,sizeof(uint16_t));
                     if(!has_mask) 
-                        oxm_put_16(buf,oft->header, value);
+                        oxm_put_16(buf,header, value);
                     else {
                         uint16_t mask;
-                        memcpy(&mask,oft->value + length ,sizeof(uint16_t));
-                        oxm_put_16w(buf, oft->header,value,mask);
+                        memcpy(&mask,oft_value + length ,sizeof(uint16_t));
+                        oxm_put_16w(buf, header,value,mask);
                     }   
                     break;     
                 }    
                 case (sizeof(uint32_t)):{ 
                     uint32_t value;
-                    memcpy(&value, oft->value,sizeof(uint32_t));
+                    memcpy(&value, oft_value,sizeof(uint32_t));
                     if(!has_mask) 
-                         oxm_put_32(buf,oft->header, value);
+                         oxm_put_32(buf,header, value);
                     else {
                          uint32_t mask;
-                         memcpy(&mask,oft->value + length ,sizeof(uint32_t));
-                         oxm_put_32w(buf, oft->header, value, mask);
+                         memcpy(&mask,oft_value + length ,sizeof(uint32_t));
+                         oxm_put_32w(buf, header, value, mask);
                     } 
                       break;     
                             
                 }
                 case (sizeof(uint64_t)):{ 
                      uint64_t value;
-                     memcpy(&value, oft->value,sizeof(uint64_t));
+                     memcpy(&value, oft_value,sizeof(uint64_t));
                      if(!has_mask) 
-                         oxm_put_64(buf,oft->header, value);
+                         oxm_put_64(buf,header, value);
                      else {
                          uint64_t mask;
-                         memcpy(&mask,oft->value + length ,sizeof(uint64_t));
-                         oxm_put_64w(buf, oft->header, value, mask);
+                         memcpy(&mask,oft_value + length ,sizeof(uint64_t));
+                         oxm_put_64w(buf, header, value, mask);
                      }
                      break;      
                 }                 
                 case (ETH_ADDR_LEN):{ 
                      uint8_t value[ETH_ADDR_LEN];
-                     memcpy(&value, oft->value,ETH_ADDR_LEN);
+                     memcpy(&value, oft_value,ETH_ADDR_LEN);
                      if(!has_mask) 
-                         oxm_put_eth(buf,oft->header, value);
+                         oxm_put_eth(buf,header, value);
                      else {
                          uint8_t mask[ETH_ADDR_LEN];
-                         memcpy(&mask,oft->value + length ,ETH_ADDR_LEN);
-                         oxm_put_ethm(buf, oft->header,value,mask);
+                         memcpy(&mask,oft_value + length ,ETH_ADDR_LEN);
+                         oxm_put_ethm(buf, header,value,mask);
                       }  
                       break;    
                    }
                case (IPv6_ADDR_LEN):{ 
                      uint8_t value[IPv6_ADDR_LEN];
-                     memcpy(value, oft->value,IPv6_ADDR_LEN);
+                     memcpy(value, oft_value,IPv6_ADDR_LEN);
                      if(!has_mask) 
-                         oxm_put_ipv6(buf,oft->header, value);
+                         oxm_put_ipv6(buf,header, value);
                      else {
                          uint8_t mask[IPv6_ADDR_LEN];
-                         memcpy(&mask,oft->value + length ,IPv6_ADDR_LEN);
-                         oxm_put_ipv6m(buf, oft->header,value,mask);
+                         memcpy(&mask,oft_value + length ,IPv6_ADDR_LEN);
+                         oxm_put_ipv6m(buf, header,value,mask);
                       }  
                       break;    
                    }
@@ -0,0 +1,179 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Measures the cost of waking a cooperative thread on file descriptor
+ * readiness while many other file descriptors are being waited on but stay
+ * idle, for each poll backend.
+ *
+ * Unless NOX is configured with --enable-ndebug, libstdc++ debug mode makes
+ * the scheduler's own bookkeeping grow with the number of blocked threads, so
+ * the numbers with many idle sockets overstate the cost of both backends.
+ *
+ * usage: bench-coop-fd-wait [N_IDLE [N_HOT [ROUNDS]]] */
+
+#include "threads/cooperative.hh"
+#include <boost/bind.hpp>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "timeval.hh"
+
+using namespace vigil;
+
+static Co_sema woken;
+
+static void
+make_socketpair(int fds[2])
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+}
+
+/* FSM that waits on 'fd' forever. */
+static void
+idle_fsm(int fd)
+{
+    co_fd_read_wait(fd, NULL);
+    co_fsm_block();
+}
+
+/* FSM that drains 'fd' and reports each wakeup. */
+static void
+hot_fsm(int fd, bool *started)
+{
+    char buf[64];
+    if (*started) {
+        while (read(fd, buf, sizeof buf) > 0) {
+            continue;
+        }
+        woken.up();
+    }
+    *started = true;
+    co_fd_read_wait(fd, NULL);
+    co_fsm_block();
+}
+
+static void
+run(const char *name, int n_idle, int n_hot, int rounds)
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    for (int i = 0; i < n_idle; i++) {
+        int fds[2];
+        make_socketpair(fds);
+        co_fsm_create(&co_group_coop, boost::bind(idle_fsm, fds[0]));
+    }
+
+    std::vector<int> peers(n_hot);
+    bool *started = new bool[n_hot];
+    for (int i = 0; i < n_hot; i++) {
+        int fds[2];
+        make_socketpair(fds);
+        peers[i] = fds[1];
+        started[i] = false;
+        co_fsm_create(&co_group_coop,
+                      boost::bind(hot_fsm, fds[0], &started[i]));
+    }
+
+    /* Let every FSM register its wait. */
+    co_yield();
+
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < rounds; i++) {
+        for (int j = 0; j < n_hot; j++) {
+            write(peers[j], "x", 1);
+        }
+        for (int j = 0; j < n_hot; j++) {
+            woken.down();
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    double usecs = timeval_to_double(end - start) * 1e6;
+    printf("%-6s %8d idle %4d hot %7d wakeups: %8.2f us/wakeup\n",
+           name, n_idle, n_hot, rounds * n_hot, usecs / (rounds * n_hot));
+    fflush(stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_idle = argc > 1 ? atoi(argv[1]) : 10000;
+    int n_hot = argc > 2 ? atoi(argv[2]) : 4;
+    int rounds = argc > 3 ? atoi(argv[3]) : 2000;
+
+    /* Each socket pair takes two file descriptors. */
+    struct rlimit rl;
+    if (!getrlimit(RLIMIT_NOFILE, &rl)) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+        int max_idle = (int) (rl.rlim_cur - 64) / 2 - n_hot;
+        if (n_idle > max_idle) {
+            fprintf(stderr, "file descriptor limit allows only %d idle "
+                    "sockets\n", max_idle);
+            n_idle = max_idle;
+        }
+    }
+
+    static const struct {
+        const char *name;
+        enum co_poll_backend backend;
+    } backends[] = {
+        { "poll", CO_POLL_POLL },
+        { "epoll", CO_POLL_EPOLL },
+    };
+    for (size_t i = 0; i < sizeof backends / sizeof *backends; i++) {
+        /* The backend must be chosen before co_init(), so run each
+         * configuration in a fresh process. */
+        int idle_counts[] = { 0, n_idle };
+        for (int j = 0; j < 2; j++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                exit(EXIT_FAILURE);
+            } else if (!pid) {
+                if (!co_set_poll_backend(backends[i].backend)) {
+                    printf("%-6s not supported\n", backends[i].name);
+                    exit(EXIT_SUCCESS);
+                }
+                run(backends[i].name, idle_counts[j], n_hot, rounds);
+                exit(EXIT_SUCCESS);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    return 0;
+}
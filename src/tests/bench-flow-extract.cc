@@ -0,0 +1,277 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times building a Flow from each frame of a pcap trace, read through
+ * Pcapreader as nox reads "pcap:" connections.  Flow::extract() is compared
+ * with what apps did before it: walking the headers with netinet++ and
+ * adding each field to a Flow by name.  The latter only knows Ethernet, one
+ * VLAN tag, IPv4, TCP and UDP, so it does less work on other frames.
+ *
+ * usage: bench-flow-extract [TRACE [ROUNDS]]
+ *
+ * Without a TRACE, a synthetic one of TCP and UDP over IPv4, some of it
+ * VLAN tagged, TCP over IPv6 and ARP is written to a temporary file. */
+
+#include <netinet/in.h>
+#include <pcap.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "buffer.hh"
+#include "flow.hh"
+#include "pcapreader.hh"
+#include "threads/cooperative.hh"
+#include "timeval.hh"
+#include "netinet++/ethernet.hh"
+#include "netinet++/ip.hh"
+#include "netinet++/tcp.hh"
+#include "netinet++/vlan.hh"
+
+using namespace vigil;
+
+struct Frame {
+    size_t ofs;
+    size_t len;
+};
+
+/* Appends the 'i'th frame to 'dumper'.  By 'kind', it is TCP over IPv4, UDP
+ * over IPv4 with a VLAN tag, TCP over IPv6 or an ARP request. */
+static void
+dump_frame(pcap_dumper_t *dumper, int kind, int i)
+{
+    uint8_t f[128];
+    size_t n = 0;
+    memset(f, 0, sizeof f);
+
+    static const uint8_t macs[12] = { 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 1 };
+    memcpy(f, macs, sizeof macs);
+    f[5] = i;
+    n = 12;
+    if (kind == 1) {
+        f[n++] = 0x81; f[n++] = 0x00; f[n++] = 0x20; f[n++] = 10 + i % 4;
+    }
+    if (kind <= 1) {
+        /* TCP or UDP over IPv4. */
+        f[n++] = 0x08; f[n++] = 0x00;
+        uint8_t *ip = f + n;
+        ip[0] = 0x45; ip[8] = 64; ip[9] = kind ? IP_TYPE_UDP : IP_TYPE_TCP;
+        ip[12] = 10; ip[15] = 1 + i % 200; ip[16] = 10; ip[19] = 2;
+        n += IP_HEADER_LEN;
+        f[n] = 0x80 | i % 64; f[n + 1] = i; f[n + 3] = 80;
+        n += TCP_HEADER_LEN;
+    } else if (kind == 2) {
+        /* TCP over IPv6. */
+        f[n++] = 0x86; f[n++] = 0xdd;
+        uint8_t *ip6 = f + n;
+        ip6[0] = 0x60; ip6[6] = IP_TYPE_TCP; ip6[7] = 64;
+        ip6[8] = 0xfe; ip6[9] = 0x80; ip6[23] = 1 + i % 200;
+        ip6[24] = 0xfe; ip6[25] = 0x80; ip6[39] = 2;
+        n += 40;
+        f[n] = 0x80 | i % 64; f[n + 1] = i; f[n + 3] = 80;
+        n += TCP_HEADER_LEN;
+    } else {
+        /* ARP request. */
+        f[n++] = 0x08; f[n++] = 0x06;
+        static const uint8_t arp[8] = { 0, 1, 8, 0, 6, 4, 0, 1 };
+        memcpy(f + n, arp, sizeof arp);
+        memcpy(f + n + 8, macs + 6, ETH_ADDR_LEN);
+        f[n + 14] = 10; f[n + 17] = 1 + i % 200;
+        f[n + 24] = 10; f[n + 27] = 2;
+        n += ARP_ETH_HEADER_LEN;
+    }
+    n = std::max(n, (size_t) ETH_TOTAL_MIN);
+
+    struct pcap_pkthdr hdr;
+    memset(&hdr, 0, sizeof hdr);
+    hdr.caplen = hdr.len = n;
+    pcap_dump((u_char *) dumper, &hdr, f);
+}
+
+static std::string
+write_trace()
+{
+    char name[] = "/tmp/bench-flow-extract-XXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    pcap_t *pcap = pcap_open_dead(DLT_EN10MB, 65535);
+    pcap_dumper_t *dumper = pcap_dump_open(pcap, name);
+    if (!dumper) {
+        fprintf(stderr, "%s: %s\n", name, pcap_geterr(pcap));
+        exit(EXIT_FAILURE);
+    }
+    static const int mix[10] = { 0, 0, 0, 0, 0, 1, 1, 2, 2, 3 };
+    for (int i = 0; i < 1000; i++) {
+        dump_frame(dumper, mix[i % 10], i);
+    }
+    pcap_dump_close(dumper);
+    pcap_close(pcap);
+    return name;
+}
+
+/* Reads the frames of packet-ins from 'trace' into 'data' and 'frames'. */
+static void
+read_trace(const std::string& trace, std::vector<uint8_t>& data,
+           std::vector<Frame>& frames)
+{
+    Pcapreader reader(trace);
+    int error = reader.connect(false);
+    if (!error) {
+        error = reader.send_features_request();
+    }
+    if (error) {
+        fprintf(stderr, "%s: %s\n", trace.c_str(), strerror(error));
+        exit(EXIT_FAILURE);
+    }
+    for (;;) {
+        std::auto_ptr<Buffer> b(reader.recv_openflow(error, false));
+        if (error == EOF) {
+            break;
+        } else if (error) {
+            fprintf(stderr, "%s: %s\n", trace.c_str(), strerror(error));
+            exit(EXIT_FAILURE);
+        }
+        const ofp_packet_in& opi = b->at<ofp_packet_in>(0);
+        if (opi.header.type != OFPT_PACKET_IN) {
+            continue;
+        }
+        size_t ofs = (offsetof(ofp_packet_in, match)
+                      + (ntohs(opi.match.length) + 7) / 8 * 8 + 2);
+        Frame frame = { data.size(), b->size() - ofs };
+        data.insert(data.end(), b->data() + ofs, b->data() + b->size());
+        frames.push_back(frame);
+    }
+}
+
+/* Fills 'flow' from the frame at 'p' the way apps used to. */
+static void
+by_name(Flow& flow, uint32_t in_port, const uint8_t *p, size_t len)
+{
+    flow = Flow();
+    flow.Add_Field("in_port", in_port);
+    if (len < sizeof(ethernet)) {
+        return;
+    }
+    const ethernet& eth = *(const ethernet *) p;
+    uint8_t mac[ETH_ADDR_LEN];
+    memcpy(mac, eth.daddr.octet, ETH_ADDR_LEN);
+    flow.Add_Field("eth_dst", mac);
+    memcpy(mac, eth.saddr.octet, ETH_ADDR_LEN);
+    flow.Add_Field("eth_src", mac);
+    uint16_t type = eth.type;
+    p += sizeof eth;
+    len -= sizeof eth;
+    if (type == ethernet::VLAN && len >= sizeof(vlan)) {
+        const vlan& tag = *(const vlan *) p;
+        uint16_t tci = ntohs(tag.tci);
+        flow.Add_Field("vlan_id", (uint16_t) (OFPVID_PRESENT | (tci & vlan::VID_MASK)));
+        flow.Add_Field("vlan_pcp", (uint8_t) (tci >> vlan::PCP_SHIFT));
+        type = tag.encapsulated_proto;
+        p += sizeof tag;
+        len -= sizeof tag;
+    }
+    flow.Add_Field("eth_type", ntohs(type));
+    if (type != ethernet::IP || len < sizeof(ip_)) {
+        return;
+    }
+    const ip_& ip = *(const ip_ *) p;
+    flow.Add_Field("ip_dscp", (uint8_t) (ip.tos >> 2));
+    flow.Add_Field("ip_ecn", (uint8_t) (ip.tos & IP_ECN_MASK));
+    flow.Add_Field("ip_proto", ip.protocol);
+    flow.Add_Field("ipv4_src", (uint32_t) ip.saddr.addr);
+    flow.Add_Field("ipv4_dst", (uint32_t) ip.daddr.addr);
+    p += ip.ihl * 4;
+    len -= std::min(len, (size_t) ip.ihl * 4);
+    if (len < 4) {
+        return;
+    }
+    const tcp& ports = *(const tcp *) p;
+    if (ip.protocol == ip_::proto::TCP) {
+        flow.Add_Field("tcp_src", ntohs(ports.sport));
+        flow.Add_Field("tcp_dst", ntohs(ports.dport));
+    } else if (ip.protocol == ip_::proto::UDP) {
+        flow.Add_Field("udp_src", ntohs(ports.sport));
+        flow.Add_Field("udp_dst", ntohs(ports.dport));
+    }
+}
+
+static void
+report(const char *name, const timeval& start, const timeval& end, long n,
+       uint64_t fields)
+{
+    printf("%-24s %7.1f ns/frame, %.1f fields/frame\n", name,
+           timeval_to_double(end - start) * 1e9 / n, (double) fields / n);
+}
+
+int
+main(int argc, char *argv[])
+{
+    std::string trace = argc > 1 ? argv[1] : write_trace();
+    int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    std::vector<uint8_t> data;
+    std::vector<Frame> frames;
+    read_trace(trace, data, frames);
+    if (argc <= 1) {
+        unlink(trace.c_str());
+    }
+    if (frames.empty()) {
+        fprintf(stderr, "%s: no frames\n", trace.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%zu frames, %d rounds\n", frames.size(), rounds);
+    long n = (long) frames.size() * rounds;
+
+    Flow flow;
+    uint64_t fields = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            by_name(flow, 1, &data[frames[i].ofs], frames[i].len);
+            fields += __builtin_popcountll(flow.match.present);
+        }
+    }
+    gettimeofday(&end, NULL);
+    report("netinet++ and Add_Field", start, end, n, fields);
+
+    fields = 0;
+    gettimeofday(&start, NULL);
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            flow.extract(1, &data[frames[i].ofs], frames[i].len);
+            fields += __builtin_popcountll(flow.match.present);
+        }
+    }
+    gettimeofday(&end, NULL);
+    report("Flow::extract", start, end, n, fields);
+    return 0;
+}
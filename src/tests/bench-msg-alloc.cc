@@ -0,0 +1,192 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Counts the calls to the global allocator made per packet-in on the path
+ * from a received buffer to a dispatched and destroyed Ofp_msg_event, and
+ * times that path.  Calls to operator new are counted separately from calls
+ * to malloc(), which oflib uses for the decoded message itself.  The two
+ * operator new calls per event that allocate the receive Buffer are
+ * included.  The message is decoded onto the heap with ofl_msg_unpack(),
+ * into a pooled arena with Ofp_msg::unpack(), and lazily from the receive
+ * Buffer, as nox does.  The handler reads the message, except in one more
+ * lazy run that shows the cost of a message that no handler looks at.
+ *
+ * usage: bench-msg-alloc [EVENTS] */
+
+#include "event-dispatcher.hh"
+#include <memory>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "buffer.hh"
+#include "ofp-msg-event.hh"
+#include "threads/cooperative.hh"
+#include "timeval.hh"
+#define TEST_MSGS_COUNT_MALLOCS
+#include "test-msgs.hh"
+
+using namespace vigil;
+
+static unsigned long int n_news;
+
+extern "C" void __libc_free(void*);
+
+void*
+operator new(size_t size) throw(std::bad_alloc)
+{
+    /* Not malloc(), so as not to count the call twice. */
+    ++n_news;
+    void* p = __libc_malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+/* Not free(), which GCC warns about for memory from operator new. */
+void
+operator delete(void* p) throw()
+{
+    __libc_free(p);
+}
+
+static unsigned long int n_handled;
+
+/* Whether the handler looks at the message. */
+static bool read_msg;
+
+static Disposition
+handler(const Event& e)
+{
+    ++n_handled;
+    if (read_msg) {
+        const Ofp_msg_event& ome = static_cast<const Ofp_msg_event&>(e);
+        struct ofl_msg_packet_in* in = (struct ofl_msg_packet_in*) **ome.msg;
+        if (!in->data_length) {
+            abort();
+        }
+    }
+    return CONTINUE;
+}
+
+enum Mode {
+    HEAP,                       /* ofl_msg_unpack(). */
+    ARENA,                      /* Ofp_msg::unpack(), copying the frame. */
+    LAZY,                       /* Ofp_msg::unpack() of the Buffer, so that the
+                                 * message is decoded, borrowing the frame,
+                                 * only if the handler reads it. */
+};
+
+static const char* mode_names[] = { "heap", "arena", "lazy" };
+
+/* Receives the packet-in in 'packed' into a Buffer, as
+ * Openflow_connection does, decodes it according to 'mode', dispatches it
+ * and destroys it. */
+static void
+receive(Event_dispatcher& dispatcher, const uint8_t* packed, size_t size,
+        Mode mode, const boost::shared_ptr<Ofp_msg_arenas>& arenas)
+{
+    std::auto_ptr<Buffer> b(new Array_buffer(size));
+    memcpy(b->data(), packed, size);
+
+    boost::shared_ptr<Ofp_msg> msg;
+    uint32_t xid;
+    if (mode == LAZY) {
+        msg = Ofp_msg::unpack(b, &xid, arenas);
+    } else if (mode == ARENA) {
+        msg = Ofp_msg::unpack(b->data(), size, &xid, arenas);
+    } else {
+        struct ofl_msg_header* ofl_msg;
+        if (!ofl_msg_unpack(b->data(), size, &ofl_msg, &xid, NULL)) {
+            msg = Ofp_msg::create(ofl_msg);
+        }
+    }
+    if (!msg) {
+        fprintf(stderr, "unpacking failed\n");
+        exit(EXIT_FAILURE);
+    }
+    b.reset();
+
+    Event* event = Ofp_msg_event::create_event(datapathid::from_host(1), xid,
+                                               msg);
+    msg.reset();
+    dispatcher.dispatch(*event);
+    delete event;
+}
+
+static void
+run(Event_dispatcher& dispatcher, size_t frame_len, int n_events, Mode mode)
+{
+    size_t size;
+    uint8_t* packed = pack_packet_in(1, frame_len, 1, &size);
+    boost::shared_ptr<Ofp_msg_arenas> arenas(new Ofp_msg_arenas);
+
+    /* Warm up the pools. */
+    for (int i = 0; i < 100; i++) {
+        receive(dispatcher, packed, size, mode, arenas);
+    }
+
+    n_news = n_mallocs = n_handled = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_events; i++) {
+        receive(dispatcher, packed, size, mode, arenas);
+    }
+    gettimeofday(&end, NULL);
+    unsigned long int news = n_news, mallocs = n_mallocs;
+
+    if (n_handled != (unsigned long int) n_events) {
+        fprintf(stderr, "handler called %lu times\n", n_handled);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%4zu-byte frame, %-6s %8.1f ns/event, %.2f operator new and "
+           "%.2f malloc calls per event%s\n", frame_len, mode_names[mode],
+           timeval_to_double(end - start) * 1e9 / n_events,
+           (double) news / n_events, (double) mallocs / n_events,
+           mode == LAZY && !read_msg ? " (not read)" : "");
+    fflush(stdout);
+    free(packed);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_events = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    Event_dispatcher dispatcher;
+    dispatcher.add_handler(Ofp_msg_event::get_event_type(OFPT_PACKET_IN),
+                           handler, 0);
+
+    read_msg = true;
+    static const size_t frame_lens[] = { 64, 1500 };
+    for (size_t i = 0; i < sizeof frame_lens / sizeof *frame_lens; i++) {
+        run(dispatcher, frame_lens[i], n_events, HEAP);
+        run(dispatcher, frame_lens[i], n_events, ARENA);
+        run(dispatcher, frame_lens[i], n_events, LAZY);
+        read_msg = false;
+        run(dispatcher, frame_lens[i], n_events, LAZY);
+        read_msg = true;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times printing messages for the log with ofl_msg_to_string() and with
+ * ofl_msg_format() into one reused buffer, with and without a limit on the
+ * entries printed from the 64 entry port stats reply, and counts the calls
+ * to malloc() each makes.
+ *
+ * usage: bench-msg-format [MESSAGES] */
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "timeval.hh"
+#include "../oflib/ofl-print.h"
+#define TEST_MSGS_COUNT_MALLOCS
+#include "test-msgs.hh"
+
+#define N_PORTS 64
+
+static char text[16384];
+static uint8_t frame[64];
+
+static Flow_mod_fixture fm;
+static struct ofl_msg_packet_in pin;
+static struct ofl_port_stats stats[N_PORTS];
+static struct ofl_port_stats *stats_ptrs[N_PORTS];
+static struct ofl_msg_multipart_reply_port reply;
+
+static void
+init_msgs()
+{
+    pin.header.type = OFPT_PACKET_IN;
+    pin.buffer_id = 0xffffffff;
+    pin.total_len = sizeof frame;
+    pin.reason = OFPR_NO_MATCH;
+    pin.data = frame;
+    pin.data_length = sizeof frame;
+
+    for (int i = 0; i < N_PORTS; i++) {
+        stats[i].port_no = i + 1;
+        stats[i].rx_packets = 1000 * i;
+        stats[i].tx_packets = 900 * i;
+        stats[i].rx_bytes = 1500000 * i;
+        stats[i].tx_bytes = 1400000 * i;
+        stats_ptrs[i] = &stats[i];
+    }
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_PORT_STATS;
+    reply.stats_num = N_PORTS;
+    reply.stats = stats_ptrs;
+}
+
+enum Msg { FLOW_MOD, PACKET_IN, PORT_STATS };
+
+static const char *msg_names[] = { "flow-mod", "packet-in", "port-stats" };
+
+static struct ofl_msg_header *
+get_msg(Msg msg)
+{
+    switch (msg) {
+    case FLOW_MOD: return &fm.mod.header;
+    case PACKET_IN: return &pin.header;
+    case PORT_STATS: return &reply.header.header;
+    }
+    abort();
+}
+
+/* Formats 'msg' 'n_msgs' times with ofl_msg_to_string() if 'max_entries' is
+ * negative, otherwise with ofl_msg_format(). */
+static void
+run(Msg msg, int max_entries, int n_msgs)
+{
+    struct ofl_fmt fmt;
+    size_t total = 0;
+
+    ofl_fmt_init(&fmt, text, sizeof text, max_entries < 0 ? 0 : max_entries);
+    n_mallocs = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_msgs; i++) {
+        if (max_entries < 0) {
+            char *str = ofl_msg_to_string(get_msg(msg), NULL);
+            total += strlen(str);
+            free(str);
+        } else {
+            ofl_fmt_clear(&fmt);
+            ofl_msg_format(&fmt, get_msg(msg));
+            total += strlen(ofl_fmt_finish(&fmt));
+        }
+    }
+    gettimeofday(&end, NULL);
+    if (!total) {
+        abort();
+    }
+
+    char how[32];
+    if (max_entries < 0) {
+        strcpy(how, "to_string");
+    } else {
+        snprintf(how, sizeof how, "format/%d", max_entries);
+    }
+    printf("%-10s %-10s %8.1f ns/msg, %.2f malloc calls per msg, %zu chars\n",
+           msg_names[msg], how, timeval_to_double(end - start) * 1e9 / n_msgs,
+           (double) n_mallocs / n_msgs, total / n_msgs);
+    fflush(stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_msgs = argc > 1 ? atoi(argv[1]) : 200000;
+
+    init_msgs();
+    for (int msg = FLOW_MOD; msg <= PORT_STATS; msg++) {
+        run((Msg) msg, -1, n_msgs);
+        run((Msg) msg, 0, n_msgs);
+        if (msg == PORT_STATS) {
+            run((Msg) msg, 8, n_msgs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times the packing of the messages a controller sends most often with
+ * ofl_msg_pack() and with the specialized packers, and counts the calls to
+ * malloc() each makes.  The specialized packers write into one buffer that
+ * is reused; the buffers from ofl_msg_pack() are freed after each message.
+ *
+ * usage: bench-msg-pack [MESSAGES] */
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "timeval.hh"
+#define TEST_MSGS_COUNT_MALLOCS
+#include "test-msgs.hh"
+
+static uint8_t out[2048];
+static uint8_t frame[64];
+
+static Flow_mod_fixture fm;
+static struct ofl_msg_packet_out po;
+static struct ofl_msg_header barrier;
+
+static void
+init_msgs()
+{
+    po.header.type = OFPT_PACKET_OUT;
+    po.buffer_id = 0xffffffff;
+    po.in_port = 1;
+    po.actions_num = 1;
+    po.actions = fm.actions;
+    po.data = frame;
+    po.data_length = sizeof frame;
+
+    barrier.type = OFPT_BARRIER_REQUEST;
+}
+
+enum Msg { FLOW_MOD, PACKET_OUT, BARRIER };
+
+static const char *msg_names[] = { "flow-mod", "packet-out", "barrier" };
+
+static struct ofl_msg_header *
+get_msg(Msg msg)
+{
+    switch (msg) {
+    case FLOW_MOD: return &fm.mod.header;
+    case PACKET_OUT: return &po.header;
+    case BARRIER: return &barrier;
+    }
+    abort();
+}
+
+static size_t
+pack_specialized(Msg msg, uint32_t xid)
+{
+    switch (msg) {
+    case FLOW_MOD:
+        return ofl_msg_pack_flow_mod_output(&fm.mod, xid, fm.output.port,
+                                            fm.output.max_len,
+                                            out, sizeof out);
+    case PACKET_OUT:
+        return ofl_msg_pack_packet_out_output(xid, 0xffffffff, 1,
+                                              fm.output.port,
+                                              frame, sizeof frame,
+                                              out, sizeof out);
+    case BARRIER:
+        return ofl_msg_pack_barrier_request(xid, out, sizeof out);
+    }
+    abort();
+}
+
+static void
+run(Msg msg, bool specialized, int n_msgs)
+{
+    size_t total = 0;
+    n_mallocs = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_msgs; i++) {
+        if (specialized) {
+            total += pack_specialized(msg, i);
+        } else {
+            uint8_t *buf;
+            size_t len;
+            if (ofl_msg_pack(get_msg(msg), i, &buf, &len, NULL)) {
+                abort();
+            }
+            total += len;
+            free(buf);
+        }
+    }
+    gettimeofday(&end, NULL);
+    if (!total) {
+        abort();
+    }
+
+    printf("%-10s %-11s %7.1f ns/msg, %.2f malloc calls per msg\n",
+           msg_names[msg], specialized ? "specialized" : "ofl_msg_pack",
+           timeval_to_double(end - start) * 1e9 / n_msgs,
+           (double) n_mallocs / n_msgs);
+    fflush(stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_msgs = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    init_msgs();
+    for (int msg = FLOW_MOD; msg <= BARRIER; msg++) {
+        run((Msg) msg, false, n_msgs);
+        run((Msg) msg, true, n_msgs);
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times building the flow-mod and packet-out messages that the switch
+ * application sends for a packet-in, ready to be queued for transmission:
+ * with the ofl structures and ofl_msg_pack(), as switch did before it used
+ * Ofp_templates, and by patching an Ofp_template in place in the Buffer.
+ *
+ * usage: bench-ofp-template [MSGS] */
+
+#include <memory>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "buffer.hh"
+#include "flowmod.hh"
+#include "ofp-template.hh"
+#include "timeval.hh"
+#include "../oflib/ofl-actions.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/oxm-match.h"
+
+using namespace vigil;
+
+static uint8_t eth_src[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 5 };
+static uint8_t eth_dst[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 6 };
+static uint8_t frame[64];
+
+/* Sink for the built messages, so that they are not optimized away. */
+static unsigned long int n_bytes;
+
+static void
+send(std::auto_ptr<Buffer> b)
+{
+    n_bytes += b->size();
+}
+
+static std::auto_ptr<Buffer>
+pack(struct ofl_msg_header *msg)
+{
+    uint8_t *buf;
+    size_t buf_len;
+    if (ofl_msg_pack(msg, 0, &buf, &buf_len, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return std::auto_ptr<Buffer>(new Malloc_buffer(buf, buf_len));
+}
+
+static void
+flow_mod_ofl(uint32_t in_port, uint32_t buffer_id, uint32_t out_port)
+{
+    Flow f;
+    f.Add_Field("in_port", in_port);
+    f.Add_Field("eth_src", eth_src);
+    f.Add_Field("eth_dst", eth_dst);
+    Actions *acts = new Actions();
+    acts->CreateOutput(out_port);
+    Instruction *inst = new Instruction();
+    inst->CreateApply(acts);
+    FlowMod mod(0x00ULL, 0x00ULL, 0, OFPFC_ADD, 1, OFP_FLOW_PERMANENT,
+                OFP_DEFAULT_PRIORITY, buffer_id, OFPP_ANY, OFPG_ANY, 0);
+    mod.AddMatch(&f.match);
+    mod.AddInstructions(inst);
+    send(pack((struct ofl_msg_header *)&mod.fm_msg));
+
+    struct ofl_instruction_header **insts = inst->insts;
+    delete inst;
+    free(insts);
+    free(acts->acts[0]);
+    free(acts->acts);
+    delete acts;
+}
+
+static void
+flow_mod_template(const Ofp_template& tmpl,
+                  uint32_t in_port, uint32_t buffer_id, uint32_t out_port)
+{
+    std::auto_ptr<Buffer> b(new Array_buffer(tmpl.size()));
+    Ofp_template_msg mod(tmpl, b->data(), b->size());
+    mod.set_field32(OXM_OF_IN_PORT, in_port);
+    mod.set_field(OXM_OF_ETH_SRC, eth_src);
+    mod.set_field(OXM_OF_ETH_DST, eth_dst);
+    mod.set(Ofp_template::BUFFER_ID, buffer_id);
+    mod.set(Ofp_template::OUTPUT_PORT, out_port);
+    send(b);
+}
+
+static void
+packet_out_ofl(uint32_t in_port, uint32_t out_port)
+{
+    struct ofl_action_output output =
+            {{/*.type = */OFPAT_OUTPUT}, /*.port = */out_port, /*.max_len = */0};
+    struct ofl_action_header *actions[] =
+            { (struct ofl_action_header *)&output };
+    struct ofl_msg_packet_out out =
+            {{/*.type       = */OFPT_PACKET_OUT},
+             /*.buffer_id   = */OFP_NO_BUFFER,
+             /*.in_port     = */in_port,
+             /*.actions_num = */1,
+             /*.actions     = */actions,
+             /*.data_length = */sizeof frame,
+             /*.data        = */frame};
+    send(pack((struct ofl_msg_header *)&out));
+}
+
+static void
+packet_out_template(const Ofp_template& tmpl,
+                    uint32_t in_port, uint32_t out_port)
+{
+    std::auto_ptr<Buffer> b(new Array_buffer(tmpl.size() + sizeof frame));
+    Ofp_template_msg out(tmpl, b->data(), b->size());
+    out.set_data(frame, sizeof frame);
+    out.set(Ofp_template::IN_PORT, in_port);
+    out.set(Ofp_template::OUTPUT_PORT, out_port);
+    send(b);
+}
+
+static Ofp_template *
+make_flow_mod_template()
+{
+    uint8_t zero_mac[ETH_ADDR_LEN] = {0};
+    Flow f;
+    f.Add_Field("in_port", (uint32_t) 0);
+    f.Add_Field("eth_src", zero_mac);
+    f.Add_Field("eth_dst", zero_mac);
+    Actions acts;
+    acts.CreateOutput(0);
+    Instruction inst;
+    inst.CreateApply(&acts);
+    FlowMod mod(0x00ULL, 0x00ULL, 0, OFPFC_ADD, 1, OFP_FLOW_PERMANENT,
+                OFP_DEFAULT_PRIORITY, OFP_NO_BUFFER, OFPP_ANY, OFPG_ANY, 0);
+    mod.AddMatch(&f.match);
+    mod.AddInstructions(&inst);
+    return new Ofp_template((struct ofl_msg_header *)&mod.fm_msg);
+}
+
+static Ofp_template *
+make_packet_out_template()
+{
+    struct ofl_action_output output =
+            {{/*.type = */OFPAT_OUTPUT}, /*.port = */OFPP_FLOOD, /*.max_len = */0};
+    struct ofl_action_header *actions[] =
+            { (struct ofl_action_header *)&output };
+    struct ofl_msg_packet_out out =
+            {{/*.type       = */OFPT_PACKET_OUT},
+             /*.buffer_id   = */OFP_NO_BUFFER,
+             /*.in_port     = */OFPP_CONTROLLER,
+             /*.actions_num = */1,
+             /*.actions     = */actions,
+             /*.data_length = */0,
+             /*.data        = */NULL};
+    return new Ofp_template((struct ofl_msg_header *)&out);
+}
+
+enum Kind { FLOW_MOD, PACKET_OUT };
+static const char *kind_names[] = { "flow mod", "packet out" };
+
+static double
+run(Kind kind, const Ofp_template *tmpl, int n_msgs)
+{
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_msgs; i++) {
+        uint32_t in_port = i & 0xff, out_port = (i >> 8) & 0xff;
+        if (kind == FLOW_MOD) {
+            if (tmpl) {
+                flow_mod_template(*tmpl, in_port, i, out_port);
+            } else {
+                flow_mod_ofl(in_port, i, out_port);
+            }
+        } else {
+            if (tmpl) {
+                packet_out_template(*tmpl, in_port, out_port);
+            } else {
+                packet_out_ofl(in_port, out_port);
+            }
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    double rate = n_msgs / timeval_to_double(end - start);
+    printf("%-10s %-8s %12.0f msgs/s\n", kind_names[kind],
+           tmpl ? "template" : "ofl", rate);
+    fflush(stdout);
+    return rate;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_msgs = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    std::auto_ptr<Ofp_template> flow_mod(make_flow_mod_template());
+    std::auto_ptr<Ofp_template> packet_out(make_packet_out_template());
+
+    double ofl = run(FLOW_MOD, NULL, n_msgs);
+    double tmpl = run(FLOW_MOD, flow_mod.get(), n_msgs);
+    printf("flow mod speedup: %.1fx\n", tmpl / ofl);
+
+    ofl = run(PACKET_OUT, NULL, n_msgs);
+    tmpl = run(PACKET_OUT, packet_out.get(), n_msgs);
+    printf("packet out speedup: %.1fx\n", tmpl / ofl);
+
+    if (!n_bytes) {
+        abort();
+    }
+    return 0;
+}
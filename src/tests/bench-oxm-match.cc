@@ -0,0 +1,162 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times decoding packet-in and flow-removed messages into an arena, as nox
+ * does for messages that a handler reads.  Most of the time goes to parsing
+ * the OXM match, so the messages carry an in_port-only match, as switches
+ * send in packet-ins, and a full TCP/IPv4 match, as flow-removed messages
+ * echo back.
+ *
+ * usage: bench-oxm-match [MSGS] */
+
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "timeval.hh"
+#include "../oflib/ofl-arena.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+#include "test-msgs.hh"
+
+/* Fills 'match' with an in_port-only match if '!full', otherwise with a
+ * TCP/IPv4 5-tuple match.  ofl_msg_pack() expects the values of a
+ * packet-in's match in network byte order, so 'network' asks for that. */
+static void
+make_match(struct ofl_match *match, bool full, bool network)
+{
+    ofl_structs_match_init(match);
+    ofl_structs_match_put32(match, OXM_OF_IN_PORT, network ? htonl(1) : 1);
+    if (full) {
+        uint8_t src[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 5 };
+        uint8_t dst[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 6 };
+        ofl_structs_match_put_eth(match, OXM_OF_ETH_SRC, src);
+        ofl_structs_match_put_eth(match, OXM_OF_ETH_DST, dst);
+        ofl_structs_match_put16(match, OXM_OF_ETH_TYPE,
+                                network ? htons(0x0800) : 0x0800);
+        ofl_structs_match_put8(match, OXM_OF_IP_PROTO, 6);
+        ofl_structs_match_put32(match, OXM_OF_IPV4_SRC, htonl(0x0a000001));
+        ofl_structs_match_put32(match, OXM_OF_IPV4_DST, htonl(0x0a000002));
+        ofl_structs_match_put16(match, OXM_OF_TCP_SRC,
+                                network ? htons(1234) : 1234);
+        ofl_structs_match_put16(match, OXM_OF_TCP_DST,
+                                network ? htons(80) : 80);
+    }
+}
+
+static uint8_t *
+pack(struct ofl_msg_header *msg, size_t *size)
+{
+    uint8_t *buf;
+    if (ofl_msg_pack(msg, 1, &buf, size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return buf;
+}
+
+static uint8_t *
+make_packet_in(bool full, size_t *size)
+{
+    struct ofl_match match;
+    make_match(&match, full, true);
+    return pack_packet_in(&match, 64, 1, size);
+}
+
+static uint8_t *
+make_flow_removed(size_t *size)
+{
+    struct ofl_match match;
+    make_match(&match, true, false);
+
+    struct ofl_flow_stats stats;
+    memset(&stats, 0, sizeof stats);
+    stats.match = &match.header;
+
+    struct ofl_msg_flow_removed fr;
+    memset(&fr, 0, sizeof fr);
+    fr.header.type = OFPT_FLOW_REMOVED;
+    fr.reason = OFPRR_IDLE_TIMEOUT;
+    fr.stats = &stats;
+    return pack(&fr.header, size);
+}
+
+static const struct ofl_match *
+get_match(const struct ofl_msg_header *msg)
+{
+    const struct ofl_match_header *m
+        = (msg->type == OFPT_PACKET_IN
+           ? ((const struct ofl_msg_packet_in *) msg)->match
+           : ((const struct ofl_msg_flow_removed *) msg)->stats->match);
+    return (const struct ofl_match *) m;
+}
+
+static void
+run(const char *name, uint8_t *packed, size_t size, int n_fields,
+    int n_msgs)
+{
+    struct ofl_arena arena;
+    ofl_arena_init(&arena);
+
+    /* ofl_msg_unpack_packet_in() ignores errors in the match, so make sure
+     * that all of it is decoded. */
+    struct ofl_msg_header *msg;
+    uint32_t xid;
+    if (ofl_msg_unpack_borrowed(packed, size, &msg, &xid, &arena)
+        || __builtin_popcountll(get_match(msg)->present) != n_fields) {
+        fprintf(stderr, "%s: bad message\n", name);
+        exit(EXIT_FAILURE);
+    }
+    ofl_arena_reset(&arena);
+
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_msgs; i++) {
+        if (ofl_msg_unpack_borrowed(packed, size, &msg, &xid, &arena)) {
+            fprintf(stderr, "%s: ofl_msg_unpack_borrowed failed\n", name);
+            exit(EXIT_FAILURE);
+        }
+        ofl_arena_reset(&arena);
+    }
+    gettimeofday(&end, NULL);
+
+    printf("%-28s %7.1f ns/msg\n", name,
+           timeval_to_double(end - start) * 1e9 / n_msgs);
+    fflush(stdout);
+    ofl_arena_destroy(&arena);
+    free(packed);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_msgs = argc > 1 ? atoi(argv[1]) : 1000000;
+    size_t size;
+    uint8_t *packed;
+
+    packed = make_packet_in(false, &size);
+    run("packet in, in_port match", packed, size, 1, n_msgs);
+
+    packed = make_packet_in(true, &size);
+    run("packet in, 9-field match", packed, size, 9, n_msgs);
+
+    packed = make_flow_removed(&size);
+    run("flow removed, 9-field match", packed, size, 9, n_msgs);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Times the decoding of a flow stats reply for a large flow table, split
+ * into parts of under 64 kB as a switch sends it, and the summing of its
+ * byte counts.  The parts are decoded into heap-allocated structures with
+ * ofl_msg_unpack(), into an arena with ofl_msg_unpack_arena(), and into
+ * reused columns with ofl_stats_columns_append().
+ *
+ * usage: bench-stats-columns [FLOWS [REPLIES]] */
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "timeval.hh"
+#include "../oflib/ofl-arena.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-stats-columns.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+/* Flows per reply part, which keeps each part, at 120 bytes per flow, under
+ * 64 kB. */
+static const int FLOWS_PER_PART = 500;
+
+struct Part {
+    uint8_t *buf;
+    size_t len;
+};
+
+/* Returns the parts of a reply with 'n_flows' 5-tuple flows. */
+static std::vector<Part>
+make_reply(int n_flows)
+{
+    std::vector<Part> parts;
+    std::vector<struct ofl_match> matches(FLOWS_PER_PART);
+    std::vector<struct ofl_flow_stats> stats(FLOWS_PER_PART);
+    std::vector<struct ofl_flow_stats *> stats_ptrs(FLOWS_PER_PART);
+    static const uint8_t src[ETH_ADDR_LEN] = { 0, 0, 0, 0, 0, 1 };
+    static const uint8_t dst[ETH_ADDR_LEN] = { 0, 0, 0, 0, 0, 2 };
+
+    for (int first = 0; first < n_flows; first += FLOWS_PER_PART) {
+        int n = std::min(FLOWS_PER_PART, n_flows - first);
+        for (int i = 0; i < n; i++) {
+            uint32_t id = first + i;
+            struct ofl_match *m = &matches[i];
+            ofl_structs_match_init(m);
+            ofl_structs_match_put32(m, OXM_OF_IN_PORT, id % 48 + 1);
+            ofl_structs_match_put_bytes(m, OXM_OF_ETH_DST, dst, NULL);
+            ofl_structs_match_put_bytes(m, OXM_OF_ETH_SRC, src, NULL);
+            ofl_structs_match_put16(m, OXM_OF_ETH_TYPE, 0x0800);
+            ofl_structs_match_put8(m, OXM_OF_IP_PROTO, 6);
+            ofl_structs_match_put32(m, OXM_OF_IPV4_SRC, htonl(0x0a000000 | id));
+            ofl_structs_match_put32(m, OXM_OF_IPV4_DST, htonl(0x0b000001));
+            ofl_structs_match_put16(m, OXM_OF_TCP_SRC, 1024 + id % 60000);
+            ofl_structs_match_put16(m, OXM_OF_TCP_DST, 80);
+
+            memset(&stats[i], 0, sizeof stats[i]);
+            stats[i].priority = 100;
+            stats[i].duration_sec = id;
+            stats[i].packet_count = id;
+            stats[i].byte_count = id * 100;
+            stats[i].match = &m->header;
+            stats_ptrs[i] = &stats[i];
+        }
+
+        struct ofl_msg_multipart_reply_flow reply;
+        memset(&reply, 0, sizeof reply);
+        reply.header.header.type = OFPT_MULTIPART_REPLY;
+        reply.header.type = OFPMP_FLOW;
+        reply.header.flags = first + n < n_flows ? OFPMPF_REPLY_MORE : 0;
+        reply.stats_num = n;
+        reply.stats = &stats_ptrs[0];
+
+        Part p;
+        if (ofl_msg_pack(&reply.header.header, 1, &p.buf, &p.len, NULL)) {
+            fprintf(stderr, "ofl_msg_pack failed\n");
+            exit(EXIT_FAILURE);
+        }
+        parts.push_back(p);
+    }
+    return parts;
+}
+
+enum Mode { HEAP, ARENA, COLUMNS };
+
+static const char *mode_names[] = { "heap", "arena", "columns" };
+
+/* Decodes the parts of 'reply' according to 'mode' and returns the sum of
+ * the byte counts. */
+static uint64_t
+decode(const std::vector<Part>& reply, Mode mode, struct ofl_arena *arena,
+       struct ofl_stats_columns *cols)
+{
+    uint64_t sum = 0;
+    if (mode == COLUMNS) {
+        ofl_stats_columns_clear(cols);
+        for (size_t i = 0; i < reply.size(); i++) {
+            bool more;
+            if (ofl_stats_columns_append(cols, reply[i].buf, reply[i].len,
+                                         &more)) {
+                fprintf(stderr, "ofl_stats_columns_append failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (size_t i = 0; i < cols->n; i++) {
+            sum += cols->flow.byte_count[i];
+        }
+        return sum;
+    }
+
+    for (size_t i = 0; i < reply.size(); i++) {
+        struct ofl_msg_header *msg;
+        uint32_t xid;
+        ofl_err error = mode == ARENA
+            ? ofl_msg_unpack_arena(reply[i].buf, reply[i].len, &msg, &xid,
+                                   arena)
+            : ofl_msg_unpack(reply[i].buf, reply[i].len, &msg, &xid, NULL);
+        if (error) {
+            fprintf(stderr, "ofl_msg_unpack failed\n");
+            exit(EXIT_FAILURE);
+        }
+        struct ofl_msg_multipart_reply_flow *r
+            = (struct ofl_msg_multipart_reply_flow *) msg;
+        for (size_t j = 0; j < r->stats_num; j++) {
+            sum += r->stats[j]->byte_count;
+        }
+        if (mode == HEAP) {
+            ofl_msg_free(msg, NULL);
+        }
+    }
+    if (mode == ARENA) {
+        ofl_arena_reset(arena);
+    }
+    return sum;
+}
+
+static void
+run(const std::vector<Part>& reply, int n_flows, int n_replies, Mode mode)
+{
+    struct ofl_arena arena;
+    ofl_arena_init(&arena);
+    struct ofl_stats_columns cols;
+    ofl_stats_columns_init(&cols, OFPMP_FLOW);
+
+    uint64_t expected = decode(reply, mode, &arena, &cols);
+
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int i = 0; i < n_replies; i++) {
+        if (decode(reply, mode, &arena, &cols) != expected) {
+            fprintf(stderr, "wrong byte count\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    double secs = timeval_to_double(end - start);
+    printf("%d flows in %zu parts, %-7s %8.1f us/reply, %6.1f ns/flow\n",
+           n_flows, reply.size(), mode_names[mode], secs * 1e6 / n_replies,
+           secs * 1e9 / n_replies / n_flows);
+    fflush(stdout);
+
+    ofl_stats_columns_destroy(&cols);
+    ofl_arena_destroy(&arena);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_flows = argc > 1 ? atoi(argv[1]) : 10000;
+    int n_replies = argc > 2 ? atoi(argv[2]) : 200;
+
+    std::vector<Part> reply = make_reply(n_flows);
+    run(reply, n_flows, n_replies, HEAP);
+    run(reply, n_flows, n_replies, ARENA);
+    run(reply, n_flows, n_replies, COLUMNS);
+
+    for (size_t i = 0; i < reply.size(); i++) {
+        free(reply[i].buf);
+    }
+    return 0;
+}
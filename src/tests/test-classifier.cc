@@ -20,8 +20,12 @@
 #include <string>
 #include <sstream>
 #include <fstream>
-#include <ctype.h>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
+#include <time.h>
+#include <arpa/inet.h>
 
 #include "test-classifier.hh"
 #include "expr.hh"
@@ -34,22 +38,53 @@ using namespace std;
 using namespace vigil;
 
 typedef std::list<pair<uint32_t,Rule<Packet_expr, void*> > > Rule_list;
-
-void add_rmv_test(Classifier_t<Packet_expr, void *>& test, Rule_list& rules);
-void check_lookup(Classifier_t<Packet_expr, void *>& test, Rule_list& rules);
+typedef Classifier<Packet_expr, void *> Cnode_engine;
+typedef Tuple_space<Packet_expr, void *> Tss_engine;
+
+template<class Engine>
+void run_tests(Rule_list rules, Rule_list& to_delete);
+template<class Engine>
+void add_rmv_test(Classifier_t<Packet_expr, void *, Engine>& test, Rule_list& rules);
+template<class Engine>
+void check_lookup(Classifier_t<Packet_expr, void *, Engine>& test, Rule_list& rules);
 bool read_rules(const char *filename, Rule_list& exprs);
 bool set_field(Packet_expr& expr, std::string type, std::string strvalue);
-void timed_test(Classifier_t<Packet_expr, void *>& test, Rule_list& rules);
+template<class Engine>
+void timed_test(const char *name, const Rule_list& rules, uint32_t rounds);
+
 
+/*
+ * Usage: test-classifier <policy file> <packets file> <delete file>
+ *        test-classifier -b <rounds> <policy file>...
+ *
+ * The first form checks both engines against a linear classifier.  The second
+ * times lookups and updates of each engine on each policy file, looking up a
+ * Flow built from every rule's expression.
+ */
 
 int
 main(int argc, char *argv[])
 {
-    Classifier_t<Packet_expr, void *> test;
     Rule_list rules, packets, to_delete;
 
+    if (argc >= 4 && !strcmp(argv[1], "-b")) {
+        uint32_t rounds = atoi(argv[2]);
+        for (int i = 3; i < argc; i++) {
+            Rule_list policy;
+            if (!read_rules(argv[i], policy) || policy.empty()) {
+                printf("%s: policy read failed\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            printf("%s: %zu rules\n", argv[i], policy.size());
+            timed_test<Cnode_engine>("cnode", policy, rounds);
+            timed_test<Tss_engine>("tuple space", policy, rounds);
+        }
+        return 0;
+    }
+
     if (argc < 4) {
         printf("Usage: %s <policy file> <packets file> <rule file with expressions to delete from tree>\n", argv[0]);
+        printf("       %s -b <rounds> <policy file>...\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
@@ -68,6 +103,17 @@ main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    run_tests<Cnode_engine>(rules, to_delete);
+    run_tests<Tss_engine>(rules, to_delete);
+    return 0;
+}
+
+template<class Engine>
+void
+run_tests(Rule_list rules, Rule_list& to_delete)
+{
+    Classifier_t<Packet_expr, void *, Engine> test;
+
 //    printf("Running tests on empty tree\n");
     test.unbuild();
     test.build();
@@ -79,14 +125,18 @@ main(int argc, char *argv[])
     add_rmv_test(test, rules);
 //    test.print();
 
-//    printf("timing test\n");
-//    timed_test(test, packets);
-
 //    printf("Unbuilding tree...\n");
     test.unbuild();
     add_rmv_test(test, rules);
 //    test.print();
 
+//    printf("Splitting tree one leaf per maintenance pass...\n");
+    while (test.maintain(1)) {
+        check_lookup(test, rules);
+    }
+    add_rmv_test(test, rules);
+//    test.print();
+
 //    printf("Deleting first half of rules and building...\n");
     int i = rules.size() / 2;
     for (Rule_list::iterator iter = rules.begin(); iter != rules.end(); ++iter) {
@@ -122,44 +172,232 @@ main(int argc, char *argv[])
 //        test.print();
     }
 
-    return 0;
+//    printf("Freezing and thawing...\n");
+    test.freeze();
+    check_lookup(test, rules);
+    check_lookup(test, to_delete);
+    test.thaw();
+    check_lookup(test, rules);
+    test.build();
+    add_rmv_test(test, rules);
 }
 
+static double
+elapsed_ms(const struct timeval& before, const struct timeval& after)
+{
+    return (after.tv_sec - before.tv_sec) * 1000
+        + ((double)(after.tv_usec - before.tv_usec)) / 1000;
+}
+
+/*
+ * Latency histogram with power-of-two nanosecond buckets: bucket i counts
+ * operations that took [2^i, 2^(i+1)) ns.
+ */
+
+class Latency_histogram {
+public:
+    Latency_histogram() : n(0), max_ns(0)
+        { memset(counts, 0, sizeof counts); }
+
+    void start() { clock_gettime(CLOCK_MONOTONIC, &before); }
+    void stop();
+    void print(const char *) const;
+
+private:
+    static const int N_BUCKETS = 32;
+
+    uint64_t counts[N_BUCKETS];
+    uint64_t n;
+    uint64_t max_ns;
+    struct timespec before;
+};
+
+void
+Latency_histogram::stop()
+{
+    struct timespec after;
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    uint64_t ns = (after.tv_sec - before.tv_sec) * 1000000000ULL
+        + after.tv_nsec - before.tv_nsec;
+
+    int i = 0;
+    while (i < N_BUCKETS - 1 && ns >> (i + 1)) {
+        i++;
+    }
+    counts[i]++;
+    n++;
+    if (ns > max_ns) {
+        max_ns = ns;
+    }
+}
+
+/*
+ * Prints one line per non-empty bucket with its upper bound, count, and
+ * cumulative percentage, then the worst case.
+ */
+
 void
-timed_test(Classifier_t<Packet_expr, void *>& test, Rule_list& rules)
+Latency_histogram::print(const char *name) const
 {
-    Classifier<Packet_expr, void *>& c = test.get_classifier();
-    uint32_t n_iterations = 1000000 / rules.size();
-    const Rule<Packet_expr, void *> *match;
+    uint64_t seen = 0;
+
+    printf("    %s latency, %llu ops:\n", name, (unsigned long long) n);
+    for (int i = 0; i < N_BUCKETS; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        seen += counts[i];
+        printf("      < %10llu ns %10llu %6.2f%%\n",
+               1ULL << (i + 1), (unsigned long long) counts[i],
+               100.0 * seen / n);
+    }
+    printf("      max %10llu ns\n", (unsigned long long) max_ns);
+}
 
+/*
+ * Times building the engine with 'rules', then, over 'rounds' rounds, adding
+ * a second copy of every rule, running maintenance passes until none is
+ * left, and deleting the copies again, then freezing, and looking up a Flow
+ * built from each rule's expression with get_rules() and get_top_rules(),
+ * and with get_rules() again once thawed.  Prints a latency histogram of each
+ * add_rule(), delete_rule() and maintenance pass.
+ */
+
+template<class Engine>
+void
+timed_test(const char *name, const Rule_list& rules, uint32_t rounds)
+{
+    Engine c;
+    std::vector<Flow> flows;
+    std::vector<uint32_t> ids;
     struct timeval before, after;
+    double update_ms = 0, build_ms = 0, freeze_ms = 0, lookup_ms = 0;
+    double top_ms = 0, thawed_ms = 0;
+    uint32_t matched = 0;
+    Latency_histogram add_latency, delete_latency, maintain_latency;
+    bool more;
+
+    for (Rule_list::const_iterator iter = rules.begin(); iter != rules.end();
+         ++iter)
+    {
+        flows.push_back(Flow(&iter->second.expr.match));
+    }
+
+    for (Rule_list::const_iterator iter = rules.begin(); iter != rules.end();
+         ++iter)
+    {
+        c.add_rule(iter->second.priority, iter->second.expr,
+                   iter->second.action);
+    }
+    EXIT_ASSERT(!gettimeofday(&before, NULL));
+    c.build();
+    EXIT_ASSERT(!gettimeofday(&after, NULL));
+    build_ms = elapsed_ms(before, after);
+
+    EXIT_ASSERT(!gettimeofday(&before, NULL));
+    for (uint32_t i = 0; i < rounds; i++) {
+        ids.clear();
+        for (Rule_list::const_iterator iter = rules.begin();
+             iter != rules.end(); ++iter)
+        {
+            add_latency.start();
+            uint32_t id = c.add_rule(iter->second.priority, iter->second.expr,
+                                     iter->second.action);
+            add_latency.stop();
+            ids.push_back(id);
+        }
+        do {
+            maintain_latency.start();
+            more = c.maintain(1);
+            maintain_latency.stop();
+        } while (more);
+        for (std::vector<uint32_t>::const_iterator id = ids.begin();
+             id != ids.end(); ++id)
+        {
+            delete_latency.start();
+            c.delete_rule(*id);
+            delete_latency.stop();
+        }
+    }
+    EXIT_ASSERT(!gettimeofday(&after, NULL));
+    update_ms = elapsed_ms(before, after);
+
+    EXIT_ASSERT(!gettimeofday(&before, NULL));
+    c.freeze();
+    EXIT_ASSERT(!gettimeofday(&after, NULL));
+    freeze_ms = elapsed_ms(before, after);
 
+    Cnode_result<Packet_expr, void *, Flow> result(NULL);
     EXIT_ASSERT(!gettimeofday(&before, NULL));
-    if (rules.size() > 1) {
-        for (uint32_t i = 0; i < n_iterations; i++) {
-            for (Rule_list::iterator iter = rules.begin();
-                 iter != rules.end(); ++iter)
-            {
-                Cnode_result<Packet_expr, void *, Packet_expr> result(&iter->second.expr);
-                c.get_rules(result);
-                match = result.next();
+    for (uint32_t i = 0; i < rounds; i++) {
+        for (std::vector<Flow>::const_iterator f = flows.begin();
+             f != flows.end(); ++f)
+        {
+            result.set_data(&*f);
+            c.get_rules(result);
+            while (result.next() != NULL) {
+                matched++;
             }
+            result.clear();
         }
-    } else {
-        for (uint32_t i = 0; i < n_iterations; i++) {
-            Cnode_result<Packet_expr, void *, Packet_expr> result(&rules.front().second.expr);
+    }
+    EXIT_ASSERT(!gettimeofday(&after, NULL));
+    lookup_ms = elapsed_ms(before, after);
+
+    EXIT_ASSERT(!gettimeofday(&before, NULL));
+    for (uint32_t i = 0; i < rounds; i++) {
+        for (std::vector<Flow>::const_iterator f = flows.begin();
+             f != flows.end(); ++f)
+        {
+            result.set_data(&*f);
+            c.get_top_rules(result);
+            const Rule<Packet_expr, void *> *match = result.next();
+            if (match != NULL) {
+                uint32_t top = match->priority;
+                do {
+                    matched++;
+                    match = result.next();
+                } while (match != NULL && match->priority == top);
+            }
+            result.clear();
+        }
+    }
+    EXIT_ASSERT(!gettimeofday(&after, NULL));
+    top_ms = elapsed_ms(before, after);
+
+    c.thaw();
+    EXIT_ASSERT(!gettimeofday(&before, NULL));
+    for (uint32_t i = 0; i < rounds; i++) {
+        for (std::vector<Flow>::const_iterator f = flows.begin();
+             f != flows.end(); ++f)
+        {
+            result.set_data(&*f);
             c.get_rules(result);
-            match = result.next();
+            while (result.next() != NULL) {
+                matched++;
+            }
+            result.clear();
         }
     }
     EXIT_ASSERT(!gettimeofday(&after, NULL));
-//    double time = (after.tv_sec - before.tv_sec) * 1000 + ((double)(after.tv_usec - before.tv_usec))/1000;
-//    printf("%u lookups in %fms\n", n_iterations * rules.size(), time);
+    thawed_ms = elapsed_ms(before, after);
+
+    double n_lookups = (double) rounds * flows.size();
+    printf("  %-12s %10.0f updates/s, build %.3f ms, freeze %.3f ms\n"
+           "  %-12s %10.0f lookups/s, %10.0f top lookups/s, "
+           "%10.0f unfrozen lookups/s\n", name,
+           2 * n_lookups / update_ms * 1000, build_ms, freeze_ms, "",
+           n_lookups / lookup_ms * 1000, n_lookups / top_ms * 1000,
+           n_lookups / thawed_ms * 1000);
+    add_latency.print("add_rule");
+    delete_latency.print("delete_rule");
+    maintain_latency.print("maintain(1)");
 }
 
 
+template<class Engine>
 void
-add_rmv_test(Classifier_t<Packet_expr, void *>& test, Rule_list& rules)
+add_rmv_test(Classifier_t<Packet_expr, void *, Engine>& test, Rule_list& rules)
 {
     check_lookup(test, rules);
 
@@ -197,11 +435,22 @@ add_rmv_test(Classifier_t<Packet_expr, void *>& test, Rule_list& rules)
     check_lookup(test, rules);
 }
 
+/*
+ * Looks up each rule's expression, and a Flow built from it, in both the
+ * engine and the linear classifier.
+ */
+
+template<class Engine>
 void
-check_lookup(Classifier_t<Packet_expr, void *>& test, Rule_list& rules)
+check_lookup(Classifier_t<Packet_expr, void *, Engine>& test, Rule_list& rules)
 {
-    for (Rule_list::iterator iter = rules.begin(); iter != rules.end(); ++iter)
+    for (Rule_list::iterator iter = rules.begin(); iter != rules.end(); ++iter) {
+        Flow flow(&iter->second.expr.match);
         EXIT_ASSERT(test.check_lookup(&iter->second.expr));
+        EXIT_ASSERT(test.check_top_lookup(&iter->second.expr));
+        EXIT_ASSERT(test.check_lookup(&flow));
+        EXIT_ASSERT(test.check_top_lookup(&flow));
+    }
 }
 
 bool
@@ -244,63 +493,69 @@ read_rules(const char *filename, Rule_list& rules)
     return true;
 }
 
-uint8_t
-hex_to_int(char ch)
+/*
+ * Parses 'str' as a value of the OXM field with 'header' into 'value', in the
+ * byte order ofl_match keeps: Ethernet addresses as "aa:bb:cc:dd:ee:ff", IP
+ * addresses in dotted or IPv6 notation, and anything else as an integer.
+ */
+
+bool
+parse_value(uint32_t header, const std::string& str, uint8_t *value)
 {
-    if (isdigit(ch))
-        return ch - '0';
-    return 10 + (tolower(ch) - 'a');
+    size_t len = OXM_LENGTH(header);
+
+    if (len == ETH_ADDR_LEN) {
+        ethernetaddr ea(str);
+        memcpy(value, ea.octet, len);
+        return true;
+    } else if (len == IPv6_ADDR_LEN) {
+        return inet_pton(AF_INET6, str.c_str(), value) == 1;
+    } else if (str.find('.') != std::string::npos) {
+        return len == 4 && inet_pton(AF_INET, str.c_str(), value) == 1;
+    }
+
+    std::stringstream ss(str);
+    uint64_t v;
+    if (!(ss >> v))
+        return false;
+    uint8_t v8 = v;
+    uint16_t v16 = v;
+    uint32_t v32 = v;
+    switch (len) {
+    case 1: memcpy(value, &v8, len); return true;
+    case 2: memcpy(value, &v16, len); return true;
+    case 4: memcpy(value, &v32, len); return true;
+    case 8: memcpy(value, &v, len); return true;
+    }
+    return false;
 }
 
+/*
+ * Sets the OXM field named 'type' (e.g. "eth_src") to 'strvalue', which may
+ * carry a mask after a '/'.
+ */
+
 bool
 set_field(Packet_expr& expr, std::string type, std::string strvalue)
 {
-    uint32_t value[2];
-
-    value[1] = 0;
-
-    if (type == "dlsrc" || type == "dldst") {
-        uint8_t *byte_ptr = (uint8_t*)value;
-        uint32_t len = strvalue.length();
-        std::string::size_type pos = 0;
-        for (uint32_t i = 0; i < 6; i++) {
-            if ((pos + 2) > len)
-                return false;
-            byte_ptr[i] = hex_to_int(strvalue.at(pos++)) << 4;
-            byte_ptr[i] += hex_to_int(strvalue.at(pos++));
-            pos++;
-        }
-        if (type == "dlsrc")
-            expr.set_field(Packet_expr::DL_SRC, value);
-        else
-            expr.set_field(Packet_expr::DL_DST, value);
+    std::map<std::string, std::pair<int,int> >::const_iterator f
+        = fields.find(type);
+    if (f == fields.end())
+        return false;
+
+    uint32_t header = f->second.first;
+    uint8_t value[IPv6_ADDR_LEN];
+    uint8_t mask[IPv6_ADDR_LEN];
+    std::string::size_type slash = strvalue.find('/');
+
+    if (!parse_value(header, strvalue.substr(0, slash), value))
+        return false;
+    if (slash == std::string::npos) {
+        expr.set_field(header, value);
     } else {
-        std::stringstream ss(strvalue);
-        ss >> value[0];
-
-        if (type == "apsrc")
-            expr.set_field(Packet_expr::AP_SRC, value);
-        else if (type == "apdst")
-            expr.set_field(Packet_expr::AP_DST, value);
-        else if (type == "nwsrc")
-            expr.set_field(Packet_expr::NW_SRC, value);
-        else if (type == "nwdst")
-            expr.set_field(Packet_expr::NW_DST, value);
-        else if (type == "tpsrc")
-            expr.set_field(Packet_expr::TP_SRC, value);
-        else if (type == "tpdst")
-            expr.set_field(Packet_expr::TP_DST, value);
-        else if (type == "groupsrc")
-            expr.set_field(Packet_expr::GROUP_SRC, value);
-        else if (type == "groupdst")
-            expr.set_field(Packet_expr::GROUP_DST, value);
-        else if (type == "dlproto")
-            expr.set_field(Packet_expr::DL_TYPE, value);
-        else if (type == "nwproto")
-            expr.set_field(Packet_expr::NW_PROTO, value);
-        else
+        if (!parse_value(header, strvalue.substr(slash + 1), mask))
             return false;
+        expr.set_field(OXM_MAKE_WILD_HEADER(header), value, mask);
     }
     return true;
 }
-
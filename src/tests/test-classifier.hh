@@ -19,15 +19,17 @@
 #define CLASSIFIER_TEST_HH
 
 #include "classifier.hh"
+#include "tuple-space.hh"
 
 /*
  * Classifier test class.
  *
- * Compares Classifier results to a linear
- * list classifier's results.
+ * Compares the results of a classifier engine (Classifier or Tuple_space) to
+ * a linear list classifier's results.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action,
+         class Engine = vigil::Classifier<Expr, Action> >
 class Classifier_t {
 
 public:
@@ -42,16 +44,22 @@ public:
     template<class Data>
     bool check_lookup(const Data *);
 
+    template<class Data>
+    bool check_top_lookup(const Data *);
+
     void build() { classifier.build(); }
     void unbuild() { classifier.unbuild(); }
     void clean() { classifier.clean(); }
+    bool maintain(uint32_t n) { return classifier.maintain(n); }
+    void freeze() { classifier.freeze(); }
+    void thaw() { classifier.thaw(); }
     void print() const { classifier.print(); }
 
-    vigil::Classifier<Expr, Action>& get_classifier()
+    Engine& get_classifier()
         { return classifier; }
 
 private:
-    vigil::Classifier<Expr, Action> classifier;
+    Engine classifier;
     std::list<vigil::Rule<Expr, Action> > linear;
 
     template<class Data>
@@ -67,9 +75,9 @@ private:
  * equivalent, else false.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action, class Engine>
 uint32_t
-Classifier_t<Expr, Action>::check_add_rule(uint32_t priority, const Expr& expr,
+Classifier_t<Expr, Action, Engine>::check_add_rule(uint32_t priority, const Expr& expr,
                                            Action action)
 {
     uint32_t id = classifier.add_rule(priority, expr, action);
@@ -104,9 +112,9 @@ Classifier_t<Expr, Action>::check_add_rule(uint32_t priority, const Expr& expr,
  * outcomes are equivalent, else false.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action, class Engine>
 bool
-Classifier_t<Expr, Action>::check_delete_rule(uint32_t id)
+Classifier_t<Expr, Action, Engine>::check_delete_rule(uint32_t id)
 {
     bool success = classifier.delete_rule(id);
 
@@ -128,10 +136,10 @@ Classifier_t<Expr, Action>::check_delete_rule(uint32_t id)
  * outcomes are equivalent, else false.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action, class Engine>
 template<class Data>
 bool
-Classifier_t<Expr, Action>::check_delete_rules(const Data *data)
+Classifier_t<Expr, Action, Engine>::check_delete_rules(const Data *data)
 {
     uint32_t c_del = classifier.delete_rules(data);
 
@@ -156,10 +164,10 @@ Classifier_t<Expr, Action>::check_delete_rules(const Data *data)
  * sets.  Returns true if the results are identical, else false.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action, class Engine>
 template<class Data>
 bool
-Classifier_t<Expr, Action>::check_lookup(const Data *data)
+Classifier_t<Expr, Action, Engine>::check_lookup(const Data *data)
 {
     vigil::Cnode_result<Expr, Action, Data> result(data);
 
@@ -192,6 +200,36 @@ Classifier_t<Expr, Action>::check_lookup(const Data *data)
 }
 
 
+/*
+ * Checks that get_top_rules() returns the same rules of the best matching
+ * priority as the linear classifier.  Returns true if they are the same,
+ * else false.
+ */
+
+template<class Expr, typename Action, class Engine>
+template<class Data>
+bool
+Classifier_t<Expr, Action, Engine>::check_top_lookup(const Data *data)
+{
+    vigil::Cnode_result<Expr, Action, Data> result(data);
+
+    classifier.get_top_rules(result);
+    const vigil::Rule<Expr, Action> *match = result.next();
+
+    typename Rule_list::const_iterator iter = linear.begin();
+    while (iter != linear.end() && !matches(iter->id, iter->expr, *data)) {
+        ++iter;
+    }
+    if (iter == linear.end()) {
+        return match == NULL;
+    }
+    if (match == NULL || match->priority != iter->priority) {
+        return false;
+    }
+    return resolve_priority(iter, data, match, result);
+}
+
+
 /*
  * Matching rules of equivalent priority might be encountered in a different
  * order by the linear classifier.  This reconciles that by comparing rules of
@@ -199,10 +237,10 @@ Classifier_t<Expr, Action>::check_lookup(const Data *data)
  * matches for the current priority are equivalent between the two classifiers.
  */
 
-template<class Expr, typename Action>
+template<class Expr, typename Action, class Engine>
 template<class Data>
 bool
-Classifier_t<Expr, Action>::resolve_priority(typename Rule_list::const_iterator& liter,
+Classifier_t<Expr, Action, Engine>::resolve_priority(typename Rule_list::const_iterator& liter,
                                              const Data *data,
                                              const vigil::Rule<Expr, Action> *match,
                                              vigil::Cnode_result<Expr, Action, Data>& result) const
@@ -0,0 +1,162 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests waiting on file descriptors, with the poll backend named on the
+ * command line. */
+
+#include "threads/cooperative.hh"
+#include <boost/bind.hpp>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace vigil;
+
+static int fds[2];
+
+static std::string
+revents_to_string(int revents)
+{
+    std::string s;
+    if (revents & POLLIN) {
+        s += "|IN";
+    }
+    if (revents & POLLOUT) {
+        s += "|OUT";
+    }
+    if (revents & POLLHUP) {
+        s += "|HUP";
+    }
+    if (revents & POLLNVAL) {
+        s += "|NVAL";
+    }
+    return s.empty() ? "0" : s.substr(1);
+}
+
+static void
+open_socketpair()
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+}
+
+static void
+reader(const char *name)
+{
+    int revents = Co_thread::fd_read_block(fds[0]);
+    char c;
+    bool got = read(fds[0], &c, 1) == 1;
+    printf("%s: revents=%s%s\n", name, revents_to_string(revents).c_str(),
+           got ? " read" : "");
+}
+
+static void
+writer(const char *name)
+{
+    int revents = Co_thread::fd_write_block(fds[0]);
+    printf("%s: revents=%s\n", name, revents_to_string(revents).c_str());
+}
+
+static void
+start(co_thread **thread, Co_completion *join,
+      void (*function)(const char *), const char *name)
+{
+    *thread = co_thread_create(&co_group_coop, boost::bind(function, name));
+    co_join_completion(*thread, join);
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        /* Fall back to the default if the backend is not available, since
+         * the results must be the same either way. */
+        co_set_poll_backend(!strcmp(argv[1], "epoll")
+                            ? CO_POLL_EPOLL : CO_POLL_POLL);
+    }
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    co_thread *thread, *thread2;
+    Co_completion join, join2;
+
+    /* These tests tend to hang if something goes wrong. */
+    alarm(3);
+
+    open_socketpair();
+
+    printf("Repeated read wakeups\n");
+    for (int i = 0; i < 3; i++) {
+        start(&thread, &join, reader, "reader");
+        co_yield();
+        printf("write\n");
+        write(fds[1], "x", 1);
+        join.block();
+        join.latch();
+    }
+
+    printf("\nReader and writer on one fd\n");
+    start(&thread, &join, reader, "reader");
+    start(&thread2, &join2, writer, "writer");
+    co_yield();
+    join2.block();
+    join2.latch();
+    printf("write\n");
+    write(fds[1], "x", 1);
+    join.block();
+    join.latch();
+
+    printf("\nco_fd_closed\n");
+    start(&thread, &join, reader, "reader");
+    co_yield();
+    printf("co_fd_closed\n");
+    co_fd_closed(fds[0]);
+    join.block();
+    join.latch();
+    close(fds[0]);
+    close(fds[1]);
+
+    printf("\nfd number reused without co_fd_closed\n");
+    open_socketpair();
+    start(&thread, &join, reader, "reader");
+    co_yield();
+    write(fds[1], "x", 1);
+    join.block();
+    join.latch();
+    close(fds[0]);
+    close(fds[1]);
+    open_socketpair();
+    start(&thread, &join, reader, "reader");
+    co_yield();
+    printf("write\n");
+    write(fds[1], "x", 1);
+    join.block();
+    join.latch();
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+for backend in poll epoll; do
+    $SUPERVISOR ./test-coop-fd-wait $backend > tmp$$
+    diff -u - tmp$$ <<EOF2
+Repeated read wakeups
+write
+reader: revents=IN read
+write
+reader: revents=IN read
+write
+reader: revents=IN read
+
+Reader and writer on one fd
+writer: revents=OUT
+write
+reader: revents=IN read
+
+co_fd_closed
+co_fd_closed
+reader: revents=IN|HUP|NVAL
+
+fd number reused without co_fd_closed
+reader: revents=IN read
+write
+reader: revents=IN read
+EOF2
+done
@@ -0,0 +1,98 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests handler ordering, STOP, and adding and removing handlers, including
+ * from within a handler. */
+
+#include "event-dispatcher.hh"
+#include <boost/bind.hpp>
+#include "threads/cooperative.hh"
+#include <cstdio>
+
+using namespace vigil;
+
+class My_event
+    : public Event
+{
+public:
+    My_event() : Event(static_event_type<My_event>()) { }
+
+    static const Event_name static_get_name() {
+        return "My_event";
+    }
+};
+
+static Event_dispatcher* dispatcher;
+static Event_dispatcher::Handler_id removable;
+
+static Disposition
+handler(const char* name, Disposition disposition)
+{
+    printf("  %s\n", name);
+    return disposition;
+}
+
+static Disposition
+remover(const Event&)
+{
+    printf("  remover\n");
+    dispatcher->remove_handler(removable);
+    return CONTINUE;
+}
+
+static void
+dispatch(const char* title)
+{
+    printf("%s\n", title);
+    Disposition d = dispatcher->dispatch(My_event());
+    printf("  => %s\n", d == STOP ? "STOP" : "CONTINUE");
+}
+
+int
+main(int argc, char *argv[])
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    dispatcher = new Event_dispatcher;
+    dispatch("No handlers");
+
+    Event_type type = static_event_type<My_event>();
+    dispatcher->add_handler(type, boost::bind(handler, "b1", CONTINUE), 20);
+    Event_dispatcher::Handler_id a
+        = dispatcher->add_handler(My_event::static_get_name(),
+                                  boost::bind(handler, "a", CONTINUE), 10);
+    dispatcher->add_handler(type, boost::bind(handler, "b2", CONTINUE), 20);
+    Event_dispatcher::Handler_id c
+        = dispatcher->add_handler(type, boost::bind(handler, "c", STOP), 30);
+    dispatcher->add_handler(type, boost::bind(handler, "d", CONTINUE), 40);
+    dispatch("Ordered, stopped by c");
+
+    printf("remove a: %d\n", dispatcher->remove_handler(a));
+    printf("remove c: %d\n", dispatcher->remove_handler(c));
+    printf("remove c again: %d\n", dispatcher->remove_handler(c));
+    dispatch("Without a and c");
+
+    removable = dispatcher->add_handler(type, boost::bind(handler, "e",
+                                                          CONTINUE), 50);
+    dispatcher->add_handler(type, remover, 0);
+    dispatch("Remover removes e while running");
+    dispatch("Without e");
+
+    return 0;
+}
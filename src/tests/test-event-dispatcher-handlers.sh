@@ -0,0 +1,34 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-event-dispatcher-handlers > tmp$$
+diff -u - tmp$$ <<EOF
+No handlers
+  => CONTINUE
+Ordered, stopped by c
+  a
+  b1
+  b2
+  c
+  => STOP
+remove a: 1
+remove c: 1
+remove c again: 0
+Without a and c
+  b1
+  b2
+  d
+  => CONTINUE
+Remover removes e while running
+  remover
+  b1
+  b2
+  d
+  e
+  => CONTINUE
+Without e
+  remover
+  b1
+  b2
+  d
+  => CONTINUE
+EOF
@@ -0,0 +1,198 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests the order in which Event_dispatcher::poll() takes events from its
+ * priority lanes, the lane budgets and statistics, and post_in_order().  Also
+ * checks that nox's lanes, with each datapath's events posted in order, let
+ * one datapath's high lane events pass only other datapaths' events. */
+
+#include "event-dispatcher.hh"
+#include <boost/bind.hpp>
+#include "datapath-join.hh"
+#include "datapath-leave.hh"
+#include "nox.hh"
+#include "ofp-msg-event.hh"
+#include "threads/cooperative.hh"
+#include <cstdio>
+#include <string>
+
+using namespace vigil;
+
+class Named_event
+    : public Event
+{
+public:
+    Named_event(Event_type type, const std::string& label_)
+        : Event(type), label(label_) { }
+
+    std::string label;
+};
+
+static Event_dispatcher* dispatcher;
+static Event_type high_type, normal_type, low_type;
+
+static Disposition
+handler(const Event& e)
+{
+    const Named_event& ne = dynamic_cast<const Named_event&>(e);
+    printf("  %s\n", ne.label.c_str());
+    if (ne.label == "repost") {
+        dispatcher->post(new Named_event(high_type, "reposted"));
+    }
+    return CONTINUE;
+}
+
+static void
+post(Event_type type, const char* label)
+{
+    dispatcher->post(new Named_event(type, label));
+}
+
+static void
+post_in_order(Event_type type, uint64_t key, const char* label)
+{
+    dispatcher->post_in_order(new Named_event(type, label), key);
+}
+
+static void
+poll(const char* title)
+{
+    printf("%s\n", title);
+    bool progress = dispatcher->poll();
+    printf("  => %s\n", progress ? "progress" : "idle");
+}
+
+static void
+print_stats(const char* name, Event_dispatcher::Lane lane)
+{
+    Event_dispatcher::Lane_stats stats = dispatcher->get_lane_stats(lane);
+    printf("%s: depth %zu, max depth %zu, dispatched %llu\n", name,
+           stats.depth, stats.max_depth,
+           (unsigned long long int) stats.n_dispatched);
+}
+
+/* Posts the events of a switch that sends packet-ins, a multipart reply and
+ * a barrier reply, then reconnects, and an echo request from a second switch,
+ * to a dispatcher with nox's default lanes. */
+static void
+test_default_lanes()
+{
+    dispatcher = new Event_dispatcher;
+    nox::set_default_lanes(*dispatcher);
+
+    Event_type join = static_event_type<Datapath_join_event>();
+    Event_type leave = static_event_type<Datapath_leave_event>();
+    Event_type packet_in = Ofp_msg_event::get_event_type(OFPT_PACKET_IN);
+    Event_type stats = Ofp_msg_event::get_stats_event_type(OFPMP_FLOW);
+    Event_type barrier = Ofp_msg_event::get_event_type(OFPT_BARRIER_REPLY);
+    Event_type echo = Ofp_msg_event::get_event_type(OFPT_ECHO_REQUEST);
+    Event_type port_status = Ofp_msg_event::get_event_type(OFPT_PORT_STATUS);
+    Event_type types[] = { join, leave, packet_in, stats, barrier, echo,
+                           port_status };
+    for (size_t i = 0; i < sizeof types / sizeof *types; i++) {
+        dispatcher->add_handler(types[i], handler, 0);
+    }
+
+    post_in_order(join, 1, "join");
+    post_in_order(stats, 1, "flow stats reply");
+    post_in_order(packet_in, 1, "packet-in");
+    post_in_order(barrier, 1, "barrier reply");
+    post_in_order(echo, 1, "echo request");
+    post_in_order(port_status, 1, "port status");
+    post_in_order(leave, 1, "leave");
+    post_in_order(join, 1, "join again");
+    post_in_order(stats, 1, "flow stats reply again");
+    post_in_order(join, 2, "join 2");
+    post_in_order(echo, 2, "echo request 2");
+    post_in_order(packet_in, 2, "packet-in 2");
+    post_in_order(port_status, 2, "port status 2");
+    poll("Default lanes");
+    poll("Default lanes, second poll");
+
+    delete dispatcher;
+}
+
+int
+main(int argc, char *argv[])
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    dispatcher = new Event_dispatcher;
+    high_type = event_type("High_event");
+    normal_type = event_type("Normal_event");
+    low_type = event_type("Low_event");
+    dispatcher->add_handler(high_type, handler, 0);
+    dispatcher->add_handler(normal_type, handler, 0);
+    dispatcher->add_handler(low_type, handler, 0);
+    dispatcher->set_lane(high_type, Event_dispatcher::HIGH_LANE);
+    dispatcher->set_lane(low_type, Event_dispatcher::LOW_LANE);
+    dispatcher->set_lane_budget(Event_dispatcher::NORMAL_LANE, 2);
+    dispatcher->set_lane_budget(Event_dispatcher::LOW_LANE, 1);
+
+    poll("Empty");
+
+    post(low_type, "l1");
+    post(normal_type, "n1");
+    post(low_type, "l2");
+    post(normal_type, "n2");
+    post(normal_type, "n3");
+    post(low_type, "l3");
+    post(high_type, "h1");
+    post(high_type, "h2");
+    poll("First poll");
+    poll("Second poll");
+    poll("Third poll");
+    poll("Fourth poll");
+
+    post(normal_type, "n4");
+    dispatcher->post(new Named_event(normal_type, "n5 (high)"),
+                     Event_dispatcher::HIGH_LANE);
+    post(high_type, "repost");
+    poll("Explicit lane and repost");
+    poll("After repost");
+
+    print_stats("high", Event_dispatcher::HIGH_LANE);
+    print_stats("normal", Event_dispatcher::NORMAL_LANE);
+    print_stats("low", Event_dispatcher::LOW_LANE);
+
+    /* Key 1's events go no higher than its queued low lane event, key 2's
+     * normal event waits at the head of its lane, and key 3's behind it, for
+     * key 2's high events beyond the budget, and key 3's high event follows
+     * its normal one. */
+    dispatcher->set_lane_budget(Event_dispatcher::HIGH_LANE, 1);
+    post_in_order(low_type, 1, "1: l");
+    post_in_order(high_type, 1, "1: h");
+    post_in_order(normal_type, 1, "1: n");
+    post_in_order(high_type, 2, "2: h1");
+    post_in_order(high_type, 2, "2: h2");
+    post_in_order(normal_type, 2, "2: n");
+    post_in_order(normal_type, 3, "3: n");
+    post_in_order(high_type, 3, "3: h");
+    poll("In order, first poll");
+    poll("In order, second poll");
+    poll("In order, third poll");
+    poll("In order, fourth poll");
+
+    post(low_type, "never dispatched");
+    post_in_order(low_type, 4, "never dispatched either");
+    delete dispatcher;
+
+    test_default_lanes();
+    return 0;
+}
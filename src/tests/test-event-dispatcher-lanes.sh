@@ -0,0 +1,66 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-event-dispatcher-lanes > tmp$$
+diff -u - tmp$$ <<EOF
+Empty
+  => idle
+First poll
+  h1
+  h2
+  n1
+  n2
+  l1
+  => progress
+Second poll
+  n3
+  l2
+  => progress
+Third poll
+  l3
+  => progress
+Fourth poll
+  => idle
+Explicit lane and repost
+  n5 (high)
+  repost
+  n4
+  => progress
+After repost
+  reposted
+  => progress
+high: depth 0, max depth 2, dispatched 5
+normal: depth 0, max depth 3, dispatched 4
+low: depth 0, max depth 3, dispatched 3
+In order, first poll
+  2: h1
+  1: l
+  => progress
+In order, second poll
+  2: h2
+  2: n
+  3: n
+  1: h
+  => progress
+In order, third poll
+  3: h
+  1: n
+  => progress
+In order, fourth poll
+  => idle
+Default lanes
+  join
+  join 2
+  echo request 2
+  flow stats reply
+  packet-in
+  barrier reply
+  echo request
+  port status
+  leave
+  join again
+  flow stats reply again
+  packet-in 2
+  port status 2
+  => progress
+Default lanes, second poll
+  => idle
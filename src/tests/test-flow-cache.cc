@@ -0,0 +1,159 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests the exact-match flow cache: hits return what the classifier would,
+ * rule changes expire every entry, flows differing in any field, mask or
+ * presence of a field get their own entries, and CLOCK eviction keeps the
+ * entries that have hit. */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "classifier.hh"
+#include "expr.hh"
+#include "flow.hh"
+#include "flow-cache.hh"
+#include "tuple-space.hh"
+
+using namespace vigil;
+
+typedef Flow_cache<Packet_expr, const char *> Cache;
+
+/* Looks 'flow' up through 'cache', printing the rules found and whether the
+ * lookup hit, and checks them against an uncached lookup. */
+template<class Engine>
+static void
+lookup(const char *what, Engine& classifier, Cache& cache, const Flow& flow)
+{
+    Cnode_result<Packet_expr, const char *, Flow> result(&flow);
+    uint64_t hits = cache.get_stats().n_hits;
+    const Cache::Rule_vector& rules
+        = cache.get_top_rules(classifier, flow, result);
+
+    std::string cached;
+    printf("%s:", what);
+    for (Cache::Rule_vector::const_iterator r = rules.begin();
+         r != rules.end(); ++r) {
+        printf(" %s(%u)", (*r)->action, (*r)->priority);
+        cached += std::string(" ") + (*r)->action;
+    }
+    printf(" [%s]\n", cache.get_stats().n_hits > hits ? "hit" : "miss");
+
+    std::string direct;
+    result.set_data(&flow);
+    classifier.get_top_rules(result);
+    const Rule<Packet_expr, const char *> *r = result.next();
+    if (r != NULL) {
+        uint32_t top = r->priority;
+        do {
+            direct += std::string(" ") + r->action;
+            r = result.next();
+        } while (r != NULL && r->priority == top);
+    }
+    result.clear();
+    if (cached != direct) {
+        printf("%s: cached%s, classifier%s\n", what, cached.c_str(),
+               direct.c_str());
+    }
+}
+
+static void
+print_stats(const Cache& cache)
+{
+    const Flow_cache_stats& s = cache.get_stats();
+    printf("%zu/%zu entries, %llu hits, %llu misses, %llu stale, "
+           "%llu evictions, hit rate %.2f\n", cache.size(), cache.capacity(),
+           (unsigned long long) s.n_hits, (unsigned long long) s.n_misses,
+           (unsigned long long) s.n_stale,
+           (unsigned long long) s.n_evictions, s.hit_rate());
+}
+
+static Flow
+tcp_flow(uint32_t in_port, uint16_t tcp_dst)
+{
+    Flow flow;
+    flow.set<OXM_OF_IN_PORT>(in_port);
+    flow.set<OXM_OF_ETH_TYPE>(0x0800);
+    flow.set<OXM_OF_IP_PROTO>(6);
+    flow.set<OXM_OF_TCP_DST>(tcp_dst);
+    return flow;
+}
+
+template<class Engine>
+static void
+run(const char *name)
+{
+    Engine classifier;
+    Cache cache(2);
+    Packet_expr e;
+
+    printf("%s\n", name);
+
+    e.set<OXM_OF_ETH_TYPE>(0x0800);
+    e.set<OXM_OF_IP_PROTO>(6);
+    e.set<OXM_OF_TCP_DST>(80);
+    classifier.add_rule(10, e, "web");
+    classifier.add_rule(10, e, "web-log");
+    e = Packet_expr();
+    e.set<OXM_OF_IN_PORT>(1);
+    uint32_t port1 = classifier.add_rule(20, e, "port1");
+    classifier.add_rule(100, Packet_expr(), "all");
+    classifier.build();
+
+    Flow web = tcp_flow(1, 80), ssh = tcp_flow(1, 22), other = tcp_flow(2, 22);
+    lookup("web", classifier, cache, web);
+    lookup("web", classifier, cache, web);
+    lookup("ssh", classifier, cache, ssh);
+    print_stats(cache);
+
+    /* Only 'web' has hit since the hand last passed, so 'ssh' goes. */
+    lookup("other", classifier, cache, other);
+    lookup("web", classifier, cache, web);
+    lookup("ssh", classifier, cache, ssh);
+    print_stats(cache);
+
+    e = Packet_expr();
+    e.set<OXM_OF_TCP_DST>(22);
+    uint32_t ssh_rule = classifier.add_rule(5, e, "ssh");
+    lookup("ssh after add", classifier, cache, ssh);
+    lookup("ssh after add", classifier, cache, ssh);
+    classifier.delete_rule(ssh_rule);
+    classifier.delete_rule(port1);
+    lookup("ssh after delete", classifier, cache, ssh);
+    print_stats(cache);
+
+    Flow masked = tcp_flow(1, 22);
+    masked.set<OXM_OF_METADATA>(0, 0);
+    Flow no_port = tcp_flow(1, 22);
+    no_port.match.present &= ~((uint64_t) 1 << OFPXMT_OFB_IN_PORT);
+    lookup("with metadata", classifier, cache, masked);
+    lookup("without in_port", classifier, cache, no_port);
+    lookup("ssh", classifier, cache, ssh);
+    print_stats(cache);
+
+    cache.clear();
+    lookup("ssh after clear", classifier, cache, ssh);
+    print_stats(cache);
+}
+
+int
+main()
+{
+    run<Classifier<Packet_expr, const char *> >("cnode");
+    run<Tuple_space<Packet_expr, const char *> >("tuple space");
+    return 0;
+}
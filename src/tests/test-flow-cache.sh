@@ -0,0 +1,43 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-flow-cache > tmp$$
+diff -u - tmp$$ <<EOF
+cnode
+web: web-log(10) web(10) [miss]
+web: web-log(10) web(10) [hit]
+ssh: port1(20) [miss]
+2/2 entries, 1 hits, 2 misses, 0 stale, 0 evictions, hit rate 0.33
+other: all(100) [miss]
+web: web-log(10) web(10) [hit]
+ssh: port1(20) [miss]
+2/2 entries, 2 hits, 4 misses, 0 stale, 2 evictions, hit rate 0.33
+ssh after add: ssh(5) [miss]
+ssh after add: ssh(5) [hit]
+ssh after delete: all(100) [miss]
+2/2 entries, 3 hits, 6 misses, 2 stale, 2 evictions, hit rate 0.33
+with metadata: all(100) [miss]
+without in_port: all(100) [miss]
+ssh: all(100) [hit]
+2/2 entries, 4 hits, 8 misses, 2 stale, 4 evictions, hit rate 0.33
+ssh after clear: all(100) [miss]
+1/2 entries, 4 hits, 9 misses, 2 stale, 4 evictions, hit rate 0.31
+tuple space
+web: web(10) web-log(10) [miss]
+web: web(10) web-log(10) [hit]
+ssh: port1(20) [miss]
+2/2 entries, 1 hits, 2 misses, 0 stale, 0 evictions, hit rate 0.33
+other: all(100) [miss]
+web: web(10) web-log(10) [hit]
+ssh: port1(20) [miss]
+2/2 entries, 2 hits, 4 misses, 0 stale, 2 evictions, hit rate 0.33
+ssh after add: ssh(5) [miss]
+ssh after add: ssh(5) [hit]
+ssh after delete: all(100) [miss]
+2/2 entries, 3 hits, 6 misses, 2 stale, 2 evictions, hit rate 0.33
+with metadata: all(100) [miss]
+without in_port: all(100) [miss]
+ssh: all(100) [hit]
+2/2 entries, 4 hits, 8 misses, 2 stale, 4 evictions, hit rate 0.33
+ssh after clear: all(100) [miss]
+1/2 entries, 4 hits, 9 misses, 2 stale, 4 evictions, hit rate 0.31
+EOF
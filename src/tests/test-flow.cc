@@ -0,0 +1,146 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests Flow's typed and string-named field accessors and its extraction of
+ * fields from raw frames. */
+
+#include <cstdio>
+#include <cstring>
+#include "buffer.hh"
+#include "flow.hh"
+
+using namespace vigil;
+
+/* Builds a frame out of big-endian fields. */
+struct Frame {
+    uint8_t data[128];
+    size_t size;
+
+    Frame() : size(0) { }
+    Frame& u8(uint8_t x) { data[size++] = x; return *this; }
+    Frame& u16(uint16_t x) { return u8(x >> 8).u8(x); }
+    Frame& u32(uint32_t x) { return u16(x >> 16).u16(x); }
+    Frame& bytes(const char *s, size_t n) {
+        memcpy(data + size, s, n);
+        size += n;
+        return *this;
+    }
+    Frame& eth(uint16_t type) {
+        return bytes("\x00\x00\x00\x00\x00\x02\x00\x00\x00\x00\x00\x01", 12)
+               .u16(type);
+    }
+    Frame& ipv4(uint8_t proto, uint16_t frag_off) {
+        return u8(0x45).u8(0xb9).u16(0).u32(frag_off).u8(64).u8(proto).u16(0)
+               .u32(0x0a000001).u32(0x0a000002);
+    }
+    Frame& ipv6(uint8_t next) {
+        u32(0x60b12345).u16(0).u8(next).u8(64);
+        bytes("\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x01", 16);
+        return bytes("\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x02", 16);
+    }
+};
+
+static Flow
+extract(const char *name, const Frame& frame)
+{
+    Flow f(1, Nonowning_buffer(frame.data, frame.size));
+    printf("%s: %s\n", name, f.to_string().c_str());
+    return f;
+}
+
+int
+main()
+{
+    Flow f;
+    printf("empty: in_port %s, eth_type %04x\n",
+           f.has<OXM_OF_IN_PORT>() ? "present" : "absent",
+           f.get<OXM_OF_ETH_TYPE>());
+
+    f.set<OXM_OF_IN_PORT>(3);
+    f.set<OXM_OF_ETH_TYPE>(0x0800);
+    f.set<OXM_OF_IP_PROTO>(6);
+    f.set<OXM_OF_ETH_SRC>(ethernetaddr("00:11:22:33:44:55"));
+    f.set<OXM_OF_METADATA>(0x0102030405060708ULL);
+    f.set<OXM_OF_IPV4_DST>(htonl(0x0a000000), htonl(0xff000000));
+    printf("typed: %s\n", f.to_string().c_str());
+
+    ethernetaddr src = f.get<OXM_OF_ETH_SRC>();
+    printf("get: in_port %u, eth_type %04x, ip_proto %u, eth_src %s, "
+           "metadata %016llx, ipv4_dst %08x\n",
+           f.get<OXM_OF_IN_PORT>(), f.get<OXM_OF_ETH_TYPE>(),
+           f.get<OXM_OF_IP_PROTO>(), src.string().c_str(),
+           (unsigned long long) f.get<OXM_OF_METADATA>(),
+           ntohl(f.get<OXM_OF_IPV4_DST>()));
+
+    ethernetaddr dst = f.get<OXM_OF_ETH_DST>();
+    printf("absent: eth_dst %s, tcp_dst %04x\n", dst.string().c_str(),
+           f.get<OXM_OF_TCP_DST>());
+
+    Flow g;
+    uint8_t eth_src[ETH_ADDR_LEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    g.Add_Field("in_port", (uint32_t) 3);
+    g.Add_Field("eth_type", (uint16_t) 0x0800);
+    g.Add_Field("ip_proto", (uint8_t) 6);
+    g.Add_Field("eth_src", eth_src);
+    g.Add_Field("metadata", (uint64_t) 0x0102030405060708ULL);
+    g.Add_Field("ipv4_dst", htonl(0x0a000000), htonl(0xff000000));
+    printf("string API: %s\n", f == g ? "same match" : "different match");
+
+    uint16_t eth_type;
+    g.get_Field("eth_type", &eth_type);
+    uint8_t mac[ETH_ADDR_LEN];
+    g.get_Field("eth_src", mac);
+    printf("get_Field: eth_type %04x, eth_src %s\n", eth_type,
+           ethernetaddr(mac).string().c_str());
+
+    g.Add_Field("no_such_field", (uint32_t) 1);
+    printf("unknown: %s\n", f == g ? "same match" : "different match");
+
+    extract("qinq tcp", Frame().eth(0x88a8).u16(0x6064).u16(0x8100).u16(0x00c8)
+                        .u16(0x0800).ipv4(6, 0).u16(1234).u16(80).u32(0));
+    extract("ipv4 fragment", Frame().eth(0x0800).ipv4(17, 0x00b9).u32(0));
+    extract("ipv4 icmp", Frame().eth(0x0800).ipv4(1, 0).u8(8).u8(0).u16(0));
+    extract("truncated tcp", Frame().eth(0x0800).ipv4(6, 0).u16(1234));
+    Flow v6 = extract("ipv6 udp", Frame().eth(0x86dd).ipv6(0).u8(17).u8(0).u16(0).u32(0)
+                        .u16(53).u16(5353).u32(0));
+    printf("ipv6 udp: ipv6_flabel %05x\n", v6.get<OXM_OF_IPV6_FLABEL>());
+    extract("ipv6 nd", Frame().eth(0x86dd).ipv6(58).u8(135).u8(0).u32(0).u16(0)
+                       .bytes("\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x03", 16)
+                       .u8(1).u8(1).bytes("\x00\x00\x00\x00\x00\x02", 6));
+    Flow arp = extract("arp", Frame().eth(0x0806).u16(1).u16(0x0800).u8(6).u8(4).u16(1)
+                   .bytes("\x00\x00\x00\x00\x00\x02", 6).u32(0x0a000001)
+                   .bytes("\x00\x00\x00\x00\x00\x00", 6).u32(0x0a000002));
+    printf("arp: arp_sha %s, arp_tha %s\n",
+           arp.get<OXM_OF_ARP_SHA>().string().c_str(),
+           arp.get<OXM_OF_ARP_THA>().string().c_str());
+    Flow mpls = extract("mpls", Frame().eth(0x8847).u32(0x0006413f).ipv4(6, 0));
+    printf("mpls: mpls_label %u, mpls_tc %u, mpls_bos %u\n",
+           mpls.get<OXM_OF_MPLS_LABEL>(), mpls.get<OXM_OF_MPLS_TC>(),
+           mpls.get<OXM_OF_MPLS_BOS>());
+    extract("llc", Frame().eth(46).u8(0x42).u8(0x42).u8(3).u32(0));
+    extract("runt", Frame().u32(0));
+
+    Frame tcp;
+    tcp.eth(0x0800).ipv4(6, 0).u16(1234).u16(80);
+    Flow h;
+    h.extract(2, tcp.data, tcp.size);
+    h.extract(1, tcp.data, tcp.size);
+    printf("re-extract: %s\n",
+           h == Flow(1, Nonowning_buffer(tcp.data, tcp.size))
+           ? "same match" : "different match");
+    return 0;
+}
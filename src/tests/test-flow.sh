@@ -0,0 +1,27 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-flow > tmp$$
+diff -u - tmp$$ <<EOF
+empty: in_port absent, eth_type ffff
+typed: oxm{in_port="3", metadata="72623859790382856", eth_src="00:11:22:33:44:55", eth_type=0x"800", ip_proto="6", ipv4_dst="10.0.0.0"ipv4_dst_mask="255.0.0.0"}
+get: in_port 3, eth_type 0800, ip_proto 6, eth_src 00:11:22:33:44:55, metadata 0102030405060708, ipv4_dst 0a000000
+absent: eth_dst ff:ff:ff:ff:ff:ff, tcp_dst ffff
+string API: same match
+get_Field: eth_type 0800, eth_src 00:11:22:33:44:55
+Match field: no_such_field is not supported 
+unknown: same match
+qinq tcp: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"800", vlan_vid="4196", vlan_pcp="3", ip_dscp="46", ip_ecn="1", ip_proto="6", ipv4_src="10.0.0.1", ipv4_dst="10.0.0.2", tcp_src="1234", tcp_dst="80"}
+ipv4 fragment: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"800", ip_dscp="46", ip_ecn="1", ip_proto="17", ipv4_src="10.0.0.1", ipv4_dst="10.0.0.2"}
+ipv4 icmp: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"800", ip_dscp="46", ip_ecn="1", ip_proto="1", ipv4_src="10.0.0.1", ipv4_dst="10.0.0.2", icmpv4_type= "8", icmpv4_code="0"}
+truncated tcp: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"800", ip_dscp="46", ip_ecn="1", ip_proto="6", ipv4_src="10.0.0.1", ipv4_dst="10.0.0.2"}
+ipv6 udp: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"86dd", ip_dscp="2", ip_ecn="3", ip_proto="17", udp_src="53", udp_dst="5353", nw_src_ipv6="fe80::1", nw_dst_ipv6="fe80::2", ipv6_flow_label="45"}
+ipv6 udp: ipv6_flabel 12345
+ipv6 nd: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"86dd", ip_dscp="2", ip_ecn="3", ip_proto="58", nw_src_ipv6="fe80::1", nw_dst_ipv6="fe80::2", ipv6_flow_label="45", icmpv6_type="135", icmpv6_code="0", ipv6_nd_target="fe80::3", ipv6_nd_sll="00:00:00:00:00:02"}
+arp: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"806", arp_op=0x"1", arp_sha="10.0.0.1", arp_tpa="10.0.0.2", }
+arp: arp_sha 00:00:00:00:00:02, arp_tha 00:00:00:00:00:00
+mpls: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"8847", mpls_label="64", mpls_tc="0", }
+mpls: mpls_label 100, mpls_tc 0, mpls_bos 1
+llc: oxm{in_port="1", eth_dst="00:00:00:00:00:02", eth_src="00:00:00:00:00:01", eth_type=0x"5ff"}
+runt: oxm{in_port="1"}
+re-extract: same match
+EOF
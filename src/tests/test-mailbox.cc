@@ -0,0 +1,81 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests passing callbacks between thread groups through Mailboxes. */
+#include "mailbox.hh"
+#include "threads/cooperative.hh"
+#include <boost/bind.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace vigil;
+
+static const int N_REQUESTS = 5;
+
+static co_group* worker_group;
+static Mailbox* requests;
+static Mailbox* replies;
+
+static void
+reply(int n, bool request_in_worker)
+{
+    printf("reply %d%s%s\n", n,
+           request_in_worker ? "" : " (request in wrong group)",
+           co_group_self() == &co_group_coop ? "" : " (reply in wrong group)");
+    if (n == N_REQUESTS - 1) {
+        exit(0);
+    }
+}
+
+static void
+request(int n)
+{
+    replies->post(boost::bind(reply, n, co_group_self() == worker_group));
+}
+
+static void
+worker()
+{
+    Poll_loop loop(2, worker_group);
+    loop.add_pollable(requests);
+    loop.run();
+}
+
+int
+main(int argc, char *argv[])
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    /* These tests tend to hang if something goes wrong. */
+    alarm(3);
+
+    requests = new Mailbox;
+    replies = new Mailbox;
+    co_group_create(&worker_group);
+    co_thread_create(worker_group, worker);
+
+    for (int i = 0; i < N_REQUESTS; i++) {
+        requests->post(boost::bind(request, i));
+    }
+
+    Poll_loop loop(2);
+    loop.add_pollable(replies);
+    loop.run();
+}
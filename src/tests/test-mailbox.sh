@@ -0,0 +1,10 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-mailbox > tmp$$
+diff -u - tmp$$ <<EOF
+reply 0
+reply 1
+reply 2
+reply 3
+reply 4
+EOF
@@ -0,0 +1,164 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TEST_MSGS_HH
+#define TEST_MSGS_HH
+
+#include <netinet/in.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../oflib/ofl-actions.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+/*
+ * OpenFlow messages shared by the tests and benchmarks.
+ *
+ * A program that defines TEST_MSGS_COUNT_MALLOCS before including this
+ * header also gets malloc(), calloc() and realloc() replaced by versions
+ * that count their calls in n_mallocs.  They call glibc's functions directly,
+ * so this only works in a program of its own.
+ */
+
+#ifdef TEST_MSGS_COUNT_MALLOCS
+static unsigned long int n_mallocs;
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+extern "C" void*
+malloc(size_t size)
+{
+    ++n_mallocs;
+    return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t n, size_t size)
+{
+    ++n_mallocs;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void*
+realloc(void* p, size_t size)
+{
+    ++n_mallocs;
+    return __libc_realloc(p, size);
+}
+#endif
+
+/* A flow-mod that adds a TCP/IPv4 5-tuple flow with one apply-actions
+ * instruction holding one output action to port 2, the message a controller
+ * sends most often.  'actions' may also be used for other messages. */
+struct Flow_mod_fixture {
+    struct ofl_match match;
+    struct ofl_action_output output;
+    struct ofl_action_header *actions[1];
+    struct ofl_instruction_actions apply;
+    struct ofl_instruction_header *insts[1];
+    struct ofl_msg_flow_mod mod;
+
+    Flow_mod_fixture();
+
+private:
+    /* The members point to each other. */
+    Flow_mod_fixture(const Flow_mod_fixture&);
+    Flow_mod_fixture& operator=(const Flow_mod_fixture&);
+};
+
+inline
+Flow_mod_fixture::Flow_mod_fixture()
+{
+    static const uint8_t mac[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 5 };
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put_bytes(&match, OXM_OF_ETH_SRC, mac, NULL);
+    ofl_structs_match_put_bytes(&match, OXM_OF_ETH_DST, mac, NULL);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put8(&match, OXM_OF_IP_PROTO, 6);
+    ofl_structs_match_put32(&match, OXM_OF_IPV4_SRC, htonl(0x0a000001));
+    ofl_structs_match_put32(&match, OXM_OF_IPV4_DST, htonl(0x0a000002));
+    ofl_structs_match_put16(&match, OXM_OF_TCP_SRC, 1234);
+    ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 80);
+
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = 2;
+    actions[0] = &output.header;
+
+    memset(&apply, 0, sizeof apply);
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = 1;
+    apply.actions = actions;
+    insts[0] = &apply.header;
+
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.command = OFPFC_ADD;
+    mod.idle_timeout = 5;
+    mod.priority = 0x8000;
+    mod.buffer_id = 0xffffffff;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match.header;
+    mod.instructions_num = 1;
+    mod.instructions = insts;
+}
+
+/* Returns a packed OFPT_PACKET_IN with transaction id 'xid', 'match' and a
+ * frame of 'frame_len' zero bytes, at most 1500, in a buffer allocated with
+ * malloc(), and stores its length in '*size'.  Exits if packing fails.
+ * ofl_msg_pack() expects the values of a packet-in's match in network byte
+ * order. */
+inline uint8_t *
+pack_packet_in(const struct ofl_match *match, size_t frame_len, uint32_t xid,
+               size_t *size)
+{
+    static uint8_t frame[1500];
+    struct ofl_msg_packet_in pin;
+    memset(&pin, 0, sizeof pin);
+    pin.header.type = OFPT_PACKET_IN;
+    pin.buffer_id = 0xffffffff;
+    pin.total_len = frame_len;
+    pin.reason = OFPR_NO_MATCH;
+    pin.match = (struct ofl_match_header *) &match->header;
+    pin.data_length = frame_len;
+    pin.data = frame;
+
+    uint8_t *buf;
+    if (ofl_msg_pack(&pin.header, xid, &buf, size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return buf;
+}
+
+/* Like the above, with a match on 'in_port', in host byte order, alone. */
+inline uint8_t *
+pack_packet_in(uint32_t in_port, size_t frame_len, uint32_t xid, size_t *size)
+{
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, htonl(in_port));
+    return pack_packet_in(&match, frame_len, xid, size);
+}
+
+#endif /* test-msgs.hh */
@@ -0,0 +1,207 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests ofl_arena and decoding messages into an arena with
+ * ofl_msg_unpack_arena() and ofl_msg_unpack_borrowed(). */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "../oflib/ofl-arena.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+static void
+test_alloc()
+{
+    struct ofl_arena arena;
+    ofl_arena_init(&arena);
+
+    uint8_t* a = (uint8_t*) ofl_arena_alloc(&arena, 3);
+    uint8_t* b = (uint8_t*) ofl_arena_alloc(&arena, 40);
+    printf("aligned: %s\n",
+           (uintptr_t) a % 16 == 0 && (uintptr_t) b % 16 == 0 ? "yes" : "no");
+    printf("distinct: %s\n", b >= a + 16 ? "yes" : "no");
+
+    /* Larger than a chunk. */
+    uint8_t* big = (uint8_t*) ofl_arena_alloc(&arena, 100000);
+    memset(big, 0xff, 100000);
+
+    ofl_arena_reset(&arena);
+    uint8_t* c = (uint8_t*) ofl_arena_alloc(&arena, 8);
+    printf("reused after reset: %s\n", c == a ? "yes" : "no");
+    ofl_arena_destroy(&arena);
+}
+
+/* Returns a packed flow stats reply with 'n' flows, each with a match and
+ * an apply-actions instruction. */
+static uint8_t*
+make_flow_stats_reply(size_t n, size_t* size)
+{
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, 0x0800);
+
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = 2;
+    output.max_len = 0;
+    struct ofl_action_header* actions[] = { &output.header };
+
+    struct ofl_instruction_actions apply;
+    memset(&apply, 0, sizeof apply);
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = 1;
+    apply.actions = actions;
+    struct ofl_instruction_header* insts[] = { &apply.header };
+
+    struct ofl_flow_stats* stats = new ofl_flow_stats[n];
+    struct ofl_flow_stats** stats_ptrs = new ofl_flow_stats*[n];
+    for (size_t i = 0; i < n; i++) {
+        memset(&stats[i], 0, sizeof stats[i]);
+        stats[i].priority = i;
+        stats[i].cookie = 1000 + i;
+        stats[i].packet_count = i * 10;
+        stats[i].match = &match.header;
+        stats[i].instructions_num = 1;
+        stats[i].instructions = insts;
+        stats_ptrs[i] = &stats[i];
+    }
+
+    struct ofl_msg_multipart_reply_flow reply;
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_FLOW;
+    reply.stats_num = n;
+    reply.stats = stats_ptrs;
+
+    uint8_t* buf;
+    if (ofl_msg_pack(&reply.header.header, 7, &buf, size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    delete[] stats;
+    delete[] stats_ptrs;
+    return buf;
+}
+
+static void
+test_unpack()
+{
+    size_t size;
+    uint8_t* packed = make_flow_stats_reply(3, &size);
+
+    struct ofl_msg_header* heap_msg;
+    uint32_t xid;
+    if (ofl_msg_unpack(packed, size, &heap_msg, &xid, NULL)) {
+        fprintf(stderr, "ofl_msg_unpack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    char* heap_str = ofl_msg_to_string(heap_msg, NULL);
+
+    struct ofl_arena arena;
+    ofl_arena_init(&arena);
+    for (int i = 0; i < 2; i++) {
+        struct ofl_msg_header* msg;
+        ofl_err error = ofl_msg_unpack_arena(packed, size, &msg, &xid, &arena);
+        char* str = ofl_msg_to_string(msg, NULL);
+        printf("arena unpack %d: error %d, xid %u, %s\n", i, (int) error, xid,
+               strcmp(str, heap_str) ? "differs" : "same as heap unpack");
+        free(str);
+        ofl_arena_reset(&arena);
+    }
+
+    /* Claims 3 flows, but the last one is cut short.  The partly decoded
+     * message is released with the arena. */
+    size_t short_size = size - 8;
+    packed[2] = short_size >> 8;
+    packed[3] = short_size;
+    struct ofl_msg_header* msg;
+    ofl_err error = ofl_msg_unpack_arena(packed, short_size, &msg, &xid,
+                                         &arena);
+    printf("truncated: %s\n", error ? "error" : "no error");
+    ofl_arena_destroy(&arena);
+
+    free(heap_str);
+    ofl_msg_free(heap_msg, NULL);
+    free(packed);
+}
+
+/* Decodes a packet-in with ofl_msg_unpack_arena() and with
+ * ofl_msg_unpack_borrowed(), and checks where its data ends up. */
+static void
+test_borrow()
+{
+    uint8_t frame[60];
+    for (size_t i = 0; i < sizeof frame; i++) {
+        frame[i] = i;
+    }
+
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 3);
+
+    struct ofl_msg_packet_in pin;
+    memset(&pin, 0, sizeof pin);
+    pin.header.type = OFPT_PACKET_IN;
+    pin.buffer_id = 0xffffffff;
+    pin.total_len = sizeof frame;
+    pin.match = &match.header;
+    pin.data_length = sizeof frame;
+    pin.data = frame;
+
+    uint8_t* packed;
+    size_t size;
+    if (ofl_msg_pack(&pin.header, 1, &packed, &size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct ofl_arena arena;
+    ofl_arena_init(&arena);
+    for (int borrow = 0; borrow < 2; borrow++) {
+        struct ofl_msg_header* msg;
+        uint32_t xid;
+        ofl_err error = (borrow
+                         ? ofl_msg_unpack_borrowed(packed, size, &msg, &xid,
+                                                   &arena)
+                         : ofl_msg_unpack_arena(packed, size, &msg, &xid,
+                                                &arena));
+        struct ofl_msg_packet_in* p = (struct ofl_msg_packet_in*) msg;
+        printf("%s: error %d, %zu bytes of data %s, %s\n",
+               borrow ? "borrowed" : "copied", (int) error, p->data_length,
+               (p->data >= packed && p->data < packed + size
+                ? "in receive buffer" : "copied out"),
+               !memcmp(p->data, frame, sizeof frame) ? "intact" : "corrupt");
+        ofl_arena_reset(&arena);
+    }
+    ofl_arena_destroy(&arena);
+    free(packed);
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_alloc();
+    test_unpack();
+    test_borrow();
+    return 0;
+}
@@ -0,0 +1,13 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofl-arena > tmp$$
+diff -u - tmp$$ <<EOF
+aligned: yes
+distinct: yes
+reused after reset: yes
+arena unpack 0: error 0, xid 7, same as heap unpack
+arena unpack 1: error 0, xid 7, same as heap unpack
+truncated: error
+copied: error 0, 60 bytes of data copied out, intact
+borrowed: error 0, 60 bytes of data in receive buffer, intact
+EOF
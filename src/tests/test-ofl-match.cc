@@ -0,0 +1,233 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests building, reading, packing and unpacking the flat ofl_match. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+static void
+print_match(const char* title, struct ofl_match* m)
+{
+    char* s = ofl_structs_match_to_string(&m->header, NULL);
+    printf("%s: %s (length %u)\n", title, s, m->header.length);
+    free(s);
+}
+
+/* Packs 'm' the way a flow_mod does and unpacks it into '*dst'. */
+static ofl_err
+round_trip(struct ofl_match* m, struct ofl_match** dst)
+{
+    uint8_t buf[1024];
+    memset(buf, 0, sizeof buf);
+    struct ofp_match* om = (struct ofp_match*) buf;
+    ofl_structs_match_pack(&m->header, om, NULL, HOST_ORDER, NULL);
+
+    size_t len = sizeof buf;
+    return ofl_structs_match_unpack(om, buf + sizeof(struct ofp_match) - 4,
+                                    &len, (struct ofl_match_header**) dst,
+                                    NULL);
+}
+
+/* Appends an OXM TLV with 'header' and the OXM_LENGTH(header) bytes of
+ * 'value' to the match in 'buf', which starts with a struct ofp_match
+ * header followed by '*len' bytes of TLVs. */
+static void
+put_tlv(uint8_t* buf, size_t* len, uint32_t header, const void* value)
+{
+    uint8_t* p = buf + sizeof(struct ofp_match) - 4 + *len;
+    uint32_t h = htonl(header);
+    memcpy(p, &h, 4);
+    memcpy(p + 4, value, OXM_LENGTH(header));
+    *len += 4 + OXM_LENGTH(header);
+}
+
+/* Unpacks the match in 'buf', with 'len' bytes of TLVs, and prints the
+ * outcome. */
+static void
+pull(const char* title, uint8_t* buf, size_t len)
+{
+    struct ofp_match* om = (struct ofp_match*) buf;
+    om->type = htons(OFPMT_OXM);
+    om->length = htons(len + 4);
+
+    struct ofl_match* m;
+    size_t buf_len = 256;
+    ofl_err error = ofl_structs_match_unpack(om, buf + 4, &buf_len,
+                                             (struct ofl_match_header**) &m,
+                                             NULL);
+    printf("%s: %s\n", title,
+           !error ? "ok"
+           : error == ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_PREREQ)
+           ? "bad prerequisite"
+           : error == ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_DUP_FIELD)
+           ? "duplicate field"
+           : error == ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_FIELD)
+           ? "bad field"
+           : error == ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_MASK)
+           ? "bad mask" : "other error");
+    ofl_structs_free_match(&m->header, NULL);
+}
+
+/* Checks field prerequisites, duplicates and unknown fields. */
+static void
+test_prereqs()
+{
+    uint8_t buf[256] = {0};
+    size_t len;
+    uint32_t port = htonl(1);
+    uint16_t ip = htons(0x0800), ipv6 = htons(0x86dd), arp = htons(0x0806);
+    uint16_t mpls_mc = htons(0x8848), vid = htons(0x1005), tp = htons(80);
+    uint8_t tcp = IPPROTO_TCP, udp = IPPROTO_UDP, pcp = 3, tc = 1;
+    uint32_t addr = htonl(0x0a000001), label = htonl(5);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &ip);
+    put_tlv(buf, &len, OXM_OF_IP_PROTO, &udp);
+    put_tlv(buf, &len, OXM_OF_TCP_DST, &tp);
+    pull("tcp_dst with ip_proto udp", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &ipv6);
+    put_tlv(buf, &len, OXM_OF_IP_PROTO, &tcp);
+    put_tlv(buf, &len, OXM_OF_TCP_DST, &tp);
+    pull("tcp_dst over ipv6", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &ip);
+    put_tlv(buf, &len, OXM_OF_TCP_DST, &tp);
+    pull("tcp_dst without ip_proto", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &arp);
+    put_tlv(buf, &len, OXM_OF_IPV4_SRC, &addr);
+    pull("ipv4_src over arp", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &arp);
+    put_tlv(buf, &len, OXM_OF_ARP_SPA, &addr);
+    pull("arp_spa over arp", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_ETH_TYPE, &mpls_mc);
+    put_tlv(buf, &len, OXM_OF_MPLS_LABEL, &label);
+    pull("mpls_label over multicast mpls", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_IN_PHY_PORT, &port);
+    pull("in_phy_port without in_port", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_IN_PORT, &port);
+    put_tlv(buf, &len, OXM_OF_IN_PHY_PORT, &port);
+    pull("in_phy_port after in_port", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_VLAN_PCP, &pcp);
+    pull("vlan_pcp without vlan_vid", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_VLAN_VID, &vid);
+    put_tlv(buf, &len, OXM_OF_VLAN_PCP, &pcp);
+    pull("vlan_pcp after vlan_vid", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_IN_PORT, &port);
+    put_tlv(buf, &len, OXM_OF_IN_PORT, &port);
+    pull("in_port twice", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_OF_IPV6_TC, &tc);
+    pull("other class", buf, len);
+
+    len = 0;
+    put_tlv(buf, &len, OXM_HEADER_W(0x8000, 5, 2), &ip);
+    pull("masked eth_type", buf, len);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct ofl_match m;
+    ofl_structs_match_init(&m);
+    print_match("empty", &m);
+
+    uint8_t eth_src[ETH_ADDR_LEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    ofl_structs_match_put16(&m, OXM_OF_TCP_DST, 80);
+    ofl_structs_match_put_eth(&m, OXM_OF_ETH_SRC, eth_src);
+    ofl_structs_match_put8(&m, OXM_OF_IP_PROTO, IPPROTO_TCP);
+    ofl_structs_match_put32m(&m, OXM_OF_IPV4_DST_W, htonl(0x0a000000),
+                             htonl(0xff000000));
+    ofl_structs_match_put16(&m, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put32(&m, OXM_OF_IN_PORT, 1);
+    print_match("built", &m);
+
+    ofl_structs_match_put16(&m, OXM_OF_TCP_DST, 443);
+    print_match("replaced tcp_dst", &m);
+
+    uint16_t tcp_dst;
+    memcpy(&tcp_dst, ofl_structs_match_get(&m, OXM_OF_TCP_DST), 2);
+    printf("get tcp_dst: %u\n", tcp_dst);
+    printf("get udp_dst: %s\n",
+           ofl_structs_match_get(&m, OXM_OF_UDP_DST) ? "present" : "absent");
+
+    unsigned int field;
+    printf("fields:");
+    OFL_MATCH_FOR_EACH_FIELD (field, &m) {
+        uint32_t header = ofl_structs_match_field_header(&m, field);
+        printf(" %u%s", field, OXM_HASMASK(header) ? "/masked" : "");
+    }
+    printf("\n");
+
+    struct hmap fields;
+    ofl_structs_match_to_hmap(&m, &fields);
+    struct ofl_match_tlv* tlv;
+    HMAP_FOR_EACH_WITH_HASH (tlv, struct ofl_match_tlv, hmap_node,
+                             hash_int(OXM_OF_IPV4_DST_W, 0), &fields) {
+        uint32_t value, mask;
+        memcpy(&value, tlv->value, 4);
+        memcpy(&mask, tlv->value + 4, 4);
+        printf("hmap: %zu fields, ipv4_dst %08x/%08x\n", hmap_count(&fields),
+               ntohl(value), ntohl(mask));
+    }
+    ofl_structs_match_hmap_destroy(&fields);
+
+    struct ofl_match copy = m;
+    printf("copy: %s\n", memcmp(&copy, &m, sizeof m) ? "differs" : "equal");
+
+    struct ofl_match* unpacked;
+    ofl_err error = round_trip(&m, &unpacked);
+    printf("round trip: error %x, %s\n", error,
+           memcmp(unpacked, &m, sizeof m) ? "differs" : "equal");
+    ofl_structs_free_match(&unpacked->header, NULL);
+
+    struct ofl_match bad;
+    ofl_structs_match_init(&bad);
+    ofl_structs_match_put16(&bad, OXM_OF_TCP_DST, 80);
+    error = round_trip(&bad, &unpacked);
+    printf("tcp_dst without ip_proto: %s\n",
+           error == ofp_mkerr(OFPET_BAD_MATCH, OFPBMC_BAD_PREREQ)
+           ? "bad prerequisite" : "accepted");
+    ofl_structs_free_match(&unpacked->header, NULL);
+
+    test_prereqs();
+    return 0;
+}
@@ -0,0 +1,28 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofl-match > tmp$$
+diff -u - tmp$$ <<EOF
+empty: oxm{all match} (length 0)
+built: oxm{in_port="1", eth_src="00:11:22:33:44:55", eth_type=0x"800", ip_proto="6", ipv4_dst="10.0.0.0"ipv4_dst_mask="255.0.0.0", tcp_dst="80"} (length 47)
+replaced tcp_dst: oxm{in_port="1", eth_src="00:11:22:33:44:55", eth_type=0x"800", ip_proto="6", ipv4_dst="10.0.0.0"ipv4_dst_mask="255.0.0.0", tcp_dst="443"} (length 47)
+get tcp_dst: 443
+get udp_dst: absent
+fields: 0 4 5 10 12/masked 14
+hmap: 6 fields, ipv4_dst 0a000000/ff000000
+copy: equal
+round trip: error 0, equal
+tcp_dst without ip_proto: bad prerequisite
+tcp_dst with ip_proto udp: bad prerequisite
+tcp_dst over ipv6: ok
+tcp_dst without ip_proto: ok
+ipv4_src over arp: bad prerequisite
+arp_spa over arp: ok
+mpls_label over multicast mpls: ok
+in_phy_port without in_port: bad prerequisite
+in_phy_port after in_port: ok
+vlan_pcp without vlan_vid: bad prerequisite
+vlan_pcp after vlan_vid: ok
+in_port twice: duplicate field
+other class: bad field
+masked eth_type: bad field
+EOF
@@ -0,0 +1,179 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests printing messages into a fixed buffer with ofl_msg_format(). */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../oflib/ofl-actions.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-print.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+static char text[4096];
+
+static const char *
+format(struct ofl_msg_header *msg, size_t size = sizeof text,
+       size_t max_entries = 0)
+{
+    struct ofl_fmt fmt;
+    ofl_fmt_init(&fmt, text, size, max_entries);
+    ofl_msg_format(&fmt, msg);
+    return ofl_fmt_finish(&fmt);
+}
+
+/* Prints whether ofl_msg_format() and ofl_msg_to_string() agree on 'msg'. */
+static void
+compare(const char *name, struct ofl_msg_header *msg)
+{
+    char *str = ofl_msg_to_string(msg, NULL);
+    const char *s = format(msg);
+    if (!strcmp(s, str)) {
+        printf("%s: same\n", name);
+    } else {
+        printf("%s: different\n  %s\n  %s\n", name, str, s);
+    }
+    free(str);
+}
+
+int
+main()
+{
+    uint8_t frame[60];
+    memset(frame, 0, sizeof frame);
+
+    struct ofl_msg_packet_in pin;
+    memset(&pin, 0, sizeof pin);
+    pin.header.type = OFPT_PACKET_IN;
+    pin.buffer_id = 0xffffffff;
+    pin.total_len = sizeof frame;
+    pin.reason = OFPR_NO_MATCH;
+    pin.table_id = 0;
+    pin.data = frame;
+    pin.data_length = sizeof frame;
+    compare("packet-in", &pin.header);
+
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = OFPP_CONTROLLER;
+    output.max_len = 128;
+    struct ofl_action_header *actions[] = { &output.header };
+    struct ofl_msg_packet_out po;
+    memset(&po, 0, sizeof po);
+    po.header.type = OFPT_PACKET_OUT;
+    po.buffer_id = 1234;
+    po.in_port = 3;
+    po.actions_num = 1;
+    po.actions = actions;
+    compare("packet-out", &po.header);
+
+    struct ofl_msg_error error;
+    memset(&error, 0, sizeof error);
+    error.header.type = OFPT_ERROR;
+    error.type = OFPET_FLOW_MOD_FAILED;
+    error.code = OFPFMFC_TABLE_FULL;
+    compare("error", &error.header);
+
+    struct ofl_msg_header barrier;
+    barrier.type = OFPT_BARRIER_REPLY;
+    compare("barrier", &barrier);
+
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put16(&match, OXM_OF_TCP_SRC, 80);
+
+    struct ofl_instruction_actions apply;
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = 1;
+    apply.actions = actions;
+    struct ofl_instruction_goto_table go;
+    go.header.type = OFPIT_GOTO_TABLE;
+    go.table_id = 2;
+    struct ofl_instruction_header *insts[] = { &apply.header, &go.header };
+
+    struct ofl_msg_flow_mod mod;
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.cookie = 0x0102030405060708ULL;
+    mod.table_id = 1;
+    mod.command = OFPFC_ADD;
+    mod.idle_timeout = 5;
+    mod.priority = 0x8000;
+    mod.buffer_id = 0xffffffff;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match.header;
+    mod.instructions_num = 2;
+    mod.instructions = insts;
+    compare("flow-mod", &mod.header);
+
+    /* Addresses, masks and set-field actions. */
+    static const uint8_t mac[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 0xab };
+    ofl_structs_match_put_bytes(&match, OXM_OF_ETH_SRC, mac, NULL);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put32m(&match, OXM_OF_IPV4_DST, htonl(0x0a000000),
+                             htonl(0xff000000));
+    uint16_t port = 8080;
+    struct ofl_match_tlv field;
+    field.header = OXM_OF_TCP_DST;
+    field.value = (uint8_t *) &port;
+    struct ofl_action_set_field set;
+    set.header.type = OFPAT_SET_FIELD;
+    set.field = &field;
+    struct ofl_action_header *two[] = { &set.header, &output.header };
+    apply.actions = two;
+    apply.actions_num = 2;
+    printf("%s\n", format(&mod.header));
+
+    /* A long reply, cut to a few entries. */
+    struct ofl_port_stats stats[5];
+    struct ofl_port_stats *ptrs[5];
+    memset(stats, 0, sizeof stats);
+    for (int i = 0; i < 5; i++) {
+        stats[i].port_no = i + 1;
+        stats[i].rx_packets = 100 * i;
+        ptrs[i] = &stats[i];
+    }
+    struct ofl_msg_multipart_reply_port reply;
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_PORT_STATS;
+    reply.stats_num = 5;
+    reply.stats = ptrs;
+    compare("port stats", &reply.header.header);
+    printf("%s\n", format(&reply.header.header, sizeof text, 2));
+
+    /* Too little space. */
+    struct ofl_fmt fmt;
+    ofl_fmt_init(&fmt, text, 48, 0);
+    ofl_msg_format(&fmt, &reply.header.header);
+    printf("%zu %d %s\n", strlen(ofl_fmt_finish(&fmt)), fmt.truncated, text);
+
+    /* The same buffer, reused. */
+    ofl_fmt_clear(&fmt);
+    ofl_msg_format(&fmt, &barrier);
+    printf("%zu %d %s\n", strlen(ofl_fmt_finish(&fmt)), fmt.truncated, text);
+
+    char buf[OFL_ID_BUF_LEN];
+    printf("%s %s\n", ofl_id_to_buf(ofl_port_name(OFPP_FLOOD), OFPP_FLOOD, buf),
+           ofl_id_to_buf(ofl_port_name(0xfffffff0), 0xfffffff0, buf));
+    return 0;
+}
@@ -0,0 +1,16 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofl-msg-format > tmp$$
+diff -u - tmp$$ <<EOF
+packet-in: same
+packet-out: same
+error: same
+barrier: same
+flow-mod: same
+flow_mod{table="1", cmd="add", cookie="0x102030405060708", mask="0x0", idle="5", hard="0", prio="32768", buf="none", port="any", group="any", flags="0x0", match=oxm{in_port="1", eth_src="00:01:02:03:04:ab", eth_type="0x800", ipv4_dst="10.0.0.0/255.0.0.0", tcp_src="80"}, insts=[apply{acts=[set_field{field:tcp_dst="8080"}, out{port="ctrl", mlen="128"}]}, goto{table="2"}]}
+port stats: same
+stat_repl{type="port", flags="0x0", stats=[{port="1", rx_pkt="0", tx_pkt="0", rx_bytes="0", tx_bytes="0", rx_drops="0", tx_drops="0", rx_errs="0", tx_errs="0", rx_frm="0", rx_over="0", rx_crc="0", coll="0"}, {port="2", rx_pkt="100", tx_pkt="0", rx_bytes="0", tx_bytes="0", rx_drops="0", tx_drops="0", rx_errs="0", tx_errs="0", rx_frm="0", rx_over="0", rx_crc="0", coll="0"}, ... 3 more]}
+47 1 stat_repl{type="port", flags="0x0", stats=[{...
+9 0 barr_repl
+flood 4294967280
+EOF
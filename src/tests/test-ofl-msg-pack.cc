@@ -0,0 +1,186 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests that the specialized packers write the same messages as
+ * ofl_msg_pack(). */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../oflib/ofl-actions.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+static uint8_t out[2048];
+
+/* Compares the 'len' bytes in 'out' with 'msg' packed by ofl_msg_pack(),
+ * except for the 'n_skip' bytes at 'skip', which ofl_msg_pack() leaves
+ * uninitialized. */
+static void
+compare(const char *name, struct ofl_msg_header *msg, uint32_t xid, size_t len,
+        size_t skip = 0, size_t n_skip = 0)
+{
+    uint8_t *buf;
+    size_t buf_len;
+    if (ofl_msg_pack(msg, xid, &buf, &buf_len, NULL)) {
+        printf("%s: ofl_msg_pack failed\n", name);
+        return;
+    }
+    memset(buf + skip, 0, n_skip);
+    printf("%s: %zu bytes, %s\n", name, len,
+           len == buf_len && !memcmp(out, buf, len) ? "same" : "different");
+    free(buf);
+}
+
+static void
+test_flow_mod(const char *name, struct ofl_match *match, uint32_t port,
+              uint16_t max_len)
+{
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = port;
+    output.max_len = max_len;
+    struct ofl_action_header *actions[] = { &output.header };
+
+    struct ofl_instruction_actions apply;
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = 1;
+    apply.actions = actions;
+    struct ofl_instruction_header *insts[] = { &apply.header };
+
+    struct ofl_msg_flow_mod mod;
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.cookie = 0x0102030405060708ULL;
+    mod.table_id = 1;
+    mod.command = OFPFC_ADD;
+    mod.idle_timeout = 5;
+    mod.hard_timeout = 60;
+    mod.priority = 0x8000;
+    mod.buffer_id = 77;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.flags = OFPFF_SEND_FLOW_REM;
+    mod.match = &match->header;
+    mod.instructions_num = 1;
+    mod.instructions = insts;
+
+    const struct ofl_action_output *found;
+    if (!ofl_msg_flow_mod_is_output(&mod, &found) || found != &output) {
+        printf("%s: not recognized as output\n", name);
+        return;
+    }
+    size_t len = ofl_msg_pack_flow_mod_output(&mod, 9, found->port,
+                                              found->max_len, out, sizeof out);
+    if (len != OFL_FLOW_MOD_OUTPUT_LEN(match->header.length)) {
+        printf("%s: packed %zu bytes\n", name, len);
+    }
+    size_t match_end = sizeof(struct ofp_flow_mod) - 4 + match->header.length;
+    compare(name, &mod.header, 9, len, match_end,
+            (match_end + 7) / 8 * 8 - match_end);
+
+    printf("%s: %zu bytes do not fit\n", name,
+           ofl_msg_pack_flow_mod_output(&mod, 9, port, max_len, out, len - 1));
+
+    /* Anything but a single output action is left to ofl_msg_pack(). */
+    struct ofl_action_header *two[] = { &output.header, &output.header };
+    apply.actions = two;
+    apply.actions_num = 2;
+    printf("%s: two actions %s\n", name,
+           ofl_msg_flow_mod_is_output(&mod, &found) ? "recognized" : "left");
+    apply.actions_num = 1;
+    apply.header.type = OFPIT_WRITE_ACTIONS;
+    printf("%s: write-actions %s\n", name,
+           ofl_msg_flow_mod_is_output(&mod, &found) ? "recognized" : "left");
+}
+
+int
+main()
+{
+    struct ofl_msg_header barrier;
+    barrier.type = OFPT_BARRIER_REQUEST;
+    compare("barrier", &barrier, 5,
+            ofl_msg_pack_barrier_request(5, out, sizeof out));
+
+    static const uint8_t hello[] = "hello";
+    struct ofl_msg_echo echo;
+    echo.header.type = OFPT_ECHO_REPLY;
+    echo.data = (uint8_t *) hello;
+    echo.data_length = sizeof hello;
+    compare("echo reply", &echo.header, 6,
+            ofl_msg_pack_echo_data(OFPT_ECHO_REPLY, 6, hello, sizeof hello,
+                                   out, sizeof out));
+    echo.header.type = OFPT_ECHO_REQUEST;
+    echo.data_length = 0;
+    compare("echo request", &echo.header, 7,
+            ofl_msg_pack_echo_data(OFPT_ECHO_REQUEST, 7, NULL, 0,
+                                   out, sizeof out));
+
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = OFPP_FLOOD;
+    struct ofl_action_header *actions[] = { &output.header };
+    uint8_t frame[60];
+    for (size_t i = 0; i < sizeof frame; i++) {
+        frame[i] = i;
+    }
+    struct ofl_msg_packet_out po;
+    memset(&po, 0, sizeof po);
+    po.header.type = OFPT_PACKET_OUT;
+    po.buffer_id = 1234;
+    po.in_port = 3;
+    po.actions_num = 1;
+    po.actions = actions;
+    compare("packet-out buffered", &po.header, 8,
+            ofl_msg_pack_packet_out_output(8, 1234, 3, OFPP_FLOOD, NULL, 0,
+                                           out, sizeof out));
+    po.buffer_id = 0xffffffff;
+    po.data = frame;
+    po.data_length = sizeof frame;
+    compare("packet-out data", &po.header, 8,
+            ofl_msg_pack_packet_out_output(8, 0xffffffff, 3, OFPP_FLOOD,
+                                           frame, sizeof frame,
+                                           out, sizeof out));
+    printf("packet-out data: %zu bytes do not fit\n",
+           ofl_msg_pack_packet_out_output(8, 0xffffffff, 3, OFPP_FLOOD,
+                                          frame, sizeof frame, out,
+                                          OFL_PACKET_OUT_OUTPUT_LEN(59)));
+
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    test_flow_mod("flow-mod empty match", &match, 2, 0);
+
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put32m(&match, OXM_OF_IPV4_DST, htonl(0x0a000000),
+                             htonl(0xff000000));
+    test_flow_mod("flow-mod 3 fields", &match, OFPP_CONTROLLER,
+                  OFPCML_NO_BUFFER);
+
+    static const uint8_t mac[ETH_ADDR_LEN] = { 0, 1, 2, 3, 4, 5 };
+    ofl_structs_match_put_bytes(&match, OXM_OF_ETH_SRC, mac, NULL);
+    ofl_structs_match_put_bytes(&match, OXM_OF_ETH_DST, mac, NULL);
+    ofl_structs_match_put8(&match, OXM_OF_IP_PROTO, 6);
+    ofl_structs_match_put32(&match, OXM_OF_IPV4_SRC, htonl(0x0a000001));
+    ofl_structs_match_put16(&match, OXM_OF_TCP_SRC, 1234);
+    ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 80);
+    test_flow_mod("flow-mod 9 fields", &match, 4, 0);
+    return 0;
+}
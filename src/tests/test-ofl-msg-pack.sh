@@ -0,0 +1,23 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofl-msg-pack > tmp$$
+diff -u - tmp$$ <<EOF
+barrier: 8 bytes, same
+echo reply: 14 bytes, same
+echo request: 8 bytes, same
+packet-out buffered: 40 bytes, same
+packet-out data: 100 bytes, same
+packet-out data: 0 bytes do not fit
+flow-mod empty match: 80 bytes, same
+flow-mod empty match: 0 bytes do not fit
+flow-mod empty match: two actions left
+flow-mod empty match: write-actions left
+flow-mod 3 fields: 104 bytes, same
+flow-mod 3 fields: 0 bytes do not fit
+flow-mod 3 fields: two actions left
+flow-mod 3 fields: write-actions left
+flow-mod 9 fields: 152 bytes, same
+flow-mod 9 fields: 0 bytes do not fit
+flow-mod 9 fields: two actions left
+flow-mod 9 fields: write-actions left
+EOF
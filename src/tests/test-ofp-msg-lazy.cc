@@ -0,0 +1,170 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests Ofp_msg's lazy decoding of received messages. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "buffer.hh"
+#include "event-dispatcher.hh"
+#include "ofp-msg-event.hh"
+#include "threads/cooperative.hh"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+#include "test-msgs.hh"
+
+using namespace vigil;
+
+/* Returns a Buffer holding a packed packet-in with a 60-byte frame. */
+static std::auto_ptr<Buffer>
+make_packet_in()
+{
+    size_t size;
+    uint8_t* packed = pack_packet_in(3, 60, 42, &size);
+    std::auto_ptr<Buffer> b(new Array_buffer(size));
+    memcpy(b->data(), packed, size);
+    free(packed);
+    return b;
+}
+
+/* Returns a Buffer holding a packed flow stats reply with one flow.  If
+ * 'bad', the flow's length runs past the end of the message. */
+static std::auto_ptr<Buffer>
+make_flow_stats_reply(bool bad)
+{
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+
+    struct ofl_flow_stats stats;
+    memset(&stats, 0, sizeof stats);
+    stats.match = &match.header;
+    struct ofl_flow_stats* stats_ptrs[] = { &stats };
+
+    struct ofl_msg_multipart_reply_flow reply;
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_FLOW;
+    reply.stats_num = 1;
+    reply.stats = stats_ptrs;
+
+    uint8_t* packed;
+    size_t size;
+    if (ofl_msg_pack(&reply.header.header, 43, &packed, &size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (bad) {
+        struct ofp_flow_stats* fs = (struct ofp_flow_stats*)
+            (packed + sizeof(struct ofp_multipart_reply));
+        fs->length = htons(size);
+    }
+    std::auto_ptr<Buffer> b(new Array_buffer(size));
+    memcpy(b->data(), packed, size);
+    free(packed);
+    return b;
+}
+
+static void
+print_error(const Ofp_msg& msg, ofl_err error)
+{
+    printf("error handler: type %u code %u\n",
+           ofl_error_type(error), ofl_error_code(error));
+}
+
+static Disposition
+read_flow_stats(const Event& e)
+{
+    const Ofp_msg_event& ome = static_cast<const Ofp_msg_event&>(e);
+    struct ofl_msg_multipart_reply_flow* reply
+        = (struct ofl_msg_multipart_reply_flow*) **ome.msg;
+    printf("handler: %zu flows\n", reply->stats_num);
+    return CONTINUE;
+}
+
+int
+main(int argc, char *argv[])
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    boost::shared_ptr<Ofp_msg_arenas> arenas(new Ofp_msg_arenas);
+
+    std::auto_ptr<Buffer> b(make_packet_in());
+    const Buffer* raw = b.get();
+    uint32_t xid;
+    boost::shared_ptr<Ofp_msg> msg(Ofp_msg::unpack(b, &xid, arenas));
+    printf("unpacked: xid %u, type %d, %s, buffer %s\n", xid,
+           (int) msg->get_type(), msg->is_decoded() ? "decoded" : "undecoded",
+           b.get() ? "kept" : "taken");
+
+    struct ofl_msg_packet_in* in = (struct ofl_msg_packet_in*) **msg;
+    printf("accessed: %s, data %s receive buffer\n",
+           msg->is_decoded() ? "decoded" : "undecoded",
+           (in->data >= raw->data() && in->data < raw->data() + raw->size()
+            ? "in" : "outside"));
+    printf("again: %s\n", **msg == &in->header ? "same message" : "redecoded");
+
+    /* A header that does not match the buffer is rejected at once. */
+    b = make_packet_in();
+    b->data()[3]++;
+    printf("bad length: %s\n",
+           Ofp_msg::unpack(b, &xid, arenas) ? "accepted" : "rejected");
+
+    /* Only the header is checked on unpacking.  The body is decoded when
+     * the handler reads it, and a bad body is passed to the arenas' error
+     * handler once, however often it is read. */
+    arenas->set_error_handler(print_error);
+    Event_dispatcher dispatcher;
+    dispatcher.add_handler(Ofp_msg_event::get_stats_event_type(OFPMP_FLOW),
+                           read_flow_stats, 0);
+    for (int bad = 0; bad < 2; bad++) {
+        b = make_flow_stats_reply(bad);
+        msg = Ofp_msg::unpack(b, &xid, arenas);
+        printf("%s body: multipart type %d, %s\n", bad ? "bad" : "good",
+               (int) msg->get_multipart_type(),
+               msg->is_decoded() ? "decoded" : "undecoded");
+        std::auto_ptr<Event> event(
+            Ofp_msg_event::create_event(datapathid::from_host(1), xid, msg));
+        Disposition d = dispatcher.dispatch(*event);
+        printf("dispatch %s, %s\n", d == STOP ? "stopped" : "continued",
+               msg->is_decoded() ? "decoded" : "undecoded");
+        try {
+            **msg;
+            printf("read again: ok\n");
+        } catch (const Bad_ofp_msg& e) {
+            printf("read again: Bad_ofp_msg\n");
+        }
+        if (ofl_err error = msg->try_decode()) {
+            printf("try_decode: error type %u code %u\n",
+                   ofl_error_type(error), ofl_error_code(error));
+        }
+    }
+
+    /* A message without handlers is never decoded. */
+    b = make_packet_in();
+    msg = Ofp_msg::unpack(b, &xid, arenas);
+    std::auto_ptr<Event> event(
+        Ofp_msg_event::create_event(datapathid::from_host(1), xid, msg));
+    dispatcher.dispatch(*event);
+    printf("unhandled packet-in: %s\n",
+           msg->is_decoded() ? "decoded" : "undecoded");
+    return 0;
+}
@@ -0,0 +1,19 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofp-msg-lazy > tmp$$
+diff -u - tmp$$ <<EOF
+unpacked: xid 42, type 10, undecoded, buffer taken
+accessed: decoded, data in receive buffer
+again: same message
+bad length: rejected
+good body: multipart type 1, undecoded
+handler: 1 flows
+dispatch continued, decoded
+read again: ok
+bad body: multipart type 1, undecoded
+error handler: type 1 code 6
+dispatch stopped, undecoded
+read again: Bad_ofp_msg
+try_decode: error type 1 code 6
+unhandled packet-in: undecoded
+EOF
@@ -0,0 +1,200 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests building flow-mod and packet-out messages from Ofp_templates. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "ofp-template.hh"
+#include "../oflib/ofl-actions.h"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+using namespace vigil;
+
+/* Unpacks 'msg', exiting on failure. */
+static struct ofl_msg_header *
+unpack(const Ofp_template_msg& msg, uint32_t *xid)
+{
+    uint8_t buf[Ofp_template::MAX_SIZE];
+    memcpy(buf, msg.header(), msg.size());
+    struct ofl_msg_header *m;
+    if (ofl_msg_unpack(buf, msg.size(), &m, xid, NULL)) {
+        fprintf(stderr, "ofl_msg_unpack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return m;
+}
+
+static uint32_t
+output_port(struct ofl_action_header **actions, size_t n)
+{
+    return n > 0 && actions[0]->type == OFPAT_OUTPUT
+        ? ((struct ofl_action_output *) actions[0])->port
+        : 0;
+}
+
+static void
+test_flow_mod()
+{
+    uint8_t zero_mac[ETH_ADDR_LEN] = {0};
+    struct ofl_match match;
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 0);
+    ofl_structs_match_put_eth(&match, OXM_OF_ETH_SRC, zero_mac);
+    ofl_structs_match_put_eth(&match, OXM_OF_ETH_DST, zero_mac);
+
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    struct ofl_action_header *actions[] = { &output.header };
+    struct ofl_instruction_actions apply;
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = 1;
+    apply.actions = actions;
+    struct ofl_instruction_header *insts[] = { &apply.header };
+
+    struct ofl_msg_flow_mod fm;
+    memset(&fm, 0, sizeof fm);
+    fm.header.type = OFPT_FLOW_MOD;
+    fm.command = OFPFC_ADD;
+    fm.idle_timeout = 5;
+    fm.priority = 100;
+    fm.buffer_id = OFP_NO_BUFFER;
+    fm.out_port = OFPP_ANY;
+    fm.out_group = OFPG_ANY;
+    fm.match = &match.header;
+    fm.instructions_num = 1;
+    fm.instructions = insts;
+
+    Ofp_template tmpl(&fm.header);
+    printf("flow mod: in_port %d, eth_src %d, ipv4_src %d, "
+           "output %d, in_port slot %d\n",
+           tmpl.has_field(OXM_OF_IN_PORT), tmpl.has_field(OXM_OF_ETH_SRC),
+           tmpl.has_field(OXM_OF_IPV4_SRC),
+           tmpl.has_slot(Ofp_template::OUTPUT_PORT),
+           tmpl.has_slot(Ofp_template::IN_PORT));
+
+    uint8_t buf[Ofp_template::MAX_SIZE];
+    Ofp_template_msg msg(tmpl, buf, sizeof buf);
+    uint8_t src[ETH_ADDR_LEN] = {0, 1, 2, 3, 4, 5};
+    msg.set_field32(OXM_OF_IN_PORT, 7);
+    msg.set_field(OXM_OF_ETH_SRC, src);
+    msg.set(Ofp_template::XID, 1234);
+    msg.set(Ofp_template::COOKIE, 0x0102030405060708ULL);
+    msg.set(Ofp_template::PRIORITY, 200);
+    msg.set(Ofp_template::BUFFER_ID, 99);
+    msg.set(Ofp_template::OUTPUT_PORT, 3);
+    printf("ipv4_src set: %d\n", msg.set_field32(OXM_OF_IPV4_SRC, 1));
+
+    uint32_t xid;
+    struct ofl_msg_flow_mod *m = (struct ofl_msg_flow_mod *) unpack(msg, &xid);
+    const struct ofl_match *mm = (const struct ofl_match *) m->match;
+    uint32_t in_port;
+    memcpy(&in_port, ofl_structs_match_get(mm, OXM_OF_IN_PORT), 4);
+    const uint8_t *s = ofl_structs_match_get(mm, OXM_OF_ETH_SRC);
+    const uint8_t *d = ofl_structs_match_get(mm, OXM_OF_ETH_DST);
+    struct ofl_instruction_actions *ia
+        = (struct ofl_instruction_actions *) m->instructions[0];
+    printf("xid %u, cookie %016llx, priority %u, idle %u, buffer %u\n",
+           xid, (unsigned long long) m->cookie, m->priority,
+           m->idle_timeout, m->buffer_id);
+    printf("in_port %u, eth_src %02x:%02x:%02x:%02x:%02x:%02x, "
+           "eth_dst %02x:%02x:%02x:%02x:%02x:%02x, output %u\n", in_port,
+           s[0], s[1], s[2], s[3], s[4], s[5],
+           d[0], d[1], d[2], d[3], d[4], d[5],
+           output_port(ia->actions, ia->actions_num));
+    ofl_msg_free(&m->header, NULL);
+}
+
+static void
+test_packet_out()
+{
+    struct ofl_action_output output;
+    memset(&output, 0, sizeof output);
+    output.header.type = OFPAT_OUTPUT;
+    output.port = OFPP_FLOOD;
+    struct ofl_action_header *actions[] = { &output.header };
+
+    struct ofl_msg_packet_out out;
+    memset(&out, 0, sizeof out);
+    out.header.type = OFPT_PACKET_OUT;
+    out.buffer_id = OFP_NO_BUFFER;
+    out.in_port = OFPP_CONTROLLER;
+    out.actions_num = 1;
+    out.actions = actions;
+
+    Ofp_template tmpl(&out.header);
+    uint8_t frame[60];
+    for (size_t i = 0; i < sizeof frame; i++) {
+        frame[i] = i;
+    }
+
+    uint8_t buf[Ofp_template::MAX_SIZE];
+    Ofp_template_msg msg(tmpl, buf, sizeof buf);
+    msg.set(Ofp_template::IN_PORT, 4);
+    msg.set_data(frame, sizeof frame);
+
+    uint32_t xid;
+    struct ofl_msg_packet_out *m = (struct ofl_msg_packet_out *) unpack(msg,
+                                                                        &xid);
+    printf("packet out: buffer %x, in_port %u, output %x, %zu bytes, %s\n",
+           m->buffer_id, m->in_port,
+           output_port(m->actions, m->actions_num), m->data_length,
+           (m->data_length == sizeof frame
+            && !memcmp(m->data, frame, sizeof frame)) ? "match" : "differ");
+    ofl_msg_free(&m->header, NULL);
+
+    Ofp_template_msg msg2(tmpl, buf, sizeof buf);
+    msg2.set(Ofp_template::BUFFER_ID, 12);
+    msg2.set(Ofp_template::OUTPUT_PORT, 2);
+    m = (struct ofl_msg_packet_out *) unpack(msg2, &xid);
+    printf("packet out: buffer %x, in_port %x, output %x, %zu bytes\n",
+           m->buffer_id, m->in_port,
+           output_port(m->actions, m->actions_num), m->data_length);
+    ofl_msg_free(&m->header, NULL);
+
+    uint8_t small[64];
+    Ofp_template_msg msg3(tmpl, small, sizeof small);
+    printf("oversized data: %s\n",
+           msg3.set_data(frame, sizeof frame) ? "accepted" : "rejected");
+}
+
+static void
+test_unsupported()
+{
+    struct ofl_msg_header hello;
+    hello.type = OFPT_HELLO;
+    try {
+        Ofp_template tmpl(&hello);
+        printf("hello: accepted\n");
+    } catch (const std::runtime_error&) {
+        printf("hello: rejected\n");
+    }
+}
+
+int
+main()
+{
+    test_flow_mod();
+    test_packet_out();
+    test_unsupported();
+    return 0;
+}
@@ -0,0 +1,13 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-ofp-template > tmp$$
+diff -u - tmp$$ <<EOF
+flow mod: in_port 1, eth_src 1, ipv4_src 0, output 1, in_port slot 0
+ipv4_src set: 0
+xid 1234, cookie 0102030405060708, priority 200, idle 5, buffer 99
+in_port 7, eth_src 00:01:02:03:04:05, eth_dst 00:00:00:00:00:00, output 3
+packet out: buffer ffffffff, in_port 4, output fffffffb, 60 bytes, match
+packet out: buffer c, in_port fffffffd, output 2, 0 bytes
+oversized data: rejected
+hello: rejected
+EOF
@@ -0,0 +1,150 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests batched receiving on an Openflow_stream_connection: messages of odd
+ * lengths are handed out intact at 8-byte aligned addresses, and a reader
+ * that holds on to messages pins only a few receive rings. */
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "auto_fd.hh"
+#include "buffer.hh"
+#include "openflow.hh"
+#include "tcp-socket.hh"
+#include "threads/cooperative.hh"
+
+using namespace vigil;
+
+static const int N_MSGS = 64;
+static const size_t RING_SIZE = 256;
+
+/* Writes to 'fd' a message of 'type' with transaction id 'xid' and 'n_body'
+ * bytes of body, each set to 'xid'. */
+static void
+write_msg(int fd, uint8_t type, uint32_t xid, size_t n_body)
+{
+    std::vector<uint8_t> msg(sizeof(ofp_header) + n_body, uint8_t(xid));
+    ofp_header oh;
+    oh.version = OFP_VERSION;
+    oh.type = type;
+    oh.length = htons(msg.size());
+    oh.xid = htonl(xid);
+    memcpy(&msg[0], &oh, sizeof oh);
+    if (write(fd, &msg[0], msg.size()) != ssize_t(msg.size())) {
+        perror("write");
+        exit(1);
+    }
+}
+
+static size_t
+body_size(uint32_t xid)
+{
+    return xid * 37 % 90;
+}
+
+/* Checks that 'b' is message 'xid' as written by write_msg(). */
+static bool
+check_msg(const Buffer& b, uint32_t xid)
+{
+    const ofp_header& oh = b.at<ofp_header>(0);
+    if (uintptr_t(b.data()) % 8
+        || b.size() != sizeof oh + body_size(xid)
+        || ntohl(oh.xid) != xid) {
+        return false;
+    }
+    for (size_t i = sizeof oh; i < b.size(); i++) {
+        if (b.data()[i] != uint8_t(xid)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Receives messages 'first' up to but not including 'last' from 'conn',
+ * keeping them until all of them have been received if 'keep' is true, and
+ * prints how many were handed out in a receive ring. */
+static void
+receive(Openflow_connection& conn, uint32_t first, uint32_t last, bool keep)
+{
+    boost::ptr_vector<Buffer> kept;
+    int n_bad = 0, n_shared = 0;
+    for (uint32_t xid = first; xid < last; xid++) {
+        int error;
+        std::auto_ptr<Buffer> b(conn.recv_openflow(error, false));
+        if (error) {
+            printf("receive error %d\n", error);
+            exit(1);
+        }
+        n_bad += !check_msg(*b, xid);
+        n_shared += dynamic_cast<Shared_array_buffer*>(b.get()) != NULL;
+        if (keep) {
+            kept.push_back(b.release());
+        }
+    }
+    /* Messages kept must not have been overwritten by later ones. */
+    for (size_t i = 0; i < kept.size(); i++) {
+        n_bad += !check_msg(kept[i], first + i);
+    }
+    printf("%s %u messages: %d bad, %d in a ring\n",
+           keep ? "kept" : "dropped", unsigned(last - first),
+           n_bad, n_shared);
+}
+
+int
+main(int argc, char *argv[])
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    /* The peer writes all of its messages up front, so each read returns
+     * as much as the receive ring asks for. */
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    write_msg(fds[1], OFPT_HELLO, 0, 0);
+    for (int xid = 1; xid <= N_MSGS; xid++) {
+        write_msg(fds[1], OFPT_ECHO_REQUEST, xid, body_size(xid));
+    }
+
+    Openflow_stream_connection::set_rx_ring_size(RING_SIZE);
+    Auto_fd fd(fds[0]);
+    std::auto_ptr<Async_stream> stream(new Tcp_socket(fd));
+    Openflow_stream_connection conn(stream,
+                                    Openflow_connection::TYPE_UNKNOWN);
+
+    /* Messages held by the reader keep their rings alive, so after a few
+     * rings the rest is copied into buffers of their own.  Once the reader
+     * lets go, the rings are used again. */
+    receive(conn, 1, N_MSGS / 2, true);
+    receive(conn, N_MSGS / 2, N_MSGS + 1, false);
+    printf("%llu messages in %llu reads\n",
+           (unsigned long long) conn.get_n_rx_msgs(),
+           (unsigned long long) conn.get_n_rx_reads());
+    ::close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests classifying Flows against OXM Packet_exprs: the rules the Cnode tree
+ * returns must be those a linear scan with matches() finds, for IPv4, IPv6
+ * and MPLS frames, masked fields and the pipeline fields a packet-in carries
+ * besides its frame. */
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "buffer.hh"
+#include "classifier.hh"
+#include "expr.hh"
+#include "flow.hh"
+
+using namespace vigil;
+
+/* Builds a frame out of big-endian fields. */
+struct Frame {
+    uint8_t data[128];
+    size_t size;
+
+    Frame() : size(0) { }
+    Frame& u8(uint8_t x) { data[size++] = x; return *this; }
+    Frame& u16(uint16_t x) { return u8(x >> 8).u8(x); }
+    Frame& u32(uint32_t x) { return u16(x >> 16).u16(x); }
+    Frame& bytes(const char *s, size_t n) {
+        memcpy(data + size, s, n);
+        size += n;
+        return *this;
+    }
+    Frame& eth(uint16_t type) {
+        return bytes("\x00\x00\x00\x00\x00\x02\x00\x00\x00\x00\x00\x01", 12)
+               .u16(type);
+    }
+    Frame& ipv4(uint8_t proto) {
+        return u8(0x45).u8(0).u16(0).u32(0).u8(64).u8(proto).u16(0)
+               .u32(0x0a000001).u32(0x0a000002);
+    }
+    Frame& ipv6(uint8_t next) {
+        u32(0x60000000).u16(0).u8(next).u8(64);
+        bytes("\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x01", 16);
+        return bytes("\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x02", 16);
+    }
+};
+
+typedef Classifier<Packet_expr, const char *> Packet_classifier_t;
+typedef std::vector<std::pair<uint32_t, Packet_expr> > Expr_list;
+
+static Packet_classifier_t classifier;
+static Expr_list exprs;
+static std::vector<const char *> names;
+
+static void
+add(const char *name, uint32_t priority, const Packet_expr& expr)
+{
+    classifier.add_rule(priority, expr, name);
+    exprs.push_back(std::make_pair(priority, expr));
+    names.push_back(name);
+}
+
+static void
+classify(const char *what, const Flow& flow)
+{
+    std::set<std::pair<uint32_t, std::string> > tree, linear;
+    Cnode_result<Packet_expr, const char *, Flow> result(&flow);
+    classifier.get_rules(result);
+
+    printf("%s:", what);
+    for (const Rule<Packet_expr, const char *> *r = result.next(); r != NULL;
+         r = result.next()) {
+        printf(" %s(%u)", r->action, r->priority);
+        tree.insert(std::make_pair(r->priority, std::string(r->action)));
+    }
+    printf("\n");
+
+    for (size_t i = 0; i < exprs.size(); i++) {
+        if (matches(0, exprs[i].second, flow)) {
+            linear.insert(std::make_pair(exprs[i].first,
+                                         std::string(names[i])));
+        }
+    }
+    if (tree != linear) {
+        printf("%s: tree and linear scan differ\n", what);
+    }
+}
+
+int
+main()
+{
+    Packet_expr e;
+
+    e.set<OXM_OF_ETH_TYPE>(0x0800);
+    e.set<OXM_OF_IP_PROTO>(6);
+    e.set<OXM_OF_TCP_DST>(80);
+    add("web", 10, e);
+    e.set<OXM_OF_TCP_DST>(22);
+    add("ssh", 10, e);
+    printf("expr: %s\n", e.to_string().c_str());
+    printf("field: %s\n", e.to_string(Packet_expr::TCP_DST).c_str());
+
+    e = Packet_expr();
+    e.set<OXM_OF_ETH_TYPE>(0x0800);
+    e.set<OXM_OF_IPV4_DST>(htonl(0x0a000000), htonl(0xff000000));
+    add("net10", 20, e);
+    printf("masked: %s, ipv4_dst %s\n", e.to_string().c_str(),
+           e.is_wildcard(Packet_expr::IPV4_DST) ? "not split" : "split");
+
+    struct in6_addr fe80_1;
+    memcpy(&fe80_1, "\xfe\x80\0\0\0\0\0\0\0\0\0\0\0\0\0\x01", 16);
+    e = Packet_expr();
+    e.set<OXM_OF_ETH_TYPE>(0x86dd);
+    e.set<OXM_OF_IPV6_SRC>(fe80_1);
+    e.set<OXM_OF_UDP_DST>(5353);
+    add("mdns6", 10, e);
+
+    e = Packet_expr();
+    e.set<OXM_OF_ETH_TYPE>(0x8847);
+    e.set<OXM_OF_MPLS_LABEL>(100);
+    add("mpls100", 10, e);
+    e.set<OXM_OF_MPLS_LABEL>(101);
+    add("mpls101", 10, e);
+
+    e = Packet_expr();
+    e.set<OXM_OF_TUNNEL_ID>(7);
+    add("tunnel7", 5, e);
+
+    e = Packet_expr();
+    e.set<OXM_OF_METADATA>(1, 1);
+    add("metadata1", 5, e);
+
+    e = Packet_expr();
+    e.set<OXM_OF_IN_PORT>(1);
+    add("port1", 30, e);
+
+    add("all", 100, Packet_expr());
+
+    classifier.build();
+
+    Frame web;
+    web.eth(0x0800).ipv4(6).u16(1234).u16(80).u32(0);
+    Flow flow(1, Nonowning_buffer(web.data, web.size));
+    classify("ipv4 tcp 80 on port 1", flow);
+
+    flow.set<OXM_OF_TUNNEL_ID>(7);
+    flow.set<OXM_OF_METADATA>(3);
+    classify("with tunnel_id 7, metadata 3", flow);
+
+    Frame ssh;
+    ssh.eth(0x0800).ipv4(6).u16(1234).u16(22).u32(0);
+    classify("ipv4 tcp 22 on port 2",
+             Flow(2, Nonowning_buffer(ssh.data, ssh.size)));
+
+    Frame mdns;
+    mdns.eth(0x86dd).ipv6(17).u16(5353).u16(5353).u32(0);
+    classify("ipv6 udp 5353", Flow(2, Nonowning_buffer(mdns.data, mdns.size)));
+
+    Frame mpls;
+    mpls.eth(0x8847).u32(0x0006413f).ipv4(6);
+    classify("mpls 100", Flow(2, Nonowning_buffer(mpls.data, mpls.size)));
+
+    Frame arp;
+    arp.eth(0x0806).u16(1).u16(0x0800).u8(6).u8(4).u16(1)
+       .bytes("\x00\x00\x00\x00\x00\x02", 6).u32(0x0a000001)
+       .bytes("\x00\x00\x00\x00\x00\x00", 6).u32(0x0a000002);
+    classify("arp", Flow(2, Nonowning_buffer(arp.data, arp.size)));
+
+    return 0;
+}
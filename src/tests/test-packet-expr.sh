@@ -0,0 +1,14 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-packet-expr > tmp$$
+diff -u - tmp$$ <<EOF
+expr: <expr:oxm{eth_type="0x800", ip_proto="6", tcp_dst="22"}>
+field: tcp_dst="22"
+masked: <expr:oxm{eth_type="0x800", ipv4_dst="10.0.0.0/255.0.0.0"}>, ipv4_dst not split
+ipv4 tcp 80 on port 1: web(10) net10(20) port1(30) all(100)
+with tunnel_id 7, metadata 3: metadata1(5) tunnel7(5) web(10) net10(20) port1(30) all(100)
+ipv4 tcp 22 on port 2: ssh(10) net10(20) all(100)
+ipv6 udp 5353: mdns6(10) all(100)
+mpls 100: mpls100(10) all(100)
+arp: all(100)
+EOF
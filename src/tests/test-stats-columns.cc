@@ -0,0 +1,274 @@
+/* Copyright 2008 (C) Nicira, Inc.
+ *
+ * This file is part of NOX.
+ *
+ * NOX is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * NOX is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with NOX.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/* Tests columnar decoding of statistics replies and their collection across
+ * multipart messages. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "buffer.hh"
+#include "ofp-msg-event.hh"
+#include "stats-collector.hh"
+#include "threads/cooperative.hh"
+#include "../oflib/ofl-messages.h"
+#include "../oflib/ofl-stats-columns.h"
+#include "../oflib/ofl-structs.h"
+#include "../oflib/oxm-match.h"
+
+using namespace vigil;
+
+/* Packs 'msg' and returns it in a Buffer. */
+static std::auto_ptr<Buffer>
+pack(struct ofl_msg_header *msg, uint32_t xid)
+{
+    uint8_t* packed;
+    size_t size;
+    if (ofl_msg_pack(msg, xid, &packed, &size, NULL)) {
+        fprintf(stderr, "ofl_msg_pack failed\n");
+        exit(EXIT_FAILURE);
+    }
+    std::auto_ptr<Buffer> b(new Array_buffer(size));
+    memcpy(b->data(), packed, size);
+    free(packed);
+    return b;
+}
+
+/* Returns a flow stats reply part with 'n' flows numbered from 'first',
+ * where flow i matches in_port i and, for odd i, IPv4 traffic to 10.0.0.i. */
+static std::auto_ptr<Buffer>
+make_flow_reply(uint32_t xid, int first, int n, bool more)
+{
+    struct ofl_match matches[4];
+    struct ofl_flow_stats stats[4];
+    struct ofl_flow_stats* stats_ptrs[4];
+    for (int i = 0; i < n; i++) {
+        int id = first + i;
+        ofl_structs_match_init(&matches[i]);
+        ofl_structs_match_put32(&matches[i], OXM_OF_IN_PORT, id);
+        if (id % 2) {
+            ofl_structs_match_put16(&matches[i], OXM_OF_ETH_TYPE, 0x0800);
+            ofl_structs_match_put32(&matches[i], OXM_OF_IPV4_DST,
+                                    htonl(0x0a000000 | id));
+        }
+        memset(&stats[i], 0, sizeof stats[i]);
+        stats[i].table_id = id % 3;
+        stats[i].duration_sec = id * 10;
+        stats[i].priority = 100 + id;
+        stats[i].idle_timeout = 30;
+        stats[i].cookie = 0x1000000000ULL + id;
+        stats[i].packet_count = id * 1000;
+        stats[i].byte_count = id * 64000;
+        stats[i].match = &matches[i].header;
+        stats_ptrs[i] = &stats[i];
+    }
+
+    struct ofl_msg_multipart_reply_flow reply;
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_FLOW;
+    reply.header.flags = more ? OFPMPF_REPLY_MORE : 0;
+    reply.stats_num = n;
+    reply.stats = stats_ptrs;
+    return pack(&reply.header.header, xid);
+}
+
+static std::auto_ptr<Buffer>
+make_port_reply(uint32_t xid, uint32_t first, int n, bool more)
+{
+    struct ofl_port_stats stats[4];
+    struct ofl_port_stats* stats_ptrs[4];
+    for (int i = 0; i < n; i++) {
+        memset(&stats[i], 0, sizeof stats[i]);
+        stats[i].port_no = first + i;
+        stats[i].rx_packets = (first + i) * 11;
+        stats[i].tx_bytes = (first + i) * 2200;
+        stats[i].collisions = i;
+        stats[i].duration_nsec = 500;
+        stats_ptrs[i] = &stats[i];
+    }
+
+    struct ofl_msg_multipart_reply_port reply;
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.type = OFPMP_PORT_STATS;
+    reply.header.flags = more ? OFPMPF_REPLY_MORE : 0;
+    reply.stats_num = n;
+    reply.stats = stats_ptrs;
+    return pack(&reply.header.header, xid);
+}
+
+static void
+print_flows(const char *name, const struct ofl_stats_columns *c)
+{
+    printf("%s: %zu flows\n", name, c->n);
+    for (size_t i = 0; i < c->n; i++) {
+        char *m = ofl_structs_match_to_string(
+            (struct ofl_match_header *) &c->flow.match[i], NULL);
+        printf("  table %u, prio %u, idle %u, dur %u, cookie %llx, "
+               "packets %llu, bytes %llu, %s\n",
+               c->flow.table_id[i], c->flow.priority[i],
+               c->flow.idle_timeout[i], c->flow.duration_sec[i],
+               (unsigned long long) c->flow.cookie[i],
+               (unsigned long long) c->flow.packet_count[i],
+               (unsigned long long) c->flow.byte_count[i], m);
+        free(m);
+    }
+}
+
+static void
+print_ports(const char *name, const struct ofl_stats_columns *c)
+{
+    printf("%s: %zu ports\n", name, c->n);
+    for (size_t i = 0; i < c->n; i++) {
+        printf("  port %u, rx_packets %llu, tx_bytes %llu, collisions %llu, "
+               "duration_nsec %u\n", c->port.port_no[i],
+               (unsigned long long) c->port.rx_packets[i],
+               (unsigned long long) c->port.tx_bytes[i],
+               (unsigned long long) c->port.collisions[i],
+               c->port.duration_nsec[i]);
+    }
+}
+
+static void
+append(const char *name, struct ofl_stats_columns *c, const Buffer& b)
+{
+    bool more = false;
+    ofl_err error = ofl_stats_columns_append(c, b.data(), b.size(), &more);
+    if (error) {
+        printf("%s: error type %u code %u, %zu entries\n", name,
+               ofl_error_type(error), ofl_error_code(error), c->n);
+    } else {
+        printf("%s: %zu entries, %s\n", name, c->n, more ? "more" : "last");
+    }
+}
+
+/* Feeds the reply part in 'b' from 'dpid' to 'sc'. */
+static const struct ofl_stats_columns *
+collect(Stats_collector& sc, uint64_t dpid, std::auto_ptr<Buffer> b,
+        boost::shared_ptr<Ofp_msg_arenas>& arenas)
+{
+    uint32_t xid;
+    boost::shared_ptr<Ofp_msg> msg(Ofp_msg::unpack(b, &xid, arenas));
+    std::auto_ptr<Ofp_msg_event> e(
+        Ofp_msg_event::create_event(datapathid::from_host(dpid), xid, msg));
+    return sc.add(*e);
+}
+
+int
+main()
+{
+    co_init();
+    co_thread_assimilate();
+    co_migrate(&co_group_coop);
+
+    struct ofl_stats_columns cols;
+    ofl_stats_columns_init(&cols, OFPMP_FLOW);
+    append("flow part 1", &cols, *make_flow_reply(1, 1, 3, true));
+    append("flow part 2", &cols, *make_flow_reply(1, 4, 2, false));
+    print_flows("flows", &cols);
+
+    /* A malformed part leaves the entries of earlier parts alone. */
+    std::auto_ptr<Buffer> bad(make_flow_reply(1, 6, 2, false));
+    struct ofp_flow_stats *second = (struct ofp_flow_stats *)
+        (bad->data() + sizeof(struct ofp_multipart_reply)
+         + ntohs(((struct ofp_flow_stats *)
+                  (bad->data() + sizeof(struct ofp_multipart_reply)))->length));
+    second->table_id = 0xff;
+    append("bad table", &cols, *bad);
+    append("port reply", &cols, *make_port_reply(1, 1, 1, false));
+    std::auto_ptr<Buffer> truncated(make_flow_reply(1, 6, 1, false));
+    truncated->trim(truncated->size() - 8);
+    truncated->at<struct ofp_header>(0).length = htons(truncated->size());
+    append("truncated", &cols, *truncated);
+
+    ofl_stats_columns_clear(&cols);
+    append("cleared", &cols, *make_flow_reply(1, 9, 1, false));
+    print_flows("reused", &cols);
+    ofl_stats_columns_destroy(&cols);
+
+    ofl_stats_columns_init(&cols, OFPMP_PORT_STATS);
+    append("port part 1", &cols, *make_port_reply(1, 1, 2, true));
+    append("port part 2", &cols, *make_port_reply(1, 3, 2, false));
+    print_ports("ports", &cols);
+    std::auto_ptr<Buffer> bad_port(make_port_reply(1, 0, 1, false));
+    append("port 0", &cols, *bad_port);
+    ofl_stats_columns_destroy(&cols);
+
+    /* Parts of replies from different switches may arrive interleaved. */
+    boost::shared_ptr<Ofp_msg_arenas> arenas(new Ofp_msg_arenas);
+    Stats_collector sc(OFPMP_PORT_STATS);
+    printf("dp1 part 1: %s\n", collect(sc, 1, make_port_reply(7, 1, 2, true),
+                                       arenas) ? "done" : "pending");
+    printf("dp2 part 1: %s\n", collect(sc, 2, make_port_reply(7, 10, 1, true),
+                                       arenas) ? "done" : "pending");
+    print_ports("dp1 done", collect(sc, 1, make_port_reply(7, 3, 1, false),
+                                    arenas));
+    print_ports("dp2 done", collect(sc, 2, make_port_reply(7, 11, 1, false),
+                                    arenas));
+
+    /* forget() drops the parts received so far. */
+    collect(sc, 3, make_port_reply(8, 1, 2, true), arenas);
+    sc.forget(datapathid::from_host(3));
+    print_ports("dp3 after forget",
+                collect(sc, 3, make_port_reply(8, 5, 1, false), arenas));
+
+    try {
+        collect(sc, 1, make_port_reply(9, 1, 1, true), arenas);
+        collect(sc, 1, make_port_reply(9, 0, 1, false), arenas);
+        printf("bad part: accepted\n");
+    } catch (const Bad_ofp_msg& e) {
+        printf("bad part: Bad_ofp_msg code %u\n", ofl_error_code(e.error));
+    }
+    print_ports("after bad part",
+                collect(sc, 1, make_port_reply(9, 2, 1, false), arenas));
+
+    /* Messages that were never packed are packed again first. */
+    struct ofl_port_stats ps;
+    memset(&ps, 0, sizeof ps);
+    ps.port_no = 42;
+    ps.rx_packets = 4242;
+    struct ofl_msg_multipart_reply_port *reply
+        = (struct ofl_msg_multipart_reply_port *) malloc(sizeof *reply);
+    memset(reply, 0, sizeof *reply);
+    reply->header.header.type = OFPT_MULTIPART_REPLY;
+    reply->header.type = OFPMP_PORT_STATS;
+    reply->stats_num = 1;
+    reply->stats = (struct ofl_port_stats **) malloc(sizeof *reply->stats);
+    reply->stats[0] = (struct ofl_port_stats *) malloc(sizeof ps);
+    *reply->stats[0] = ps;
+    std::auto_ptr<Ofp_msg_event> e(Ofp_msg_event::create_event(
+        datapathid::from_host(4), 5, Ofp_msg::create(&reply->header.header)));
+    print_ports("decoded", sc.add(*e));
+
+    /* A message that cannot be packed again is rejected like a bad part. */
+    struct ofl_msg_multipart_reply_header *exp
+        = (struct ofl_msg_multipart_reply_header *) malloc(sizeof *exp);
+    memset(exp, 0, sizeof *exp);
+    exp->header.type = OFPT_MULTIPART_REPLY;
+    exp->type = OFPMP_EXPERIMENTER;
+    e.reset(Ofp_msg_event::create_event(
+        datapathid::from_host(4), 6, Ofp_msg::create(&exp->header)));
+    try {
+        sc.add(*e);
+        printf("unpackable: accepted\n");
+    } catch (const Bad_ofp_msg& e) {
+        printf("unpackable: Bad_ofp_msg\n");
+    }
+    return 0;
+}
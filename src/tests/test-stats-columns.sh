@@ -0,0 +1,44 @@
+#! /bin/sh -e
+trap 'rm -f tmp$$' 0
+$SUPERVISOR ./test-stats-columns > tmp$$
+diff -u - tmp$$ <<EOF
+flow part 1: 3 entries, more
+flow part 2: 5 entries, last
+flows: 5 flows
+  table 1, prio 101, idle 30, dur 10, cookie 1000000001, packets 1000, bytes 64000, oxm{in_port="1", eth_type=0x"800", ipv4_dst="10.0.0.1"}
+  table 2, prio 102, idle 30, dur 20, cookie 1000000002, packets 2000, bytes 128000, oxm{in_port="2"}
+  table 0, prio 103, idle 30, dur 30, cookie 1000000003, packets 3000, bytes 192000, oxm{in_port="3", eth_type=0x"800", ipv4_dst="10.0.0.3"}
+  table 1, prio 104, idle 30, dur 40, cookie 1000000004, packets 4000, bytes 256000, oxm{in_port="4"}
+  table 2, prio 105, idle 30, dur 50, cookie 1000000005, packets 5000, bytes 320000, oxm{in_port="5", eth_type=0x"800", ipv4_dst="10.0.0.5"}
+bad table: error type 1 code 9, 5 entries
+port reply: error type 1 code 2, 5 entries
+truncated: error type 1 code 6, 5 entries
+cleared: 1 entries, last
+reused: 1 flows
+  table 0, prio 109, idle 30, dur 90, cookie 1000000009, packets 9000, bytes 576000, oxm{in_port="9", eth_type=0x"800", ipv4_dst="10.0.0.9"}
+port part 1: 2 entries, more
+port part 2: 4 entries, last
+ports: 4 ports
+  port 1, rx_packets 11, tx_bytes 2200, collisions 0, duration_nsec 500
+  port 2, rx_packets 22, tx_bytes 4400, collisions 1, duration_nsec 500
+  port 3, rx_packets 33, tx_bytes 6600, collisions 0, duration_nsec 500
+  port 4, rx_packets 44, tx_bytes 8800, collisions 1, duration_nsec 500
+port 0: error type 2 code 6, 4 entries
+dp1 part 1: pending
+dp2 part 1: pending
+dp1 done: 3 ports
+  port 1, rx_packets 11, tx_bytes 2200, collisions 0, duration_nsec 500
+  port 2, rx_packets 22, tx_bytes 4400, collisions 1, duration_nsec 500
+  port 3, rx_packets 33, tx_bytes 6600, collisions 0, duration_nsec 500
+dp2 done: 2 ports
+  port 10, rx_packets 110, tx_bytes 22000, collisions 0, duration_nsec 500
+  port 11, rx_packets 121, tx_bytes 24200, collisions 0, duration_nsec 500
+dp3 after forget: 1 ports
+  port 5, rx_packets 55, tx_bytes 11000, collisions 0, duration_nsec 500
+bad part: Bad_ofp_msg code 6
+after bad part: 1 ports
+  port 2, rx_packets 22, tx_bytes 4400, collisions 0, duration_nsec 500
+decoded: 1 ports
+  port 42, rx_packets 4242, tx_bytes 0, collisions 0, duration_nsec 0
+unpackable: Bad_ofp_msg
+EOF